@@ -0,0 +1,67 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include "AttitudeIntegrator.h"
+
+/******************************************************************************
+*                                                                             *
+*                         AttitudeIntegrator::advance                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The rotational state to advance in place.                         *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Euler's equations, I w' = torque - w x (I w), give the change in spin.     *
+*  The body turns about the midpoint spin w by the quaternion                 *
+*  (cos(|w| dt / 2), sin(|w| dt / 2) w / |w|), applied in the body's frame,   *
+*  and is renormalized to stop rounding from accumulating. The loop has no    *
+*  branches other than the guard against a zero spin.                         *
+*                                                                             *
+*******************************************************************************/
+void AttitudeIntegrator::advance(AttitudeState& state, const GLfloat dt)
+{
+	GLuint n = state.orientations.size();
+
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		glm::quat* q = state.orientations.data();
+		glm::vec3* w = state.spins.data();
+		glm::vec3* t = state.torques.data();
+		glm::vec3* I = state.inertia.data();
+
+		for (GLuint i = begin; i < end; i++)
+		{
+			/* Midpoint rule for the spin. */
+			glm::vec3 rate = (t[i] - glm::cross(w[i], I[i] * w[i])) / I[i];
+			glm::vec3 half = w[i] + (0.5f * dt) * rate;
+			rate = (t[i] - glm::cross(half, I[i] * half)) / I[i];
+			w[i] += dt * rate;
+
+			/* Exact rotation by the midpoint spin. */
+			GLfloat speed = glm::length(half);
+			GLfloat angle = 0.5f * speed * dt;
+			GLfloat sinc  = (speed > 0) ? sin(angle) / speed : 0.5f * dt;
+			glm::quat turn(cos(angle), sinc * half.x, sinc * half.y, sinc * half.z);
+
+			q[i] = glm::normalize(q[i] * turn);
+		}
+	};
+
+	if (pool != nullptr && n >= ATTITUDE_PARALLEL_BODIES)
+		pool->parallelFor(n, task);
+	else
+		task(0, n);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  <glm\gtc\quaternion.hpp>
+#include  "WorkerPool.h"
+#include  "MortonOrder.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Fewest bodies for which the attitude update is split across threads. */
+#define   ATTITUDE_PARALLEL_BODIES          4096
+
+/******************************************************************************
+*                                                                             *
+*                            AttitudeState (struct)                           *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  orientations                                                               *
+*          Unit quaternion taking every body's frame to world space.          *
+*  spins                                                                      *
+*          RADIANS / SECOND                                                   *
+*          Angular velocity of every body, in its own frame.                  *
+*  torques                                                                    *
+*          Torque on every body, in its own frame, divided by its mass.       *
+*  inertia                                                                    *
+*          Principal moments of inertia of every body, divided by its mass.   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Structure-of-arrays rotational state of a system. Bodies spinning about    *
+*  their own y axis with no torque (every planet loaded from a file) keep a   *
+*  constant spin, so only the orientations change.                            *
+*                                                                             *
+*******************************************************************************/
+struct AttitudeState
+{
+	std::vector<glm::quat> orientations;
+	std::vector<glm::vec3> spins;
+	std::vector<glm::vec3> torques;
+	std::vector<glm::vec3> inertia;
+
+	/* Append a body with the given orientation and spin. */
+	void add(const glm::quat& orientation, const glm::vec3& spin)
+	{
+		orientations.push_back(orientation);
+		spins.push_back(spin);
+		torques.push_back(glm::vec3(0.0f));
+		inertia.push_back(glm::vec3(1.0f));
+	}
+
+	/* Remove body i by moving the last body into its place. */
+	void swapRemove(GLuint i)
+	{
+		GLuint last = orientations.size() - 1;
+		orientations[i] = orientations[last];
+		spins[i]        = spins[last];
+		torques[i]      = torques[last];
+		inertia[i]      = inertia[last];
+		orientations.pop_back();
+		spins.pop_back();
+		torques.pop_back();
+		inertia.pop_back();
+	}
+
+	/* Make room for n bodies. */
+	void reserve(GLuint n)
+	{
+		orientations.reserve(n);
+		spins.reserve(n);
+		torques.reserve(n);
+		inertia.reserve(n);
+	}
+
+	/* Rearrange the bodies so that body i is the old body order[i]. */
+	void reorder(const std::vector<GLuint>& order)
+	{
+		MortonOrder::apply(orientations, order);
+		MortonOrder::apply(spins, order);
+		MortonOrder::apply(torques, order);
+		MortonOrder::apply(inertia, order);
+	}
+};
+
+/******************************************************************************
+ *																			  *
+ *                          AttitudeIntegrator Class                          *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  pool                                                                      *
+ *          Optional worker pool used to split large systems by body.         *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Advances every orientation of an AttitudeState together. The spins are    *
+ *  advanced by Euler's equations with the midpoint rule, and each            *
+ *  orientation is turned by the exact rotation of the midpoint spin over     *
+ *  the step, so a free symmetric body spins at exactly its rate however      *
+ *  long the step. No matrices are built: transformation matrices are made    *
+ *  from the orientations only when a frame is drawn.                         *
+ *                                                                            *
+ ******************************************************************************/
+class AttitudeIntegrator
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   AttitudeIntegrator(WorkerPool* pool = nullptr) :
+	                       pool(pool)                                      {}
+
+	/* Advance every body's spin and orientation by dt. */
+	void               advance      (      AttitudeState&          state,
+	                                 const GLfloat                 dt       );
+
+	/* Getters. */
+	WorkerPool*        getWorkerPool()     const  {  return pool;            }
+
+	/* Setters. */
+	void               setWorkerPool(WorkerPool* p)  {  pool = p;            }
+
+	/* Destructor. */
+	                  ~AttitudeIntegrator()                                {}
+
+/* Private Members. */
+private:
+
+	/* Optional worker pool. */
+	WorkerPool*        pool;
+};
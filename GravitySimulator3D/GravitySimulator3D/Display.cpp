@@ -9,6 +9,7 @@
 #include <glm\gtx\transform.hpp>
 #include <SDL\SDL_video.h>
 #include <iostream>
+#include <algorithm>
 #include "Display.h"
 #include "Geometry.h"
 
@@ -64,6 +65,9 @@ Display::Display(std::string title, GLushort width, GLushort height)
 
 	/* Show the version of GLEW currently being used. */
 	fprintf(stdout, "Stats: Using GLEW %s\n", glewGetString(GLEW_VERSION));
+
+	/* Generate the buffer for the per-instance matrices. */
+	glGenBuffers(1, &instanceBufferID);
 	
 	/* Update the viewport. */
 	updateViewport();
@@ -168,14 +172,10 @@ void Display::updateViewport()
 *                                                                             *
 *******************************************************************************
 * PARAMETERS                                                                  *
-*  @param red                                                                 *
-*           The amount of red to be painted on the color buffer (0.0 - 1.0)   *
-*  @param green                                                               *
-*           The amount of green to be painted on the color buffer (0.0 - 1.0) *
-*  @param blue                                                                *
-*           The amount of blue to be painted on the color buffer (0.0 - 1.0)  *
-*  @param alpha                                                               *
-*           The opaqueness of the color buffer.                               *
+*  @param meshes                                                              *
+*           The meshes to be drawn.                                           *
+*  @param modelToWorldMatrices                                                *
+*           The model to world transformation of each mesh, in the same order *
 *                                                                             *
 *******************************************************************************
 * RETURNS                                                                     *
@@ -183,8 +183,10 @@ void Display::updateViewport()
 *                                                                             *
 *******************************************************************************
 * DESCRIPTION                                                                 *
-*  Function which clears the window by changing all of the pixels to the      *
-*  specified color and opacity.                                               *
+*  Function which clears the window and draws the meshes from the camera's    *
+*  perspective. The meshes are sorted into batches sharing a vertex array,    *
+*  index count, draw mode and texture. The matrices of every batch are sent   *
+*  down in a single buffer, and each batch is drawn with one instanced call.  *
 *                                                                             *
 *******************************************************************************/
 void Display::repaint(std::vector<Mesh*> meshes,
@@ -198,41 +200,86 @@ void Display::repaint(std::vector<Mesh*> meshes,
 
 	glEnable(GL_DEPTH_TEST);
 
-	/* Draw 3-D space. */
+	/* Meshes drawing the same data with the same texture form a batch. */
+	auto sameBatch = [&](GLuint a, GLuint b) -> bool
+	{
+		return meshes.at(a)->getVertexArrayID() == meshes.at(b)->getVertexArrayID() &&
+		       meshes.at(a)->getTextureID()     == meshes.at(b)->getTextureID()     &&
+		       meshes.at(a)->getNumIndices()    == meshes.at(b)->getNumIndices()    &&
+		       meshes.at(a)->getDrawMode()      == meshes.at(b)->getDrawMode();
+	};
+	auto batchLess = [&](GLuint a, GLuint b) -> bool
+	{
+		const Mesh* m = meshes.at(a);
+		const Mesh* n = meshes.at(b);
+		if (m->getVertexArrayID() != n->getVertexArrayID())
+			return m->getVertexArrayID() < n->getVertexArrayID();
+		if (m->getTextureID() != n->getTextureID())
+			return m->getTextureID() < n->getTextureID();
+		if (m->getNumIndices() != n->getNumIndices())
+			return m->getNumIndices() < n->getNumIndices();
+		return m->getDrawMode() < n->getDrawMode();
+	};
+
+	/* Sort the meshes into batches, keeping their order within each. */
+	drawOrder.resize(meshes.size());
 	for (GLuint i = 0; i < meshes.size(); i++)
+		drawOrder[i] = i;
+	std::stable_sort(drawOrder.begin(), drawOrder.end(), batchLess);
+
+	/* Send every matrix down at once, in batch order. */
+	instanceMatrices.resize(meshes.size());
+	for (GLuint i = 0; i < drawOrder.size(); i++)
+		instanceMatrices[i] = *(modelToWorldMatrices.at(drawOrder[i]));
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBufferID);
+	glBufferData(GL_ARRAY_BUFFER, instanceMatrices.size() * sizeof(glm::mat4),
+		instanceMatrices.empty() ? NULL : &instanceMatrices[0], GL_STREAM_DRAW);
+
+	/* Generate the World -> Proj. transformation, shared by every batch. */
+	worldToProjectionMatrix = 
+		viewToProjectionMatrix *           // View  -> Proj.
+		camera.getWorldToViewMatrix();     // World -> View 
+	glUniformMatrix4fv(worldToProjectionUniformLocation, 1, GL_FALSE,
+		&worldToProjectionMatrix[0][0]);
+
+	/* Set the active Texture. */
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(textureUniformLocation, 0);
+
+	/* Draw 3-D space, one batch at a time. */
+	for (GLuint first = 0, last; first < drawOrder.size(); first = last)
 	{
-		/* Generate the Model -> Proj. transformation. */
-		modelToProjectionMatrix = 
-			viewToProjectionMatrix *           // View  -> Proj.
-            camera.getWorldToViewMatrix() *	   // World -> View 
-            *(modelToWorldMatrices.at(i));     // Model -> World
+		/* Find the end of this batch. */
+		for (last = first + 1; last < drawOrder.size() &&
+		     sameBatch(drawOrder[first], drawOrder[last]); last++);
+		Mesh* mesh = meshes.at(drawOrder[first]);
 
 		/* Bind the appropriate Vertex Array. */
-		glBindVertexArray(meshes.at(i)->getVertexArrayID());
+		glBindVertexArray(mesh->getVertexArrayID());
 
 		/* Bind the appropriate Index Array. */
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshes.at(i)->getBufferIDs()[1]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->getBufferIDs()[1]);
 
 		/* If a texture has been generated, bind the Texture ID. */
-		if (meshes.at(i)->getTextureID() != -1)
-			glBindTexture(GL_TEXTURE_2D, meshes.at(i)->getTextureID());
-
-		/* Set the active Texture. */
-		glActiveTexture(GL_TEXTURE0);
-		glUniform1i(textureUniformLocation, 0);
-
-		/* Send the transformation data down to the buffer. */
-		glUniformMatrix4fv(modelToWorldUniformLocation, 1, GL_FALSE, 
-			 &(*(modelToWorldMatrices.at(i)))[0][0]);
-		glUniformMatrix4fv(modelToProjectionUniformLocation, 1, GL_FALSE,
-			&modelToProjectionMatrix[0][0]);
-
-
-		/* Draw the elements to the window. */
-		glDrawElements(meshes.at(i)->getDrawMode(),      // Draw mode.
-                       meshes.at(i)->getNumIndices(),    // Number of indices
-					   GL_UNSIGNED_SHORT,                // Data type of index
-                       0);                               // Index offset
+		if (mesh->getTextureID() != -1)
+			glBindTexture(GL_TEXTURE_2D, mesh->getTextureID());
+
+		/* Point the instance matrix, one column per location, at this batch. */
+		for (GLuint c = 0; c < 4; c++)
+		{
+			glEnableVertexAttribArray(INSTANCE_MATRIX_LOCATION + c);
+			glVertexAttribPointer(INSTANCE_MATRIX_LOCATION + c, 4, GL_FLOAT,
+				GL_FALSE, sizeof(glm::mat4),
+				(void*) (first * sizeof(glm::mat4) + c * sizeof(glm::vec4)));
+			glVertexAttribDivisor(INSTANCE_MATRIX_LOCATION + c, 1);
+		}
+
+		/* Draw every instance of the batch to the window. */
+		glDrawElementsInstanced(mesh->getDrawMode(),  // Draw mode.
+		                        mesh->getNumIndices(),// Number of indices
+		                        GL_UNSIGNED_SHORT,    // Data type of index
+		                        0,                    // Index offset
+		                        last - first);        // Number of instances
 	}
 
 	/* Swap the double buffer. */
@@ -263,12 +310,9 @@ void Display::setShader(Shader shader)
 	/* Tell OpenGL to use this shader. */
 	shader.use();
 
-	/* Get the location of the fullTransformMatrix uniform variable. */
-	modelToProjectionUniformLocation = glGetUniformLocation(
-		shader.getProgram(), "modelToProjectionMatrix");
-
-	modelToWorldUniformLocation = glGetUniformLocation(
-		shader.getProgram(), "modelToWorldMatrix");
+	/* Get the location of the worldToProjectionMatrix uniform variable. */
+	worldToProjectionUniformLocation = glGetUniformLocation(
+		shader.getProgram(), "worldToProjectionMatrix");
 
 	/* Get the location of the texture sampler uniform variable. */
 	textureUniformLocation = glGetUniformLocation(
@@ -312,6 +356,9 @@ void Display::setShader(Shader shader)
 *******************************************************************************/
 Display::~Display()
 {
+	/* Delete the instance buffer. */
+	glDeleteBuffers(1, &instanceBufferID);
+
 	/* Delete the GL context. */
 	SDL_GL_DeleteContext(context);
 
@@ -29,6 +29,8 @@
 /* Default vertex and fragment shader source files. */
 #define  DEFAULT_VERTEX_SHADER    "res/shaders/shader.vs"
 #define  DEFAULT_FRAGMENT_SHADER  "res/shaders/shader.fs"
+/* First of the four attribute locations holding the per-instance matrix. */
+#define  INSTANCE_MATRIX_LOCATION 4
 
 /******************************************************************************
  *																			  *
@@ -68,20 +70,31 @@ enum class Dimension
  *          drawn.                                                            *
  *  camera                                                                    *
  *          Camera instance whose perspective this display shows.             *
- *  modelToProjectionMatrix                                                   *
- *          4-D matrix representing the total transformation to the display.  *
+ *  worldToProjectionMatrix                                                   *
+ *          4-D matrix representing the transformation from the world to the  *
+ *          display, shared by every mesh drawn in a frame.                   *
  *  viewToProjectionMatrix                                                    *
  *          4-D matrix representing the transformation from the view to the   *
  *          projection (camera view).                                         *
- *  modelToProjectionUniformLocation                                          *
- *          ID  of the location for the modelToProjectionMatrix in the shader *
+ *  worldToProjectionUniformLocation                                          *
+ *          ID  of the location for the worldToProjectionMatrix in the shader *
  *          program.                                                          *
  *  textureUniformLocation                                                    *
  *          ID  of the location for the texture sampler in the shader program *
+ *  instanceBufferID                                                          *
+ *          ID of the buffer holding the model to world matrix of every mesh  *
+ *          drawn in a frame, grouped by batch.                               *
+ *  drawOrder, instanceMatrices                                               *
+ *          Meshes of a frame sorted into batches, and their matrices in the  *
+ *          same order (kept between frames to avoid reallocating).           *
  *                                                                            *
  ******************************************************************************
  * DESCRIPTION                                                                *
  *  Class representing the window in which the OpenGL context may render.     *
+ *  Meshes drawing the same vertex array with the same texture form a batch,  *
+ *  which is drawn with one instanced call, each instance reading its model   *
+ *  matrix from the instance buffer. Bodies sharing a shape therefore cost    *
+ *  one draw call per batch rather than one each.                             *
  *                                                                            *
  ******************************************************************************/
 class Display
@@ -131,19 +144,22 @@ private:
 	SDL_GLContext  context;
 	/* Camera for looking at the world. */
 	Camera         camera;
-	/* Model to Projection (complete) matrix. */
-	glm::mat4      modelToProjectionMatrix;
+	/* World to Projection matrix. */
+	glm::mat4      worldToProjectionMatrix;
 	/* View to Projection matrix. */
 	glm::mat4      viewToProjectionMatrix;
-	/* Uniform location for the full transformation. */
-	GLuint         modelToProjectionUniformLocation;
+	/* Uniform location for the world to projection transformation. */
+	GLuint         worldToProjectionUniformLocation;
 	/* Uniform location for the texture. */
 	GLuint         textureUniformLocation;
 	/* Uniform location for the light source. */
 	GLuint         lightSourceUniformLocation;
 	/* Uniform location for the ambient light. */
 	GLuint         ambientLightUniformLocation;
-	/* Uniform location for the model to world transformation.*/
-	GLuint         modelToWorldUniformLocation;
+	/* Buffer of the per-instance model to world matrices. */
+	GLuint         instanceBufferID;
+	/* Mesh indices sorted into batches, and their matrices in that order. */
+	std::vector<GLuint>    drawOrder;
+	std::vector<glm::mat4> instanceMatrices;
 
 };
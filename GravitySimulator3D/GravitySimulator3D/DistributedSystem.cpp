@@ -0,0 +1,510 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "DistributedSystem.h"
+#include "MortonOrder.h"
+
+/******************************************************************************
+*                                                                             *
+*                               Local Helpers                                 *
+*                                                                             *
+******************************************************************************/
+/* Append count values to a message. */
+template <typename T>
+static void pack(std::vector<char>& out, const T* data, size_t count)
+{
+	size_t at = out.size();
+	out.resize(at + count * sizeof(T));
+	if (count > 0)
+		memcpy(&out[at], data, count * sizeof(T));
+}
+
+/* Read count values from a message, returning the position after them. */
+template <typename T>
+static const char* unpack(const char* in, T* data, size_t count)
+{
+	if (count > 0)
+		memcpy(data, in, count * sizeof(T));
+	return in + count * sizeof(T);
+}
+
+/******************************************************************************
+*                                                                             *
+*               DistributedSystem::DistributedSystem (Constructor)            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param transport                                                           *
+*           Link to the other processes of the run.                           *
+*  @param pool                                                                *
+*           Optional worker pool for the local force sums.                    *
+*  @param openingAngle                                                        *
+*           Largest size over distance of a domain seen as a point mass.      *
+*  @param repartitionInterval                                                 *
+*           Number of steps between repartitions (0 never).                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the DistributedSystem class. No bodies are owned until     *
+*  distribute is called.                                                      *
+*                                                                             *
+*******************************************************************************/
+DistributedSystem::DistributedSystem(Transport* transport, WorkerPool* pool,
+                                     GLfloat openingAngle,
+                                     GLuint repartitionInterval) :
+	transport(transport), pool(pool), openingAngle(openingAngle),
+	repartitionInterval(repartitionInterval), steps(0), numBodies(0),
+	exchangeMillis(0), forceMillis(0), haveStart(false)
+{
+	local.G = 0;
+	local.t = 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                        DistributedSystem::distribute                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param all                                                                 *
+*           State of the whole system, identical on every process.            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Every process sorts the same bodies the same way along the Morton curve    *
+*  and keeps its own run of it, so the split needs no communication.          *
+*                                                                             *
+*******************************************************************************/
+void DistributedSystem::distribute(const NBodyState& all)
+{
+	GLuint rank = transport->getRank();
+	GLuint size = transport->getSize();
+
+	std::vector<GLuint> order;
+	MortonOrder::sort(all.positions, pool, order);
+
+	numBodies = all.positions.size();
+	GLuint first = (GLuint) ((unsigned long long) numBodies * rank / size);
+	GLuint last  = (GLuint) ((unsigned long long) numBodies * (rank + 1) / size);
+
+	local.positions.clear();
+	local.velocities.clear();
+	local.masses.clear();
+	ids.clear();
+	for (GLuint k = first; k < last; k++)
+	{
+		GLuint i = order[k];
+		local.positions.push_back(all.positions[i]);
+		local.velocities.push_back(all.velocities[i]);
+		local.masses.push_back(all.masses[i]);
+		ids.push_back(i);
+	}
+	local.G   = all.G;
+	local.t   = all.t;
+	haveStart = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           DistributedSystem::step                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the communication failed.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Classical fourth order Runge-Kutta on the owned bodies, the same stages as *
+*  NBodyIntegrator::rungeKutta. Every stage is one distributed force          *
+*  evaluation; the one at the end of the step starts the next.                *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::step(const GLfloat dt)
+{
+	if (repartitionInterval > 0 && steps > 0 && steps % repartitionInterval == 0)
+		if (!repartition())
+			return false;
+
+	GLuint n = local.positions.size();
+
+	/* Stage 1: k = (v, a(r)). */
+	if (!haveStart && !accelerations(local.positions, startAccel))
+		return false;
+	stageVelocities = local.velocities;
+	stageAccel      = startAccel;
+	sumPositions    = stageVelocities;
+	sumVelocities   = stageAccel;
+	stagePositions.resize(n);
+
+	/* Stages 2 - 4. */
+	for (GLuint stage = 2; stage <= 4; stage++)
+	{
+		GLfloat c = (stage < 4) ? 0.5f * dt : dt;
+		GLfloat w = (stage < 4) ? 2.0f      : 1.0f;
+
+		for (GLuint i = 0; i < n; i++)
+		{
+			stagePositions[i]  = local.positions[i]  + c * stageVelocities[i];
+			stageVelocities[i] = local.velocities[i] + c * stageAccel[i];
+		}
+
+		if (!accelerations(stagePositions, stageAccel))
+			return false;
+
+		for (GLuint i = 0; i < n; i++)
+		{
+			sumPositions[i]  += w * stageVelocities[i];
+			sumVelocities[i] += w * stageAccel[i];
+		}
+	}
+
+	/* Combine the stages. */
+	GLfloat c = dt / 6.0f;
+	for (GLuint i = 0; i < n; i++)
+	{
+		local.positions[i]  += c * sumPositions[i];
+		local.velocities[i] += c * sumVelocities[i];
+	}
+	local.t += dt;
+	steps++;
+
+	/* Acceleration at the end of the step (the start of the next). */
+	haveStart = accelerations(local.positions, startAccel);
+	return haveStart;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          DistributedSystem::gather                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param all                                                                 *
+*           Output state of the whole system.                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the communication failed.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Every process sends its bodies, with their indices, to every other. This   *
+*  holds the whole system in every process for a moment, so it is for output  *
+*  and repartitioning rather than for every step.                             *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::gather(NBodyState& all)
+{
+	GLuint            count = ids.size();
+	std::vector<char> mine;
+	pack(mine, &count, 1);
+	pack(mine, ids.data(), count);
+	pack(mine, local.positions.data(), count);
+	pack(mine, local.velocities.data(), count);
+	pack(mine, local.masses.data(), count);
+
+	std::vector<std::vector<char> > blocks;
+	if (!allGather(mine, blocks))
+		return false;
+
+	all.positions.resize(numBodies);
+	all.velocities.resize(numBodies);
+	all.masses.resize(numBodies);
+	for (const std::vector<char>& block : blocks)
+	{
+		const char* in = unpack(block.data(), &count, 1);
+		std::vector<GLuint>    blockIds(count);
+		std::vector<glm::vec3> positions(count);
+		std::vector<glm::vec3> velocities(count);
+		std::vector<GLfloat>   masses(count);
+		in = unpack(in, blockIds.data(), count);
+		in = unpack(in, positions.data(), count);
+		in = unpack(in, velocities.data(), count);
+		in = unpack(in, masses.data(), count);
+
+		for (GLuint k = 0; k < count; k++)
+		{
+			all.positions[blockIds[k]]  = positions[k];
+			all.velocities[blockIds[k]] = velocities[k];
+			all.masses[blockIds[k]]     = masses[k];
+		}
+	}
+	all.G = local.G;
+	all.t = local.t;
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       DistributedSystem::repartition                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the communication failed.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gathers the bodies and splits them again along the curve, so the domains   *
+*  stay compact and equal as the bodies move.                                 *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::repartition()
+{
+	NBodyState all;
+	if (!gather(all))
+		return false;
+
+	distribute(all);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       DistributedSystem::accelerations                      *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param positions                                                           *
+*           Positions of the owned bodies.                                    *
+*  @param out                                                                 *
+*           Output acceleration of every owned body.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the communication failed.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gathers the remote sources, then sums the owned bodies and the remote      *
+*  sources on every owned body, split across the pool for large shares.       *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::accelerations(const std::vector<glm::vec3>& positions,
+                                      std::vector<glm::vec3>& out)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	if (!exchangeSources(positions))
+		return false;
+
+	Clock::time_point exchanged = Clock::now();
+
+	GLuint  n     = positions.size();
+	GLuint  m     = ghostPositions.size();
+	GLfloat G     = local.G;
+	out.resize(n);
+
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin; i < end; i++)
+		{
+			glm::vec3 net(0);
+			for (GLuint j = 0; j < n; j++)
+			{
+				if (j == i || local.masses[j] == 0)
+					continue;
+
+				glm::vec3 d  = positions[j] - positions[i];
+				GLfloat   r2 = glm::dot(d, d);
+				if (r2 == 0)
+					continue;
+				GLfloat   r  = sqrt(r2);
+				net += (G * local.masses[j] / (r2 * r)) * d;
+			}
+			for (GLuint j = 0; j < m; j++)
+			{
+				glm::vec3 d  = ghostPositions[j] - positions[i];
+				GLfloat   r2 = glm::dot(d, d);
+				if (r2 == 0)
+					continue;
+				GLfloat   r  = sqrt(r2);
+				net += (G * ghostMasses[j] / (r2 * r)) * d;
+			}
+			out[i] = net;
+		}
+	};
+
+	if (pool != nullptr && n >= PARALLEL_MIN_BODIES)
+		pool->parallelFor(n, task);
+	else
+		task(0, n);
+
+	std::chrono::duration<GLdouble, std::milli> exchange = exchanged - start;
+	std::chrono::duration<GLdouble, std::milli> sum      = Clock::now() - exchanged;
+	exchangeMillis += exchange.count();
+	forceMillis    += sum.count();
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      DistributedSystem::exchangeSources                     *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param positions                                                           *
+*           Positions of the owned bodies.                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the communication failed.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Two rounds. In the first every process shares the summary of its domain.   *
+*  In the second each sends its bodies to the processes which are near it,    *
+*  and nothing to the rest; a far domain becomes a single source at its       *
+*  center of mass. Afterwards ghostPositions and ghostMasses hold every       *
+*  remote source.                                                             *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::exchangeSources(const std::vector<glm::vec3>& positions)
+{
+	GLuint rank = transport->getRank();
+	GLuint size = transport->getSize();
+	GLuint n    = positions.size();
+
+	/* Summary of this domain. */
+	DomainSummary mine = { glm::vec3(0), glm::vec3(0), glm::vec3(0), 0, n };
+	if (n > 0)
+	{
+		mine.lo = mine.hi = positions[0];
+		for (GLuint i = 0; i < n; i++)
+		{
+			mine.lo      = glm::min(mine.lo, positions[i]);
+			mine.hi      = glm::max(mine.hi, positions[i]);
+			mine.center += local.masses[i] * positions[i];
+			mine.mass   += local.masses[i];
+		}
+		mine.center = (mine.mass > 0) ? mine.center / mine.mass
+		                              : 0.5f * (mine.lo + mine.hi);
+	}
+
+	std::vector<char> summary;
+	pack(summary, &mine, 1);
+	std::vector<std::vector<char> > summaries;
+	if (!allGather(summary, summaries))
+		return false;
+
+	domains.resize(size);
+	for (GLuint r = 0; r < size; r++)
+		unpack(summaries[r].data(), &domains[r], 1);
+
+	/* Bodies to the near domains only. */
+	std::vector<std::vector<char> > outgoing(size);
+	std::vector<std::vector<char> > incoming;
+	for (GLuint r = 0; r < size; r++)
+	{
+		if (r == rank || !isNear(domains[r], domains[rank]))
+			continue;
+		pack(outgoing[r], positions.data(), n);
+		pack(outgoing[r], local.masses.data(), n);
+	}
+	if (!transport->exchange(outgoing, incoming))
+		return false;
+
+	ghostPositions.clear();
+	ghostMasses.clear();
+	for (GLuint r = 0; r < size; r++)
+	{
+		if (r == rank)
+			continue;
+
+		const DomainSummary& other = domains[r];
+		if (isNear(domains[rank], other))
+		{
+			GLuint count = other.count;
+			GLuint at    = ghostPositions.size();
+			ghostPositions.resize(at + count);
+			ghostMasses.resize(at + count);
+			const char* in = unpack(incoming[r].data(), &ghostPositions[at], count);
+			unpack(in, &ghostMasses[at], count);
+		}
+		else if (other.mass > 0)
+		{
+			ghostPositions.push_back(other.center);
+			ghostMasses.push_back(other.mass);
+		}
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          DistributedSystem::isNear                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param a                                                                   *
+*           The domain feeling the force.                                     *
+*  @param b                                                                   *
+*           The domain exerting it.                                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if a needs the bodies of b: the largest side of b is at least         *
+*  openingAngle times the gap between the two boxes. The gap, not the         *
+*  distance between centers, is used so that no body of a is ever closer to   *
+*  b than the test assumed.                                                   *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::isNear(const DomainSummary& a, const DomainSummary& b) const
+{
+	if (a.count == 0 || b.count == 0)
+		return false;
+	if (openingAngle <= 0)
+		return true;
+
+	glm::vec3 gap  = glm::max(glm::vec3(0), glm::max(a.lo - b.hi, b.lo - a.hi));
+	glm::vec3 side = b.hi - b.lo;
+	GLfloat   size = std::max(side.x, std::max(side.y, side.z));
+	return size >= openingAngle * glm::length(gap);
+}
+
+/******************************************************************************
+*                                                                             *
+*                        DistributedSystem::allGather                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param mine                                                                *
+*           This process's contribution.                                      *
+*  @param all                                                                 *
+*           Output contribution of every process, in rank order.              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the communication failed.                                         *
+*                                                                             *
+*******************************************************************************/
+bool DistributedSystem::allGather(const std::vector<char>& mine,
+                                  std::vector<std::vector<char> >& all)
+{
+	std::vector<std::vector<char> > outgoing(transport->getSize(), mine);
+	return transport->exchange(outgoing, all);
+}
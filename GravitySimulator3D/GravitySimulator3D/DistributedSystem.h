@@ -0,0 +1,182 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "NBodyIntegrator.h"
+#include  "SocketTransport.h"
+#include  "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default size over distance below which a domain is seen as one point. */
+#define   DISTRIBUTED_OPENING_ANGLE         0.5f
+/* Default number of steps between repartitions of the bodies. */
+#define   DISTRIBUTED_REPARTITION_STEPS       64
+
+/******************************************************************************
+*                                                                             *
+*                            DomainSummary (struct)                           *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  lo, hi                                                                     *
+*          Corners of the bounding box of the domain's bodies.                *
+*  center                                                                     *
+*          Center of mass of the domain.                                      *
+*  mass                                                                       *
+*          Total mass of the domain.                                          *
+*  count                                                                      *
+*          Number of bodies in the domain.                                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  What every process knows of every other process's bodies.                  *
+*                                                                             *
+*******************************************************************************/
+struct DomainSummary
+{
+	glm::vec3 lo;
+	glm::vec3 hi;
+	glm::vec3 center;
+	GLfloat   mass;
+	GLuint    count;
+};
+
+/******************************************************************************
+ *																			  *
+ *                          DistributedSystem Class                           *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  transport                                                                 *
+ *          Link to the other processes of the run.                           *
+ *  pool                                                                      *
+ *          Optional worker pool for the local force sums.                    *
+ *  openingAngle                                                              *
+ *          A remote domain whose box size over its distance is below this    *
+ *          acts as a point mass (0 always sends the bodies, which is exact). *
+ *  repartitionInterval, steps                                                *
+ *          Steps between repartitions (0 never), and steps taken.            *
+ *  local, ids                                                                *
+ *          State of the bodies owned by this process, and the index of each  *
+ *          in the whole system.                                              *
+ *  numBodies                                                                 *
+ *          Number of bodies in the whole system.                             *
+ *  domains                                                                   *
+ *          Summary of every process's bodies at the last force evaluation.   *
+ *  ghostPositions, ghostMasses                                               *
+ *          Remote sources at the last force evaluation: the bodies of near   *
+ *          domains and the centers of far ones.                              *
+ *  haveStart, startAccel                                                     *
+ *          Acceleration of the owned bodies at the end of the last step,     *
+ *          which starts the next one unless the bodies were redistributed.   *
+ *  exchangeMillis, forceMillis                                               *
+ *          Wall-clock time spent communicating and summing forces.           *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Runs one system across several processes, each of which holds only its    *
+ *  own share of the bodies. The bodies are split into equal runs along a     *
+ *  Morton curve of their positions, so each process owns a compact region    *
+ *  of space, and they are split again every few steps as they move.          *
+ *                                                                            *
+ *  For every force evaluation the processes first swap a summary of their    *
+ *  domains. Each process then sends its bodies only to the processes it is   *
+ *  near, by the same opening test a tree code uses; the others see the       *
+ *  domain as a point mass at its center of mass. Both ends apply the test    *
+ *  to the same summaries, so no request needs to be sent. Steps are          *
+ *  classical Runge-Kutta, matching NBodyIntegrator::rungeKutta, and every    *
+ *  process must call each method together with the others.                   *
+ *                                                                            *
+ ******************************************************************************/
+class DistributedSystem
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   DistributedSystem(Transport*  transport,
+	                                     WorkerPool* pool                = nullptr,
+	                                     GLfloat     openingAngle        = DISTRIBUTED_OPENING_ANGLE,
+	                                     GLuint      repartitionInterval = DISTRIBUTED_REPARTITION_STEPS);
+
+	/* Take this process's share of a whole state (the same on every process). */
+	void               distribute   (const NBodyState& all);
+
+	/* Advance every body by dt. */
+	bool               step         (const GLfloat     dt);
+
+	/* Collect the whole state, in its original order, on every process. */
+	bool               gather       (      NBodyState& all);
+
+	/* Split the bodies again by their current positions. */
+	bool               repartition  ();
+
+	/* Getters. */
+	const NBodyState&  getLocalState()     const  {  return local;           }
+	const std::vector<GLuint>& getIds()    const  {  return ids;             }
+	GLuint             getNumBodies()      const  {  return numBodies;       }
+	GLuint             getNumGhosts()      const  {  return ghostPositions.size(); }
+	GLfloat            getOpeningAngle()   const  {  return openingAngle;    }
+	GLdouble           getExchangeMillis() const  {  return exchangeMillis;  }
+	GLdouble           getForceMillis()    const  {  return forceMillis;     }
+
+	/* Setters. */
+	void               setOpeningAngle(GLfloat a)  {  openingAngle = a;      }
+	void               setRepartitionInterval(GLuint k) {  repartitionInterval = k; }
+
+	/* Destructor. */
+	                  ~DistributedSystem()                                 {}
+
+/* Private Members. */
+private:
+
+	/* Communication and threads. */
+	Transport*             transport;
+	WorkerPool*            pool;
+	/* Options. */
+	GLfloat                openingAngle;
+	GLuint                 repartitionInterval;
+	GLuint                 steps;
+	/* Owned bodies. */
+	NBodyState             local;
+	std::vector<GLuint>    ids;
+	GLuint                 numBodies;
+	/* Remote sources. */
+	std::vector<DomainSummary> domains;
+	std::vector<glm::vec3> ghostPositions;
+	std::vector<GLfloat>   ghostMasses;
+	/* Statistics. */
+	GLdouble               exchangeMillis;
+	GLdouble               forceMillis;
+	/* Acceleration at the start of the next step, if still valid. */
+	bool                   haveStart;
+	std::vector<glm::vec3> startAccel;
+	/* Scratch space. */
+	std::vector<glm::vec3> stagePositions;
+	std::vector<glm::vec3> stageVelocities;
+	std::vector<glm::vec3> stageAccel;
+	std::vector<glm::vec3> sumPositions;
+	std::vector<glm::vec3> sumVelocities;
+
+	/* Acceleration of every owned body with the owned bodies at positions. */
+	bool               accelerations(const std::vector<glm::vec3>& positions,
+	                                       std::vector<glm::vec3>& out);
+	/* Swap summaries, then bodies with the near domains. */
+	bool               exchangeSources(const std::vector<glm::vec3>& positions);
+	/* Whether domain a must see the bodies of domain b. */
+	bool               isNear       (const DomainSummary& a,
+	                                 const DomainSummary& b) const;
+	/* Send the same buffer to every process. */
+	bool               allGather    (const std::vector<char>&               mine,
+	                                       std::vector<std::vector<char> >& all);
+};
@@ -0,0 +1,159 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <algorithm>
+#include "Ephemeris.h"
+
+/******************************************************************************
+*                                                                             *
+*                       Ephemeris::Ephemeris (Constructor)                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param initial                                                             *
+*           State of the system at the start of the window.                   *
+*  @param duration                                                            *
+*           SECONDS                                                           *
+*           Length of the window to record.                                   *
+*  @param step                                                                *
+*           SECONDS                                                           *
+*           Largest integrator step (and the spacing of the samples).         *
+*  @param pool                                                                *
+*           Optional worker pool for the force evaluations.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Integrates the system over the window with equal Runge-Kutta steps and     *
+*  keeps the position, velocity and acceleration of every body after each     *
+*  step. The accelerations come from the integrator for free.                 *
+*                                                                             *
+*******************************************************************************/
+Ephemeris::Ephemeris(const NBodyState& initial, GLfloat duration,
+                     GLfloat step, WorkerPool* pool) :
+	start(initial.t), G(initial.G), masses(initial.masses)
+{
+	GLuint steps = std::max(1u, (GLuint) ceil(duration / step));
+	this->step   = duration / steps;
+
+	NBodyIntegrator integrator(pool);
+	NBodyState      state = initial;
+
+	positions.reserve(steps + 1);
+	velocities.reserve(steps + 1);
+	accelerations.reserve(steps + 1);
+
+	for (GLuint k = 0; k < steps; k++)
+	{
+		integrator.rungeKutta(state, this->step);
+
+		/* The first step also supplies the acceleration of the first sample. */
+		if (k == 0)
+		{
+			positions.push_back(initial.positions);
+			velocities.push_back(initial.velocities);
+			accelerations.push_back(integrator.getStartAccel());
+		}
+
+		positions.push_back(state.positions);
+		velocities.push_back(state.velocities);
+		accelerations.push_back(integrator.getEndAccel());
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Ephemeris::segment                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param body                                                                *
+*           Index of the body.                                                *
+*  @param t                                                                   *
+*           SECONDS                                                           *
+*           Time of interest.                                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The interpolant of the body over the sample interval containing t.         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Times outside of the window use its first or last interval, where the      *
+*  interpolant clamps them to the end points.                                 *
+*                                                                             *
+*******************************************************************************/
+Interpolant Ephemeris::segment(GLuint body, GLdouble t) const
+{
+	GLint last = (GLint) positions.size() - 2;
+	GLint k    = (GLint) floor((t - start) / step);
+	k = std::max(0, std::min(k, last));
+
+	Interpolant interpolant;
+	interpolant.begin(start + (GLdouble) k * step, positions[k][body],
+	                  velocities[k][body], accelerations[k][body]);
+	interpolant.end(start + (GLdouble) (k + 1) * step, positions[k + 1][body],
+	                velocities[k + 1][body], accelerations[k + 1][body]);
+	return interpolant;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Ephemeris::stateAt                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param body                                                                *
+*           Index of the body.                                                *
+*  @param t                                                                   *
+*           SECONDS                                                           *
+*           Time of interest.                                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The position and velocity of the body at time t.                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Interpolates the recorded samples either side of t.                        *
+*                                                                             *
+*******************************************************************************/
+BodyState Ephemeris::stateAt(GLuint body, GLdouble t) const
+{
+	return segment(body, t).stateAt(t);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Ephemeris::positionsAt                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param t                                                                   *
+*           SECONDS                                                           *
+*           Time of interest.                                                 *
+*  @param out                                                                 *
+*           Output position of every body.                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Interpolates the position of every recorded body at time t.                *
+*                                                                             *
+*******************************************************************************/
+void Ephemeris::positionsAt(GLdouble t, std::vector<glm::vec3>& out) const
+{
+	GLuint n = masses.size();
+	out.resize(n);
+	for (GLuint i = 0; i < n; i++)
+		out[i] = segment(i, t).stateAt(t).position;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "NBodyIntegrator.h"
+#include  "Interpolant.h"
+
+/******************************************************************************
+ *																			  *
+ *                              Ephemeris Class                               *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  start                                                                     *
+ *          SECONDS                                                           *
+ *          Simulation time of the first sample.                              *
+ *  step                                                                      *
+ *          SECONDS                                                           *
+ *          Time between consecutive samples.                                 *
+ *  G                                                                         *
+ *          Gravitational constant of the recorded system.                    *
+ *  masses                                                                    *
+ *          KILOGRAMS                                                         *
+ *          Mass of every recorded body.                                      *
+ *  positions, velocities                                                     *
+ *          State of every body at each sample time.                          *
+ *  accelerations                                                             *
+ *          Acceleration of every body at each sample time.                   *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Precomputed trajectory of the massive bodies of a system over a time      *
+ *  window. The system is integrated once, and the state of any body at any   *
+ *  time inside the window is then reconstructed with the same quintic        *
+ *  Hermite interpolation used for dense output. This lets any number of      *
+ *  massless probes be propagated against the system, in parallel, without    *
+ *  integrating the massive bodies again for each one.                        *
+ *                                                                            *
+ ******************************************************************************/
+class Ephemeris
+{
+/* Public Members. */
+public:
+
+	/* Record the system from initial.t for duration seconds. */
+	                   Ephemeris(const NBodyState& initial,
+	                             GLfloat           duration,
+	                             GLfloat           step,
+	                             WorkerPool*       pool = nullptr);
+
+	/* State of a body at time t (clamped to the window). */
+	BodyState          stateAt      (GLuint body, GLdouble t)             const;
+
+	/* Position of every body at time t (clamped to the window). */
+	void               positionsAt  (GLdouble t,
+	                                 std::vector<glm::vec3>& out)         const;
+
+	/* Getters. */
+	GLdouble           getStartTime()      const  {  return start;           }
+	GLdouble           getEndTime()        const
+	                        {  return start + step * (positions.size() - 1); }
+	GLfloat            getStep()           const  {  return step;            }
+	GLfloat            getG()              const  {  return G;               }
+	GLuint             getNumBodies()      const  {  return masses.size();   }
+	const std::vector<GLfloat>& getMasses() const {  return masses;          }
+
+	/* Destructor. */
+	                  ~Ephemeris()                                         {}
+
+/* Private Members. */
+private:
+
+	/* Sample spacing and origin. */
+	GLdouble                            start;
+	GLfloat                             step;
+	/* Constants of the recorded system. */
+	GLfloat                             G;
+	std::vector<GLfloat>                masses;
+	/* Recorded states and accelerations. */
+	std::vector<std::vector<glm::vec3>> positions;
+	std::vector<std::vector<glm::vec3>> velocities;
+	std::vector<std::vector<glm::vec3>> accelerations;
+
+	/* Interpolant of a body over the sample interval containing t. */
+	Interpolant        segment      (GLuint body, GLdouble t)             const;
+};
@@ -0,0 +1,480 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <algorithm>
+#include "EventDetector.h"
+#include "OrbitalSystem.h"
+
+/******************************************************************************
+*                                                                             *
+*                                SweptBox (struct)                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Axis-aligned box bounding the path of one body over the last step.         *
+*                                                                             *
+*******************************************************************************/
+struct SweptBox
+{
+	glm::vec3      lo;
+	glm::vec3      hi;
+	OrbitalBody*   body;
+};
+
+/******************************************************************************
+*                                                                             *
+*                       EventDetector::watch...  (registration)               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param first, second                                                       *
+*           The bodies to watch. A null body matches every body.              *
+*  @param maxDistance / radius                                                *
+*           The distance threshold of the predicate.                          *
+*  @param observer, target, occluder                                          *
+*           The line of sight (observer -> target) and the body which may     *
+*           block it. A null occluder matches every other body; the observer  *
+*           and target must be given.                                         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void, except watchOccultation: false, and nothing registered, if the       *
+*  observer or target is null.                                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Register a new predicate with the detector.                                *
+*                                                                             *
+*******************************************************************************/
+void EventDetector::watchClosestApproach(OrbitalBody* first,
+                                         OrbitalBody* second,
+                                         GLfloat maxDistance)
+{
+	EventPredicate p = { EventType::CLOSEST_APPROACH, first, second, nullptr,
+	                     maxDistance };
+	predicates.push_back(p);
+}
+void EventDetector::watchRadiusCrossing(OrbitalBody* first,
+                                        OrbitalBody* second,
+                                        GLfloat radius)
+{
+	EventPredicate p = { EventType::RADIUS_CROSSING, first, second, nullptr,
+	                     radius };
+	predicates.push_back(p);
+}
+void EventDetector::watchCollisions(OrbitalBody* first, OrbitalBody* second)
+{
+	EventPredicate p = { EventType::COLLISION, first, second, nullptr, 0 };
+	predicates.push_back(p);
+}
+bool EventDetector::watchOccultation(OrbitalBody* observer,
+                                     OrbitalBody* target,
+                                     OrbitalBody* occluder)
+{
+	/* A line of sight needs both of its ends. */
+	if (observer == nullptr || target == nullptr)
+		return false;
+
+	EventPredicate p = { EventType::OCCULTATION, observer, target, occluder,
+	                     0 };
+	predicates.push_back(p);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          EventDetector::onRemove                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which is removing a body.                      *
+*  @param i                                                                   *
+*           Index of the body being removed.                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Predicates which match any body keep working without it. Events already    *
+*  located are kept, since they are often the reason for the removal (a       *
+*  collision), so their bodies must outlive them.                             *
+*                                                                             *
+*******************************************************************************/
+void EventDetector::onRemove(OrbitalSystem& system, GLuint i)
+{
+	OrbitalBody* body = system.getBody(i);
+	predicates.erase(std::remove_if(predicates.begin(), predicates.end(),
+	                                [body](const EventPredicate& p)
+	                                { 
+	                                    return p.first == body || p.second == body ||
+	                                           p.occluder == body; 
+	                                }),
+	                 predicates.end());
+}
+
+/******************************************************************************
+*                                                                             *
+*                           EventDetector::onStep                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has just completed a step.               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Tests every predicate against the step which has just completed. Pairs     *
+*  are taken directly from the predicate when both bodies are given, and      *
+*  from the broadphase otherwise. Located events are appended to the event    *
+*  stream in time order.                                                      *
+*                                                                             *
+*******************************************************************************/
+void EventDetector::onStep(OrbitalSystem& system)
+{
+	GLdouble t0 = system.getStepStart();
+	GLdouble t1 = system.t();
+
+	/* Nothing can happen in an empty step. */
+	if (t1 <= t0 || predicates.empty())
+		return;
+
+	/* Find the widest margin needed by any open-ended pair predicate. */
+	bool    needPairs = false;
+	GLfloat margin    = 0;
+	for (const EventPredicate& p : predicates)
+	{
+		if (p.type == EventType::OCCULTATION ||
+		   (p.first != nullptr && p.second != nullptr))
+			continue;
+
+		needPairs = true;
+		if (p.type == EventType::COLLISION)
+			continue;
+		margin = std::max(margin, p.threshold);
+	}
+
+	/* Closest approaches without a distance limit must test every pair. */
+	for (const EventPredicate& p : predicates)
+		if (p.type == EventType::CLOSEST_APPROACH && p.threshold <= 0 &&
+		   (p.first == nullptr || p.second == nullptr))
+			margin = -1;
+
+	std::vector<std::pair<OrbitalBody*, OrbitalBody*> > pairs;
+	if (needPairs)
+		broadphase(system, t0, t1, margin, pairs);
+
+	std::vector<SimEvent> stepEvents;
+	for (const EventPredicate& p : predicates)
+	{
+		/* Occultations are tested against each candidate occluder. */
+		if (p.type == EventType::OCCULTATION)
+		{
+			if (p.occluder != nullptr)
+			{
+				locate(p, p.first, p.second, p.occluder, t0, t1, stepEvents);
+				continue;
+			}
+			for (GLuint i = 0; i < system.getNumBodies(); i++)
+			{
+				OrbitalBody* c = system.getBody(i);
+				if (c != p.first && c != p.second)
+					locate(p, p.first, p.second, c, t0, t1, stepEvents);
+			}
+			continue;
+		}
+
+		/* Fully specified pairs skip the broadphase. */
+		if (p.first != nullptr && p.second != nullptr)
+		{
+			locate(p, p.first, p.second, nullptr, t0, t1, stepEvents);
+			continue;
+		}
+
+		/* Otherwise test the candidate pairs which match the predicate. */
+		OrbitalBody* fixed = (p.first != nullptr) ? p.first : p.second;
+		for (const std::pair<OrbitalBody*, OrbitalBody*>& pair : pairs)
+		{
+			if (fixed != nullptr && pair.first != fixed && pair.second != fixed)
+				continue;
+			locate(p, pair.first, pair.second, nullptr, t0, t1, stepEvents);
+		}
+	}
+
+	/* Emit the step's events in time order. */
+	std::sort(stepEvents.begin(), stepEvents.end(),
+		[](const SimEvent& a, const SimEvent& b) { return a.time < b.time; });
+	events.insert(events.end(), stepEvents.begin(), stepEvents.end());
+}
+
+/******************************************************************************
+*                                                                             *
+*                          EventDetector::pollEvents                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The events located since the last poll, in time order.                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Drains the event stream.                                                   *
+*                                                                             *
+*******************************************************************************/
+std::vector<SimEvent> EventDetector::pollEvents()
+{
+	std::vector<SimEvent> polled;
+	polled.swap(events);
+	return polled;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          EventDetector::broadphase                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has just completed a step.               *
+*  @param t0, t1                                                              *
+*           The start and end times of the step.                              *
+*  @param margin                                                              *
+*           Distance by which the boxes are grown before testing overlap. A   *
+*           negative margin disables culling and returns every pair.          *
+*  @param pairs                                                               *
+*           Output collection of candidate pairs.                             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sweep-and-prune along the x axis over the boxes swept by each body during  *
+*  the step. Boxes are grown by the body's radius so contact is never missed. *
+*                                                                             *
+*******************************************************************************/
+void EventDetector::broadphase(OrbitalSystem& system, GLdouble t0, GLdouble t1,
+                               GLfloat margin,
+                               std::vector<std::pair<OrbitalBody*,
+                                           OrbitalBody*> >& pairs)
+{
+	GLuint n = system.getNumBodies();
+
+	/* Without a margin every pair is a candidate. */
+	if (margin < 0)
+	{
+		for (GLuint i = 0; i < n; i++)
+			for (GLuint j = i + 1; j < n; j++)
+				pairs.push_back(std::make_pair(system.getBody(i),
+				                               system.getBody(j)));
+		return;
+	}
+
+	/* Build the swept box of each body from samples of its interpolant. */
+	std::vector<SweptBox> boxes(n);
+	for (GLuint i = 0; i < n; i++)
+	{
+		OrbitalBody* body  = system.getBody(i);
+		glm::vec3    p     = body->getInterpolant()->stateAt(t0).position;
+		glm::vec3    lo    = p;
+		glm::vec3    hi    = p;
+		GLfloat      chord = 0;
+		for (GLuint k = 1; k <= EVENT_SAMPLES_PER_STEP; k++)
+		{
+			GLdouble  t = t0 + (t1 - t0) * k / EVENT_SAMPLES_PER_STEP;
+			glm::vec3 q = body->getInterpolant()->stateAt(t).position;
+			chord = std::max(chord, glm::length(q - p));
+			lo    = glm::min(lo, q);
+			hi    = glm::max(hi, q);
+			p     = q;
+		}
+
+		/* Allow for bulging of the path between samples. */
+		glm::vec3 grow(0.25f * chord + body->getRadius() + 0.5f * margin);
+		boxes[i].lo   = lo - grow;
+		boxes[i].hi   = hi + grow;
+		boxes[i].body = body;
+	}
+
+	/* Sort along x and sweep. */
+	std::sort(boxes.begin(), boxes.end(),
+		[](const SweptBox& a, const SweptBox& b) { return a.lo.x < b.lo.x; });
+	for (GLuint i = 0; i < n; i++)
+	{
+		for (GLuint j = i + 1; j < n && boxes[j].lo.x <= boxes[i].hi.x; j++)
+		{
+			if (boxes[j].lo.y > boxes[i].hi.y || boxes[i].lo.y > boxes[j].hi.y ||
+			    boxes[j].lo.z > boxes[i].hi.z || boxes[i].lo.z > boxes[j].hi.z)
+				continue;
+			pairs.push_back(std::make_pair(boxes[i].body, boxes[j].body));
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           EventDetector::evaluate                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param p                                                                   *
+*           The predicate being tested.                                       *
+*  @param a, b, c                                                             *
+*           The bodies being tested (c is the occluder for occultations).     *
+*  @param t                                                                   *
+*           Simulation time within the last step.                             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The value of the event function, whose roots are the events.               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Closest approaches are roots of the radial velocity (r . v), crossings     *
+*  are roots of the separation minus the threshold, and occultations are      *
+*  roots of the distance from the occluder to the line of sight minus the     *
+*  occluder's radius.                                                         *
+*                                                                             *
+*******************************************************************************/
+GLfloat EventDetector::evaluate(const EventPredicate& p, OrbitalBody* a,
+                                OrbitalBody* b, OrbitalBody* c, GLdouble t)
+{
+	BodyState sa = a->getInterpolant()->stateAt(t);
+	BodyState sb = b->getInterpolant()->stateAt(t);
+
+	switch (p.type)
+	{
+	case EventType::CLOSEST_APPROACH:
+		return glm::dot(sb.position - sa.position, sb.velocity - sa.velocity);
+
+	case EventType::RADIUS_CROSSING:
+		return glm::distance(sa.position, sb.position) - p.threshold;
+
+	case EventType::COLLISION:
+		return glm::distance(sa.position, sb.position) -
+		       (a->getRadius() + b->getRadius());
+
+	case EventType::OCCULTATION:
+	{
+		/* Distance from the occluder to the observer -> target segment. */
+		glm::vec3 o   = c->getInterpolant()->stateAt(t).position;
+		glm::vec3 los = sb.position - sa.position;
+		GLfloat   len = glm::dot(los, los);
+		GLfloat   u   = (len > 0) ?
+		                glm::dot(o - sa.position, los) / len : 0.0f;
+		u = glm::clamp(u, 0.0f, 1.0f);
+		return glm::distance(o, sa.position + u * los) - c->getRadius();
+	}
+	}
+	return 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            EventDetector::locate                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param p                                                                   *
+*           The predicate being tested.                                       *
+*  @param a, b, c                                                             *
+*           The bodies being tested (c is the occluder for occultations).     *
+*  @param t0, t1                                                              *
+*           The start and end times of the step.                              *
+*  @param out                                                                 *
+*           Collection to which located events are appended.                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Samples the event function across the step to bracket sign changes, then   *
+*  refines each bracket with the Illinois variant of regula falsi. A root     *
+*  landing exactly on the start of the step was already reported by the       *
+*  previous step and is skipped.                                              *
+*                                                                             *
+*******************************************************************************/
+void EventDetector::locate(const EventPredicate& p, OrbitalBody* a,
+                           OrbitalBody* b, OrbitalBody* c, GLdouble t0,
+                           GLdouble t1, std::vector<SimEvent>& out)
+{
+	GLdouble ta = t0;
+	GLfloat fa = evaluate(p, a, b, c, ta);
+
+	for (GLuint k = 1; k <= EVENT_SAMPLES_PER_STEP; k++)
+	{
+		GLdouble tb = t0 + (t1 - t0) * k / EVENT_SAMPLES_PER_STEP;
+		GLfloat fb = evaluate(p, a, b, c, tb);
+
+		bool falling = (fa > 0 && fb <= 0);
+		bool rising  = (fa < 0 && fb >= 0);
+
+		/* Closest approaches are only the minima of the distance. */
+		if (p.type == EventType::CLOSEST_APPROACH)
+			falling = false;
+
+		if (falling || rising)
+		{
+			/* Illinois refinement of the bracket [ta, tb]. */
+			GLdouble lo = ta, hi = tb, root = tb;
+			GLfloat  flo = fa, fhi = fb;
+			GLint   side = 0;
+			for (GLuint i = 0; i < EVENT_MAX_ITERATIONS; i++)
+			{
+				root = (flo * hi - fhi * lo) / (flo - fhi);
+				if (hi - lo <= EVENT_TIME_TOLERANCE * (t1 - t0))
+					break;
+
+				GLfloat froot = evaluate(p, a, b, c, root);
+				if (froot == 0)
+					break;
+				if ((froot > 0) == (fhi > 0))
+				{
+					hi = root; fhi = froot;
+					if (side == -1) flo *= 0.5f;
+					side = -1;
+				}
+				else
+				{
+					lo = root; flo = froot;
+					if (side == +1) fhi *= 0.5f;
+					side = +1;
+				}
+			}
+
+			/* Build the event at the located time. */
+			SimEvent e;
+			e.type     = p.type;
+			e.time     = root;
+			e.first    = a;
+			e.second   = b;
+			e.occluder = c;
+			e.distance = glm::distance(
+				a->getInterpolant()->stateAt(root).position,
+				b->getInterpolant()->stateAt(root).position);
+			e.entering = falling;
+
+			/* Closest approaches may be limited to a maximum distance. */
+			if (p.type != EventType::CLOSEST_APPROACH || p.threshold <= 0 ||
+			    e.distance <= p.threshold)
+				out.push_back(e);
+		}
+
+		ta = tb;
+		fa = fb;
+	}
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <utility>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "OrbitalBody.h"
+#include  "StepObserver.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define   EVENT_SAMPLES_PER_STEP            8
+#define   EVENT_MAX_ITERATIONS             50
+#define   EVENT_TIME_TOLERANCE           1e-6f
+
+/******************************************************************************
+ *																			  *
+ *	                           EventType Enum                                 *
+ *																			  *
+ ******************************************************************************
+ *  CLOSEST_APPROACH                                                          *
+ *       Local minimum of the distance between two bodies.                    *
+ *  RADIUS_CROSSING                                                           *
+ *       Distance between two bodies crosses a fixed radius.                  *
+ *  COLLISION                                                                 *
+ *       Surfaces of two bodies touch (distance crosses the sum of radii).    *
+ *  OCCULTATION                                                               *
+ *       A third body enters or leaves the line of sight between two bodies.  *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Enumeration of the kinds of events the EventDetector can locate.          *
+ *                                                                            *
+ ******************************************************************************/
+enum class EventType
+{
+	CLOSEST_APPROACH,
+	RADIUS_CROSSING,
+	COLLISION,
+	OCCULTATION,
+};
+
+/******************************************************************************
+*                                                                             *
+*                             SimEvent (struct)                               *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  type                                                                       *
+*          Kind of event which occurred.                                      *
+*  time                                                                       *
+*          SECONDS                                                            *
+*          Simulation time at which the event occurred.                       *
+*  first, second                                                              *
+*          The pair of bodies involved (observer and target for occultations).*
+*  occluder                                                                   *
+*          Body blocking the line of sight (occultations only).               *
+*  distance                                                                   *
+*          METERS                                                             *
+*          Separation of first and second at the time of the event.           *
+*  entering                                                                   *
+*          True when a threshold was crossed inwards (or an occultation       *
+*          began), false when it was crossed outwards.                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Struct representing a single timestamped event emitted by the detector.    *
+*                                                                             *
+*******************************************************************************/
+struct SimEvent
+{
+	EventType      type;
+	GLdouble       time;
+	OrbitalBody*   first;
+	OrbitalBody*   second;
+	OrbitalBody*   occluder;
+	GLfloat        distance;
+	bool           entering;
+};
+
+/******************************************************************************
+*                                                                             *
+*                          EventPredicate (struct)                            *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  type                                                                       *
+*          Kind of event to watch for.                                        *
+*  first, second                                                              *
+*          Bodies to watch. A null body matches every body in the system, in  *
+*          which case candidate pairs are supplied by the broadphase.         *
+*  occluder                                                                   *
+*          Occluding body for occultations (null matches every body).         *
+*  threshold                                                                  *
+*          METERS                                                             *
+*          Radius for crossings, or maximum reported distance for closest     *
+*          approaches (0 reports every approach).                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Struct describing one registered event predicate.                          *
+*                                                                             *
+*******************************************************************************/
+struct EventPredicate
+{
+	EventType      type;
+	OrbitalBody*   first;
+	OrbitalBody*   second;
+	OrbitalBody*   occluder;
+	GLfloat        threshold;
+};
+
+/******************************************************************************
+ *																			  *
+ *                            EventDetector Class                             *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  predicates                                                                *
+ *          Collection of registered event predicates.                        *
+ *  events                                                                    *
+ *          Stream of located events which have not yet been polled.          *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Step observer which locates events inside each integrator step by root-   *
+ *  finding on the dense output of the step, so event times are exact to the  *
+ *  interpolant without shrinking the step size. Predicates which match any   *
+ *  body are narrowed with a sweep-and-prune broadphase over the swept        *
+ *  bounding boxes of the bodies, so only nearby pairs are root-found.        *
+ *                                                                            *
+ ******************************************************************************/
+class EventDetector : public StepObserver
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                        EventDetector()                                {}
+
+	/* Report minima of the distance between two bodies. */
+	void                    watchClosestApproach(OrbitalBody* first,
+	                                             OrbitalBody* second,
+	                                             GLfloat      maxDistance);
+	/* Report crossings of a fixed separation between two bodies. */
+	void                    watchRadiusCrossing (OrbitalBody* first,
+	                                             OrbitalBody* second,
+	                                             GLfloat      radius);
+	/* Report contact between the surfaces of two bodies. */
+	void                    watchCollisions     (OrbitalBody* first,
+	                                             OrbitalBody* second);
+	/* Report a body blocking the line of sight from observer to target. */
+	bool                    watchOccultation    (OrbitalBody* observer,
+	                                             OrbitalBody* target,
+	                                             OrbitalBody* occluder);
+
+	/* Remove all of the registered predicates. */
+	void                    clearPredicates()       {  predicates.clear();  }
+
+	/* Locate the events within the step which just completed. */
+	virtual void            onStep(OrbitalSystem& system);
+
+	/* Forget the predicates which name a body leaving the system. */
+	virtual void            onRemove(OrbitalSystem& system, GLuint i);
+
+	/* Remove and return all of the events located so far. */
+	std::vector<SimEvent>   pollEvents();
+
+	/* Getters. */
+	const std::vector<SimEvent>& getEvents() const  {  return events;       }
+
+	/* Destructor. */
+	virtual                ~EventDetector()                                {}
+
+/* Private Members. */
+private:
+
+	/* Registered predicates. */
+	std::vector<EventPredicate> predicates;
+	/* Located events which have not yet been polled. */
+	std::vector<SimEvent>       events;
+
+	/* Find the pairs of bodies whose swept boxes come within margin. */
+	void                    broadphase  (OrbitalSystem&  system,
+	                                     GLdouble        t0,
+	                                     GLdouble        t1,
+	                                     GLfloat         margin,
+	                                     std::vector<std::pair<OrbitalBody*,
+	                                                 OrbitalBody*> >& pairs);
+	/* Evaluate the predicate's event function at time t. */
+	GLfloat                 evaluate    (const EventPredicate& p,
+	                                     OrbitalBody*    a,
+	                                     OrbitalBody*    b,
+	                                     OrbitalBody*    c,
+	                                     GLdouble        t);
+	/* Bracket and refine every root of the event function in the step. */
+	void                    locate      (const EventPredicate& p,
+	                                     OrbitalBody*    a,
+	                                     OrbitalBody*    b,
+	                                     OrbitalBody*    c,
+	                                     GLdouble        t0,
+	                                     GLdouble        t1,
+	                                     std::vector<SimEvent>& out);
+};
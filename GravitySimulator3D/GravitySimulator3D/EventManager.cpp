@@ -10,6 +10,10 @@
 * PARAMETERS                                                                  *
 *  @param camera                                                              *
 *           The camera which this event manager controls.                     *
+*  @param speed                                                               *
+*           The time warp adjusted by the speed keys.                         *
+*  @param seek                                                                *
+*           The time jump set by the scrub keys (null to ignore them).        *
 *                                                                             *
 *******************************************************************************
 * RETURNS                                                                     *
@@ -21,10 +25,11 @@
 *  camera used by this event manager.                                         *
 *                                                                             *
 *******************************************************************************/
-EventManager::EventManager(Camera* camera, GLfloat* speed)
+EventManager::EventManager(Camera* camera, GLfloat* speed, GLfloat* seek)
 {
 	this->camera = camera;
 	this->speed = speed;
+	this->seek = seek;
 }
 
 /******************************************************************************
@@ -84,16 +89,32 @@ void EventManager::handleKeyPress(SDL_Scancode key)
 
 	switch (key) 
 	{
-	/* Speed Up. */
+	/* Speed Up (time warp). */
 	case SDL_SCANCODE_T:
-		if(*speed < 4.0f)
-			*speed += 0.5f;
+		*speed = glm::min(*speed * SPEED_FACTOR, MAX_SPEED);
 		break;
 	
-	/* Slow Down. */
+	/* Slow Down (time warp). */
 	case SDL_SCANCODE_R:
-		if(*speed < 0.0f)
-			*speed -= 0.5f;
+		*speed = glm::max(*speed / SPEED_FACTOR, MIN_SPEED);
+		break;
+
+	/* Scrub Backward (time seek). */
+	case SDL_SCANCODE_LEFTBRACKET:
+		if (seek != nullptr)
+			*seek = -(*speed) * SCRUB_REAL_SECONDS;
+		break;
+
+	/* Scrub Forward (time seek). */
+	case SDL_SCANCODE_RIGHTBRACKET:
+		if (seek != nullptr)
+			*seek = +(*speed) * SCRUB_REAL_SECONDS;
+		break;
+
+	/* Return to the start of the run (time seek). */
+	case SDL_SCANCODE_HOME:
+		if (seek != nullptr)
+			*seek = SEEK_TO_START;
 		break;
 
 	/* Strafe Right. */
@@ -2,6 +2,20 @@
 #include  "Camera.h"
 #include  "SDL\SDL.h"
 #include  <GL\glew.h>
+#include  <cfloat>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define   MIN_SPEED                          1.0f
+#define   MAX_SPEED                          1.0e7f
+#define   SPEED_FACTOR                      10.0f
+/* Real seconds of run, at the current speed, skipped by each scrub key. */
+#define   SCRUB_REAL_SECONDS                10.0f
+/* Seek request which returns to the start of the run. */
+#define   SEEK_TO_START                   -FLT_MAX
 
 /******************************************************************************
  *																			  *
@@ -23,7 +37,7 @@ class EventManager
 public:
 
 	/* Constructor. */
-	EventManager(Camera* camera, GLfloat* speed);
+	EventManager(Camera* camera, GLfloat* speed, GLfloat* seek = nullptr);
 
 	/* Handle an SDL Event. */
 	void           handleSDLEvent(SDL_Event* event);
@@ -44,5 +58,7 @@ private:
 	/* Camera for the application. */
 	Camera*        camera;
 	GLfloat*        speed;
+	/* Requested jump in simulation time (seconds), or null if not wanted. */
+	GLfloat*        seek;
 };
 
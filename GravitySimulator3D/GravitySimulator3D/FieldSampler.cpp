@@ -0,0 +1,825 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include "FieldSampler.h"
+
+/******************************************************************************
+*                                                                             *
+*                                write (helper)                               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Raw binary transfer of count values, in the byte order of the machine.     *
+*                                                                             *
+*******************************************************************************/
+template <typename T>
+static void write(std::ostream& out, const T* values, size_t count)
+{
+	out.write(reinterpret_cast<const char*>(values), sizeof(T) * count);
+}
+
+/******************************************************************************
+*                                                                             *
+*                    FieldSampler::FieldSampler (Constructor)                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param pool                                                                *
+*           Optional worker pool over the nodes.                              *
+*  @param openingAngle                                                        *
+*           Largest cell size over distance at which a cell is a point mass.  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the FieldSampler class. There are no nodes until setSlice  *
+*  or setVolume is called.                                                    *
+*                                                                             *
+*******************************************************************************/
+FieldSampler::FieldSampler(WorkerPool* pool, GLfloat openingAngle) :
+	pool(pool), openingAngle(openingAngle), origin(0), spacing(0),
+	softening2(0), G(0), cellOrigin(0), cellSize(0), cellsPerAxis(0),
+	updates(0), resampledCells(0)
+{
+	counts[0] = counts[1] = counts[2] = 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            FieldSampler::setSlice                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param center                                                              *
+*           Center of the slice.                                              *
+*  @param normal                                                              *
+*           Direction at right angles to the slice.                           *
+*  @param halfWidth                                                           *
+*           Distance from the center to each edge of the slice.               *
+*  @param resolution                                                          *
+*           Number of nodes along each edge (at least 2).                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The third axis of a slice has a single node and points along the normal,   *
+*  which is the direction a heightmap is sunk in.                             *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::setSlice(const glm::vec3& center, const glm::vec3& normal,
+                            const GLfloat halfWidth, const GLuint resolution)
+{
+	glm::vec3 n      = glm::normalize(normal);
+	glm::vec3 helper = (fabs(n.y) < 0.9f) ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+	glm::vec3 u      = glm::normalize(glm::cross(helper, n));
+	glm::vec3 v      = glm::cross(n, u);
+
+	GLuint  r    = std::max(resolution, 2u);
+	GLfloat step = 2.0f * halfWidth / (r - 1);
+
+	origin    = center - halfWidth * (u + v);
+	steps[0]  = step * u;
+	steps[1]  = step * v;
+	steps[2]  = step * n;
+	counts[0] = r;
+	counts[1] = r;
+	counts[2] = 1;
+	resize();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           FieldSampler::setVolume                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param lo, hi                                                              *
+*           Opposite corners of the box.                                      *
+*  @param resolution                                                          *
+*           Number of nodes along each edge (at least 2).                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::setVolume(const glm::vec3& lo, const glm::vec3& hi,
+                             const GLuint resolution)
+{
+	GLuint    r    = std::max(resolution, 2u);
+	glm::vec3 step = (hi - lo) / (GLfloat) (r - 1);
+
+	origin    = lo;
+	steps[0]  = glm::vec3(step.x, 0, 0);
+	steps[1]  = glm::vec3(0, step.y, 0);
+	steps[2]  = glm::vec3(0, 0, step.z);
+	counts[0] = r;
+	counts[1] = r;
+	counts[2] = r;
+	resize();
+}
+
+/******************************************************************************
+*                                                                             *
+*                         FieldSampler::setResolution                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param resolution                                                          *
+*           Number of nodes along each edge (at least 2).                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Respaces the nodes of the current slice or box so the same extent is       *
+*  covered by the new number of nodes along each sampled axis.                *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::setResolution(const GLuint resolution)
+{
+	GLuint r = std::max(resolution, 2u);
+	for (GLuint a = 0; a < 3; a++)
+	{
+		if (counts[a] < 2)
+			continue;
+		steps[a] *= (GLfloat) (counts[a] - 1) / (r - 1);
+		counts[a] = r;
+	}
+	resize();
+}
+
+/******************************************************************************
+*                                                                             *
+*                             FieldSampler::resize                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sizes the nodes for the new grid and drops the sources, so that the next   *
+*  update is a full sample.                                                   *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::resize()
+{
+	GLuint n = counts[0] * counts[1] * counts[2];
+	potential.assign(n, 0.0f);
+	acceleration.assign(n, glm::vec3(0));
+
+	spacing = 0;
+	for (GLuint a = 0; a < 3; a++)
+	{
+		GLfloat length = glm::length(steps[a]);
+		if (counts[a] > 1 && length > 0 && (spacing == 0 || length < spacing))
+			spacing = length;
+	}
+	softening2 = (FIELD_SOFTENING_SPACINGS * spacing) *
+	             (FIELD_SOFTENING_SPACINGS * spacing);
+	cellStart.clear();
+}
+
+/******************************************************************************
+*                                                                             *
+*                          FieldSampler::nodePosition                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param i, j, k                                                             *
+*           Index of the node along each axis.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The position of the node.                                                  *
+*                                                                             *
+*******************************************************************************/
+glm::vec3 FieldSampler::nodePosition(GLuint i, GLuint j, GLuint k) const
+{
+	return origin + (GLfloat) i * steps[0] + (GLfloat) j * steps[1] +
+	                (GLfloat) k * steps[2];
+}
+
+/******************************************************************************
+*                                                                             *
+*                             FieldSampler::sample                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The bodies to sample the field of.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Fits the cell grid around the bodies with about FIELD_BODIES_PER_CELL in   *
+*  each, bins the bodies by counting sort, and sums every cell at every node. *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::sample(const NBodyState& state)
+{
+	GLuint n = state.positions.size();
+	G       = state.G;
+	updates = 0;
+
+	/* Fit the cell grid around the bodies. */
+	glm::vec3 lo(0), hi(0);
+	if (n > 0)
+		lo = hi = state.positions[0];
+	for (GLuint i = 1; i < n; i++)
+	{
+		lo = glm::min(lo, state.positions[i]);
+		hi = glm::max(hi, state.positions[i]);
+	}
+	GLfloat extent = std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z));
+	cellsPerAxis = (GLuint) (pow((GLdouble) n / FIELD_BODIES_PER_CELL, 1.0 / 3.0) + 0.5);
+	cellsPerAxis = std::min(std::max(cellsPerAxis, 1u), (GLuint) FIELD_MAX_CELLS);
+	cellOrigin   = lo;
+	cellSize     = (extent > 0) ? extent * 1.0001f / cellsPerAxis : 1.0f;
+
+	/* Bin the bodies by counting sort. */
+	GLuint              numCells = cellsPerAxis * cellsPerAxis * cellsPerAxis;
+	std::vector<GLuint> cellIndex(n);
+	cellStart.assign(numCells + 1, 0);
+	for (GLuint i = 0; i < n; i++)
+	{
+		cellIndex[i] = cellOf(state.positions[i]);
+		cellStart[cellIndex[i] + 1]++;
+	}
+	for (GLuint c = 0; c < numCells; c++)
+		cellStart[c + 1] += cellStart[c];
+
+	std::vector<GLuint> next(cellStart.begin(), cellStart.end() - 1);
+	x.resize(n);
+	y.resize(n);
+	z.resize(n);
+	gm.resize(n);
+	body.resize(n);
+	for (GLuint i = 0; i < n; i++)
+	{
+		GLuint e = next[cellIndex[i]]++;
+		x[e]    = state.positions[i].x;
+		y[e]    = state.positions[i].y;
+		z[e]    = state.positions[i].z;
+		gm[e]   = G * state.masses[i];
+		body[e] = i;
+	}
+
+	/* Summarize the cells and sum every occupied one at every node. */
+	cellCenter.resize(numCells);
+	cellGm.resize(numCells);
+	cellRadius.resize(numCells);
+	std::vector<GLuint> occupied;
+	for (GLuint c = 0; c < numCells; c++)
+	{
+		summarize(c);
+		if (cellStart[c + 1] > cellStart[c])
+			occupied.push_back(c);
+	}
+
+	std::fill(potential.begin(), potential.end(), 0.0f);
+	std::fill(acceleration.begin(), acceleration.end(), glm::vec3(0));
+	accumulate(occupied, 1.0f);
+	resampledCells = occupied.size();
+}
+
+/******************************************************************************
+*                                                                             *
+*                             FieldSampler::update                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The same bodies as the last sample, at their new positions.       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A cell is stale when one of its bodies moved more than the tolerance or    *
+*  changed mass, or a body left or joined it. The stale cells' terms are      *
+*  subtracted with their old bodies, the cells are rebuilt, and their terms   *
+*  are added back; the other cells keep their entries unchanged. Falls back   *
+*  to a full sample when the bodies changed, when most cells are stale, and   *
+*  every FIELD_REFRESH_UPDATES updates.                                       *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::update(const NBodyState& state)
+{
+	GLuint n = state.positions.size();
+	if (cellStart.empty() || n != body.size() || state.G != G ||
+	    ++updates > FIELD_REFRESH_UPDATES)
+	{
+		sample(state);
+		return;
+	}
+
+	/* Find the stale cells. */
+	GLuint              numCells  = cellsPerAxis * cellsPerAxis * cellsPerAxis;
+	GLfloat             tolerance = FIELD_MOVE_TOLERANCE * spacing;
+	std::vector<GLuint> cellIndex(n);
+	std::vector<char>   stale(numCells, 0);
+	GLuint              occupied  = 0;
+	for (GLuint c = 0; c < numCells; c++)
+	{
+		if (cellStart[c + 1] > cellStart[c])
+			occupied++;
+		for (GLuint e = cellStart[c]; e < cellStart[c + 1]; e++)
+		{
+			GLuint    i = body[e];
+			glm::vec3 p = state.positions[i];
+			glm::vec3 d = p - glm::vec3(x[e], y[e], z[e]);
+			cellIndex[i] = cellOf(p);
+			if (cellIndex[i] != c)
+				stale[c] = stale[cellIndex[i]] = 1;
+			else if (glm::dot(d, d) > tolerance * tolerance ||
+			         G * state.masses[i] != gm[e])
+				stale[c] = 1;
+		}
+	}
+
+	std::vector<GLuint> staleCells;
+	for (GLuint c = 0; c < numCells; c++)
+		if (stale[c])
+			staleCells.push_back(c);
+	resampledCells = staleCells.size();
+	if (staleCells.empty())
+		return;
+	if (2 * staleCells.size() > occupied)
+	{
+		sample(state);
+		return;
+	}
+
+	/* Take out the old terms of the stale cells. */
+	accumulate(staleCells, -1.0f);
+
+	/* Rebuild the entries: stale cells from the state, the rest as they were. */
+	std::vector<GLuint> newStart(numCells + 1, 0);
+	std::vector<GLuint> fresh(numCells + 1, 0);
+	for (GLuint i = 0; i < n; i++)
+		if (stale[cellIndex[i]])
+			fresh[cellIndex[i] + 1]++;
+	for (GLuint c = 0; c < numCells; c++)
+		fresh[c + 1] += fresh[c];
+	std::vector<GLuint> members(fresh[numCells]);
+	std::vector<GLuint> next(fresh.begin(), fresh.end() - 1);
+	for (GLuint i = 0; i < n; i++)
+		if (stale[cellIndex[i]])
+			members[next[cellIndex[i]]++] = i;
+
+	std::vector<GLfloat> newX, newY, newZ, newGm;
+	std::vector<GLuint>  newBody;
+	newX.reserve(n);
+	newY.reserve(n);
+	newZ.reserve(n);
+	newGm.reserve(n);
+	newBody.reserve(n);
+	for (GLuint c = 0; c < numCells; c++)
+	{
+		newStart[c] = newBody.size();
+		if (stale[c])
+		{
+			for (GLuint m = fresh[c]; m < fresh[c + 1]; m++)
+			{
+				GLuint i = members[m];
+				newX.push_back(state.positions[i].x);
+				newY.push_back(state.positions[i].y);
+				newZ.push_back(state.positions[i].z);
+				newGm.push_back(G * state.masses[i]);
+				newBody.push_back(i);
+			}
+		}
+		else
+		{
+			for (GLuint e = cellStart[c]; e < cellStart[c + 1]; e++)
+			{
+				newX.push_back(x[e]);
+				newY.push_back(y[e]);
+				newZ.push_back(z[e]);
+				newGm.push_back(gm[e]);
+				newBody.push_back(body[e]);
+			}
+		}
+	}
+	newStart[numCells] = newBody.size();
+	cellStart.swap(newStart);
+	x.swap(newX);
+	y.swap(newY);
+	z.swap(newZ);
+	gm.swap(newGm);
+	body.swap(newBody);
+
+	/* Put in the new terms of the stale cells. */
+	for (GLuint c : staleCells)
+		summarize(c);
+	accumulate(staleCells, 1.0f);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             FieldSampler::cellOf                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param p                                                                   *
+*           A position.                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The cell holding the position. Positions outside the cell grid go to the   *
+*  nearest edge cell, whose radius then grows to take them in.                *
+*                                                                             *
+*******************************************************************************/
+GLuint FieldSampler::cellOf(const glm::vec3& p) const
+{
+	glm::vec3 f = (p - cellOrigin) / cellSize;
+	GLint     last = (GLint) cellsPerAxis - 1;
+	GLint     i = std::min(std::max((GLint) floor(f.x), 0), last);
+	GLint     j = std::min(std::max((GLint) floor(f.y), 0), last);
+	GLint     k = std::min(std::max((GLint) floor(f.z), 0), last);
+	return ((GLuint) k * cellsPerAxis + (GLuint) j) * cellsPerAxis + (GLuint) i;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           FieldSampler::summarize                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param c                                                                   *
+*           The cell to summarize.                                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::summarize(GLuint c)
+{
+	GLuint    begin = cellStart[c];
+	GLuint    end   = cellStart[c + 1];
+	GLfloat   total = 0;
+	glm::vec3 sum(0), mean(0);
+	for (GLuint e = begin; e < end; e++)
+	{
+		glm::vec3 p(x[e], y[e], z[e]);
+		total += gm[e];
+		sum   += gm[e] * p;
+		mean  += p;
+	}
+
+	/* Massless cells still need a center for the radius. */
+	glm::vec3 center = (total > 0) ? sum / total
+	                               : mean / (GLfloat) std::max(end - begin, 1u);
+	GLfloat   radius = 0;
+	for (GLuint e = begin; e < end; e++)
+		radius = std::max(radius, glm::distance(center, glm::vec3(x[e], y[e], z[e])));
+
+	cellCenter[c] = center;
+	cellGm[c]     = total;
+	cellRadius[c] = radius;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           FieldSampler::accumulate                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param cells                                                               *
+*           The cells to sum.                                                 *
+*  @param sign                                                                *
+*           +1 to add their terms, -1 to take them out.                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Every node is independent, so the nodes are split across the pool.         *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::accumulate(const std::vector<GLuint>& cells, const GLfloat sign)
+{
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		for (GLuint node = begin; node < end; node++)
+		{
+			GLuint    i   = node % counts[0];
+			GLuint    j   = (node / counts[0]) % counts[1];
+			GLuint    k   = node / (counts[0] * counts[1]);
+			glm::vec3 p   = nodePosition(i, j, k);
+			GLfloat   phi = 0;
+			glm::vec3 a(0);
+			for (GLuint c : cells)
+				cellTerm(c, p, phi, a);
+			potential[node]    += sign * phi;
+			acceleration[node] += sign * a;
+		}
+	};
+
+	GLuint n = potential.size();
+	if (pool != nullptr && n >= PARALLEL_MIN_BODIES)
+		pool->parallelFor(n, task);
+	else
+		task(0, n);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            FieldSampler::cellTerm                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param c                                                                   *
+*           The cell.                                                         *
+*  @param node                                                                *
+*           Position of the node.                                             *
+*  @param phi, a                                                              *
+*           Output potential and acceleration, added to.                      *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A cell far enough away for the opening test is a single softened point     *
+*  mass. Otherwise its bodies are summed in a loop without branches over the  *
+*  flat arrays, which the compiler turns into vector instructions.            *
+*                                                                             *
+*******************************************************************************/
+void FieldSampler::cellTerm(GLuint c, const glm::vec3& node, GLfloat& phi,
+                            glm::vec3& a) const
+{
+	if (cellGm[c] == 0)
+		return;
+
+	glm::vec3 d    = cellCenter[c] - node;
+	GLfloat   r2   = glm::dot(d, d);
+	GLfloat   size = 2.0f * cellRadius[c];
+	if (size * size < openingAngle * openingAngle * r2)
+	{
+		GLfloat inverse = 1.0f / sqrt(r2 + softening2);
+		GLfloat w       = cellGm[c] * inverse;
+		phi -= w;
+		a   += (w * inverse * inverse) * d;
+		return;
+	}
+
+	const GLfloat* px = x.data();
+	const GLfloat* py = y.data();
+	const GLfloat* pz = z.data();
+	const GLfloat* pm = gm.data();
+	GLfloat sumPhi = 0, sumX = 0, sumY = 0, sumZ = 0;
+	for (GLuint e = cellStart[c]; e < cellStart[c + 1]; e++)
+	{
+		GLfloat dx      = px[e] - node.x;
+		GLfloat dy      = py[e] - node.y;
+		GLfloat dz      = pz[e] - node.z;
+		GLfloat inverse = 1.0f / sqrt(dx * dx + dy * dy + dz * dz + softening2);
+		GLfloat w       = pm[e] * inverse;
+		sumPhi -= w;
+		w      *= inverse * inverse;
+		sumX   += w * dx;
+		sumY   += w * dy;
+		sumZ   += w * dz;
+	}
+	phi += sumPhi;
+	a   += glm::vec3(sumX, sumY, sumZ);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            FieldSampler::writeCsv                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the file to write.                                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the file was written.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  One row per node, with its indices, position, potential and acceleration.  *
+*                                                                             *
+*******************************************************************************/
+bool FieldSampler::writeCsv(const char* file) const
+{
+	std::ofstream out(file);
+	if (!out)
+		return false;
+
+	out.precision(10);
+	out << "i,j,k,x,y,z,potential,ax,ay,az\n";
+	GLuint node = 0;
+	for (GLuint k = 0; k < counts[2]; k++)
+	{
+		for (GLuint j = 0; j < counts[1]; j++)
+		{
+			for (GLuint i = 0; i < counts[0]; i++, node++)
+			{
+				glm::vec3 p = nodePosition(i, j, k);
+				glm::vec3 a = acceleration[node];
+				out << i << "," << j << "," << k << ","
+				    << p.x << "," << p.y << "," << p.z << ","
+				    << potential[node] << ","
+				    << a.x << "," << a.y << "," << a.z << "\n";
+			}
+		}
+	}
+
+	return out.good();
+}
+
+/******************************************************************************
+*                                                                             *
+*                          FieldSampler::writeBinary                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the file to write.                                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the file was written.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  FIELD_MAGIC, the three node counts (32-bit), the origin and the three      *
+*  axis steps (3 + 9 floats), then the potential of every node and the        *
+*  acceleration of every node (3 floats each), all with i fastest and in the  *
+*  byte order of the machine.                                                 *
+*                                                                             *
+*******************************************************************************/
+bool FieldSampler::writeBinary(const char* file) const
+{
+	std::ofstream out(file, std::ios::binary);
+	if (!out)
+		return false;
+
+	out.write(FIELD_MAGIC, 4);
+	write(out, counts, 3);
+	write(out, &origin.x, 3);
+	for (GLuint a = 0; a < 3; a++)
+		write(out, &steps[a].x, 3);
+	if (!potential.empty())
+	{
+		write(out, potential.data(), potential.size());
+		write(out, &acceleration[0].x, 3 * acceleration.size());
+	}
+
+	return out.good();
+}
+
+/******************************************************************************
+*                                                                             *
+*                         FieldSampler::buildHeightmap                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param mesh                                                                *
+*           The mesh to fill, empty the first time and the same mesh after.   *
+*  @param depth                                                               *
+*           How far the deepest part of the surface is sunk.                  *
+*  @param floor                                                               *
+*           Potential (negative) at which the surface reaches full depth;     *
+*           deeper wells are cut off there. 0 uses the lowest node.           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the grid is not a slice small enough for one mesh.                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Each node becomes a vertex sunk along the slice normal in proportion to    *
+*  its potential, giving the familiar picture of wells around the bodies.     *
+*  The fragment shader colors by texture, so the contours are a banded        *
+*  texture looked up by depth: every band is one contour interval. The first  *
+*  call creates the buffers and the texture; later calls with the same slice  *
+*  only send the new vertices down, and a change of resolution rebuilds them. *
+*                                                                             *
+*******************************************************************************/
+bool FieldSampler::buildHeightmap(Mesh* mesh, GLfloat depth, GLfloat floor) const
+{
+	GLuint nu = counts[0];
+	GLuint nv = counts[1];
+	if (counts[2] != 1 || nu < 2 || nv < 2 ||
+	    nu > FIELD_HEIGHTMAP_MAX || nv > FIELD_HEIGHTMAP_MAX)
+		return false;
+
+	GLfloat reference = floor;
+	if (reference >= 0)
+		reference = *std::min_element(potential.begin(), potential.end());
+	if (reference >= 0)
+		reference = -1.0f;
+
+	/* Sink every node along the normal. */
+	glm::vec3           normal = glm::normalize(steps[2]);
+	std::vector<Vertex> vertices(nu * nv);
+	for (GLuint j = 0; j < nv; j++)
+	{
+		for (GLuint i = 0; i < nu; i++)
+		{
+			GLuint  node     = j * nu + i;
+			GLfloat fraction = std::min(std::max(potential[node] / reference, 0.0f), 1.0f);
+			Vertex& v        = vertices[node];
+			v.position          = nodePosition(i, j, 0) - (depth * fraction) * normal;
+			v.color             = DEFAULT_VERTEX_COLOR;
+			v.textureCoordinate = glm::vec2(fraction, 0.5f);
+		}
+	}
+
+	/* Surface normals from the neighbouring vertices. */
+	for (GLuint j = 0; j < nv; j++)
+	{
+		for (GLuint i = 0; i < nu; i++)
+		{
+			glm::vec3 du = vertices[j * nu + std::min(i + 1, nu - 1)].position -
+			               vertices[j * nu + (i > 0 ? i - 1 : 0)].position;
+			glm::vec3 dv = vertices[std::min(j + 1, nv - 1) * nu + i].position -
+			               vertices[(j > 0 ? j - 1 : 0) * nu + i].position;
+			vertices[j * nu + i].normal = glm::normalize(glm::cross(du, dv));
+		}
+	}
+
+	/* Later frames only move the vertices. */
+	if (mesh->getBufferIDs() != 0 && mesh->getNumVertices() == vertices.size())
+	{
+		mesh->updateVertices(&vertices);
+		return true;
+	}
+
+	/* A new number of nodes needs new buffers. */
+	if (mesh->getBufferIDs() != 0)
+	{
+		GLuint texture = mesh->getTextureID();
+		glDeleteTextures(1, &texture);
+		mesh->cleanUp();
+	}
+
+	std::vector<GLushort> indices;
+	indices.reserve(6 * (nu - 1) * (nv - 1));
+	for (GLuint j = 0; j + 1 < nv; j++)
+	{
+		for (GLuint i = 0; i + 1 < nu; i++)
+		{
+			GLushort corner = (GLushort) (j * nu + i);
+			indices.push_back(corner);
+			indices.push_back((GLushort) (corner + 1));
+			indices.push_back((GLushort) (corner + nu));
+			indices.push_back((GLushort) (corner + 1));
+			indices.push_back((GLushort) (corner + nu + 1));
+			indices.push_back((GLushort) (corner + nu));
+		}
+	}
+
+	/* Alternating light and dark bands, from white at the rim to deep blue. */
+	std::vector<GLubyte> texels;
+	for (GLuint b = 0; b < FIELD_CONTOUR_BANDS; b++)
+	{
+		GLfloat   f     = (b + 0.5f) / FIELD_CONTOUR_BANDS;
+		glm::vec3 color = glm::mix(glm::vec3(1.0f), glm::vec3(0.1f, 0.25f, 0.8f), f);
+		if (b % 2)
+			color *= 0.8f;
+		texels.push_back((GLubyte) (255 * color.r));
+		texels.push_back((GLubyte) (255 * color.g));
+		texels.push_back((GLubyte) (255 * color.b));
+	}
+
+	mesh->setVertices(&vertices);
+	mesh->setIndices(&indices);
+	mesh->genBufferArrayID();
+	mesh->genVertexArrayID();
+	mesh->genTextureID(FIELD_CONTOUR_BANDS, 1, texels.data());
+	return true;
+}
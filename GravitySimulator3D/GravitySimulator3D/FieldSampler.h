@@ -0,0 +1,188 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "NBodyIntegrator.h"
+#include  "WorkerPool.h"
+#include  "Geometry.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default largest cell size over distance at which a cell is one point mass. */
+#define   FIELD_OPENING_ANGLE               0.5f
+/* Softening length, in node spacings, so nodes on top of a body stay finite. */
+#define   FIELD_SOFTENING_SPACINGS          0.25f
+/* A body is resampled once it moves this many node spacings. */
+#define   FIELD_MOVE_TOLERANCE              0.05f
+/* Incremental updates between full samples (clears accumulated rounding). */
+#define   FIELD_REFRESH_UPDATES               64
+/* Average number of bodies per cell of the source grid. */
+#define   FIELD_BODIES_PER_CELL                8
+/* Largest number of cells along each axis of the source grid. */
+#define   FIELD_MAX_CELLS                     32
+/* Number of color bands (contours) of a heightmap. */
+#define   FIELD_CONTOUR_BANDS                 12
+/* Largest nodes along each side of a heightmap (16-bit vertex indices). */
+#define   FIELD_HEIGHTMAP_MAX                256
+/* First four bytes of a binary export. */
+#define   FIELD_MAGIC                     "GSFG"
+
+/******************************************************************************
+ *																			  *
+ *                           FieldSampler Class                               *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  pool                                                                      *
+ *          Optional worker pool over the nodes.                              *
+ *  openingAngle                                                              *
+ *          A cell whose size over its distance from a node is below this     *
+ *          acts on that node as a point mass (0 sums every body exactly).    *
+ *  origin, steps, counts                                                     *
+ *          Node (i, j, k) lies at origin + i steps[0] + j steps[1] +         *
+ *          k steps[2], with counts[a] nodes along axis a.                    *
+ *  potential, acceleration                                                   *
+ *          Gravitational potential and acceleration at every node, i fastest.*
+ *  spacing, softening2                                                       *
+ *          Smallest distance between neighbouring nodes, and the square of   *
+ *          the softening length.                                             *
+ *  G                                                                         *
+ *          Gravitational constant of the sampled state.                      *
+ *  cellOrigin, cellSize, cellsPerAxis                                        *
+ *          Grid the bodies are binned into, fixed at each full sample.       *
+ *  cellStart                                                                 *
+ *          Members of cell c are entries [cellStart[c], cellStart[c + 1]).   *
+ *  x, y, z, gm, body                                                         *
+ *          Position, G m and index of every entry as last sampled, in cell   *
+ *          order and as separate arrays so the inner loops vectorize.        *
+ *  cellCenter, cellGm, cellRadius                                            *
+ *          Center of mass, total G m and bounding radius of every cell.      *
+ *  updates                                                                   *
+ *          Incremental updates since the last full sample.                   *
+ *  resampledCells                                                            *
+ *          Number of cells resampled by the last update.                     *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Samples the gravitational potential and acceleration of a state on a      *
+ *  regular grid of nodes, either a 2-D slice or a 3-D box, for drawing and   *
+ *  analysing potential wells, Hill spheres and Lagrange points.              *
+ *                                                                            *
+ *  The bodies are binned into a coarse grid of cells. A node sees a distant  *
+ *  cell as a point mass at its center of mass, by the same opening test a    *
+ *  tree code uses, and sums the bodies of near cells directly; the nodes     *
+ *  are split across the worker pool and each cell's bodies are kept in flat  *
+ *  arrays so the sum over them vectorizes.                                   *
+ *                                                                            *
+ *  Every node is a sum of per-cell terms, so update only recomputes the      *
+ *  cells whose bodies moved more than a fraction of the node spacing: it     *
+ *  subtracts each such cell's old term and adds its new one. The bodies of   *
+ *  the other cells keep their sampled positions, so the error of the grid    *
+ *  stays below that of a fresh sample with bodies shifted by the tolerance.  *
+ *                                                                            *
+ ******************************************************************************/
+class FieldSampler
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   FieldSampler (WorkerPool* pool         = nullptr,
+	                                 GLfloat     openingAngle = FIELD_OPENING_ANGLE);
+
+	/* Sample a square slice through center, at right angles to normal. */
+	void               setSlice     (const glm::vec3& center,
+	                                 const glm::vec3& normal,
+	                                 const GLfloat    halfWidth,
+	                                 const GLuint     resolution);
+	/* Sample a box from lo to hi. */
+	void               setVolume    (const glm::vec3& lo,
+	                                 const glm::vec3& hi,
+	                                 const GLuint     resolution);
+	/* Change the nodes per side of the slice or box, keeping its extent. */
+	void               setResolution(const GLuint     resolution);
+
+	/* Evaluate every node from scratch. */
+	void               sample       (const NBodyState& state);
+	/* Bring the nodes up to date with the bodies' new positions. */
+	void               update       (const NBodyState& state);
+
+	/* Position of a node. */
+	glm::vec3          nodePosition (GLuint i, GLuint j, GLuint k)        const;
+
+	/* Write every node as text, or as a compact binary grid. */
+	bool               writeCsv     (const char* file)                    const;
+	bool               writeBinary  (const char* file)                    const;
+
+	/* Fill a mesh with the slice drawn as a surface sunk by the potential. */
+	bool               buildHeightmap(Mesh*   mesh,
+	                                  GLfloat depth,
+	                                  GLfloat floor = 0)                  const;
+
+	/* Getters. */
+	GLuint             getCount(GLuint a)  const  {  return counts[a];       }
+	GLuint             getNumNodes()       const  {  return potential.size();}
+	const std::vector<GLfloat>&   getPotential()    const  {  return potential;    }
+	const std::vector<glm::vec3>& getAcceleration() const  {  return acceleration; }
+	GLfloat            getOpeningAngle()   const  {  return openingAngle;    }
+	GLuint             getResampledCells() const  {  return resampledCells;  }
+
+	/* Setters. */
+	void               setOpeningAngle(GLfloat a)  {  openingAngle = a;  cellStart.clear();  }
+
+	/* Destructor. */
+	                  ~FieldSampler()                                      {}
+
+/* Private Members. */
+private:
+
+	/* Options. */
+	WorkerPool*            pool;
+	GLfloat                openingAngle;
+	/* Nodes. */
+	glm::vec3              origin;
+	glm::vec3              steps[3];
+	GLuint                 counts[3];
+	std::vector<GLfloat>   potential;
+	std::vector<glm::vec3> acceleration;
+	GLfloat                spacing;
+	GLfloat                softening2;
+	GLfloat                G;
+	/* Sources, as last sampled. */
+	glm::vec3              cellOrigin;
+	GLfloat                cellSize;
+	GLuint                 cellsPerAxis;
+	std::vector<GLuint>    cellStart;
+	std::vector<GLfloat>   x, y, z, gm;
+	std::vector<GLuint>    body;
+	std::vector<glm::vec3> cellCenter;
+	std::vector<GLfloat>   cellGm;
+	std::vector<GLfloat>   cellRadius;
+	/* Statistics. */
+	GLuint                 updates;
+	GLuint                 resampledCells;
+
+	/* Size the node arrays, and forget the sources. */
+	void               resize       ();
+	/* Cell holding a position. */
+	GLuint             cellOf       (const glm::vec3& p)                  const;
+	/* Center, mass and radius of a cell from its entries. */
+	void               summarize    (GLuint c);
+	/* Add sign times the terms of the given cells to every node. */
+	void               accumulate   (const std::vector<GLuint>& cells,
+	                                 const GLfloat              sign);
+	/* Term of cell c at a node. */
+	void               cellTerm     (GLuint           c,
+	                                 const glm::vec3& node,
+	                                 GLfloat&         phi,
+	                                 glm::vec3&       a)                  const;
+};
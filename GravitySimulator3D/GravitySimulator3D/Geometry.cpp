@@ -58,7 +58,7 @@ Mesh::Mesh() :
     indices(0), numIndices(0),
     textureID(-1),
     numBuffers(DEFAULT_NUM_BUFFERS), bufferIDs(0), vertexArrayID(0),
-    drawMode(DEFAULT_DRAW_MODE) 
+    sharedBuffers(false), drawMode(DEFAULT_DRAW_MODE) 
 {
 	/* Empty. */
 }
@@ -69,6 +69,7 @@ Mesh::Mesh(const Mesh& rhs) :
 	textureID(rhs.getTextureID()),
 	numBuffers(rhs.getNumBuffers()),
 	vertexArrayID(rhs.getVertexArrayID()),
+	sharedBuffers(rhs.hasSharedBuffers()),
 	drawMode(rhs.getDrawMode())
 {
 	/* Allocate space for the vertices, indices, and buffers on the heap. */
@@ -307,6 +308,46 @@ Mesh* Geometry::loadObj(const char* objFile, const char* textureFile)
 	return obj;
 }
 
+/******************************************************************************
+*                                                                             *
+*                               Geometry::shareObj                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param source                                                              *
+*        A Mesh previously returned by loadObj, whose buffers are to be       *
+*        drawn. Must outlive the returned Mesh's use.                         *
+*  @param textureFile (optional)                                              *
+*        The path to the texture file to be loaded for the new Mesh. By       *
+*        default this parameter is NULL.                                      *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A new Mesh drawing the vertex and index buffers of the source.             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Creates a Mesh for a body with the same shape as one already loaded,       *
+*  without reading the OBJ file or sending its data down again. Meshes with   *
+*  the same vertex array are drawn together by Display::repaint, so bodies    *
+*  sharing a shape cost one draw call per texture rather than one each.       *
+*                                                                             *
+*******************************************************************************/
+Mesh* Geometry::shareObj(const Mesh* source, const char* textureFile)
+{
+	/* Copy the source, which keeps its buffer and vertex array IDs. */
+	Mesh* obj = new Mesh(*source);
+	obj->setSharedBuffers(true);
+
+	/* The texture is the body's own. */
+	obj->setTextureID(-1);
+	if (textureFile != NULL)
+		obj->genTextureID(textureFile);
+
+	/* Return the mesh. */
+	return obj;
+}
+
 /******************************************************************************
 *                                                                             *
 *                               Mesh::genTextureID                            *
@@ -370,6 +411,79 @@ void Mesh::genTextureID(const char* filename)
 		}
 	}
 }
+/******************************************************************************
+*                                                                             *
+*                        Mesh::genTextureID (from memory)                     *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  width, height                                                              *
+*        The dimensions of the texture in pixels.                             *
+*  pixels                                                                     *
+*        Three bytes (r, g, b) per pixel, row by row.                         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Generates the texture buffer for an image made by the program rather than  *
+*  loaded from a file, with the same parameters as the file version.          *
+*                                                                             *
+*******************************************************************************/
+void Mesh::genTextureID(GLsizei width, GLsizei height, const GLubyte* pixels)
+{
+	/* Enable Texture 2D. */
+	glEnable(GL_TEXTURE_2D);
+
+	/* Generate the texture buffer and bind it. */
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+
+	/* Send the image data down to the graphics card (rows are not padded). */
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
+		GL_UNSIGNED_BYTE, pixels);
+
+	/* Set the desred texture parameters. */
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Mesh::updateVertices                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  v                                                                          *
+*        The new vertices, as many as the mesh already has.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Overwrites the vertices of a mesh whose buffers have been generated and    *
+*  sends them down to the existing vertex buffer, for meshes which change     *
+*  shape from frame to frame.                                                 *
+*                                                                             *
+*******************************************************************************/
+void Mesh::updateVertices(std::vector<Vertex>* v)
+{
+	/* Only the contents may change, not the size. */
+	if (v->size() != numVertices || bufferIDs == NULL)
+		return;
+
+	memcpy(vertices, v->data(), sizeof(Vertex) * v->size());
+	glBindBuffer(GL_ARRAY_BUFFER, bufferIDs[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBufferSize(), vertices);
+}
+
 /******************************************************************************
 *                                                                             *
 *                            Mesh::genBufferArrayID                           *
@@ -487,9 +601,12 @@ void Mesh::genVertexArrayID()
 *******************************************************************************/
 void Mesh::cleanUp()
 {
-	/* Delete the buffers on the graphics hardware. */
-	glDeleteBuffers(numBuffers, bufferIDs);
-	glDeleteBuffers(1, &vertexArrayID);
+	/* Delete the buffers on the graphics hardware, unless another owns them. */
+	if (!sharedBuffers)
+	{
+		glDeleteBuffers(numBuffers, bufferIDs);
+		glDeleteBuffers(1, &vertexArrayID);
+	}
 
 	/* Free the space allocated on the heap for vertex/index data. */
 	delete[] vertices;
@@ -103,6 +103,9 @@ struct Triangle
 *  vertexArrayID                                                              *
 *          ID of the buffer in which the vertex array object for this Mesh    *
 *          is located.                                                        *
+*  sharedBuffers                                                              *
+*          Whether the buffers and vertex array belong to another Mesh, which *
+*          is then responsible for deleting them.                             *
 *  drawMode                                                                   *
 *          GLenum for the draw mode of this Mesh. Can be GL_TRIANGLES,        *
 *          GL_LINES, GL_QUADS, etc.                                           *
@@ -129,6 +132,9 @@ public:
 	void           genBufferArrayID();
 	/* Generate the texture buffer and ID for the mesh.  */
 	void           genTextureID(const char* filename);
+	/* Generate the texture buffer and ID from RGB pixels in memory. */
+	void           genTextureID(GLsizei width, GLsizei height,
+	                            const GLubyte* pixels);
 	/* Generate the vertex array object and ID for the mesh. */
 	void           genVertexArrayID();
 
@@ -144,12 +150,15 @@ public:
 	GLuint*        getBufferIDs()        const   {  return bufferIDs;      }
 	GLuint         getBufferID(GLuint i) const   {  return bufferIDs[i];   } 
 	GLuint         getVertexArrayID()    const   {  return vertexArrayID;  }
+	bool           hasSharedBuffers()    const   {  return sharedBuffers;  }
 	GLenum         getDrawMode()         const   {  return drawMode;       }
 											    						 
 	/* Setters */							    						 
 	void           setVertices(GLuint n, 
                                Vertex* a);
 	void           setVertices(std::vector<Vertex>* v);
+	/* Replace the vertices (same count) and send them down to the buffer. */
+	void           updateVertices(std::vector<Vertex>* v);
 	void           setIndices(GLuint n, 
                               GLushort* a);
 	void           setIndices(std::vector<GLushort>* v);
@@ -157,6 +166,7 @@ public:
 	void           setNumBuffers(GLuint n)       {  numBuffers       = n;  }
 	void           setBufferIDs(GLuint* b)       {  bufferIDs        = b;  }
 	void           setVertexArrayID(GLuint v)    {  vertexArrayID    = v;  }
+	void           setSharedBuffers(bool s)      {  sharedBuffers    = s;  }
 	void           setDrawMode(GLenum d)         {  drawMode         = d;  }
 
 	/* Destructor */ 
@@ -175,6 +185,7 @@ protected:
 	GLuint         numBuffers;
 	GLuint*        bufferIDs;
 	GLuint         vertexArrayID;
+	bool           sharedBuffers;
 	/* Draw Data */
 	GLenum         drawMode;
 };
@@ -201,4 +212,7 @@ public:
 	/* Load from .obj file. */
 	static Mesh*     loadObj(const char* objFile, 
                              const char* textFile = NULL);
+	/* Draw the buffers of a loaded mesh with a texture of its own. */
+	static Mesh*     shareObj(const Mesh* source,
+                              const char* textFile = NULL);
 };
@@ -0,0 +1,44 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <glm\glm.hpp>
+
+/******************************************************************************
+*                                                                             *
+*                              Forward Declarations                           *
+*                                                                             *
+******************************************************************************/
+struct NBodyState;
+
+/******************************************************************************
+ *																			  *
+ *                            GravitySolver Class                             *
+ *																			  *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Interface for an alternative to direct summation of gravity. When a       *
+ *  solver is given to an NBodyIntegrator, every force evaluation of every    *
+ *  stage is handed to it in place of the built-in pairwise sum, so any       *
+ *  integrator can be combined with any solver. A solver replaces either      *
+ *  SummationMode, so it must give the same forces bit for bit however many   *
+ *  threads it uses.                                                          *
+ *                                                                            *
+ ******************************************************************************/
+class GravitySolver
+{
+/* Public Members. */
+public:
+
+	/* Gravitational acceleration of every body at the given positions. */
+	virtual void   accelerations(const NBodyState&             state,
+	                             const std::vector<glm::vec3>& positions,
+	                                   std::vector<glm::vec3>& out) = 0;
+
+	/* Destructor. */
+	virtual       ~GravitySolver()                {                          }
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+
+/******************************************************************************
+*                                                                             *
+*                             BodyState (struct)                              *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  position                                                                   *
+*          METERS                                                             *
+*          Position vector of the body in world space.                        *
+*  velocity                                                                   *
+*          METERS / SECOND                                                    *
+*          Velocity vector of the body in world space.                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Struct representing the translational state of a body at an instant.       *
+*                                                                             *
+*******************************************************************************/
+struct BodyState
+{
+	glm::vec3      position;
+	glm::vec3      velocity;
+};
+
+/******************************************************************************
+ *																			  *
+ *                             Interpolant Class                              *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  t0, t1                                                                    *
+ *          SECONDS                                                           *
+ *          Simulation times at the start and end of the last step.           *
+ *  r0, r1                                                                    *
+ *          Positions at the start and end of the last step.                  *
+ *  v0, v1                                                                    *
+ *          Velocities at the start and end of the last step.                 *
+ *  a0, a1                                                                    *
+ *          Accelerations at the start and end of the last step.              *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Continuous (dense) output for a single body over the last integrator      *
+ *  step. The integrator records the position, velocity and acceleration it   *
+ *  already has at both ends of the step, and the state anywhere inside the   *
+ *  step is reconstructed with a quintic Hermite polynomial. This costs no    *
+ *  extra force evaluations and is accurate to the order of RK4 itself.       *
+ *                                                                            *
+ ******************************************************************************/
+class Interpolant
+{
+/* Public Members. */
+public:
+
+	/* Default Constructor. */
+	Interpolant() :
+		t0(0), t1(0),
+		r0(0), r1(0),
+		v0(0), v1(0),
+		a0(0), a1(0)                              {}
+
+	/**************************************************************************
+	 *  Record the state of the body at the start of a step.                  *
+	 *************************************************************************/
+	void begin(GLdouble t, glm::vec3 r, glm::vec3 v, glm::vec3 a)
+	{
+		t0 = t1 = t;
+		r0 = r1 = r;
+		v0 = v1 = v;
+		a0 = a1 = a;
+	}
+
+	/**************************************************************************
+	 *  Record the state of the body at the end of a step.                    *
+	 *************************************************************************/
+	void end(GLdouble t, glm::vec3 r, glm::vec3 v, glm::vec3 a)
+	{
+		t1 = t;
+		r1 = r;
+		v1 = v;
+		a1 = a;
+	}
+
+	/**************************************************************************
+	 *  Determine whether t lies within the last recorded step.               *
+	 *************************************************************************/
+	bool contains(GLdouble t) const
+	{
+		return (t >= t0) && (t <= t1);
+	}
+
+	/**************************************************************************
+	 *  Evaluate the position and velocity of the body at time t. Times       *
+	 *  outside of the last step are clamped to its end points.               *
+	 *************************************************************************/
+	BodyState stateAt(GLdouble t) const
+	{
+		GLfloat h = (GLfloat) (t1 - t0);
+
+		/* A zero length step has only one state. */
+		if (h <= 0)
+			return { r1, v1 };
+
+		/* Normalized time within the step (in double, as t is far from 0). */
+		GLfloat s  = (GLfloat) glm::clamp((t - t0) / (t1 - t0), 0.0, 1.0);
+		GLfloat s2 = s  * s;
+		GLfloat s3 = s2 * s;
+		GLfloat s4 = s3 * s;
+		GLfloat s5 = s4 * s;
+
+		/* Quintic Hermite basis functions. */
+		GLfloat hr0 = 1 - 10 * s3 + 15 * s4 - 6 * s5;
+		GLfloat hv0 = s  -  6 * s3 +  8 * s4 - 3 * s5;
+		GLfloat ha0 = 0.5f * s2 - 1.5f * s3 + 1.5f * s4 - 0.5f * s5;
+		GLfloat ha1 = 0.5f * s3 - s4 + 0.5f * s5;
+		GLfloat hv1 = -4 * s3 +  7 * s4 - 3 * s5;
+		GLfloat hr1 = 10 * s3 - 15 * s4 + 6 * s5;
+
+		/* Derivatives of the basis functions with respect to s. */
+		GLfloat dr0 = -30 * s2 + 60 * s3 - 30 * s4;
+		GLfloat dv0 = 1 - 18 * s2 + 32 * s3 - 15 * s4;
+		GLfloat da0 = s - 4.5f * s2 + 6 * s3 - 2.5f * s4;
+		GLfloat da1 = 1.5f * s2 - 4 * s3 + 2.5f * s4;
+		GLfloat dv1 = -12 * s2 + 28 * s3 - 15 * s4;
+		GLfloat dr1 = 30 * s2 - 60 * s3 + 30 * s4;
+
+		BodyState state;
+		state.position = hr0 * r0 + (hv0 * h) * v0 + (ha0 * h * h) * a0 +
+		                 hr1 * r1 + (hv1 * h) * v1 + (ha1 * h * h) * a1;
+		state.velocity = (dr0 / h) * r0 + dv0 * v0 + (da0 * h) * a0 +
+		                 (dr1 / h) * r1 + dv1 * v1 + (da1 * h) * a1;
+		return state;
+	}
+
+	/* Getters. */
+	GLdouble       getStartTime()       const     {  return t0;              }
+	GLdouble       getEndTime()         const     {  return t1;              }
+
+/* Protected Members. */
+protected:
+	/* Start and end times of the step. */
+	GLdouble       t0, t1;
+	/* Positions at the start and end of the step. */
+	glm::vec3      r0, r1;
+	/* Velocities at the start and end of the step. */
+	glm::vec3      v0, v1;
+	/* Accelerations at the start and end of the step. */
+	glm::vec3      a0, a1;
+};
@@ -0,0 +1,205 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <algorithm>
+#include "KSRegularization.h"
+
+/******************************************************************************
+*                                                                             *
+*                               Local Helpers                                 *
+*                                                                             *
+******************************************************************************/
+/* Product L(u) x of the KS matrix with a 4-vector. */
+static glm::dvec4 multiplyL(const glm::dvec4& u, const glm::dvec4& x)
+{
+	return glm::dvec4(u.x * x.x - u.y * x.y - u.z * x.z + u.w * x.w,
+	                  u.y * x.x + u.x * x.y - u.w * x.z - u.z * x.w,
+	                  u.z * x.x + u.w * x.y + u.x * x.z + u.y * x.w,
+	                  u.w * x.x - u.z * x.y + u.y * x.z - u.x * x.w);
+}
+
+/* Product L(u)^T p with a 3-vector (whose fourth component is zero). */
+static glm::dvec4 multiplyLT(const glm::dvec4& u, const glm::dvec3& p)
+{
+	return glm::dvec4( u.x * p.x + u.y * p.y + u.z * p.z,
+	                  -u.y * p.x + u.x * p.y + u.w * p.z,
+	                  -u.z * p.x - u.w * p.y + u.x * p.z,
+	                   u.w * p.x - u.z * p.y + u.y * p.z);
+}
+
+/* Derivative of a KS state with respect to s under the tidal tensor at t. */
+static KSState derivative(const KSState& y, GLdouble t0, GLdouble dt,
+                          const glm::mat3& tidalStart, const glm::mat3& tidalEnd)
+{
+	glm::dvec3 r(multiplyL(y.u, y.u));
+	GLdouble   rLength = glm::dot(y.u, y.u);
+	GLdouble   f       = (dt > 0) ? std::min(1.0, std::max(0.0, (y.t - t0) / dt)) : 0;
+	glm::dmat3 tidal   = glm::dmat3(tidalStart) +
+	                     f * (glm::dmat3(tidalEnd) - glm::dmat3(tidalStart));
+	glm::dvec3 p       = tidal * r;
+	glm::dvec4 lp      = multiplyLT(y.u, p);
+
+	KSState d;
+	d.u      = y.w;
+	d.w      = 0.5 * y.energy * y.u + 0.5 * rLength * lp;
+	d.energy = 2.0 * glm::dot(y.w, lp);
+	d.t      = rLength;
+	return d;
+}
+
+/* y + h * d for every component. */
+static KSState axpy(const KSState& y, GLdouble h, const KSState& d)
+{
+	KSState out;
+	out.u      = y.u      + h * d.u;
+	out.w      = y.w      + h * d.w;
+	out.energy = y.energy + h * d.energy;
+	out.t      = y.t      + h * d.t;
+	return out;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             KSIntegrator::toKS                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param r, v                                                                *
+*           Relative position and velocity of the pair.                       *
+*  @param mu                                                                  *
+*           G times the total mass of the pair.                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The regularized state, at t = 0.                                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Of the circle of u that map to r, takes the one with u4 = 0 (or u3 = 0     *
+*  when x < 0, to avoid dividing by a small number). Then w = L(u)^T v / 2.   *
+*                                                                             *
+*******************************************************************************/
+KSState KSIntegrator::toKS(const glm::dvec3& r, const glm::dvec3& v, GLdouble mu)
+{
+	GLdouble rLength = glm::length(r);
+	KSState  ks;
+
+	if (r.x >= 0)
+	{
+		GLdouble u1 = sqrt(0.5 * (rLength + r.x));
+		ks.u = (u1 > 0) ? glm::dvec4(u1, 0.5 * r.y / u1, 0.5 * r.z / u1, 0.0)
+		                : glm::dvec4(0.0);
+	}
+	else
+	{
+		GLdouble u2 = sqrt(0.5 * (rLength - r.x));
+		ks.u = glm::dvec4(0.5 * r.y / u2, u2, 0.0, 0.5 * r.z / u2);
+	}
+
+	ks.w      = 0.5 * multiplyLT(ks.u, v);
+	ks.energy = 0.5 * glm::dot(v, v) - ((rLength > 0) ? mu / rLength : 0);
+	ks.t      = 0;
+	return ks;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            KSIntegrator::fromKS                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param ks                                                                  *
+*           The regularized state.                                            *
+*  @param r, v                                                                *
+*           Output relative position and velocity.                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  r = L(u) u and v = 2 L(u) w / |u|^2.                                       *
+*                                                                             *
+*******************************************************************************/
+void KSIntegrator::fromKS(const KSState& ks, glm::dvec3& r, glm::dvec3& v)
+{
+	GLdouble rLength = glm::dot(ks.u, ks.u);
+
+	r = glm::dvec3(multiplyL(ks.u, ks.u));
+	v = (rLength > 0) ? glm::dvec3(multiplyL(ks.u, ks.w)) * (2.0 / rLength)
+	                  : glm::dvec3(0.0);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           KSIntegrator::advance                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param r, v                                                                *
+*           Relative position and velocity, advanced in place.                *
+*  @param mu                                                                  *
+*           G times the total mass of the pair.                               *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Physical time to advance by.                                      *
+*  @param tidalStart, tidalEnd                                                *
+*           Tidal tensor of the rest of the system at the start and end of    *
+*           the interval; the relative motion feels tidal * r.                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Steps in s until the physical time reaches dt. Near the end each step is   *
+*  the remaining time divided by the current r (negative after an overshoot), *
+*  a Newton iteration which lands on dt to within KS_TIME_TOLERANCE after a   *
+*  few steps; the tiny remainder is covered by a straight drift.              *
+*                                                                             *
+*******************************************************************************/
+void KSIntegrator::advance(glm::dvec3& r, glm::dvec3& v, GLdouble mu,
+                           GLdouble dt, const glm::mat3& tidalStart,
+                           const glm::mat3& tidalEnd)
+{
+	lastSteps = 0;
+	if (dt <= 0)
+		return;
+
+	/* Without gravity between them the pair just drifts. */
+	if (mu <= 0 || glm::dot(r, r) == 0)
+	{
+		r += dt * v;
+		return;
+	}
+
+	const GLdouble pi  = 3.14159265358979323846;
+	GLdouble       eta = 2 * pi / std::max(1u, stepsPerOrbit);
+	KSState        y   = toKS(r, v, mu);
+
+	while (fabs(dt - y.t) > KS_TIME_TOLERANCE * dt && lastSteps < KS_MAX_STEPS)
+	{
+		/* The last steps aim at dt, and step back if r grew and they overshot. */
+		GLdouble rLength = glm::dot(y.u, y.u);
+		GLdouble h       = std::min(eta * sqrt(rLength / mu), (dt - y.t) / rLength);
+
+		KSState k1 = derivative(y, 0, dt, tidalStart, tidalEnd);
+		KSState k2 = derivative(axpy(y, 0.5 * h, k1), 0, dt, tidalStart, tidalEnd);
+		KSState k3 = derivative(axpy(y, 0.5 * h, k2), 0, dt, tidalStart, tidalEnd);
+		KSState k4 = derivative(axpy(y, h, k3), 0, dt, tidalStart, tidalEnd);
+
+		y.u      += (h / 6) * (k1.u      + 2.0 * k2.u      + 2.0 * k3.u      + k4.u);
+		y.w      += (h / 6) * (k1.w      + 2.0 * k2.w      + 2.0 * k3.w      + k4.w);
+		y.energy += (h / 6) * (k1.energy + 2 * k2.energy + 2 * k3.energy + k4.energy);
+		y.t      += (h / 6) * (k1.t      + 2 * k2.t      + 2 * k3.t      + k4.t);
+		lastSteps++;
+	}
+
+	fromKS(y, r, v);
+	r += (dt - y.t) * v;
+}
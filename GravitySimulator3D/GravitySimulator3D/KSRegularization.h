@@ -0,0 +1,120 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default number of regularized steps per circular orbit of the pair. */
+#define   KS_STEPS_PER_ORBIT                  128
+/* Largest number of regularized steps in one call (guards a stalled pair). */
+#define   KS_MAX_STEPS                     100000
+/* Relative mismatch in time at which the final step is accepted. */
+#define   KS_TIME_TOLERANCE                1.0e-9
+
+/******************************************************************************
+*                                                                             *
+*                              KSState (struct)                               *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  u                                                                          *
+*          Regularized coordinates, with r = L(u) u.                          *
+*  w                                                                          *
+*          Derivative of u with respect to the fictitious time s.             *
+*  energy                                                                     *
+*          Kepler energy of the relative motion per unit reduced mass,        *
+*          v^2 / 2 - mu / r (negative while the pair is bound).               *
+*  t                                                                          *
+*          SECONDS                                                            *
+*          Physical time, with dt / ds = r.                                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Kustaanheimo-Stiefel state of the relative motion of a pair.               *
+*                                                                             *
+*******************************************************************************/
+struct KSState
+{
+	glm::dvec4 u;
+	glm::dvec4 w;
+	GLdouble   energy;
+	GLdouble   t;
+};
+
+/******************************************************************************
+ *																			  *
+ *                             KSIntegrator Class                             *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  stepsPerOrbit                                                             *
+ *          Resolution of the regularized steps.                              *
+ *  lastSteps                                                                 *
+ *          Number of regularized steps taken by the last call to advance.    *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Integrates the relative motion r of two bodies under their mutual         *
+ *  gravity, mu = G (m1 + m2), plus a perturbing acceleration that is linear  *
+ *  in r (the tidal field of the rest of the system), in Kustaanheimo-Stiefel *
+ *  coordinates. With the fictitious time ds = dt / r the unperturbed motion  *
+ *  becomes a harmonic oscillator in u, free of the 1 / r^2 singularity, so   *
+ *  a close pericenter needs no smaller steps in s than the rest of the       *
+ *  orbit: the steps in t shrink in proportion to r on their own. Uses        *
+ *  fourth order Runge-Kutta in s, in double precision, with steps of         *
+ *  2 pi sqrt(r / mu) / stepsPerOrbit.                                        *
+ *                                                                            *
+ ******************************************************************************/
+class KSIntegrator
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   KSIntegrator (GLuint stepsPerOrbit = KS_STEPS_PER_ORBIT) :
+	                       stepsPerOrbit(stepsPerOrbit), lastSteps(0) {}
+
+	/* Advance r, v by dt under mu and a tidal tensor moving linearly in time. */
+	void               advance      (glm::dvec3&      r,
+	                                 glm::dvec3&      v,
+	                                 GLdouble         mu,
+	                                 GLdouble         dt,
+	                                 const glm::mat3& tidalStart,
+	                                 const glm::mat3& tidalEnd);
+
+	/* Regularize a relative position and velocity. */
+	static KSState     toKS         (const glm::dvec3& r,
+	                                 const glm::dvec3& v,
+	                                 GLdouble          mu);
+
+	/* Physical position and velocity of a regularized state. */
+	static void        fromKS       (const KSState&    ks,
+	                                 glm::dvec3&       r,
+	                                 glm::dvec3&       v);
+
+	/* Getters. */
+	GLuint             getStepsPerOrbit()  const  {  return stepsPerOrbit;   }
+	GLuint             getLastSteps()      const  {  return lastSteps;       }
+
+	/* Setters. */
+	void               setStepsPerOrbit(GLuint n) {  stepsPerOrbit = n;      }
+
+	/* Destructor. */
+	                  ~KSIntegrator()                                      {}
+
+/* Private Members. */
+private:
+
+	/* Resolution and statistics. */
+	GLuint             stepsPerOrbit;
+	GLuint             lastSteps;
+};
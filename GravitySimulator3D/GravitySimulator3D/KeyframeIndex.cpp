@@ -0,0 +1,304 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <algorithm>
+#include "KeyframeIndex.h"
+#include "OrbitalSystem.h"
+
+/******************************************************************************
+*                                                                             *
+*                   KeyframeIndex::KeyframeIndex (Constructor)                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param spacing                                                             *
+*           SECONDS                                                           *
+*           Simulation time between keyframes.                                *
+*  @param maxKeyframes                                                        *
+*           Number of keyframes kept before the index is thinned.             *
+*  @param maxBytes                                                            *
+*           Bytes of state the keyframes may hold before the index is         *
+*           thinned.                                                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the KeyframeIndex class.                                   *
+*                                                                             *
+*******************************************************************************/
+KeyframeIndex::KeyframeIndex(GLfloat spacing, GLuint maxKeyframes,
+                             size_t maxBytes) :
+	spacing(spacing), maxKeyframes(std::max(2u, maxKeyframes)),
+	maxBytes(maxBytes)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                         KeyframeIndex::getNumBytes                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Bytes of body state held by the keyframes.                                 *
+*                                                                             *
+*******************************************************************************/
+size_t KeyframeIndex::getNumBytes() const
+{
+	size_t bytes = 0;
+	for (const Keyframe& k : keyframes)
+		bytes += k.state.positions.size()       * sizeof(glm::vec3) +
+		         k.state.velocities.size()      * sizeof(glm::vec3) +
+		         k.state.masses.size()          * sizeof(GLfloat)   +
+		         k.attitude.orientations.size() * sizeof(glm::quat) +
+		         k.attitude.spins.size()        * sizeof(glm::vec3) +
+		         k.attitude.torques.size()      * sizeof(glm::vec3) +
+		         k.attitude.inertia.size()      * sizeof(glm::vec3);
+	return bytes;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            KeyframeIndex::find                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param t                                                                   *
+*           SECONDS                                                           *
+*           Time of interest.                                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Index of the last keyframe at or before t, or -1 if there is none.         *
+*                                                                             *
+*******************************************************************************/
+GLint KeyframeIndex::find(GLdouble t) const
+{
+	return (GLint) (std::upper_bound(keyframes.begin(), keyframes.end(), t,
+	                [](GLdouble time, const Keyframe& k)
+	                { return time < k.state.t; }) - keyframes.begin()) - 1;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           KeyframeIndex::onStep                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has just completed a step.               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Records a keyframe once a spacing has passed since the one before, and     *
+*  when the next one (left from before a backwards seek) is at least a        *
+*  spacing away, so replaying a stretch does not crowd it with keyframes.     *
+*                                                                             *
+*******************************************************************************/
+void KeyframeIndex::onStep(OrbitalSystem& system)
+{
+	GLdouble t    = system.t();
+	GLint    last = find(t);
+
+	if (last >= 0 && t - keyframes[last].state.t < spacing)
+		return;
+	if (last + 1 < (GLint) keyframes.size() &&
+	    keyframes[last + 1].state.t - t < spacing)
+		return;
+
+	record(system);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           KeyframeIndex::record                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system to snapshot.                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Inserts a snapshot in time order, replacing any at the same time. While    *
+*  the index holds too many keyframes, or too many bytes, every other         *
+*  keyframe is dropped and the spacing is doubled, so the keyframes always    *
+*  cover the whole run evenly. Two keyframes are always kept.                 *
+*                                                                             *
+*******************************************************************************/
+void KeyframeIndex::record(OrbitalSystem& system)
+{
+	Keyframe keyframe;
+	system.gatherState(keyframe.state);
+	keyframe.attitude = *system.getAttitude();
+
+	GLint last = find(keyframe.state.t);
+	if (last >= 0 && keyframes[last].state.t == keyframe.state.t)
+		keyframes[last] = keyframe;
+	else
+		keyframes.insert(keyframes.begin() + (last + 1), keyframe);
+
+	while (keyframes.size() > 2 &&
+	       (keyframes.size() > maxKeyframes || getNumBytes() > maxBytes))
+	{
+		GLuint kept = 0;
+		for (GLuint k = 0; k < keyframes.size(); k += 2)
+			std::swap(keyframes[kept++], keyframes[k]);
+		keyframes.resize(kept);
+		spacing *= 2;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          KeyframeIndex::onReorder                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has rearranged its bodies.               *
+*  @param order                                                               *
+*           Old index of the body now at each index.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Keyframes are restored by index, so each one is rearranged the same way    *
+*  as the system. Keyframes taken with a different number of bodies cannot    *
+*  be restored anyway and are left alone.                                     *
+*                                                                             *
+*******************************************************************************/
+void KeyframeIndex::onReorder(OrbitalSystem&,
+                              const std::vector<GLuint>& order)
+{
+	for (Keyframe& k : keyframes)
+	{
+		if (k.state.positions.size() != order.size())
+			continue;
+
+		MortonOrder::apply(k.state.positions, order);
+		MortonOrder::apply(k.state.velocities, order);
+		MortonOrder::apply(k.state.masses, order);
+		k.attitude.reorder(order);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           KeyframeIndex::onRemove                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which is removing a body.                      *
+*  @param i                                                                   *
+*           Index of the body being removed.                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Removes the body from each keyframe the same way as from the system, so    *
+*  the remaining bodies can still be restored; seeking back then replays the  *
+*  past without the removed body.                                             *
+*                                                                             *
+*******************************************************************************/
+void KeyframeIndex::onRemove(OrbitalSystem& system, GLuint i)
+{
+	GLuint n = system.getNumBodies();
+	for (Keyframe& k : keyframes)
+	{
+		if (k.state.positions.size() != n)
+			continue;
+
+		k.state.positions[i]  = k.state.positions[n - 1];
+		k.state.velocities[i] = k.state.velocities[n - 1];
+		k.state.masses[i]     = k.state.masses[n - 1];
+		k.state.positions.pop_back();
+		k.state.velocities.pop_back();
+		k.state.masses.pop_back();
+		k.attitude.swapRemove(i);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                            KeyframeIndex::seek                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system to move.                                       *
+*  @param t                                                                   *
+*           SECONDS                                                           *
+*           Simulation time to move to.                                       *
+*  @param maxStep                                                             *
+*           SECONDS                                                           *
+*           Largest step used to integrate from the keyframe.                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The time reached: t, or the first keyframe if t is earlier than it, or     *
+*  the current time if no keyframe before t holds the system's bodies.        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Starts from whichever is latest of the current state and the keyframes     *
+*  not after t, restoring a keyframe only when it is needed, then             *
+*  integrates the rest of the way without notifying the observers.            *
+*                                                                             *
+*******************************************************************************/
+GLdouble KeyframeIndex::seek(OrbitalSystem& system, GLdouble t, GLfloat maxStep)
+{
+	GLint k = find(t);
+
+	/* Nothing is known before the first keyframe. */
+	if (k < 0 && !keyframes.empty() && t < system.t())
+	{
+		k = 0;
+		t = keyframes[0].state.t;
+	}
+
+	/* Keyframes from before bodies were added no longer fit the system. */
+	while (k >= 0 && keyframes[k].state.positions.size() != system.getNumBodies())
+		k--;
+
+	/* Restore unless the system is already at or past the keyframe. */
+	bool ahead = (t >= system.t());
+	if (k >= 0 && !(ahead && keyframes[k].state.t <= system.t()))
+		system.restoreState(keyframes[k].state, keyframes[k].attitude);
+
+	/* Integrate the remainder silently. */
+	while (system.t() < t)
+	{
+		GLfloat dt = (GLfloat) std::min((GLdouble) maxStep, t - system.t());
+		system.advance(dt, false);
+
+		/* Stop if the clock can no longer resolve the step. */
+		if (system.t() == system.getStepStart())
+			break;
+	}
+
+	return system.t();
+}
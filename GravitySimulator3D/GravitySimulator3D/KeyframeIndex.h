@@ -0,0 +1,129 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  "StepObserver.h"
+#include  "NBodyIntegrator.h"
+#include  "AttitudeIntegrator.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default simulation time between keyframes (one day). */
+#define   KEYFRAME_SPACING               86400.0f
+/* Default number of keyframes kept before the index is thinned. */
+#define   MAX_KEYFRAMES                     4096
+/* Default bytes of state kept before the index is thinned (64 MB). */
+#define   MAX_KEYFRAME_BYTES            67108864
+
+/******************************************************************************
+*                                                                             *
+*                             Keyframe (struct)                               *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  state                                                                      *
+*          Translational state of every body, and the time of the keyframe.   *
+*  attitude                                                                   *
+*          Rotational state of every body.                                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Full snapshot of a system from which a run can be resumed.                 *
+*                                                                             *
+*******************************************************************************/
+struct Keyframe
+{
+	NBodyState     state;
+	AttitudeState  attitude;
+};
+
+/******************************************************************************
+ *																			  *
+ *                            KeyframeIndex Class                             *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  spacing                                                                   *
+ *          SECONDS                                                           *
+ *          Simulation time between keyframes.                                *
+ *  maxKeyframes, maxBytes                                                    *
+ *          Number of keyframes, and bytes of state they hold, kept before    *
+ *          every other one is dropped and the spacing doubled. This bounds   *
+ *          memory for any length of run and any number of bodies.            *
+ *  keyframes                                                                 *
+ *          Snapshots in time order.                                          *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Step observer which snapshots the whole system at regular intervals of    *
+ *  simulation time, so a run can be sought to any time already reached       *
+ *  (or beyond) by restoring the nearest earlier keyframe and integrating     *
+ *  forward the remaining distance, which is never more than one spacing.     *
+ *  Re-integration is silent: no other observer sees the replayed steps.      *
+ *                                                                            *
+ ******************************************************************************/
+class KeyframeIndex : public StepObserver
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                       KeyframeIndex(GLfloat spacing      = KEYFRAME_SPACING,
+	                                     GLuint  maxKeyframes = MAX_KEYFRAMES,
+	                                     size_t  maxBytes     = MAX_KEYFRAME_BYTES);
+
+	/* Take a keyframe when one spacing has passed since the last. */
+	virtual void           onStep       (OrbitalSystem& system);
+
+	/* Rearrange every keyframe to match the system's new body order. */
+	virtual void           onReorder    (OrbitalSystem&             system,
+	                                     const std::vector<GLuint>& order);
+
+	/* Take a body leaving the system out of every keyframe. */
+	virtual void           onRemove     (OrbitalSystem&             system,
+	                                     GLuint                     i);
+
+	/* Take a keyframe of the system now. */
+	void                   record       (OrbitalSystem& system);
+
+	/* Move the system to time t, in steps no longer than maxStep. */
+	GLdouble               seek         (OrbitalSystem& system,
+	                                     GLdouble       t,
+	                                     GLfloat        maxStep);
+
+	/* Forget every keyframe. */
+	void                   clear()             {  keyframes.clear();     }
+
+	/* Getters. */
+	GLuint                 getNumKeyframes()   const  {  return keyframes.size(); }
+	GLfloat                getSpacing()        const  {  return spacing;         }
+	size_t                 getNumBytes()       const;
+	GLdouble               getStartTime()      const
+	                       {  return keyframes.empty() ? 0 : keyframes.front().state.t;  }
+	GLdouble               getEndTime()        const
+	                       {  return keyframes.empty() ? 0 : keyframes.back().state.t;   }
+
+	/* Destructor. */
+	virtual               ~KeyframeIndex()                                 {}
+
+/* Private Members. */
+private:
+
+	/* Spacing and capacity. */
+	GLfloat                spacing;
+	GLuint                 maxKeyframes;
+	size_t                 maxBytes;
+	/* Snapshots in time order. */
+	std::vector<Keyframe>  keyframes;
+
+	/* Index of the last keyframe at or before t (-1 for none). */
+	GLint                  find         (GLdouble t) const;
+};
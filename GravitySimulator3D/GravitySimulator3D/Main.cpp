@@ -11,6 +11,11 @@
 #include <iostream>
 #include <string>
 #include <ctime>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <csignal>
 #include "Display.h"
 #include "Shader.h"
 #include "Geometry.h"
@@ -19,6 +24,20 @@
 #include "OrbitalBody.h"
 #include "OrbitalSystem.h"
 #include "Planet.h"
+#include "EventDetector.h"
+#include "WorkerPool.h"
+#include "TimeWarpScheduler.h"
+#include "Parareal.h"
+#include "TrajectorySearch.h"
+#include "ParticleMesh.h"
+#include "OrbitalAnalytics.h"
+#include "TrajectoryArchive.h"
+#include "KeyframeIndex.h"
+#include "SharedState.h"
+#include "DistributedSystem.h"
+#include "FieldSampler.h"
+#include "QualityGovernor.h"
+#include "ResultCache.h"
 
 /*******************************************************************************
  *                                                                             *
@@ -34,6 +53,23 @@
 #define  SHADERS_PATH         "res/shaders/";
 #define  FRAMES_PER_SECOND    100
 #define  PROJECT_TITLE        "GravitySimulator3D"
+#define  SYSTEM_FILE          "res/data/system.xml"
+#define  BENCHMARK_BODIES     1024
+#define  BENCHMARK_STEPS      10
+#define  BENCHMARK_DT         1.0e-3f
+#define  BENCHMARK_SEED       42
+#define  MESH_SAMPLE_STRIDE   97
+#define  PORKCHOP_FILE        "porkchop.csv"
+#define  PARKING_RADIUS_RATIO 1.1f
+#define  ANALYTICS_FILE       "orbits.csv"
+#define  MULTIRATE_RATIO      4
+#define  REORDER_STEPS        64
+#define  FIELD_RESOLUTION     128
+#define  FIELD_VIEW_SPAN      1.25f
+#define  FIELD_VIEW_DEPTH     0.2f
+#define  FIELD_VIEW_CLIP      4.0f
+#define  CACHE_DIRECTORY      "cache"
+#define  APPROACH_RADII       10.0f
 #define  PRINT(a)             std::cout << a << std::endl;
 
 /*******************************************************************************
@@ -44,6 +80,12 @@
 /* Speed of the simulation. */
 GLfloat speed = + 8.000e2f;
 
+/* Pending jump in simulation time, set by the scrub keys. */
+GLfloat seek  = + 0.000e0f;
+
+/* Set by an interrupt to stop a headless server. */
+volatile sig_atomic_t serverStopped = 0;
+
 /* Unit vectors for the 3-D space. */
 glm::vec3  bases[] =
 	{
@@ -52,6 +94,704 @@ glm::vec3  bases[] =
         {+0.0f, +0.0f, +1.0f}
     };
 
+/*******************************************************************************
+ *                                                                             *
+ *                                 runParareal                                 *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  duration                                                                   *
+ *        Number of simulation seconds to integrate.                           *
+ *  slices                                                                     *
+ *        Number of Parareal time slices (0 uses one per hardware thread).     *
+ *  cache                                                                      *
+ *        Store the result may be served from and is kept in (or nullptr).     *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Offline, headless run of the system file using the Parareal driver, so a   *
+ *  long horizon can be split across every core. Prints the final state. A     *
+ *  run of the same scene with the same settings is served from the cache.    *
+ *                                                                             *
+ *******************************************************************************/
+int runParareal(GLfloat duration, GLuint slices, ResultCache* cache)
+{
+	/* Load the system without any geometry (no GL context is needed). */
+	OrbitalSystem system = OrbitalSystem::loadFile(SYSTEM_FILE, false);
+	NBodyState    initial;
+	system.gatherState(initial);
+
+	/* Coarse leapfrog steps are a multiple of the fine Runge-Kutta step. */
+	WorkerPool     pool;
+	PararealConfig config = { slices, 
+	                          PARAREAL_COARSE_FACTOR * MAX_DELTA_T, 
+	                          MAX_DELTA_T, 
+	                          PARAREAL_MAX_ITERATIONS, 
+	                          PARAREAL_TOLERANCE };
+	Parareal       parareal(&pool, config);
+
+	/* The result depends on the scene, every setting and the horizon. */
+	ContentHash key;
+	key.add(std::string("parareal"));
+	key.addFile(SYSTEM_FILE);
+	key.addValue(slices ? slices : pool.getNumThreads());
+	key.addValue(config.coarseStep);
+	key.addValue(config.fineStep);
+	key.addValue(config.maxIterations);
+	key.addValue(config.tolerance);
+	key.addValue(duration);
+
+	/* Serve an identical earlier run, or run and time the integration. */
+	NBodyState result;
+	if (cache != nullptr && cache->getState(key.getValue(), result))
+		PRINT("Parareal: served from the cache")
+	else
+	{
+		std::clock_t start = std::clock();
+		result             = parareal.run(initial, duration);
+		std::clock_t end   = std::clock();
+
+		PRINT("Parareal: " << parareal.getIterations() << " iterations, "
+		      << "relative change " << parareal.getLastChange() << ", "
+		      << ((GLfloat) (end - start) / CLOCKS_PER_SEC) << " s CPU")
+		if (cache != nullptr && !cache->putState(key.getValue(), result))
+			PRINT("Could not cache the result")
+	}
+	for (GLuint i = 0; i < system.getNumBodies(); i++)
+		PRINT(system.getBody(i)->getName() << ": {" 
+		      << result.positions[i].x << ", " 
+		      << result.positions[i].y << ", " 
+		      << result.positions[i].z << "}")
+
+	system.cleanUp();
+	return 0;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                                runTrajectory                                *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  duration                                                                   *
+ *        Number of simulation seconds to record.                              *
+ *  file                                                                       *
+ *        Trajectory archive to write.                                         *
+ *  cache                                                                      *
+ *        Store the archive may be served from and is kept in (or nullptr).    *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Offline, headless recording of the system file over the given time, in     *
+ *  steps of at most MAX_DELTA_T, to a compressed trajectory archive for       *
+ *  reports and dashboards. A recording of the same scene over the same time   *
+ *  is copied out of the cache instead of being simulated again.               *
+ *                                                                             *
+ *******************************************************************************/
+int runTrajectory(GLfloat duration, const char* file, ResultCache* cache)
+{
+	/* The archive depends on the scene, the step, the horizon and the format. */
+	ContentHash key;
+	key.add(std::string("trajectory"));
+	key.addFile(SYSTEM_FILE);
+	key.addValue(MAX_DELTA_T);
+	key.addValue(duration);
+	key.addValue(ARCHIVE_POSITION_TOLERANCE);
+	key.addValue(ARCHIVE_VELOCITY_TOLERANCE);
+	key.addValue(ARCHIVE_BLOCK_FRAMES);
+	key.addValue(ARCHIVE_VERSION);
+
+	if (cache != nullptr && cache->getFile(key.getValue(), file))
+	{
+		PRINT("Trajectory: served " << file << " from the cache")
+		return 0;
+	}
+
+	/* Load the system without any geometry (no GL context is needed). */
+	OrbitalSystem    system = OrbitalSystem::loadFile(SYSTEM_FILE, false);
+	TrajectoryWriter recorder(file, ARCHIVE_POSITION_TOLERANCE, 
+	                          ARCHIVE_VELOCITY_TOLERANCE);
+	WorkerPool       pool;
+	system.setWorkerPool(&pool);
+	system.addObserver(&recorder);
+
+	/* Equal steps within the accuracy limit, each recorded as a frame. */
+	GLuint       steps = std::max(1u, (GLuint) ceil(duration / MAX_DELTA_T));
+	std::clock_t start = std::clock();
+	for (GLuint k = 0; k < steps; k++)
+		system.advance(duration / steps, true);
+	std::clock_t end   = std::clock();
+
+	system.removeObserver(&recorder);
+	bool written = recorder.close();
+	PRINT("Trajectory: " << recorder.getNumFrames() << " frames, " 
+	      << ((GLfloat) (end - start) / CLOCKS_PER_SEC) << " s CPU")
+	system.cleanUp();
+
+	if (!written)
+	{
+		PRINT("Could not write " << file)
+		return 1;
+	}
+	if (cache != nullptr && !cache->putFile(key.getValue(), file))
+		PRINT("Could not cache " << file)
+	return 0;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                                 runPorkchop                                 *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  origin, target                                                             *
+ *        Names of the departure and arrival bodies.                           *
+ *  window                                                                     *
+ *        Simulation seconds over which launch dates are searched.             *
+ *  flight                                                                     *
+ *        Longest time of flight, in simulation seconds.                       *
+ *  gridSize                                                                   *
+ *        Number of launch and arrival dates.                                  *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Offline, headless transfer search between two bodies of the system file.   *
+ *  The heaviest body is taken as the center of the transfer, the probe        *
+ *  leaves from a low parking orbit around the origin, and the grid of launch  *
+ *  and arrival dates is written to PORKCHOP_FILE.                             *
+ *                                                                             *
+ *******************************************************************************/
+int runPorkchop(const std::string& origin, const std::string& target,
+                GLfloat window, GLfloat flight, GLuint gridSize)
+{
+	/* Load the system without any geometry (no GL context is needed). */
+	OrbitalSystem   system = OrbitalSystem::loadFile(SYSTEM_FILE, false);
+	NBodyState      initial;
+	system.gatherState(initial);
+
+	/* Find the bodies of the transfer. */
+	TransferProblem problem = { 0, 0, 0, 0, 0 };
+	bool            foundOrigin = false, foundTarget = false;
+	for (GLuint i = 0; i < system.getNumBodies(); i++)
+	{
+		OrbitalBody* body = system.getBody(i);
+		if (body->getMass() > system.getBody(problem.central)->getMass())
+			problem.central = i;
+		if (body->getName() == origin)
+		{
+			problem.origin = i;
+			foundOrigin    = true;
+		}
+		if (body->getName() == target)
+		{
+			problem.target = i;
+			foundTarget    = true;
+		}
+	}
+	if (!foundOrigin || !foundTarget || problem.origin == problem.target)
+	{
+		PRINT("Unknown or identical bodies: " << origin << ", " << target)
+		system.cleanUp();
+		return 1;
+	}
+	problem.parkingRadius = PARKING_RADIUS_RATIO * 
+	                        system.getBody(problem.origin)->getRadius();
+
+	/* Record the system once, then search the grid across every core. */
+	WorkerPool                pool;
+	std::clock_t              start = std::clock();
+	Ephemeris                 ephemeris(initial, window + flight, MAX_DELTA_T, 
+	                                    &pool);
+	TrajectorySearch          search(&ephemeris, &pool, MAX_DELTA_T);
+	std::vector<PorkchopCell> cells;
+	search.porkchop(problem, initial.t, initial.t + window,
+	                initial.t + flight / gridSize, initial.t + window + flight,
+	                gridSize, cells);
+	std::clock_t              end   = std::clock();
+
+	/* Report the cheapest transfer. */
+	const PorkchopCell* best = nullptr;
+	for (const PorkchopCell& c : cells)
+		if (c.valid && (best == nullptr || 
+		    c.departureDeltaV + c.arrivalDeltaV < 
+		    best->departureDeltaV + best->arrivalDeltaV))
+			best = &c;
+
+	PRINT("Porkchop: " << cells.size() << " cells, " 
+	      << ((GLfloat) (end - start) / CLOCKS_PER_SEC) << " s CPU")
+	if (best != nullptr)
+		PRINT("Best: depart " << best->departure << ", arrive " 
+		      << best->arrival << ", delta-v " << best->departureDeltaV 
+		      << " + " << best->arrivalDeltaV << ", miss distance " 
+		      << best->missDistance)
+
+	bool written = TrajectorySearch::writeCsv(PORKCHOP_FILE, cells);
+	if (!written)
+		PRINT("Could not write " << PORKCHOP_FILE)
+
+	system.cleanUp();
+	return written ? 0 : 1;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                             runMeshBenchmark                                *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  numBodies                                                                  *
+ *        Number of bodies in the synthetic cloud (at least one).              *
+ *  gridSize                                                                   *
+ *        Number of mesh cells along each axis, rounded up to a power of two.  *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0.                                                                         *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Times one force evaluation of a seeded uniform sphere with direct          *
+ *  summation, the particle-mesh solver and the P3M solver, and reports the    *
+ *  relative error of each solver against the direct forces on a sample of     *
+ *  bodies.                                                                    *
+ *                                                                             *
+ *******************************************************************************/
+int runMeshBenchmark(GLuint numBodies, GLuint gridSize)
+{
+	/* Seeded uniform sphere of equal masses. */
+	NBodyState state;
+	state.G = 1.0f;
+	state.t = 0.0f;
+	srand(BENCHMARK_SEED);
+	while (state.positions.size() < numBodies)
+	{
+		glm::vec3 p((GLfloat) rand() / RAND_MAX - 0.5f,
+		            (GLfloat) rand() / RAND_MAX - 0.5f,
+		            (GLfloat) rand() / RAND_MAX - 0.5f);
+		if (glm::dot(p, p) > 0.25f)
+			continue;
+		state.positions.push_back(p);
+		state.velocities.push_back(glm::vec3(0.0f));
+		state.masses.push_back(1.0f / numBodies);
+	}
+
+	WorkerPool             pool;
+	ParticleMesh           mesh(gridSize, &pool, false);
+	ParticleMesh           p3m(gridSize, &pool, true);
+	GravitySolver*         solvers[] = { nullptr, &mesh, &p3m };
+	const char*            names[]   = { "direct", "mesh", "p3m" };
+	std::vector<glm::vec3> accel[3];
+	PRINT(numBodies << " bodies on a mesh of " << mesh.getGridSize() << " cells per side")
+
+	for (GLuint s = 0; s < 3; s++)
+	{
+		NBodyIntegrator integrator(&pool);
+		integrator.setSolver(solvers[s]);
+
+		/* The first step builds the Green's function; time the second. */
+		for (GLuint k = 0; k < 2; k++)
+		{
+			NBodyState copy = state;
+			integrator.resetTimers();
+			integrator.rungeKutta(copy, BENCHMARK_DT);
+		}
+		accel[s] = integrator.getStartAccel();
+
+		PRINT(names[s] << ": " << integrator.getForceMillis() / 
+		      integrator.getForceEvaluations() << " ms per force evaluation")
+	}
+
+	/* Relative error of each solver on a sample of bodies. */
+	for (GLuint s = 1; s < 3; s++)
+	{
+		GLdouble sum = 0.0, worst = 0.0;
+		GLuint   count = 0;
+		for (GLuint i = 0; i < numBodies; i += MESH_SAMPLE_STRIDE, count++)
+		{
+			GLdouble error = glm::length(accel[s][i] - accel[0][i]) / 
+			                 glm::length(accel[0][i]);
+			sum  += error;
+			worst = std::max(worst, error);
+		}
+		PRINT(names[s] << " relative error: mean " << sum / count 
+		      << ", worst " << worst)
+	}
+
+	return 0;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                           runSummationBenchmark                             *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  numBodies                                                                  *
+ *        Number of bodies in the synthetic cloud.                             *
+ *  steps                                                                      *
+ *        Number of Runge-Kutta steps to time in each configuration.           *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 if deterministic summation was reproducible, 1 otherwise.                *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Measures the cost of deterministic force summation against the fast        *
+ *  sequential mode on a seeded random cloud, with one thread and with the     *
+ *  whole worker pool, and checks that the deterministic trajectories are      *
+ *  bitwise identical between the two thread counts.                           *
+ *                                                                             *
+ *******************************************************************************/
+int runSummationBenchmark(GLuint numBodies, GLuint steps)
+{
+	/* Seeded random cloud of equal masses. */
+	NBodyState initial;
+	initial.G = 1.0f;
+	initial.t = 0.0f;
+	srand(BENCHMARK_SEED);
+	for (GLuint i = 0; i < numBodies; i++)
+	{
+		initial.positions.push_back(glm::vec3(
+			(GLfloat) rand() / RAND_MAX - 0.5f,
+			(GLfloat) rand() / RAND_MAX - 0.5f,
+			(GLfloat) rand() / RAND_MAX - 0.5f));
+		initial.velocities.push_back(glm::vec3(0.0f));
+		initial.masses.push_back(1.0f / numBodies);
+	}
+
+	WorkerPool    pool;
+	SummationMode modes[] = { SummationMode::FAST, SummationMode::DETERMINISTIC };
+	const char*   names[] = { "fast", "deterministic" };
+	NBodyState    results[2][2];
+	GLdouble      millis[2][2];
+
+	/* Time every mode with one thread and with the whole pool. */
+	for (GLuint m = 0; m < 2; m++)
+	{
+		for (GLuint threaded = 0; threaded < 2; threaded++)
+		{
+			NBodyIntegrator integrator(threaded ? &pool : nullptr);
+			integrator.setSummationMode(modes[m]);
+
+			results[m][threaded] = initial;
+			for (GLuint k = 0; k < steps; k++)
+				integrator.rungeKutta(results[m][threaded], BENCHMARK_DT);
+
+			millis[m][threaded] = integrator.getForceMillis() / 
+			                      integrator.getForceEvaluations();
+			PRINT(names[m] << ", " << (threaded ? pool.getNumThreads() : 1) 
+			      << " thread(s): " << millis[m][threaded] 
+			      << " ms per force evaluation")
+		}
+	}
+
+	PRINT("Deterministic overhead: " 
+	      << 100.0 * (millis[1][1] / millis[0][1] - 1.0) << "%")
+
+	/* Deterministic trajectories must not depend on the thread count. */
+	bool identical = memcmp(results[1][0].positions.data(), 
+	                        results[1][1].positions.data(),
+	                        numBodies * sizeof(glm::vec3)) == 0;
+	PRINT("Deterministic results bitwise identical across thread counts: " 
+	      << (identical ? "yes" : "NO"))
+
+	return identical ? 0 : 1;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                                   runNode                                   *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  rank, size                                                                 *
+ *        Rank of this process, and number of processes in the run.            *
+ *  numBodies                                                                  *
+ *        Number of bodies in the synthetic cloud (0 uses the system file).    *
+ *  steps                                                                      *
+ *        Number of steps to take.                                             *
+ *  host                                                                       *
+ *        Address of rank 0.                                                   *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  One process of a distributed, headless run. Every process builds the same  *
+ *  initial state and keeps its share of it; rank 0 listens for the others,    *
+ *  so the processes may be started in any order on one machine or several.   *
+ *  Each reports its share and timing, and rank 0 the final state of the      *
+ *  first body (which does not depend on the number of processes when the     *
+ *  opening angle is 0).                                                       *
+ *                                                                             *
+ *******************************************************************************/
+int runNode(GLuint rank, GLuint size, GLuint numBodies, GLuint steps, const char* host)
+{
+	/* The same initial state on every process. */
+	NBodyState initial;
+	GLfloat    dt = BENCHMARK_DT;
+	if (numBodies > 0)
+	{
+		/* Seeded uniform sphere of equal masses. */
+		initial.G = 1.0f;
+		initial.t = 0.0f;
+		srand(BENCHMARK_SEED);
+		while (initial.positions.size() < numBodies)
+		{
+			glm::vec3 p((GLfloat) rand() / RAND_MAX - 0.5f,
+			            (GLfloat) rand() / RAND_MAX - 0.5f,
+			            (GLfloat) rand() / RAND_MAX - 0.5f);
+			if (glm::dot(p, p) > 0.25f)
+				continue;
+			initial.positions.push_back(p);
+			initial.velocities.push_back(glm::vec3(0.0f));
+			initial.masses.push_back(1.0f / numBodies);
+		}
+	}
+	else
+	{
+		OrbitalSystem system = OrbitalSystem::loadFile(SYSTEM_FILE, false);
+		system.gatherState(initial);
+		system.cleanUp();
+		dt = MAX_DELTA_T;
+	}
+
+	SocketTransport transport;
+	if (!transport.open(rank, size, host))
+	{
+		PRINT("Rank " << rank << " could not join a run of " << size)
+		return 1;
+	}
+
+	WorkerPool        pool;
+	DistributedSystem distributed(&transport, &pool);
+	distributed.distribute(initial);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (GLuint k = 0; k < steps; k++)
+	{
+		if (!distributed.step(dt))
+		{
+			PRINT("Rank " << rank << " lost the run at step " << k)
+			return 1;
+		}
+	}
+	std::chrono::duration<GLdouble, std::milli> spent = 
+		std::chrono::steady_clock::now() - start;
+
+	PRINT("Rank " << rank << ": " << distributed.getLocalState().positions.size()
+	      << " bodies, " << distributed.getNumGhosts() << " remote sources, "
+	      << spent.count() / std::max(1u, steps) << " ms per step ("
+	      << distributed.getExchangeMillis() << " ms exchanging), "
+	      << transport.getBytesSent() << " bytes sent")
+
+	NBodyState final;
+	if (!distributed.gather(final))
+		return 1;
+	if (rank == 0 && !final.positions.empty())
+		PRINT("t = " << final.t << ", body 0 at {" << final.positions[0].x << ", "
+		      << final.positions[0].y << ", " << final.positions[0].z << "}")
+	return 0;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                                 stopServer                                  *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  signal                                                                     *
+ *        The signal received.                                                 *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Interrupt handler which lets the server loop finish and remove its shared  *
+ *  segment.                                                                   *
+ *                                                                             *
+ *******************************************************************************/
+void stopServer(int)
+{
+	serverStopped = 1;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                                  runServer                                  *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  name                                                                       *
+ *        Name of the shared segment to publish.                               *
+ *  warp                                                                       *
+ *        Simulation seconds per real second.                                  *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Headless run of the system file in real time at the given warp, which      *
+ *  publishes the bodies to shared memory once per frame for any number of     *
+ *  viewers (see runViewer). Runs until interrupted.                           *
+ *                                                                             *
+ *******************************************************************************/
+int runServer(const char* name, GLfloat warp)
+{
+	/* Load the system without any geometry (no GL context is needed). */
+	OrbitalSystem     system = OrbitalSystem::loadFile(SYSTEM_FILE, false);
+	WorkerPool        pool;
+	TimeWarpScheduler scheduler(&system);
+	system.setWorkerPool(&pool);
+	scheduler.setWarp(warp);
+
+	SharedState server;
+	if (!server.create(name, std::max((GLuint) SHARED_STATE_CAPACITY, 
+	                                  system.getNumBodies())))
+	{
+		PRINT("Could not create shared state " << name)
+		return 1;
+	}
+	server.publish(system);
+	PRINT("Serving " << system.getNumBodies() << " bodies as " << name 
+	      << " at " << warp << "x")
+
+	signal(SIGINT,  stopServer);
+	signal(SIGTERM, stopServer);
+
+	/* Step in real time, publishing after every frame's worth of steps. */
+	std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+	while (!serverStopped)
+	{
+		std::this_thread::sleep_for(
+			std::chrono::milliseconds(MILLIS_PER_SECOND / FRAMES_PER_SECOND));
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		scheduler.advance(std::chrono::duration<GLfloat>(now - last).count());
+		server.publish(system);
+		last = now;
+	}
+
+	PRINT("Server stopped at t = " << system.t())
+	server.detach();
+	system.cleanUp();
+	return 0;
+}
+
+/*******************************************************************************
+ *                                                                             *
+ *                                  runViewer                                  *
+ *                                                                             *
+ *******************************************************************************
+ * PARAMETERS                                                                  *
+ *  name                                                                       *
+ *        Name of the shared segment to draw.                                  *
+ *                                                                             *
+ *******************************************************************************
+ * RETURNS                                                                     *
+ *  0 on success, any non-zero value on failure.                               *
+ *                                                                             *
+ *******************************************************************************
+ * DESCRIPTION                                                                 *
+ *  Draws a simulation published by runServer in another process. The meshes   *
+ *  come from the system file; the transforms are copied out of the shared    *
+ *  segment, and a frame the server overwrote during the copy is dropped in    *
+ *  favour of the last good one. The viewer attaches when the server starts,   *
+ *  detaches when it stops, and attaches again if it is restarted.             *
+ *                                                                             *
+ *******************************************************************************/
+int runViewer(const char* name)
+{
+	/* Initialize SDL with all subsystems. */
+	SDL_Init(SDL_INIT_EVERYTHING);
+
+	/* Create the display, shader, camera, and event manager. */
+	Display      display(PROJECT_TITLE, DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	Shader       shader(DEFAULT_VERTEX_SHADER, DEFAULT_FRAGMENT_SHADER);
+	Camera*      camera = display.getCamera();
+	EventManager eventManager(camera, &speed);
+
+	/* Apply the shaders and maximize the display. */
+	Geometry::shader = &shader;
+	display.setShader(shader);
+	display.maximize();
+
+	/* The local system only provides the meshes (stars first). */
+	OrbitalSystem           system = OrbitalSystem::loadFile(SYSTEM_FILE);
+	std::vector<Mesh*>      localMeshes     = system.getMeshes();
+	std::vector<glm::mat4*> localTransforms = system.getTransforms();
+	std::vector<Mesh*>      meshes;
+	std::vector<glm::mat4*> transforms;
+	std::vector<glm::mat4>  frameTransforms;
+	std::vector<glm::mat4>  goodTransforms;
+	SharedState             viewer;
+
+	SDL_Event event;
+	SDL_PollEvent(&event);
+	GLuint millisPerFrame = (GLuint) ((1.0 / FRAMES_PER_SECOND) * MILLIS_PER_SECOND);
+
+	while (event.type != SDL_QUIT)
+	{
+		eventManager.handleSDLEvent(&event);
+
+		/* Follow the server as it starts and stops. */
+		if (viewer.isAttached() && !viewer.isServerRunning())
+		{
+			PRINT("Detached from " << name)
+			viewer.detach();
+		}
+		if (!viewer.isAttached() && viewer.attach(name))
+			PRINT("Attached to " << name)
+
+		/* Take the latest frame, keeping it only if it was not torn. */
+		SharedFrame* frame = viewer.acquire();
+		if (frame != nullptr)
+		{
+			GLuint n = std::min(frame->numBodies, 
+			                    (GLuint) localMeshes.size() - 1);
+			frameTransforms.assign(frame->getTransforms(),
+			                       frame->getTransforms() + n);
+			if (viewer.release(frame))
+				goodTransforms.swap(frameTransforms);
+		}
+
+		/* Draw the last good frame. */
+		if (!goodTransforms.empty())
+		{
+			GLuint n = (GLuint) goodTransforms.size();
+			meshes.assign(localMeshes.begin(), localMeshes.begin() + 1 + n);
+			transforms.assign(1, localTransforms[0]);
+			for (GLuint i = 0; i < n; i++)
+				transforms.push_back(&goodTransforms[i]);
+
+			display.repaint(meshes, transforms);
+		}
+
+		SDL_Delay(millisPerFrame);
+		SDL_PollEvent(&event);
+	}
+
+	viewer.detach();
+	system.cleanUp();
+	SDL_Quit();
+	return 0;
+}
+
 /*******************************************************************************
  *                                                                             *
  *                                     main                                    *
@@ -74,6 +814,65 @@ glm::vec3  bases[] =
  *******************************************************************************/
 int main(int argc, char* argv[])
 {
+	/* Summation benchmark: --benchmark-summation [bodies] [steps] */
+	if (argc >= 2 && std::string(argv[1]) == "--benchmark-summation")
+		return runSummationBenchmark(
+			(argc >= 3) ? (GLuint) atoi(argv[2]) : BENCHMARK_BODIES,
+			(argc >= 4) ? (GLuint) atoi(argv[3]) : BENCHMARK_STEPS);
+
+	/* Mesh solver benchmark: --benchmark-mesh [bodies] [grid] */
+	if (argc >= 2 && std::string(argv[1]) == "--benchmark-mesh")
+	{
+		GLint bodies = (argc >= 3) ? atoi(argv[2]) : BENCHMARK_BODIES;
+		GLint grid   = (argc >= 4) ? atoi(argv[3]) : PM_DEFAULT_GRID;
+		if (bodies <= 0 || grid <= 0)
+		{
+			PRINT("The body count and grid must both be positive")
+			return 1;
+		}
+		return runMeshBenchmark((GLuint) bodies, (GLuint) grid);
+	}
+
+	/* Transfer search: --porkchop <origin> <target> <window> <flight> [grid] */
+	if (argc >= 6 && std::string(argv[1]) == "--porkchop")
+		return runPorkchop(argv[2], argv[3], (GLfloat) atof(argv[4]), 
+		                   (GLfloat) atof(argv[5]),
+		                   (argc >= 7) ? (GLuint) atoi(argv[6]) : PORKCHOP_GRID);
+
+	/* Offline results are served from, and kept in, CACHE_DIRECTORY: --no-cache */
+	ResultCache cache(CACHE_DIRECTORY);
+	bool        cached = true;
+	for (GLint i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--no-cache")
+			cached = false;
+
+	/* Offline Parareal run: --parareal <seconds> [slices] */
+	if (argc >= 3 && std::string(argv[1]) == "--parareal")
+		return runParareal((GLfloat) atof(argv[2]), 
+		                   (argc >= 4 && argv[3][0] != '-') ? (GLuint) atoi(argv[3]) : 0,
+		                   cached ? &cache : nullptr);
+
+	/* Offline trajectory recording: --trajectory <seconds> <file> */
+	if (argc >= 4 && std::string(argv[1]) == "--trajectory")
+		return runTrajectory((GLfloat) atof(argv[2]), argv[3], 
+		                     cached ? &cache : nullptr);
+
+	/* Distributed run: --node <rank> <size> [bodies] [steps] [host] */
+	if (argc >= 4 && std::string(argv[1]) == "--node")
+		return runNode((GLuint) atoi(argv[2]), (GLuint) atoi(argv[3]),
+		               (argc >= 5) ? (GLuint) atoi(argv[4]) : BENCHMARK_BODIES,
+		               (argc >= 6) ? (GLuint) atoi(argv[5]) : BENCHMARK_STEPS,
+		               (argc >= 7) ? argv[6] : "127.0.0.1");
+
+	/* Headless simulation server: --server [name] [warp] */
+	if (argc >= 2 && std::string(argv[1]) == "--server")
+		return runServer((argc >= 3) ? argv[2] : SHARED_STATE_NAME,
+		                 (argc >= 4) ? (GLfloat) atof(argv[3]) : speed);
+
+	/* Viewer of a server in another process: --attach [name] */
+	if (argc >= 2 && std::string(argv[1]) == "--attach")
+		return runViewer((argc >= 3) ? argv[2] : SHARED_STATE_NAME);
+
 	/* Initialize SDL with all subsystems. */
 	SDL_Init(SDL_INIT_EVERYTHING);
 
@@ -81,7 +880,7 @@ int main(int argc, char* argv[])
 	Display      display(PROJECT_TITLE, DEFAULT_WIDTH, DEFAULT_HEIGHT);
 	Shader       shader(DEFAULT_VERTEX_SHADER, DEFAULT_FRAGMENT_SHADER);
 	Camera*      camera = display.getCamera();
-	EventManager eventManager(camera, &speed);
+	EventManager eventManager(camera, &speed, &seek);
 
 	/* Apply the shaders and maximize the display. */
 	Geometry::shader = &shader;
@@ -89,7 +888,129 @@ int main(int argc, char* argv[])
 	display.maximize();
 
 	/* Create the orbital system. */
-	OrbitalSystem system = OrbitalSystem::loadFile("res/data/system.xml");
+	OrbitalSystem system = OrbitalSystem::loadFile(SYSTEM_FILE);
+
+	/* Detect collisions, and approaches within a few radii of the largest body. */
+	GLfloat       largestRadius = 0;
+	for (GLuint i = 0; i < system.getNumBodies(); i++)
+		largestRadius = std::max(largestRadius, system.getBody(i)->getRadius());
+	EventDetector eventDetector;
+	eventDetector.watchCollisions(nullptr, nullptr);
+	eventDetector.watchClosestApproach(nullptr, nullptr, APPROACH_RADII * largestRadius);
+	system.addObserver(&eventDetector);
+
+	/* Spread force evaluation across every core and warp time. */
+	WorkerPool        workerPool;
+	TimeWarpScheduler scheduler(&system);
+	system.setWorkerPool(&workerPool);
+
+	/* Bitwise reproducible force summation: --deterministic */
+	for (GLint i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--deterministic")
+			system.setSummationMode(SummationMode::DETERMINISTIC);
+
+	/* Regularize close pairs and encounters automatically: --regularize */
+	for (GLint i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--regularize")
+			system.setRegularizing(true);
+
+	/* Near forces on substeps of the far ones: --multirate <radius> [ratio] */
+	for (GLint i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) != "--multirate")
+			continue;
+		GLint ratio = (i + 2 < argc) ? atoi(argv[i + 2]) : 0;
+		system.setForceSplit((GLfloat) atof(argv[i + 1]),
+		                     (ratio > 0) ? (GLuint) ratio : MULTIRATE_RATIO);
+	}
+
+	/* Keep bodies in Morton order for cache locality: --reorder [steps] */
+	for (GLint i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) != "--reorder")
+			continue;
+		GLint steps = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+		system.setReorderInterval((steps > 0) ? (GLuint) steps : REORDER_STEPS);
+	}
+
+	/* Particle-mesh gravity in place of direct summation: --mesh|--p3m [grid] */
+	ParticleMesh* meshSolver = nullptr;
+	for (GLint i = 1; i < argc; i++)
+	{
+		std::string arg(argv[i]);
+		if ((arg != "--mesh" && arg != "--p3m") || meshSolver != nullptr)
+			continue;
+		GLint grid = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+		meshSolver = new ParticleMesh((grid > 0) ? (GLuint) grid : PM_DEFAULT_GRID,
+		                              &workerPool, arg == "--p3m");
+		system.setGravitySolver(meshSolver);
+	}
+
+	/* Orbit statistics about a primary: --analytics <primary> [interval] */
+	OrbitalAnalytics analytics(0, ANALYTICS_INTERVAL, ANALYTICS_FILE);
+	bool             analyze = false;
+	for (GLint i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) != "--analytics")
+			continue;
+		for (GLuint b = 0; b < system.getNumBodies(); b++)
+		{
+			if (system.getBody(b)->getName() == argv[i + 1])
+			{
+				analytics.setPrimary(b);
+				analyze = true;
+			}
+		}
+		if (i + 2 < argc && argv[i + 2][0] != '-')
+			analytics.setInterval((GLuint) atoi(argv[i + 2]));
+	}
+	if (analyze)
+		system.addObserver(&analytics);
+
+	/* Compressed trajectory recording: --record <file> [position] [velocity] */
+	TrajectoryWriter* recorder = nullptr;
+	for (GLint i = 1; i + 1 < argc; i++)
+	{
+		if (std::string(argv[i]) != "--record" || recorder != nullptr)
+			continue;
+		GLdouble positionTolerance = (i + 2 < argc && argv[i + 2][0] != '-') 
+		                           ? atof(argv[i + 2]) : ARCHIVE_POSITION_TOLERANCE;
+		GLdouble velocityTolerance = (i + 3 < argc && argv[i + 3][0] != '-') 
+		                           ? atof(argv[i + 3]) : ARCHIVE_VELOCITY_TOLERANCE;
+		recorder = new TrajectoryWriter(argv[i + 1], positionTolerance, 
+		                                velocityTolerance);
+		system.addObserver(recorder);
+	}
+
+	/* Potential heightmap in the plane of the first body: --field [nodes] [file] */
+	FieldSampler field(&workerPool);
+	Mesh         fieldMesh;
+	glm::mat4    fieldMatrix;
+	NBodyState   fieldState;
+	GLfloat      fieldDepth = 0;
+	const char*  fieldFile  = nullptr;
+	for (GLint i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) != "--field" || system.getNumBodies() == 0)
+			continue;
+		GLint     nodes  = (i + 1 < argc) ? atoi(argv[i + 1]) : 0;
+		glm::vec3 center = system.getBody(0)->getLinearPosition();
+		GLfloat   span   = 0;
+		for (GLuint b = 1; b < system.getNumBodies(); b++)
+			span = std::max(span, glm::distance(center, 
+			                      system.getBody(b)->getLinearPosition()));
+		span       = FIELD_VIEW_SPAN * ((span > 0) ? span : 1.0f);
+		fieldDepth = FIELD_VIEW_DEPTH * span;
+		field.setSlice(center, glm::vec3(0, 1, 0), span, 
+		               (nodes > 0) ? (GLuint) nodes : FIELD_RESOLUTION);
+		if (i + 2 < argc && argv[i + 2][0] != '-')
+			fieldFile = argv[i + 2];
+	}
+
+	/* Keyframes of the run, so it can be scrubbed back and forth. */
+	KeyframeIndex keyframes;
+	keyframes.record(system);
+	system.addObserver(&keyframes);
 
 	/* Instantiate the event reference. */
 	SDL_Event event;
@@ -99,19 +1020,57 @@ int main(int argc, char* argv[])
 	GLuint startMillis = 0, tempMillis = 0, currentMillis = 0, millisPerFrame = 0;
 	startMillis = tempMillis = currentMillis = SDL_GetTicks();	
 	millisPerFrame = (GLuint) ((1.0 / FRAMES_PER_SECOND) * MILLIS_PER_SECOND);
+	bool keepingUp = true;
 	PRINT(millisPerFrame)
 
+	/* Hold the frame rate by trading accuracy for time: off with --fixed-quality */
+	typedef std::chrono::high_resolution_clock Clock;
+	QualityGovernor governor(&scheduler, (GLfloat) millisPerFrame,
+	                         (fieldDepth > 0) ? &field : nullptr);
+	GLfloat         physicsMillis = 0;
+	bool            governed      = true;
+	for (GLint i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--fixed-quality")
+			governed = false;
+
+	/* Vertical sync stays on unless --no-vsync; while on, its wait counts as drawing. */
+	for (GLint i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--no-vsync")
+			SDL_GL_SetSwapInterval(0);
+
 	/* Main loop. */
 	while (event.type != SDL_QUIT)
 	{
 		/* Handle the new event. */
 		eventManager.handleSDLEvent(&event);
 
+		/* Jump to the requested time from the nearest keyframe. */
+		if (seek != 0)
+		{
+			GLdouble target = (seek == SEEK_TO_START) ? seek : system.t() + seek;
+			seek = 0;
+			PRINT("Seek to t = " << keyframes.seek(system, target, 
+			                                        scheduler.getMaxStep()))
+		}
+
 		/* Get the new number of milliseconds. */
 		currentMillis = SDL_GetTicks();
 
-		/* Interpolate the system over the interval. */
-		system.interpolate((speed * (currentMillis - tempMillis)) / 1000);
+		/* Advance the system over the interval at the requested warp. */
+		Clock::time_point physicsStart = Clock::now();
+		scheduler.setWarp(speed);
+		scheduler.advance((GLfloat) (currentMillis - tempMillis) / 
+		                  MILLIS_PER_SECOND);
+		physicsMillis += std::chrono::duration<GLfloat, std::milli>(
+		                 Clock::now() - physicsStart).count();
+
+		/* Report any events located during the step. */
+		for (const SimEvent& e : eventDetector.pollEvents())
+			PRINT("t = " << e.time << ": " 
+			      << ((e.type == EventType::COLLISION) ? "collision " 
+			                                           : "closest approach ")
+			      << e.first->getName() << " / " << e.second->getName() 
+			      << " at " << e.distance)
 
 		//PRINT(glm::distance(system.getBody(0)->getLinearPosition(), system.getBody(1)->getLinearPosition()));
 
@@ -119,7 +1078,50 @@ int main(int argc, char* argv[])
 		if ((currentMillis - startMillis) >= millisPerFrame)
 		{
 			startMillis = currentMillis;
-			display.repaint(system.getMeshes(), system.getTransforms());
+			Clock::time_point renderStart = Clock::now();
+			system.snapshotTransforms();
+			if (fieldDepth > 0)
+			{
+				/* Cut the wells off at a multiple of the mean potential. */
+				system.gatherState(fieldState);
+				field.update(fieldState);
+				GLfloat mean = 0;
+				for (GLfloat phi : field.getPotential())
+					mean += phi / field.getNumNodes();
+				field.buildHeightmap(&fieldMesh, fieldDepth, FIELD_VIEW_CLIP * mean);
+
+				std::vector<Mesh*>      meshes     = system.getMeshes();
+				std::vector<glm::mat4*> transforms = system.getTransforms();
+				meshes.push_back(&fieldMesh);
+				transforms.push_back(&fieldMatrix);
+				display.repaint(meshes, transforms);
+			}
+			else
+				display.repaint(system.getMeshes(), system.getTransforms());
+
+			/* Rebalance the settings against the frame's budget, and log it. */
+			if (governed)
+			{
+				governor.frame(physicsMillis, std::chrono::duration<GLfloat, std::milli>(
+				                              Clock::now() - renderStart).count());
+				for (const QualityChange& c : governor.pollChanges())
+					PRINT("Quality: " 
+					      << ((c.knob == QualityKnob::MAX_STEP)      ? "largest step " :
+					          (c.knob == QualityKnob::OPENING_ANGLE) ? "field opening angle " 
+					                                                 : "field nodes per side ")
+					      << c.from << " -> " << c.to << " (physics " << c.physicsMillis 
+					      << " ms, drawing " << c.renderMillis << " ms, frame " 
+					      << governor.getFrameBudget() << " ms)")
+			}
+			physicsMillis = 0;
+
+			/* Report when the requested warp can or cannot be sustained. */
+			if (scheduler.isKeepingUp() != keepingUp)
+			{
+				keepingUp = scheduler.isKeepingUp();
+				PRINT("Warp " << scheduler.getWarp() << "x requested, " 
+				      << scheduler.getAchievedWarp() << "x achieved")
+			}
 		}
 
 		/* Update the temporary millisecond counter. */
@@ -129,7 +1131,36 @@ int main(int argc, char* argv[])
 		SDL_PollEvent(&event);
 	}
 
+	/* Keep the final orbit statistics. */
+	if (analyze)
+		analytics.writeSummary(ANALYTICS_FILE);
+
+	/* Complete the trajectory archive. */
+	if (recorder != nullptr)
+	{
+		system.removeObserver(recorder);
+		delete recorder;
+	}
+
+	/* Return to direct summation before freeing the mesh. */
+	if (meshSolver != nullptr)
+	{
+		system.setGravitySolver(nullptr);
+		delete meshSolver;
+	}
+
+	/* Export the last field sampled, as text for a .csv file. */
+	if (fieldFile != nullptr)
+	{
+		std::string name(fieldFile);
+		bool        csv = name.size() > 4 && name.substr(name.size() - 4) == ".csv";
+		if (!(csv ? field.writeCsv(fieldFile) : field.writeBinary(fieldFile)))
+			PRINT("Could not write " << fieldFile)
+	}
+
 	/* Free the shapes. */
+	if (fieldMesh.getBufferIDs() != 0)
+		fieldMesh.cleanUp();
 	system.cleanUp();
 
 	/* Quit using SDL. */
@@ -0,0 +1,146 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <algorithm>
+#include "MortonOrder.h"
+
+/******************************************************************************
+*                                                                             *
+*                               Local Helpers                                 *
+*                                                                             *
+******************************************************************************/
+/* Spread the low 21 bits of x so that two zero bits follow each one. */
+static unsigned long long spreadBits(unsigned long long x)
+{
+	x &= 0x1fffffULL;
+	x  = (x | x << 32) & 0x1f00000000ffffULL;
+	x  = (x | x << 16) & 0x1f0000ff0000ffULL;
+	x  = (x | x <<  8) & 0x100f00f00f00f00fULL;
+	x  = (x | x <<  4) & 0x10c30c30c30c30c3ULL;
+	x  = (x | x <<  2) & 0x1249249249249249ULL;
+	return x;
+}
+
+/* Cell coordinate of a distance from the low corner, clamped to the grid. */
+static unsigned long long cell(GLfloat d)
+{
+	const GLfloat top = (GLfloat) ((1 << MORTON_BITS) - 1);
+	if (!(d > 0))
+		return 0;
+	return (unsigned long long) std::min(d, top);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             MortonOrder::code                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param p                                                                   *
+*           The point to encode.                                              *
+*  @param lo                                                                  *
+*           Low corner of the box being divided.                              *
+*  @param scale                                                               *
+*           Cells per unit length.                                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The interleaved bits of the cell coordinates, x lowest. Points outside     *
+*  the box (or not a number) are clamped to its faces.                        *
+*                                                                             *
+*******************************************************************************/
+unsigned long long MortonOrder::code(const glm::vec3& p, const glm::vec3& lo,
+                                     const GLfloat scale)
+{
+	glm::vec3 d = (p - lo) * scale;
+	return spreadBits(cell(d.x))      |
+	       spreadBits(cell(d.y)) << 1 |
+	       spreadBits(cell(d.z)) << 2;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             MortonOrder::sort                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param positions                                                           *
+*           Position of every body.                                           *
+*  @param pool                                                                *
+*           Optional worker pool to compute and sort the keys with.           *
+*  @param order                                                               *
+*           Output current index of the body at each position of the curve.   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The cells are cubes, sized so the longest side of the bounding box spans   *
+*  the grid. With a pool, each thread computes the keys of a chunk and sorts  *
+*  it, and the sorted chunks are merged pairwise.                             *
+*                                                                             *
+*******************************************************************************/
+void MortonOrder::sort(const std::vector<glm::vec3>& positions, WorkerPool* pool,
+                       std::vector<GLuint>& order)
+{
+	typedef std::pair<unsigned long long, GLuint> Key;
+
+	GLuint n = positions.size();
+	order.resize(n);
+	if (n == 0)
+		return;
+
+	/* Bounding box of the points. */
+	glm::vec3 lo(positions[0]);
+	glm::vec3 hi(positions[0]);
+	for (GLuint i = 1; i < n; i++)
+	{
+		lo = glm::min(lo, positions[i]);
+		hi = glm::max(hi, positions[i]);
+	}
+	glm::vec3 size   = hi - lo;
+	GLfloat   extent = std::max(size.x, std::max(size.y, size.z));
+	GLfloat   scale  = (extent > 0) ? (1 << MORTON_BITS) / extent : 0;
+
+	/* Key and sort each chunk. */
+	std::vector<Key> keys(n);
+	GLuint chunks = (pool != nullptr && n >= MORTON_PARALLEL_MIN) ?
+	                pool->getNumThreads() : 1;
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		for (GLuint c = begin; c < end; c++)
+		{
+			GLuint first = (GLuint) ((unsigned long long) n * c / chunks);
+			GLuint last  = (GLuint) ((unsigned long long) n * (c + 1) / chunks);
+			for (GLuint i = first; i < last; i++)
+				keys[i] = Key(code(positions[i], lo, scale), i);
+			std::sort(keys.begin() + first, keys.begin() + last);
+		}
+	};
+
+	if (chunks > 1)
+		pool->parallelFor(chunks, task);
+	else
+		task(0, 1);
+
+	/* Merge neighbouring runs until one is left. */
+	for (GLuint width = 1; width < chunks; width *= 2)
+	{
+		for (GLuint c = 0; c + width < chunks; c += 2 * width)
+		{
+			GLuint first = (GLuint) ((unsigned long long) n * c / chunks);
+			GLuint mid   = (GLuint) ((unsigned long long) n * (c + width) / chunks);
+			GLuint last  = (GLuint) ((unsigned long long) n *
+			                         std::min(chunks, c + 2 * width) / chunks);
+			std::inplace_merge(keys.begin() + first, keys.begin() + mid,
+			                   keys.begin() + last);
+		}
+	}
+
+	for (GLuint i = 0; i < n; i++)
+		order[i] = keys[i].second;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Bits per axis of a Morton code (three axes fit in 64 bits). */
+#define   MORTON_BITS                         21
+/* Fewest bodies for which the codes are computed and sorted in parallel. */
+#define   MORTON_PARALLEL_MIN              4096
+
+/******************************************************************************
+ *																			  *
+ *                             MortonOrder Class                              *
+ *																			  *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Orders points along a Z-order (Morton) curve: the bounding box is cut     *
+ *  into 2^MORTON_BITS cells per axis, and the bits of the three cell         *
+ *  coordinates are interleaved into one key. Sorting by the key keeps points *
+ *  which are close in space mostly close in the list, so the force and       *
+ *  collision passes over a list sorted this way touch memory in runs rather  *
+ *  than at random. Ties are broken by the current index, which makes the     *
+ *  order independent of how the work is split across threads.                *
+ *                                                                            *
+ *  An order is given as the current index of the item for each new index,    *
+ *  order[new] = old, and apply carries any per-body array along with it.     *
+ *                                                                            *
+ ******************************************************************************/
+class MortonOrder
+{
+/* Public Members. */
+public:
+
+	/* Morton key of p within the box at lo with cells of size 1 / scale. */
+	static unsigned long long  code  (const glm::vec3&               p,
+	                                  const glm::vec3&               lo,
+	                                  const GLfloat                  scale    );
+
+	/* Order of the positions along the curve through their bounding box. */
+	static void                sort  (const std::vector<glm::vec3>& positions,
+	                                        WorkerPool*              pool,
+	                                        std::vector<GLuint>&     order    );
+
+	/* Rearrange items[offset ..] so that item i is the old item order[i]. */
+	template <class T>
+	static void                apply (      std::vector<T>&          items,
+	                                  const std::vector<GLuint>&     order,
+	                                  const GLuint                   offset = 0)
+	{
+		std::vector<T> old(items.begin() + offset, items.end());
+		for (GLuint i = 0; i < order.size(); i++)
+			items[offset + i] = old[order[i]];
+	}
+};
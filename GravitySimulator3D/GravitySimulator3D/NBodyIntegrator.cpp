@@ -0,0 +1,781 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "NBodyIntegrator.h"
+#include "SmallNKernel.h"
+
+/******************************************************************************
+*                                                                             *
+*                       NBodyIntegrator::accelerations                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions at which to evaluate gravity (one per body).            *
+*  @param out                                                                 *
+*           Output acceleration of every body.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Direct summation of the gravitational acceleration felt by each body,      *
+*  plus the tidal field when one is set.                                      *
+*  Each body's sum is computed by a single thread in body order, so the       *
+*  result does not depend on how the bodies are split across the pool.        *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::accelerations(const NBodyState& state,
+                                    const std::vector<glm::vec3>& positions,
+                                    std::vector<glm::vec3>& out)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	GLuint n = positions.size();
+	out.resize(n);
+
+	/* External tidal field, if any. */
+	bool tides = (tidal != glm::mat3(0.0f));
+
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin; i < end; i++)
+		{
+			/* Fixed-shape pairwise reduction. */
+			if (mode == SummationMode::DETERMINISTIC)
+			{
+				out[i] = pairwiseSum(state, positions, i, 0, n);
+				if (tides)
+					out[i] += tidal * positions[i];
+				continue;
+			}
+
+			/* Sequential accumulation. */
+			glm::vec3 net(0);
+			for (GLuint j = 0; j < n; j++)
+			{
+				/* Do not compare a body with itself, or with massless ones. */
+				if (j == i || state.masses[j] == 0)
+					continue;
+
+				/* a = G * m * d / |d|^3 */
+				glm::vec3 d  = positions[j] - positions[i];
+				GLfloat   r2 = glm::dot(d, d);
+				if (r2 == 0)
+					continue;
+				GLfloat   r  = sqrt(r2);
+				net += (state.G * state.masses[j] / (r2 * r)) * d;
+			}
+			if (tides)
+				net += tidal * positions[i];
+			out[i] = net;
+		}
+	};
+
+	if (solver != nullptr)
+	{
+		/* Delegate to the solver, itself reproducible, adding the tides here. */
+		solver->accelerations(state, positions, out);
+		if (tides)
+			for (GLuint i = 0; i < n; i++)
+				out[i] += tidal * positions[i];
+	}
+	else if (pool != nullptr && n >= PARALLEL_MIN_BODIES)
+		pool->parallelFor(n, task);
+	else
+		task(0, n);
+
+	std::chrono::duration<GLdouble, std::milli> spent = Clock::now() - start;
+	forceMillis += spent.count();
+	forceEvaluations++;
+}
+
+/******************************************************************************
+*                                                                             *
+*                        NBodyIntegrator::pairwiseSum                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions at which to evaluate gravity (one per body).            *
+*  @param i                                                                   *
+*           Index of the body feeling the force.                              *
+*  @param lo, hi                                                              *
+*           Range of source bodies [lo, hi) to sum.                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The acceleration of body i due to the sources in the range.                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Splits the range in half until it is at most PAIRWISE_BLOCK_SIZE long,     *
+*  sums each block sequentially and adds the halves back together. The        *
+*  order of every floating-point addition depends only on the number of       *
+*  bodies, so the result is bitwise identical however the targets (or, in     *
+*  future, subtrees of sources) are divided between threads, and the          *
+*  rounding error grows with log(n) rather than n.                            *
+*                                                                             *
+*******************************************************************************/
+glm::vec3 NBodyIntegrator::pairwiseSum(const NBodyState& state,
+                                       const std::vector<glm::vec3>& positions,
+                                       const GLuint i, const GLuint lo,
+                                       const GLuint hi)
+{
+	if (hi - lo > PAIRWISE_BLOCK_SIZE)
+	{
+		GLuint mid = lo + (hi - lo) / 2;
+		return pairwiseSum(state, positions, i, lo, mid) +
+		       pairwiseSum(state, positions, i, mid, hi);
+	}
+
+	glm::vec3 net(0);
+	for (GLuint j = lo; j < hi; j++)
+	{
+		if (j == i || state.masses[j] == 0)
+			continue;
+
+		glm::vec3 d  = positions[j] - positions[i];
+		GLfloat   r2 = glm::dot(d, d);
+		if (r2 == 0)
+			continue;
+		GLfloat   r  = sqrt(r2);
+		net += (state.G * state.masses[j] / (r2 * r)) * d;
+	}
+	return net;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         NBodyIntegrator::startStep                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state at the start of the step.                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Fills startAccel. When the state is unchanged since the end of the last    *
+*  step, the acceleration evaluated there is reused instead of recomputed.    *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::startStep(const NBodyState& state)
+{
+	if (state.positions == cachedPositions && state.masses == cachedMasses &&
+	    tidal == cachedTidal)
+		startAccel = endAccel;
+	else
+		accelerations(state, state.positions, startAccel);
+}
+
+/******************************************************************************
+*                                                                             *
+*                         NBodyIntegrator::rungeKutta                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state to advance (modified in place).                         *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Classical fourth order Runge-Kutta step applied to every body at once.     *
+*  The accelerations at both ends of the step are kept for dense output.      *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::rungeKutta(NBodyState& state, const GLfloat dt)
+{
+	GLuint n = state.positions.size();
+
+	/* A few bodies take an unrolled kernel specialized on their number. */
+	if (smallRungeKutta(state, dt))
+		return;
+
+	startStep(state);
+
+	/* Stage 1: k = (v, a(r)). */
+	stageVelocities = state.velocities;
+	stageAccel      = startAccel;
+	sumPositions    = stageVelocities;
+	sumVelocities   = stageAccel;
+	stagePositions.resize(n);
+
+	/* Stages 2 - 4. */
+	for (GLuint stage = 2; stage <= 4; stage++)
+	{
+		GLfloat c = (stage < 4) ? 0.5f * dt : dt;
+		GLfloat w = (stage < 4) ? 2.0f      : 1.0f;
+
+		for (GLuint i = 0; i < n; i++)
+		{
+			stagePositions[i]  = state.positions[i]  + c * stageVelocities[i];
+			stageVelocities[i] = state.velocities[i] + c * stageAccel[i];
+		}
+
+		accelerations(state, stagePositions, stageAccel);
+
+		for (GLuint i = 0; i < n; i++)
+		{
+			sumPositions[i]  += w * stageVelocities[i];
+			sumVelocities[i] += w * stageAccel[i];
+		}
+	}
+
+	/* Combine the stages. */
+	GLfloat c = dt / 6.0f;
+	for (GLuint i = 0; i < n; i++)
+	{
+		state.positions[i]  += c * sumPositions[i];
+		state.velocities[i] += c * sumVelocities[i];
+	}
+	state.t += dt;
+
+	/* Acceleration at the end of the step (the start of the next). */
+	accelerations(state, state.positions, endAccel);
+	cachedPositions = state.positions;
+	cachedMasses    = state.masses;
+	cachedTidal     = tidal;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      NBodyIntegrator::smallRungeKutta                       *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state to advance (modified in place).                         *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the step was taken, false if no kernel applies: there are fewer    *
+*  than SMALL_N_MIN or more than SMALL_N_MAX bodies, a gravity solver is set, *
+*  or the summation is deterministic (whose order the kernels do not keep).   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Picks the SmallNKernel instance for the number of bodies. The start        *
+*  acceleration is reused from the last step in the same way as startStep.    *
+*  The timer covers the whole kernel, as the force evaluations are inlined.   *
+*                                                                             *
+*******************************************************************************/
+bool NBodyIntegrator::smallRungeKutta(NBodyState& state, const GLfloat dt)
+{
+	GLuint n = state.positions.size();
+	if (!specialized || solver != nullptr || mode != SummationMode::FAST ||
+	    n < SMALL_N_MIN || n > SMALL_N_MAX)
+		return false;
+
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	bool computeStart = !(state.positions == cachedPositions &&
+	                      state.masses == cachedMasses && tidal == cachedTidal);
+	if (!computeStart)
+		startAccel = endAccel;
+
+	/* One case for every count from SMALL_N_MIN to SMALL_N_MAX. */
+	switch (n)
+	{
+	case  2:  SmallNKernel< 2>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  3:  SmallNKernel< 3>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  4:  SmallNKernel< 4>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  5:  SmallNKernel< 5>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  6:  SmallNKernel< 6>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  7:  SmallNKernel< 7>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  8:  SmallNKernel< 8>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case  9:  SmallNKernel< 9>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 10:  SmallNKernel<10>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 11:  SmallNKernel<11>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 12:  SmallNKernel<12>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 13:  SmallNKernel<13>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 14:  SmallNKernel<14>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 15:  SmallNKernel<15>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	case 16:  SmallNKernel<16>::rungeKutta(state, dt, tidal, computeStart, startAccel, endAccel);  break;
+	default:  return false;
+	}
+
+	std::chrono::duration<GLdouble, std::milli> spent = Clock::now() - start;
+	forceMillis      += spent.count();
+	forceEvaluations += computeStart ? 5 : 4;
+
+	cachedPositions = state.positions;
+	cachedMasses    = state.masses;
+	cachedTidal     = tidal;
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NBodyIntegrator::leapfrog                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state to advance (modified in place).                         *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Second order symplectic kick-drift-kick step. It needs one force           *
+*  evaluation per step (the start value is reused from the previous step),    *
+*  which makes it a cheap, stable propagator for large steps.                 *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::leapfrog(NBodyState& state, const GLfloat dt)
+{
+	GLuint n = state.positions.size();
+
+	startStep(state);
+
+	/* Half kick and full drift. */
+	for (GLuint i = 0; i < n; i++)
+	{
+		state.velocities[i] += (0.5f * dt) * startAccel[i];
+		state.positions[i]  += dt * state.velocities[i];
+	}
+
+	/* Second half kick with the new acceleration. */
+	accelerations(state, state.positions, endAccel);
+	for (GLuint i = 0; i < n; i++)
+		state.velocities[i] += (0.5f * dt) * endAccel[i];
+	state.t += dt;
+
+	cachedPositions = state.positions;
+	cachedMasses    = state.masses;
+	cachedTidal     = tidal;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NBodyIntegrator::step                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state to advance (modified in place).                         *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Multirate step when a force split is set, Runge-Kutta otherwise.           *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::step(NBodyState& state, const GLfloat dt)
+{
+	if (isSplit())
+		multirate(state, dt);
+	else
+		rungeKutta(state, dt);
+}
+
+/******************************************************************************
+*                                                                             *
+*                        NBodyIntegrator::nearWeight                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param r                                                                   *
+*           Separation of a pair.                                             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  1 inside SPLIT_INNER_FRACTION of the split radius, 0 beyond it, and a      *
+*  smoothstep in between. The far field takes the rest of the force.          *
+*                                                                             *
+*******************************************************************************/
+GLfloat NBodyIntegrator::nearWeight(const GLfloat r) const
+{
+	GLfloat inner = SPLIT_INNER_FRACTION * splitRadius;
+	if (r <= inner)
+		return 1.0f;
+	if (r >= splitRadius)
+		return 0.0f;
+
+	GLfloat x = (r - inner) / (splitRadius - inner);
+	return 1.0f - x * x * (3.0f - 2.0f * x);
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NBodyIntegrator::cellKey                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param x, y, z                                                             *
+*           Integer coordinates of a cell.                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  A hash of the coordinates. Distinct cells may share a key; that only adds  *
+*  bodies which the distance test then rejects.                               *
+*                                                                             *
+*******************************************************************************/
+unsigned long long NBodyIntegrator::cellKey(long long x, long long y, long long z)
+{
+	return ((unsigned long long) x * 73856093ULL) ^
+	       ((unsigned long long) y * 19349663ULL) ^
+	       ((unsigned long long) z * 83492791ULL);
+}
+
+/******************************************************************************
+*                                                                             *
+*                        NBodyIntegrator::buildCells                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param positions                                                           *
+*           Positions of the bodies.                                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sorts the bodies by the key of their cell. cellKeys holds every occupied   *
+*  key once, and the bodies of cellKeys[c] are                                *
+*  cellBodies[cellStart[c] .. cellStart[c + 1]). Hashing the cells keeps the  *
+*  list sparse however far apart the bodies are.                              *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::buildCells(const std::vector<glm::vec3>& positions)
+{
+	GLuint n = positions.size();
+
+	std::vector<std::pair<unsigned long long, GLuint> > keyed(n);
+	for (GLuint i = 0; i < n; i++)
+	{
+		glm::vec3 c = positions[i] / splitRadius;
+		keyed[i] = std::make_pair(cellKey((long long) floor(c.x),
+		                                  (long long) floor(c.y),
+		                                  (long long) floor(c.z)), i);
+	}
+	std::sort(keyed.begin(), keyed.end());
+
+	cellKeys.clear();
+	cellStart.clear();
+	cellBodies.resize(n);
+	for (GLuint b = 0; b < n; b++)
+	{
+		if (b == 0 || keyed[b].first != keyed[b - 1].first)
+		{
+			cellKeys.push_back(keyed[b].first);
+			cellStart.push_back(b);
+		}
+		cellBodies[b] = keyed[b].second;
+	}
+	cellStart.push_back(n);
+}
+
+/******************************************************************************
+*                                                                             *
+*                         NBodyIntegrator::nearField                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions at which to evaluate gravity (one per body).            *
+*  @param out                                                                 *
+*           Output near field acceleration of every body.                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sum of nearWeight(r) times the pair force over the bodies in the 27 cells  *
+*  around each body, so the cost follows the number of neighbours rather      *
+*  than the number of bodies.                                                 *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::nearField(const NBodyState& state,
+                                const std::vector<glm::vec3>& positions,
+                                std::vector<glm::vec3>& out)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	sumNear(state, positions, out);
+
+	std::chrono::duration<GLdouble, std::milli> spent = Clock::now() - start;
+	forceMillis += spent.count();
+	nearEvaluations++;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NBodyIntegrator::sumNear                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions at which to evaluate gravity (one per body).            *
+*  @param out                                                                 *
+*           Output near field acceleration of every body.                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The work of nearField, without the timing.                                 *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::sumNear(const NBodyState& state,
+                              const std::vector<glm::vec3>& positions,
+                              std::vector<glm::vec3>& out)
+{
+	GLuint  n  = positions.size();
+	GLfloat R2 = splitRadius * splitRadius;
+	out.resize(n);
+
+	buildCells(positions);
+
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		unsigned long long keys[27];
+		for (GLuint i = begin; i < end; i++)
+		{
+			/* Keys of the surrounding cells, each visited once. */
+			glm::vec3 c  = positions[i] / splitRadius;
+			long long cx = (long long) floor(c.x);
+			long long cy = (long long) floor(c.y);
+			long long cz = (long long) floor(c.z);
+			GLuint    k  = 0;
+			for (long long z = cz - 1; z <= cz + 1; z++)
+			for (long long y = cy - 1; y <= cy + 1; y++)
+			for (long long x = cx - 1; x <= cx + 1; x++)
+				keys[k++] = cellKey(x, y, z);
+			std::sort(keys, keys + 27);
+			k = std::unique(keys, keys + 27) - keys;
+
+			glm::vec3 net(0);
+			for (GLuint q = 0; q < k; q++)
+			{
+				std::vector<unsigned long long>::const_iterator found =
+					std::lower_bound(cellKeys.begin(), cellKeys.end(), keys[q]);
+				if (found == cellKeys.end() || *found != keys[q])
+					continue;
+
+				GLuint cell = found - cellKeys.begin();
+				for (GLuint b = cellStart[cell]; b < cellStart[cell + 1]; b++)
+				{
+					GLuint j = cellBodies[b];
+					if (j == i || state.masses[j] == 0)
+						continue;
+
+					glm::vec3 d  = positions[j] - positions[i];
+					GLfloat   r2 = glm::dot(d, d);
+					if (r2 == 0 || r2 >= R2)
+						continue;
+					GLfloat   r  = sqrt(r2);
+					net += (state.G * state.masses[j] * nearWeight(r) / (r2 * r)) * d;
+				}
+			}
+			out[i] = net;
+		}
+	};
+
+	if (pool != nullptr && n >= PARALLEL_MIN_BODIES)
+		pool->parallelFor(n, task);
+	else
+		task(0, n);
+}
+
+/******************************************************************************
+*                                                                             *
+*                          NBodyIntegrator::farField                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions at which to evaluate gravity (one per body).            *
+*  @param out                                                                 *
+*           Output far field acceleration of every body.                      *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sum of (1 - nearWeight(r)) times the pair force over every pair, plus the  *
+*  tidal field. With a gravity solver it is the solver's total less the       *
+*  near field instead, so the solver runs only once per multirate step.       *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::farField(const NBodyState& state,
+                               const std::vector<glm::vec3>& positions,
+                               std::vector<glm::vec3>& out)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	Clock::time_point start = Clock::now();
+
+	GLuint  n     = positions.size();
+	GLfloat inner = SPLIT_INNER_FRACTION * splitRadius;
+	out.resize(n);
+
+	if (solver != nullptr)
+	{
+		solver->accelerations(state, positions, out);
+		sumNear(state, positions, stageAccel);
+		for (GLuint i = 0; i < n; i++)
+			out[i] += tidal * positions[i] - stageAccel[i];
+	}
+	else
+	{
+		WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+		{
+			for (GLuint i = begin; i < end; i++)
+			{
+				glm::vec3 net(0);
+				for (GLuint j = 0; j < n; j++)
+				{
+					if (j == i || state.masses[j] == 0)
+						continue;
+
+					glm::vec3 d  = positions[j] - positions[i];
+					GLfloat   r2 = glm::dot(d, d);
+					if (r2 <= inner * inner)
+						continue;
+					GLfloat   r  = sqrt(r2);
+					net += (state.G * state.masses[j] * (1.0f - nearWeight(r)) / 
+					        (r2 * r)) * d;
+				}
+				out[i] = net + tidal * positions[i];
+			}
+		};
+
+		if (pool != nullptr && n >= PARALLEL_MIN_BODIES)
+			pool->parallelFor(n, task);
+		else
+			task(0, n);
+	}
+
+	std::chrono::duration<GLdouble, std::milli> spent = Clock::now() - start;
+	forceMillis += spent.count();
+	forceEvaluations++;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         NBodyIntegrator::multirate                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state to advance (modified in place).                         *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the step.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Impulse multiple time stepping (r-RESPA): a half kick of the far field,    *
+*  splitRatio kick-drift-kick substeps of dt / splitRatio under the near      *
+*  field, and a closing half kick of the far field at the new positions.      *
+*  The far field is evaluated once per step instead of once per substep, and  *
+*  the method stays symplectic and second order. Both parts at the end are    *
+*  kept to start the next step, and their sum serves as the dense output.     *
+*                                                                             *
+*******************************************************************************/
+void NBodyIntegrator::multirate(NBodyState& state, const GLfloat dt)
+{
+	GLuint  n = state.positions.size();
+	GLuint  k = std::max(1u, splitRatio);
+	GLfloat h = dt / k;
+
+	/* Both parts at the start, unless kept from the last step. */
+	if (!(state.positions == splitPositions && state.masses == cachedMasses &&
+	      tidal == cachedTidal))
+	{
+		nearField(state, state.positions, nearAccel);
+		farField(state, state.positions, farAccel);
+	}
+	startAccel.resize(n);
+	for (GLuint i = 0; i < n; i++)
+		startAccel[i] = nearAccel[i] + farAccel[i];
+
+	/* Opening far field half kick. */
+	for (GLuint i = 0; i < n; i++)
+		state.velocities[i] += (0.5f * dt) * farAccel[i];
+
+	/* Near field substeps. */
+	for (GLuint s = 0; s < k; s++)
+	{
+		for (GLuint i = 0; i < n; i++)
+		{
+			state.velocities[i] += (0.5f * h) * nearAccel[i];
+			state.positions[i]  += h * state.velocities[i];
+		}
+		nearField(state, state.positions, nearAccel);
+		for (GLuint i = 0; i < n; i++)
+			state.velocities[i] += (0.5f * h) * nearAccel[i];
+	}
+
+	/* Closing far field half kick. */
+	farField(state, state.positions, farAccel);
+	for (GLuint i = 0; i < n; i++)
+		state.velocities[i] += (0.5f * dt) * farAccel[i];
+	state.t += dt;
+
+	endAccel.resize(n);
+	for (GLuint i = 0; i < n; i++)
+		endAccel[i] = nearAccel[i] + farAccel[i];
+	cachedPositions = state.positions;
+	cachedMasses    = state.masses;
+	cachedTidal     = tidal;
+	splitPositions  = state.positions;
+}
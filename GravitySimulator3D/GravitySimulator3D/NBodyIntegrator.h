@@ -0,0 +1,278 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "WorkerPool.h"
+#include  "GravitySolver.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Fewest bodies for which force evaluation is split across threads. */
+#define   PARALLEL_MIN_BODIES                 64
+/* Largest run of sources summed sequentially in deterministic mode. */
+#define   PAIRWISE_BLOCK_SIZE                  8
+/* Start of the switch from near to far field, as a fraction of the radius. */
+#define   SPLIT_INNER_FRACTION              0.8f
+
+/******************************************************************************
+ *																			  *
+ *	                         SummationMode Enum                               *
+ *																			  *
+ ******************************************************************************
+ *  FAST                                                                      *
+ *       Sources are accumulated one after another in body order.             *
+ *  DETERMINISTIC                                                             *
+ *       Sources are accumulated with a pairwise tree whose shape depends     *
+ *       only on the number of bodies, so the rounding of every sum is the    *
+ *       same no matter how the work is split across threads.                 *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Enumeration of the force accumulation strategies. A GravitySolver, when   *
+ *  set, replaces both, and is itself independent of the number of threads.   *
+ *                                                                            *
+ ******************************************************************************/
+enum class SummationMode
+{
+	FAST,
+	DETERMINISTIC,
+};
+
+/******************************************************************************
+*                                                                             *
+*                             NBodyState (struct)                             *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  positions                                                                  *
+*          METERS                                                             *
+*          Position of every body in world space.                             *
+*  velocities                                                                 *
+*          METERS / SECOND                                                    *
+*          Velocity of every body in world space.                             *
+*  masses                                                                     *
+*          KILOGRAMS                                                          *
+*          Mass of every body (0 for test particles).                         *
+*  G                                                                          *
+*          Gravitational constant in the system's units.                      *
+*  t                                                                          *
+*          SECONDS                                                            *
+*          Simulation time of the state.                                      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Plain structure-of-arrays copy of the translational state of a system,     *
+*  free of any rendering data, which the integrator kernels operate on.       *
+*                                                                             *
+*******************************************************************************/
+struct NBodyState
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> velocities;
+	std::vector<GLfloat>   masses;
+	GLfloat                G;
+	GLdouble               t;
+};
+
+/******************************************************************************
+ *																			  *
+ *                           NBodyIntegrator Class                            *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  pool                                                                      *
+ *          Optional worker pool used to split force evaluation by body.      *
+ *  solver                                                                    *
+ *          Optional replacement for the built-in direct summation.           *
+ *  mode                                                                      *
+ *          Force accumulation strategy (see SummationMode).                  *
+ *  tidal                                                                     *
+ *          Linear external field: every body also feels tidal * position.    *
+ *          Zero except when integrating a subsystem in its own frame.        *
+ *  forceMillis, forceEvaluations                                             *
+ *          Wall-clock time spent evaluating forces, for measuring the cost   *
+ *          of the summation mode.                                            *
+ *  specialized                                                               *
+ *          Whether small scenes use the kernels specialized on their size.   *
+ *  splitRadius, splitRatio                                                   *
+ *          Force split for multirate steps: pairs closer than the radius     *
+ *          are near field, evaluated splitRatio times per far evaluation.    *
+ *  nearEvaluations                                                           *
+ *          Number of near field evaluations (far ones count as force         *
+ *          evaluations, since they visit every pair).                        *
+ *  startAccel, endAccel                                                      *
+ *          Accelerations at the start and end of the last step.              *
+ *  cachedPositions, cachedMasses, cachedTidal                                *
+ *          State at which endAccel was evaluated. When the next step starts  *
+ *          from the same state, endAccel is reused as its start value.       *
+ *  nearAccel, farAccel, splitPositions                                       *
+ *          The two parts of the acceleration at the end of the last          *
+ *          multirate step, and the positions they belong to.                 *
+ *  cellKeys, cellStart, cellBodies                                           *
+ *          Hashed cell list of the bodies, one split radius per cell.        *
+ *  stagePositions, stageAccel, ...                                           *
+ *          Scratch arrays reused between steps to avoid allocation.          *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Integrates every body of an NBodyState simultaneously. Each stage         *
+ *  evaluates all accelerations from the same positions, so the step does     *
+ *  not depend on body order, and the per-body force sums are independent     *
+ *  of one another so they can be split across threads.                       *
+ *                                                                            *
+ *  With a force split set, step uses the multirate method instead: a         *
+ *  symplectic impulse scheme (RESPA) in which the slowly varying far field   *
+ *  kicks once per step and the near field drives splitRatio leapfrog         *
+ *  substeps. A smooth switch between the two keeps the split free of         *
+ *  impulses as pairs cross the radius.                                       *
+ *                                                                            *
+ ******************************************************************************/
+class NBodyIntegrator
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   NBodyIntegrator(WorkerPool* pool = nullptr) :
+	                       pool(pool), solver(nullptr), mode(SummationMode::FAST),
+	                       tidal(0.0f), specialized(true), splitRadius(0), splitRatio(1),
+	                       forceMillis(0), forceEvaluations(0), nearEvaluations(0) {}
+
+	/* Gravitational acceleration of every body at the given positions. */
+	void               accelerations (const NBodyState&             state,
+	                                  const std::vector<glm::vec3>& positions,
+	                                        std::vector<glm::vec3>& out      );
+
+	/* Advance every body by dt with the classical Runge-Kutta method. */
+	void               rungeKutta    (      NBodyState&             state,
+	                                  const GLfloat                 dt       );
+
+	/* Advance every body by dt with the kick-drift-kick leapfrog method. */
+	void               leapfrog      (      NBodyState&             state,
+	                                  const GLfloat                 dt       );
+
+	/* Advance every body by dt with near and far forces on separate steps. */
+	void               multirate     (      NBodyState&             state,
+	                                  const GLfloat                 dt       );
+
+	/* Advance by dt with multirate if a force split is set, else Runge-Kutta. */
+	void               step          (      NBodyState&             state,
+	                                  const GLfloat                 dt       );
+
+	/* Near and far parts of the acceleration (they sum to accelerations). */
+	void               nearField     (const NBodyState&             state,
+	                                  const std::vector<glm::vec3>& positions,
+	                                        std::vector<glm::vec3>& out      );
+	void               farField      (const NBodyState&             state,
+	                                  const std::vector<glm::vec3>& positions,
+	                                        std::vector<glm::vec3>& out      );
+
+	/* Share of a pair's force at separation r which is near field. */
+	GLfloat            nearWeight    (const GLfloat                 r        ) const;
+
+	/* Sum of the accelerations on body i from the sources [lo, hi). */
+	static glm::vec3   pairwiseSum   (const NBodyState&             state,
+	                                  const std::vector<glm::vec3>& positions,
+	                                  const GLuint                  i,
+	                                  const GLuint                  lo,
+	                                  const GLuint                  hi       );
+
+	/* Reset the force evaluation timers. */
+	void               resetTimers()
+	                   {  forceMillis = 0; forceEvaluations = 0; nearEvaluations = 0;  }
+
+	/* Getters. */
+	WorkerPool*        getWorkerPool()     const  {  return pool;            }
+	GravitySolver*     getSolver()         const  {  return solver;          }
+	SummationMode      getSummationMode()  const  {  return mode;            }
+	glm::mat3          getTidalTensor()    const  {  return tidal;           }
+	GLdouble           getForceMillis()    const  {  return forceMillis;     }
+	GLuint             getForceEvaluations() const
+	                                              {  return forceEvaluations;}
+	GLuint             getNearEvaluations() const {  return nearEvaluations; }
+	GLfloat            getSplitRadius()    const  {  return splitRadius;     }
+	GLuint             getSplitRatio()     const  {  return splitRatio;      }
+	bool               isSpecialized()     const  {  return specialized;     }
+	bool               isSplit()           const
+	                                  {  return splitRadius > 0 && splitRatio > 1; }
+	const std::vector<glm::vec3>& getStartAccel() const
+	                                              {  return startAccel;      }
+	const std::vector<glm::vec3>& getEndAccel()   const
+	                                              {  return endAccel;        }
+
+	/* Setters. */
+	void               setWorkerPool(WorkerPool* p) {  pool = p;             }
+	void               setSolver(GravitySolver* s)  {  solver = s;           }
+	void               setSummationMode(SummationMode m) {  mode = m;        }
+	void               setTidalTensor(const glm::mat3& t) {  tidal = t;      }
+	void               setSpecialized(bool s)       {  specialized = s;      }
+	void               setForceSplit(GLfloat radius, GLuint ratio)
+	                   {  splitRadius = radius;  splitRatio = ratio;  splitPositions.clear();  }
+
+/* Protected Members. */
+protected:
+
+	/* Optional worker pool. */
+	WorkerPool*            pool;
+	/* Optional gravity solver (null for direct summation). */
+	GravitySolver*         solver;
+	/* Force accumulation strategy. */
+	SummationMode          mode;
+	/* Linear external field. */
+	glm::mat3              tidal;
+	/* Use the small-N kernels when they apply. */
+	bool                   specialized;
+	/* Force split for multirate steps. */
+	GLfloat                splitRadius;
+	GLuint                 splitRatio;
+	/* Wall-clock time spent in, and number of, force evaluations. */
+	GLdouble               forceMillis;
+	GLuint                 forceEvaluations;
+	GLuint                 nearEvaluations;
+	/* Accelerations at the ends of the last step. */
+	std::vector<glm::vec3> startAccel;
+	std::vector<glm::vec3> endAccel;
+	/* State at which endAccel was evaluated. */
+	std::vector<glm::vec3> cachedPositions;
+	std::vector<GLfloat>   cachedMasses;
+	glm::mat3              cachedTidal;
+	/* Split acceleration at the end of the last multirate step. */
+	std::vector<glm::vec3> nearAccel;
+	std::vector<glm::vec3> farAccel;
+	std::vector<glm::vec3> splitPositions;
+	/* Hashed cell list for the near field. */
+	std::vector<unsigned long long> cellKeys;
+	std::vector<GLuint>    cellStart;
+	std::vector<GLuint>    cellBodies;
+	/* Scratch space. */
+	std::vector<glm::vec3> stagePositions;
+	std::vector<glm::vec3> stageVelocities;
+	std::vector<glm::vec3> stageAccel;
+	std::vector<glm::vec3> sumPositions;
+	std::vector<glm::vec3> sumVelocities;
+
+	/* Ensure startAccel holds the acceleration at the current state. */
+	void               startStep     (const NBodyState&             state    );
+
+	/* Runge-Kutta step by a kernel specialized on the number of bodies. */
+	bool               smallRungeKutta(      NBodyState&            state,
+	                                   const GLfloat                dt       );
+
+	/* Hash key of the cell at integer coordinates (x, y, z). */
+	static unsigned long long cellKey(long long x, long long y, long long z);
+	/* Sort the bodies into cells one split radius wide. */
+	void               buildCells    (const std::vector<glm::vec3>& positions);
+	/* Near field without the timing (also used by farField). */
+	void               sumNear       (const NBodyState&             state,
+	                                  const std::vector<glm::vec3>& positions,
+	                                        std::vector<glm::vec3>& out      );
+};
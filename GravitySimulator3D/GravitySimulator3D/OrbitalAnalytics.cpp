@@ -0,0 +1,336 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <limits>
+#include <fstream>
+#include "OrbitalAnalytics.h"
+#include "OrbitalSystem.h"
+
+/******************************************************************************
+*                                                                             *
+*                OrbitalAnalytics::OrbitalAnalytics (Constructor)             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param primary                                                             *
+*           Index of the body the elements are measured relative to.          *
+*  @param interval                                                            *
+*           Number of steps between samples.                                  *
+*  @param summaryFile                                                         *
+*           File to rewrite with the statistics (empty for none).             *
+*  @param summarySamples                                                      *
+*           Number of samples between rewrites of the summary file.           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the OrbitalAnalytics class.                                *
+*                                                                             *
+*******************************************************************************/
+OrbitalAnalytics::OrbitalAnalytics(GLuint primary, GLuint interval,
+                                   const char* summaryFile,
+                                   GLuint summarySamples) :
+	primary(primary), interval(std::max(1u, interval)),
+	summaryFile(summaryFile), summarySamples(std::max(1u, summarySamples)),
+	steps(0), samples(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                          OrbitalAnalytics::onStep                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has just completed a step.               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Every interval steps, computes the elements of every body and adds them    *
+*  to the running statistics. If the bodies of the system have changed, the   *
+*  statistics are started again.                                              *
+*                                                                             *
+*******************************************************************************/
+void OrbitalAnalytics::onStep(OrbitalSystem& system)
+{
+	if (++steps % interval != 0)
+		return;
+
+	GLuint n = system.getNumBodies();
+	if (primary >= n)
+		return;
+
+	/* Start again when bodies are added or removed. */
+	if (names.size() != n)
+	{
+		reset();
+		for (GLuint i = 0; i < n; i++)
+			names.push_back(system.getBody(i)->getName());
+		stats.resize(n * ELEMENT_COUNT);
+	}
+
+	system.gatherState(state);
+	computeElements(state, primary, latest);
+
+	/* Unavailable elements are NaN, which never compares equal to itself. */
+	for (GLuint k = 0; k < n * ELEMENT_COUNT; k++)
+		if (latest[k] == latest[k])
+			stats[k].add(latest[k]);
+
+	samples++;
+	if (!summaryFile.empty() && samples % summarySamples == 0)
+		writeSummary(summaryFile.c_str());
+}
+
+/******************************************************************************
+*                                                                             *
+*                         OrbitalAnalytics::onReorder                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has rearranged its bodies.               *
+*  @param order                                                               *
+*           Old index of the body now at each index.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Moves the statistics of each body to its new index, so a reorder does not  *
+*  restart them, and follows the primary.                                     *
+*                                                                             *
+*******************************************************************************/
+void OrbitalAnalytics::onReorder(OrbitalSystem&,
+                                 const std::vector<GLuint>& order)
+{
+	GLuint n = order.size();
+	for (GLuint i = 0; i < n; i++)
+	{
+		if (order[i] == primary)
+		{
+			primary = i;
+			break;
+		}
+	}
+
+	if (names.size() != n)
+		return;
+
+	std::vector<GLdouble>     oldLatest(latest);
+	std::vector<RunningStats> oldStats(stats);
+	MortonOrder::apply(names, order);
+	for (GLuint i = 0; i < n; i++)
+	{
+		for (GLuint e = 0; e < ELEMENT_COUNT; e++)
+		{
+			if (!latest.empty())
+				latest[i * ELEMENT_COUNT + e] = oldLatest[order[i] * ELEMENT_COUNT + e];
+			stats[i * ELEMENT_COUNT + e] = oldStats[order[i] * ELEMENT_COUNT + e];
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                          OrbitalAnalytics::onRemove                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which is removing a body.                      *
+*  @param i                                                                   *
+*           Index of the body being removed.                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The last body's statistics move into the removed body's place, as the      *
+*  body does, so the other bodies keep theirs. Removing the primary stops     *
+*  the sampling.                                                              *
+*                                                                             *
+*******************************************************************************/
+void OrbitalAnalytics::onRemove(OrbitalSystem& system, GLuint i)
+{
+	GLuint last = system.getNumBodies() - 1;
+	if (primary == i)
+		primary = NO_BODY;
+	else if (primary == last)
+		primary = i;
+
+	if (names.size() != last + 1)
+		return;
+
+	names[i] = names[last];
+	names.pop_back();
+	for (GLuint e = 0; e < ELEMENT_COUNT; e++)
+	{
+		if (!latest.empty())
+			latest[i * ELEMENT_COUNT + e] = latest[last * ELEMENT_COUNT + e];
+		stats[i * ELEMENT_COUNT + e] = stats[last * ELEMENT_COUNT + e];
+	}
+	if (!latest.empty())
+		latest.resize(last * ELEMENT_COUNT);
+	stats.resize(last * ELEMENT_COUNT);
+}
+
+/******************************************************************************
+*                                                                             *
+*                      OrbitalAnalytics::computeElements                      *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state of the system.                                          *
+*  @param primary                                                             *
+*           Index of the body the elements are measured relative to.          *
+*  @param out                                                                 *
+*           Output elements, ELEMENT_COUNT per body in OrbitalElement order.  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Two-body osculating elements from the position and velocity relative to    *
+*  the primary, with mu = G (M + m):                                          *
+*    h = r x v,  e = |v x h / mu - r / |r||,  a = -mu / (v^2 - 2 mu / |r|)    *
+*  The periapsis is h^2 / (mu (1 + e)), which holds for every conic.          *
+*  Elements without a value (the primary itself, or the apoapsis and period   *
+*  of an unbound orbit) are NaN. Works in double precision, since the energy  *
+*  is the difference of two nearly equal terms for wide orbits.               *
+*                                                                             *
+*******************************************************************************/
+void OrbitalAnalytics::computeElements(const NBodyState& state, GLuint primary,
+                                       std::vector<GLdouble>& out)
+{
+	const GLdouble nan = std::numeric_limits<GLdouble>::quiet_NaN();
+	const GLdouble pi  = 3.14159265358979323846;
+	GLuint         n   = state.positions.size();
+
+	out.resize(n * ELEMENT_COUNT);
+
+	glm::dvec3 center(state.positions[primary]);
+	glm::dvec3 drift(state.velocities[primary]);
+	for (GLuint i = 0; i < n; i++)
+	{
+		GLdouble* e  = &out[i * ELEMENT_COUNT];
+		GLdouble  mu = (GLdouble) state.G *
+		               ((GLdouble) state.masses[primary] + state.masses[i]);
+		glm::dvec3 r = glm::dvec3(state.positions[i])  - center;
+		glm::dvec3 v = glm::dvec3(state.velocities[i]) - drift;
+		GLdouble  d  = glm::length(r);
+
+		if (i == primary || mu <= 0 || d == 0)
+		{
+			for (GLuint k = 0; k < ELEMENT_COUNT; k++)
+				e[k] = nan;
+			continue;
+		}
+
+		glm::dvec3 h      = glm::cross(r, v);
+		GLdouble   h2     = glm::dot(h, h);
+		GLdouble   ecc    = glm::length(glm::cross(v, h) / mu - r / d);
+		GLdouble   energy = 0.5 * glm::dot(v, v) - mu / d;
+		GLdouble   a      = -mu / (2 * energy);
+		bool       bound  = (energy < 0);
+
+		e[(GLuint) OrbitalElement::PERIAPSIS]       = h2 / (mu * (1 + ecc));
+		e[(GLuint) OrbitalElement::APOAPSIS]        = bound ? a * (1 + ecc) : nan;
+		e[(GLuint) OrbitalElement::PERIOD]          = bound ? 2 * pi * sqrt(a * a * a / mu) : nan;
+		e[(GLuint) OrbitalElement::ECCENTRICITY]    = ecc;
+		e[(GLuint) OrbitalElement::SEMI_MAJOR_AXIS] = a;
+		e[(GLuint) OrbitalElement::INCLINATION]     = (h2 > 0) ? acos(h.z / sqrt(h2)) : nan;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                       OrbitalAnalytics::writeSummary                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the file to write.                                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the file was written.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  One row per body and element, with the number of samples, minimum,         *
+*  maximum, mean and standard deviation.                                      *
+*                                                                             *
+*******************************************************************************/
+bool OrbitalAnalytics::writeSummary(const char* file) const
+{
+	static const char* elementNames[ELEMENT_COUNT] =
+	{
+		"periapsis", "apoapsis", "period", "eccentricity",
+		"semi_major_axis", "inclination"
+	};
+
+	std::ofstream out(file);
+	if (!out)
+		return false;
+
+	out.precision(10);
+	out << "body,element,samples,min,max,mean,stddev\n";
+	for (GLuint i = 0; i < names.size(); i++)
+	{
+		if (i == primary)
+			continue;
+		for (GLuint k = 0; k < ELEMENT_COUNT; k++)
+		{
+			const RunningStats& s = stats[i * ELEMENT_COUNT + k];
+			out << names[i] << "," << elementNames[k] << "," << s.count << ","
+			    << s.minimum << "," << s.maximum << "," << s.mean << ","
+			    << sqrt(s.variance()) << "\n";
+		}
+	}
+
+	return out.good();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           OrbitalAnalytics::reset                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Clears the statistics. They are sized again at the next sample.            *
+*                                                                             *
+*******************************************************************************/
+void OrbitalAnalytics::reset()
+{
+	samples = 0;
+	names.clear();
+	latest.clear();
+	stats.clear();
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <string>
+#include  <algorithm>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "StepObserver.h"
+#include  "NBodyIntegrator.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Number of orbital elements tracked for every body. */
+#define   ELEMENT_COUNT                        6
+/* Default number of steps between samples. */
+#define   ANALYTICS_INTERVAL                  10
+/* Default number of samples between summary files. */
+#define   ANALYTICS_SUMMARY_SAMPLES          100
+
+/******************************************************************************
+ *																			  *
+ *	                         OrbitalElement Enum                              *
+ *																			  *
+ ******************************************************************************
+ *  PERIAPSIS                                                                 *
+ *       METERS: closest distance to the primary.                             *
+ *  APOAPSIS                                                                  *
+ *       METERS: farthest distance from the primary (bound orbits only).      *
+ *  PERIOD                                                                    *
+ *       SECONDS: time of one revolution (bound orbits only).                 *
+ *  ECCENTRICITY                                                              *
+ *       0 for a circle, below 1 for an ellipse.                              *
+ *  SEMI_MAJOR_AXIS                                                           *
+ *       METERS: negative for hyperbolic orbits.                              *
+ *  INCLINATION                                                               *
+ *       RADIANS: angle between the orbit plane and the x-y plane.            *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Enumeration of the osculating elements, used to index the statistics.     *
+ *                                                                            *
+ ******************************************************************************/
+enum class OrbitalElement
+{
+	PERIAPSIS,
+	APOAPSIS,
+	PERIOD,
+	ECCENTRICITY,
+	SEMI_MAJOR_AXIS,
+	INCLINATION,
+};
+
+/******************************************************************************
+*                                                                             *
+*                           RunningStats (struct)                             *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  count                                                                      *
+*          Number of values accumulated.                                      *
+*  minimum, maximum, mean                                                     *
+*          Extremes and mean of the values.                                   *
+*  squares                                                                    *
+*          Sum of squared differences from the mean (Welford's method), from  *
+*          which the variance follows without storing the values.             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Fixed-size summary of a stream of values.                                  *
+*                                                                             *
+*******************************************************************************/
+struct RunningStats
+{
+	GLuint         count;
+	GLdouble       minimum;
+	GLdouble       maximum;
+	GLdouble       mean;
+	GLdouble       squares;
+
+	/* Empty summary. */
+	RunningStats() : count(0), minimum(0), maximum(0), mean(0), squares(0) {}
+
+	/* Accumulate one value. */
+	void add(GLdouble x)
+	{
+		minimum  = (count == 0 || x < minimum) ? x : minimum;
+		maximum  = (count == 0 || x > maximum) ? x : maximum;
+		count++;
+		GLdouble delta = x - mean;
+		mean    += delta / count;
+		squares += delta * (x - mean);
+	}
+
+	/* Variance of the values accumulated so far. */
+	GLdouble variance() const  {  return (count > 1) ? squares / (count - 1) : 0; }
+};
+
+/******************************************************************************
+ *																			  *
+ *                          OrbitalAnalytics Class                            *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  primary                                                                   *
+ *          Index of the body the elements are measured relative to.          *
+ *  interval                                                                  *
+ *          Number of steps between samples.                                  *
+ *  summaryFile, summarySamples                                               *
+ *          File rewritten with the statistics every summarySamples samples   *
+ *          (empty for none).                                                 *
+ *  steps, samples                                                            *
+ *          Number of steps observed and samples taken so far.                *
+ *  names                                                                     *
+ *          Name of every body, for the summary.                              *
+ *  latest                                                                    *
+ *          Elements of every body at the last sample, ELEMENT_COUNT per body.*
+ *  stats                                                                     *
+ *          Running statistics, ELEMENT_COUNT per body.                       *
+ *  state                                                                     *
+ *          Scratch copy of the system's state.                               *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Step observer which computes the osculating orbit of every body about a   *
+ *  primary every few steps, in one pass over the structure-of-arrays state,  *
+ *  and folds the elements into running minimum, maximum, mean and variance.  *
+ *  Memory does not grow with the length of the run, so long runs need only   *
+ *  the summary instead of a dump of every trajectory. Apoapsis and period    *
+ *  are left out of the statistics while an orbit is unbound.                 *
+ *                                                                            *
+ ******************************************************************************/
+class OrbitalAnalytics : public StepObserver
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                        OrbitalAnalytics(GLuint      primary,
+	                                         GLuint      interval       = ANALYTICS_INTERVAL,
+	                                         const char* summaryFile    = "",
+	                                         GLuint      summarySamples = ANALYTICS_SUMMARY_SAMPLES);
+
+	/* Sample the elements every interval steps. */
+	virtual void            onStep(OrbitalSystem& system);
+
+	/* Carry the statistics and primary along when the bodies are reordered. */
+	virtual void            onReorder(OrbitalSystem&             system,
+	                                  const std::vector<GLuint>& order);
+
+	/* Drop the statistics of a body leaving the system. */
+	virtual void            onRemove (OrbitalSystem&             system,
+	                                  GLuint                     i);
+
+	/* Compute the elements of every body about the primary. */
+	static void             computeElements(const NBodyState&     state,
+	                                        GLuint                primary,
+	                                        std::vector<GLdouble>& out);
+
+	/* Write the statistics of every body as comma separated values. */
+	bool                    writeSummary(const char* file) const;
+
+	/* Forget every sample taken so far. */
+	void                    reset();
+
+	/* Getters. */
+	GLuint                  getPrimary()        const  {  return primary;       }
+	GLuint                  getInterval()       const  {  return interval;      }
+	GLuint                  getNumSamples()     const  {  return samples;       }
+	const RunningStats&     getStats(GLuint body, OrbitalElement e) const
+	                          {  return stats.at(body * ELEMENT_COUNT + (GLuint) e);   }
+	GLdouble                getLatest(GLuint body, OrbitalElement e) const
+	                          {  return latest.at(body * ELEMENT_COUNT + (GLuint) e);  }
+
+	/* Setters. */
+	void                    setPrimary(GLuint p)       {  primary  = p;  reset();  }
+	void                    setInterval(GLuint k)      {  interval = std::max(1u, k); }
+
+	/* Destructor. */
+	virtual                ~OrbitalAnalytics()                             {}
+
+/* Private Members. */
+private:
+
+	/* Sampling options. */
+	GLuint                    primary;
+	GLuint                    interval;
+	std::string               summaryFile;
+	GLuint                    summarySamples;
+	/* Progress. */
+	GLuint                    steps;
+	GLuint                    samples;
+	/* Per-body results. */
+	std::vector<std::string>  names;
+	std::vector<GLdouble>     latest;
+	std::vector<RunningStats> stats;
+	/* Scratch state. */
+	NBodyState                state;
+};
@@ -8,8 +8,10 @@
 #include  <math.h>
 #include  <string>
 #include  "Geometry.h"
+#include  "Interpolant.h"
 #include  "glm\glm.hpp"
 #include  "glm\gtc\matrix_transform.hpp"
+#include  "glm\gtc\quaternion.hpp"
 #include  "glm\gtx\vector_angle.hpp"
 #include  <glm\gtx\rotate_vector.hpp>
 #include  <iostream>
@@ -82,6 +84,8 @@
  *  transformationMatrix                                                      *
  *          Matrix describing the body's current transformation, which is     *
  *          based on the current linear and angular positions of the body.    *
+ *  interpolant                                                               *
+ *          Dense output of the body's motion over the last integrator step.  *
  *                                                                            *
  ******************************************************************************
  * DESCRIPTION                                                                *
@@ -99,6 +103,7 @@ public:
 
 	/* Default Constructor. */
 	OrbitalBody() :
+		geometry(nullptr),
 		radius(0),
 		scale(1),
 		mass(0),  
@@ -113,33 +118,35 @@ public:
 		angularVelocity(0),
 		angularAccel(0),
 		angularThrust(0), 
-		transMatrix(0)                            {}
+		transMatrix(0),
+		trail(nullptr)                            {}
 
 	/************************************************************************** 
 	 *  Calculate the current transformation matrix based upon the object's   *
-	 *  linear and angular position.                                          *
+	 *  linear position and the given orientation. Only the rendering needs   *
+	 *  the matrix, so it is built once per frame rather than once per step.  *
 	 *************************************************************************/
-	void snapshotMatrix()           
+	void snapshotMatrix(const glm::quat& orientation)           
 	{
-		/* Scale the body. */
-		glm::mat4 scaleM          = glm::scale(glm::mat4(), 
-                                               scale);
-		/* Rotate the body. */
-		glm::mat4 rotM;
-		
-		glm::vec3 cross = glm::cross(DEFAULT_ROT_AXIS, rotationalAxis);
+		/* Rotate and scale the body. */
+		glm::mat3 rotM            = glm::mat3_cast(orientation);
+		transMatrix               = glm::mat4(rotM);
+		transMatrix[0]           *= scale.x;
+		transMatrix[1]           *= scale.y;
+		transMatrix[2]           *= scale.z;
 
-		/* Rotate to angle of inclination. */
-		if(rotationalAxis != DEFAULT_ROT_AXIS)
-			rotM                  = glm::rotate(rotationalAngle, cross);
-		
-		rotM                      = glm::rotate(rotM, 
-                                                angularPosition,
-                                                DEFAULT_ROT_AXIS);	       
 		/* Translate the body. */
-		glm::mat4 tranM           = glm::translate(glm::mat4(), 
-                                                   linearPosition);
-		transMatrix   = tranM * rotM * scaleM ;
+		transMatrix[3]            = glm::vec4(linearPosition, 1.0f);
+	}
+
+	/************************************************************************** 
+	 *  Orientation given by the tilt and angular position: a turn of the     *
+	 *  angular position about the body's own axis, then the tilt about x.    *
+	 *************************************************************************/
+	glm::quat getOrientation() const
+	{
+		return glm::angleAxis(rotationalAngle, glm::vec3(1.0f, 0.0f, 0.0f)) *
+		       glm::angleAxis(angularPosition, DEFAULT_ROT_AXIS);
 	}
 
 	/************************************************************************** 
@@ -183,6 +190,7 @@ public:
 	GLfloat        getAngularAccel()    const     {  return angularAccel;    }
 	GLfloat        getAngularThrust()   const     {  return angularThrust;   }
 	glm::mat4*     getTransformation()            {  return &transMatrix;    }
+	Interpolant*   getInterpolant()               {  return &interpolant;    }
 												  
 	/* Setters. */			
 	void           setName(std::string n)         {  name              = n;  }
@@ -253,4 +261,7 @@ protected:
 	glm::mat4      transMatrix;
 	Mesh*          trail;
 
+	/* Dense output over the last integrator step. */
+	Interpolant    interpolant;
+
 };
@@ -2,13 +2,19 @@
 #include "tinyxml2.h"
 #include <glm\gtx\rotate_vector.hpp>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include "Planet.h"
 
 
 OrbitalSystem::OrbitalSystem(const OrbitalSystem& rhs) :
-	  G(rhs.getG()), clock(rhs.t()), starsMatrix(rhs.getStarsMatrix())
+	  G(rhs.getG()), clock(rhs.t()), stepStart(rhs.getStepStart()),
+	  starsMatrix(rhs.getStarsMatrix()), regularizing(rhs.isRegularizing()),
+	  handles(rhs.handles), handleIndex(rhs.handleIndex),
+	  slotGeneration(rhs.slotGeneration), freeSlots(rhs.freeSlots),
+	  reorderInterval(rhs.reorderInterval), stepsSinceReorder(rhs.stepsSinceReorder)
 {
-	stars = new Mesh(*rhs.stars);
+	stars = (rhs.stars != nullptr) ? new Mesh(*rhs.stars) : nullptr;
 	for(OrbitalBody* b : rhs.bodies)
 		bodies.push_back(new OrbitalBody(*b));
 	
@@ -19,23 +25,125 @@ OrbitalSystem::OrbitalSystem(const OrbitalSystem& rhs) :
 	transforms.push_back(&starsMatrix);
 	for(unsigned int i = 0; i < bodies.size(); i++)
 		transforms.push_back(bodies.at(i)->getTransformation());
+
+	observers  = rhs.observers;
+	subsystems = rhs.subsystems;
+	attitude   = rhs.attitude;
 }
 
-void OrbitalSystem::addBody(OrbitalBody* body)
+GLuint OrbitalSystem::addBody(OrbitalBody* body)
 {
 	/* Add the pointer, mesh, and transformation. */
 	bodies.push_back(body);
 	meshes.push_back(body->getGeometry());
 	transforms.push_back(body->getTransformation());
+
+	/* Reuse the slot freed longest ago, or open a new one. */
+	GLuint slot;
+	if(!freeSlots.empty())
+	{
+		slot = freeSlots.front();
+		freeSlots.pop_front();
+	}
+	else
+	{
+		slot = handleIndex.size();
+		handleIndex.push_back(NO_BODY);
+		slotGeneration.push_back(0);
+	}
+	handleIndex[slot] = bodies.size() - 1;
+	handles.push_back((slotGeneration[slot] << HANDLE_SLOT_BITS) | slot);
+
+	/* Rotational state as set on the body, spinning about its own axis. */
+	attitude.add(body->getOrientation(), 
+	             glm::vec3(0.0f, body->getAngularVelocity(), 0.0f));
+	return handles.back();
+}
+
+void OrbitalSystem::addBodies(const std::vector<OrbitalBody*>& batch)
+{
+	/* Grow every list once for the whole batch. */
+	GLuint n = bodies.size() + batch.size();
+	bodies.reserve(n);
+	meshes.reserve(meshes.size() + batch.size());
+	transforms.reserve(transforms.size() + batch.size());
+	handles.reserve(n);
+	attitude.reserve(n);
+
+	for(OrbitalBody* body : batch)
+		addBody(body);
 }
 
 void OrbitalSystem::removeBody(const GLuint i)
 {
-	bodies.erase(bodies.begin() + i);
+	GLuint last = bodies.size() - 1;
+
+	/* Observers see the body before it goes. */
+	for(StepObserver* o : observers)
+		o->onRemove(*this, i);
+
+	/* The last body, with its mesh, matrix and rotation, fills the gap. *
+	 * Meshes and matrices of the bodies follow those of the background. */
+	GLuint first = meshes.size() - bodies.size();
+	bodies[i]                = bodies[last];
+	meshes[first + i]        = meshes[first + last];
+	transforms[first + i]    = transforms[first + last];
+	bodies.pop_back();
+	meshes.pop_back();
+	transforms.pop_back();
+	attitude.swapRemove(i);
+
+	/* The slot is freed with a new generation, so old handles go stale. */
+	GLuint slot = handles[i] & HANDLE_SLOT_MASK;
+	handleIndex[slot] = NO_BODY;
+	slotGeneration[slot] = (slotGeneration[slot] + 1) & (0xFFFFFFFF >> HANDLE_SLOT_BITS);
+	freeSlots.push_back(slot);
+	handles[i] = handles[last];
+	handles.pop_back();
+	if(i < last)
+		handleIndex[handles[i] & HANDLE_SLOT_MASK] = i;
+
+	/* Keep the subsystem indices in step, and drop any left empty. */
+	for(Subsystem& s : subsystems)
+		s.removeMember(i, last);
+	subsystems.erase(std::remove_if(subsystems.begin(), subsystems.end(),
+	                                [](const Subsystem& s) 
+	                                { return s.getMembers().empty(); }),
+	                 subsystems.end());
+}
+
+void OrbitalSystem::removeBodies(std::vector<GLuint> indices)
+{
+	/* From the highest index down, so no body still to go is moved. */
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+	for(GLuint k = indices.size(); k > 0; k--)
+		if(indices[k - 1] < bodies.size())
+			removeBody(indices[k - 1]);
+}
+
+void OrbitalSystem::addSubsystem(const Subsystem& subsystem)
+{
+	subsystems.push_back(subsystem);
+}
+
+void OrbitalSystem::addObserver(StepObserver* o)
+{
+	observers.push_back(o);
+}
+
+void OrbitalSystem::removeObserver(StepObserver* o)
+{
+	observers.erase(std::remove(observers.begin(), observers.end(), o),
+	                observers.end());
 }
 
 glm::vec3 OrbitalSystem::gravityVector(OrbitalBody* subject, glm::vec3 position)
 {
+	/* Reproducible mode sums with the same fixed-shape tree as the integrator. */
+	if(getSummationMode() == SummationMode::DETERMINISTIC)
+		return pairwiseGravity(subject, position, 0, bodies.size());
+
 	glm::vec3 netGravity(0);
 	glm::vec3 direction(0);
 
@@ -65,6 +173,34 @@ glm::vec3 OrbitalSystem::gravityVector(OrbitalBody* subject, glm::vec3 position)
 }
 
 
+glm::vec3 OrbitalSystem::pairwiseGravity(OrbitalBody* subject, 
+                                         const glm::vec3 position,
+                                         const GLuint lo, const GLuint hi)
+{
+	/* Split the range until it is short enough to sum directly. */
+	if(hi - lo > PAIRWISE_BLOCK_SIZE)
+	{
+		GLuint mid = lo + (hi - lo) / 2;
+		return pairwiseGravity(subject, position, lo, mid) +
+		       pairwiseGravity(subject, position, mid, hi);
+	}
+
+	glm::vec3 netGravity(0);
+	for(GLuint j = lo; j < hi; j++)
+	{
+		OrbitalBody* body = bodies[j];
+		if(body == subject || body->getMass() == 0)
+			continue;
+
+		glm::vec3 d  = body->getLinearPosition() - position;
+		GLfloat   r2 = glm::dot(d, d);
+		if(r2 == 0)
+			continue;
+		netGravity += (G * body->getMass() / (r2 * sqrt(r2))) * d;
+	}
+	return netGravity;
+}
+
 glm::vec3 OrbitalSystem::A(OrbitalBody* subject, const glm::vec3 position, float dt)
 {
 	/* Calculate the force of gravity the the body's new position. */
@@ -75,33 +211,285 @@ glm::vec3 OrbitalSystem::A(OrbitalBody* subject, const glm::vec3 position, float
 	//return netAcceleration += dt * subject->getLinearThrust();
 }
 
-void OrbitalSystem::rungeKattaApprx(OrbitalBody* subject, const GLfloat dt)
+void OrbitalSystem::rungeKattaApprx(const GLfloat dt)
+{
+	/* Close pairs are split off into regularized subsystems. */
+	if(regularizing)
+		regularizeEncounters(dt);
+
+	/* Nested subsystems need their own steps. */
+	if(!subsystems.empty())
+	{
+		hierarchicalStep(dt);
+		return;
+	}
+
+	GLuint n = bodies.size();
+
+	/* Gather the translational state of every body. */
+	gatherState(state);
+	state.t = stepStart;
+
+	/* Advance all of the bodies together. */
+	integrator.step(state, dt);
+
+	/* Record the dense output and scatter the new state to the bodies. */
+	const std::vector<glm::vec3>& startAccel = integrator.getStartAccel();
+	const std::vector<glm::vec3>& endAccel   = integrator.getEndAccel();
+	for(GLuint i = 0; i < n; i++)
+	{
+		OrbitalBody* subject = bodies[i];
+
+		subject->getInterpolant()->begin(stepStart, 
+		                                 subject->getLinearPosition(),
+		                                 subject->getLinearVelocity(), 
+		                                 startAccel[i]);
+		subject->getInterpolant()->end(stepStart + dt, state.positions[i],
+		                               state.velocities[i], endAccel[i]);
+
+		subject->setLinearPosition(state.positions[i]);
+		subject->setLinearVelocity(state.velocities[i]);
+		subject->setGravityVector(endAccel[i]);
+	}
+
+	/* Turn every body; the matrices are only rebuilt when drawn. */
+	attitudeIntegrator.advance(attitude, dt);
+}
+
+void OrbitalSystem::hierarchicalStep(const GLfloat dt)
+{
+	GLuint n = bodies.size();
+	GLuint m = subsystems.size();
+
+	/* World state, and local frames for any new subsystems. */
+	gatherState(state);
+	state.t = stepStart;
+	for(Subsystem& s : subsystems)
+		if(!s.isCaptured())
+			s.capture(state);
+
+	/* The outer problem holds the free bodies and one point per subsystem. */
+	NBodyState          outer;
+	std::vector<GLint>  owner(n, -1);
+	std::vector<GLuint> entry(n);
+	for(GLuint k = 0; k < m; k++)
+		for(GLuint i : subsystems[k].getMembers())
+			owner[i] = k;
+	for(GLuint i = 0; i < n; i++)
+	{
+		if(owner[i] >= 0)
+			continue;
+		entry[i] = outer.positions.size();
+		outer.positions.push_back(state.positions[i]);
+		outer.velocities.push_back(state.velocities[i]);
+		outer.masses.push_back(state.masses[i]);
+	}
+	GLuint first = outer.positions.size();
+	for(Subsystem& s : subsystems)
+	{
+		outer.positions.push_back(s.getCenterPosition());
+		outer.velocities.push_back(s.getCenterVelocity());
+		outer.masses.push_back(s.getMass());
+	}
+	outer.G = G;
+	outer.t = stepStart;
+
+	/* Long outer step, with the tides on each subsystem at both ends. */
+	std::vector<glm::mat3> tidalStart(m);
+	std::vector<glm::mat3> tidalEnd(m);
+	for(GLuint k = 0; k < m; k++)
+		tidalStart[k] = Subsystem::tidalTensor(outer, first + k);
+	integrator.step(outer, dt);
+	for(GLuint k = 0; k < m; k++)
+		tidalEnd[k] = Subsystem::tidalTensor(outer, first + k);
+
+	/* Short internal steps in each local frame. */
+	for(GLuint k = 0; k < m; k++)
+	{
+		subsystems[k].setCenter(outer.positions[first + k], 
+		                        outer.velocities[first + k]);
+		subsystems[k].advance(dt, tidalStart[k], tidalEnd[k]);
+	}
+
+	/* Record the dense output and scatter the new state to the bodies. */
+	const std::vector<glm::vec3>& startAccel = integrator.getStartAccel();
+	const std::vector<glm::vec3>& endAccel   = integrator.getEndAccel();
+	for(GLuint i = 0; i < n; i++)
+	{
+		OrbitalBody* subject = bodies[i];
+		glm::vec3    position, velocity, accelStart, accelEnd;
+
+		if(owner[i] < 0)
+		{
+			position   = outer.positions[entry[i]];
+			velocity   = outer.velocities[entry[i]];
+			accelStart = startAccel[entry[i]];
+			accelEnd   = endAccel[entry[i]];
+		}
+		else
+		{
+			/* Members move with the center plus their local motion. */
+			Subsystem&          s       = subsystems[owner[i]];
+			const NBodyState&   local   = s.getLocalState();
+			GLuint              e       = first + owner[i];
+			GLuint              k       = std::find(s.getMembers().begin(),
+			                                        s.getMembers().end(), i) -
+			                              s.getMembers().begin();
+
+			position   = s.getCenterPosition() + local.positions[k];
+			velocity   = s.getCenterVelocity() + local.velocities[k];
+			accelStart = startAccel[e] + s.getStartAccel()[k];
+			accelEnd   = endAccel[e]   + s.getEndAccel()[k];
+		}
+
+		subject->getInterpolant()->begin(stepStart, 
+		                                 subject->getLinearPosition(),
+		                                 subject->getLinearVelocity(), 
+		                                 accelStart);
+		subject->getInterpolant()->end(stepStart + dt, position, velocity, 
+		                               accelEnd);
+
+		subject->setLinearPosition(position);
+		subject->setLinearVelocity(velocity);
+		subject->setGravityVector(accelEnd);
+	}
+
+	/* Turn every body; the matrices are only rebuilt when drawn. */
+	attitudeIntegrator.advance(attitude, dt);
+}
+
+void OrbitalSystem::regularizeEncounters(const GLfloat dt)
 {
-	const GLuint  order      = 4;
-	const GLfloat c          = 1.0f / 6.0f;
+	GLuint n = bodies.size();
+	gatherState(state);
+
+	/* Release pairs which have drifted apart or are being pulled apart. */
+	for(GLuint k = 0; k < subsystems.size(); )
+	{
+		Subsystem& s = subsystems[k];
+		bool       release = false;
+		if(s.isRegularized())
+		{
+			const std::vector<GLuint>& m = s.getMembers();
+			if(m.size() != 2)
+				release = true;
+			else
+			{
+				GLfloat r  = glm::distance(state.positions[m[0]], state.positions[m[1]]);
+				GLfloat mu = G * (state.masses[m[0]] + state.masses[m[1]]);
+				release = Subsystem::pairTime(r, mu) > KS_RELEASE_STEPS * dt ||
+				          s.getPerturbation() > KS_RELEASE_PERTURBATION;
+			}
+		}
+		if(release)
+			subsystems.erase(subsystems.begin() + k);
+		else
+			k++;
+	}
+
+	/* Only free bodies can pair up. */
+	std::vector<bool> grouped(n, false);
+	for(const Subsystem& s : subsystems)
+		for(GLuint i : s.getMembers())
+			grouped[i] = true;
 
-	glm::vec3     k[order];
-	glm::vec3     l[order];
-	glm::vec3     r          = subject->getLinearPosition();
-	glm::vec3     v          = subject->getLinearVelocity();
-			     	  
-	k[0]  = dt * v;
-	l[0]  = dt * A(subject, r, 0);
-	k[1]  = dt * (v + (0.5f * l[0]));
-	l[1]  = dt * A(subject, r + (0.5f * k[0]), (0.5f * dt));
-	k[2]  = dt * (v + (0.5f * l[1]));
-	l[2]  = dt * A(subject, r + (0.5f * k[1]), (0.5f * dt));
-	k[3]  = dt * (v + l[2]);
-	l[3]  = dt * A(subject, r + k[2], dt);
+	/* No pair of free bodies is close enough beyond this separation. */
+	std::vector<GLuint> free;
+	GLfloat             heaviest = 0, second = 0;
+	for(GLuint i = 0; i < n; i++)
+	{
+		if(grouped[i])
+			continue;
+		free.push_back(i);
+		if(state.masses[i] > heaviest)
+		{
+			second   = heaviest;
+			heaviest = state.masses[i];
+		}
+		else if(state.masses[i] > second)
+			second = state.masses[i];
+	}
+	GLfloat reach = (GLfloat) cbrt((GLdouble) KS_CAPTURE_STEPS * KS_CAPTURE_STEPS * 
+	                               dt * dt * G * (heaviest + second));
+	if(free.size() < 2 || !(reach > 0))
+		return;
 
-	r += c * (k[0] + k[1] + k[2] + k[3]);
-	v += c * (l[0] + l[1] + l[2] + l[3]);
+	/* Sweep along x for each body's closest partner within its capture time. */
+	std::sort(free.begin(), free.end(), [this](GLuint a, GLuint b)
+	          { return state.positions[a].x < state.positions[b].x; });
+	std::vector<GLint>   partner(n, -1);
+	std::vector<GLfloat> closest(n, reach);
+	for(GLuint a = 0; a < free.size(); a++)
+	{
+		GLuint i = free[a];
+		for(GLuint b = a + 1; b < free.size(); b++)
+		{
+			GLuint j = free[b];
+			if(state.positions[j].x - state.positions[i].x > reach)
+				break;
 
-	subject->setLinearPosition(r);
-	subject->setLinearVelocity(v);
-	subject->setGravityVector(gravityVector(subject, r));
-	subject->setAngularPosition(subject->getAngularPosition() + subject->getAngularVelocity() * dt);
-	subject->snapshotMatrix();
+			GLfloat r  = glm::distance(state.positions[i], state.positions[j]);
+			GLfloat mu = G * (state.masses[i] + state.masses[j]);
+			if(Subsystem::pairTime(r, mu) >= KS_CAPTURE_STEPS * dt)
+				continue;
+			if(r < closest[i])
+			{
+				closest[i] = r;
+				partner[i] = j;
+			}
+			if(r < closest[j])
+			{
+				closest[j] = r;
+				partner[j] = i;
+			}
+		}
+	}
+
+	/* Mutual closest pairs, if the rest of the system barely disturbs them. */
+	for(GLuint i = 0; i < n; i++)
+	{
+		GLint j = partner[i];
+		if(j <= (GLint) i || partner[j] != (GLint) i)
+			continue;
+
+		GLfloat   r      = closest[i];
+		GLfloat   mu     = G * (state.masses[i] + state.masses[j]);
+		glm::vec3 center = 0.5f * (state.positions[i] + state.positions[j]);
+		GLdouble  tides  = 0;
+		for(GLuint k = 0; k < n; k++)
+		{
+			if(k == i || k == (GLuint) j)
+				continue;
+			GLdouble d = glm::distance(state.positions[k], center);
+			if(d > 0)
+				tides += 2.0 * G * state.masses[k] / (d * d * d);
+		}
+		if(tides * r * r * r > KS_CAPTURE_PERTURBATION * mu)
+			continue;
+
+		Subsystem pair(bodies[i]->getName() + "+" + bodies[j]->getName());
+		pair.addMember(i);
+		pair.addMember(j);
+		pair.setRegularized(true);
+		subsystems.push_back(pair);
+	}
+}
+
+void OrbitalSystem::gatherState(NBodyState& out) const
+{
+	GLuint n = bodies.size();
+
+	out.positions.resize(n);
+	out.velocities.resize(n);
+	out.masses.resize(n);
+	for(GLuint i = 0; i < n; i++)
+	{
+		out.positions[i]  = bodies[i]->getLinearPosition();
+		out.velocities[i] = bodies[i]->getLinearVelocity();
+		out.masses[i]     = bodies[i]->getMass();
+	}
+	out.G = G;
+	out.t = clock;
 }
 
 /* Delta t is in real-time seconds. */
@@ -111,16 +499,101 @@ void OrbitalSystem::interpolate(GLfloat realSeconds)
 	GLfloat dt = (GLfloat) (realSeconds * SIM_SECONDS_PER_REAL_SECOND);
 	//std::cout << realSeconds << " -> " << dt << std::endl;
 
+	advance(dt, true);
+}
+
+void OrbitalSystem::advance(GLfloat dt, bool notify)
+{
+	/* Keep bodies which are close in space close in memory. */
+	if(reorderInterval > 0 && ++stepsSinceReorder >= reorderInterval)
+	{
+		reorderBodies();
+		stepsSinceReorder = 0;
+	}
+
 	/* Add the time to the global clock. */
+	stepStart = clock;
 	clock += dt;
 
 	/* Use Runge-Katta approximation to update the state vectors. */
-	for(OrbitalBody* subject : bodies) 
-		rungeKattaApprx(subject, dt);
-	
+	rungeKattaApprx(dt);
+
+	/* Let the observers inspect the completed step. */
+	if(notify)
+		for(StepObserver* o : observers)
+			o->onStep(*this);
+}
+
+void OrbitalSystem::restoreState(const NBodyState& saved, const AttitudeState& savedAttitude)
+{
+	/* Place every body, with an empty step at the restored time. */
+	for(GLuint i = 0; i < bodies.size(); i++)
+	{
+		OrbitalBody* subject = bodies[i];
+		subject->setLinearPosition(saved.positions[i]);
+		subject->setLinearVelocity(saved.velocities[i]);
+		subject->getInterpolant()->begin(saved.t, saved.positions[i],
+		                                 saved.velocities[i], glm::vec3(0));
+		subject->getInterpolant()->end(saved.t, saved.positions[i],
+		                               saved.velocities[i], glm::vec3(0));
+	}
+	attitude  = savedAttitude;
+	clock     = saved.t;
+	stepStart = saved.t;
+
+	/* Subsystems take their local frames from the restored bodies. */
+	gatherState(state);
+	for(Subsystem& s : subsystems)
+		s.capture(state);
 }
 
-OrbitalSystem OrbitalSystem::loadFile(const char* xmlFile)
+void OrbitalSystem::reorderBodies()
+{
+	GLuint n = bodies.size();
+	gatherState(state);
+
+	std::vector<GLuint> order;
+	MortonOrder::sort(state.positions, getWorkerPool(), order);
+
+	bool moved = false;
+	for(GLuint i = 0; i < n && !moved; i++)
+		moved = order[i] != i;
+	if(!moved)
+		return;
+
+	/* The bodies take their meshes, matrices and rotation with them. */
+	MortonOrder::apply(bodies, order);
+	MortonOrder::apply(meshes, order, meshes.size() - n);
+	MortonOrder::apply(transforms, order, transforms.size() - n);
+	MortonOrder::apply(handles, order);
+	attitude.reorder(order);
+	for(GLuint i = 0; i < n; i++)
+		handleIndex[handles[i] & HANDLE_SLOT_MASK] = i;
+
+	/* Subsystems and observers follow the bodies to their new indices. */
+	std::vector<GLuint> newIndex(n);
+	for(GLuint i = 0; i < n; i++)
+		newIndex[order[i]] = i;
+	for(Subsystem& s : subsystems)
+		s.remapMembers(newIndex);
+	for(StepObserver* o : observers)
+		o->onReorder(*this, order);
+}
+
+void OrbitalSystem::snapshotTransforms()
+{
+	/* Build the matrices from the current positions and orientations. */
+	for(GLuint i = 0; i < bodies.size(); i++)
+		bodies[i]->snapshotMatrix(attitude.orientations[i]);
+}
+
+BodyState OrbitalSystem::stateAt(const GLuint i, const GLdouble t)
+{
+	/* Evaluate the body's interpolant over the last step. */
+	return bodies.at(i)->getInterpolant()->stateAt(t);
+}
+
+OrbitalSystem OrbitalSystem::loadFile(const char* xmlFile, const bool loadGeometry)
 {
 	//OrbitalSystem newSystem("res/meshes/body.obj", "res/textures/milkyway.jpg", 1.000e5f);
 	OrbitalSystem newSystem;
@@ -153,17 +626,23 @@ OrbitalSystem OrbitalSystem::loadFile(const char* xmlFile)
 			GLfloat     bgTilt_float   = (GLfloat) atof(bgTilt_str);
 
 			/* Set the background parameters of the system. */
-			newSystem.stars = Geometry::loadObj(bgMeshFile_str, bgTextFile_str);
-			Vertex* vertices = newSystem.stars->getVertices();
-			for(unsigned int i = 0; i < newSystem.stars->getNumVertices(); i++)
-				vertices[i].normal = glm::vec3(0.0f, -1.0f, 0.0f);//glm::normalize(vertices[i].position);
+			if(loadGeometry)
+			{
+				newSystem.stars = Geometry::loadObj(bgMeshFile_str, bgTextFile_str);
+				Vertex* vertices = newSystem.stars->getVertices();
+				for(unsigned int i = 0; i < newSystem.stars->getNumVertices(); i++)
+					vertices[i].normal = glm::vec3(0.0f, -1.0f, 0.0f);//glm::normalize(vertices[i].position);
+			}
 			newSystem.meshes.push_back(newSystem.stars);
 			glm::mat4 starsMatrix = glm::scale(glm::mat4(), glm::vec3(bgRadius_float));
 			newSystem.starsMatrix = glm::rotate(starsMatrix, bgTilt_float, DEFAULT_TILT_AXIS);
 			newSystem.transforms.push_back(&newSystem.starsMatrix);
 		
-			/* Parse each body of the system. */
-			for(tinyxml2::XMLElement* body = bodies->FirstChildElement("body"); body != NULL; body = body->NextSiblingElement("body"))
+			/* The first mesh loaded from each OBJ file, which later bodies share. */
+			std::map<std::string, Mesh*> loadedMeshes;
+
+			/* Parse the parameters of a body element into a new body. */
+			auto parseBody = [&](tinyxml2::XMLElement* body) -> Planet*
 			{
 				/* Parse the body parameters for each body. */
 				const char* bodyName_str       = body->FirstChildElement("name")->GetText();
@@ -190,21 +669,49 @@ OrbitalSystem OrbitalSystem::loadFile(const char* xmlFile)
 				const char* bodyRotSpeed_str   = body->FirstChildElement("rotationalSpeed")->GetText();
 				GLfloat     bodyRotSpeed_float = (GLfloat) atof(bodyRotSpeed_str);
 
-				/* Set the body parameters for each body, and add the body to the system. */
+				/* Create the body from its parameters, loading its OBJ file only once. */
+				auto        loaded      = loadedMeshes.find(bodyMeshFile_str);
+				bool        loadMesh    = loadGeometry && loaded == loadedMeshes.end();
 				glm::vec3   bodyPos_vec{bodyPosX_float, bodyPosY_float, bodyPosZ_float};
 				glm::vec3   bodyVel_vec{bodyVelX_float, bodyVelY_float, bodyVelZ_float};
 				Planet*     newBody = new Planet(bodyName_str,
 				                                 bodyMass_float/ scale_float, 
 				                                 bodyRadius_float/ scale_float,
-				                                 bodyMeshFile_str, 
-				                                 bodyTextFile_str, 
+				                                 loadMesh ? bodyMeshFile_str : NULL, 
+				                                 loadMesh ? bodyTextFile_str : NULL, 
 				                                 bodyPos_vec/ scale_float, 
 				                                 bodyVel_vec/ sqrt(scale_float));
+				if(loadMesh && newBody->getGeometry() != nullptr)
+					loadedMeshes[bodyMeshFile_str] = newBody->getGeometry();
+				else if(loadGeometry && !loadMesh)
+					newBody->setGeometry(Geometry::shareObj(loaded->second, bodyTextFile_str));
 
 				newBody->setRotationalAxis(bodyTilt_float);
 				newBody->setAngularVelocity(bodyRotSpeed_float);
 
-				newSystem.addBody(newBody);
+				return newBody;
+			};
+
+			/* Parse each body of the system. */
+			for(tinyxml2::XMLElement* body = bodies->FirstChildElement("body"); body != NULL; body = body->NextSiblingElement("body"))
+				newSystem.addBody(parseBody(body));
+
+			/* Parse each subsystem, whose bodies are integrated in their own frame. */
+			for(tinyxml2::XMLElement* sub = bodies->FirstChildElement("subsystem"); sub != NULL; sub = sub->NextSiblingElement("subsystem"))
+			{
+				tinyxml2::XMLElement* subName_el  = sub->FirstChildElement("name");
+				tinyxml2::XMLElement* subStep_el  = sub->FirstChildElement("maxStep");
+				Subsystem             subsystem(subName_el ? subName_el->GetText() : "",
+				                                subStep_el ? (GLfloat) atof(subStep_el->GetText())
+				                                           : DEFAULT_SUBSYSTEM_STEP);
+
+				for(tinyxml2::XMLElement* body = sub->FirstChildElement("body"); body != NULL; body = body->NextSiblingElement("body"))
+				{
+					newSystem.addBody(parseBody(body));
+					subsystem.addMember(newSystem.bodies.size() - 1);
+				}
+				if(!subsystem.getMembers().empty())
+					newSystem.addSubsystem(subsystem);
 			}
 
 		}
@@ -216,7 +723,9 @@ OrbitalSystem OrbitalSystem::loadFile(const char* xmlFile)
 
 void OrbitalSystem::cleanUp() 
 {
-	stars->cleanUp();
+	if(stars != nullptr)
+		stars->cleanUp();
 	for(OrbitalBody* body : bodies)
-		body->getGeometry()->cleanUp();
+		if(body->getGeometry() != nullptr)
+			body->getGeometry()->cleanUp();
 }
@@ -7,17 +7,36 @@
 
 #include  <string>
 #include  <map>
+#include  <deque>
 #include  <vector>
 #include  <glm\glm.hpp>
 #include  <GL\glew.h>
 #include  "OrbitalBody.h"
 #include  "Geometry.h"
+#include  "StepObserver.h"
+#include  "NBodyIntegrator.h"
+#include  "AttitudeIntegrator.h"
+#include  "WorkerPool.h"
+#include  "Subsystem.h"
+#include  "MortonOrder.h"
 
 #define   SIM_SECONDS_PER_REAL_SECOND                            1.0f
 #define   SECONDS_PER_HOUR                                    3600.0f
 #define   MAX_DELTA_T                                          100.0f                
 #define   DEFAULT_G                                      6.67384e-20f
 #define   DEFAULT_TILT_AXIS            glm::vec3{+1.0f, +0.0f, +0.0f}
+/* A free pair is regularized when its own time scale is below this many steps. */
+#define   KS_CAPTURE_STEPS                                        8.0f
+/* A regularized pair is released when its time scale exceeds this many steps. */
+#define   KS_RELEASE_STEPS                                       16.0f
+/* Largest relative tidal disturbance of a pair at capture, and at release. */
+#define   KS_CAPTURE_PERTURBATION                                0.05f
+#define   KS_RELEASE_PERTURBATION                                0.20f
+/* Index returned for a handle whose body is no longer in the system. */
+#define   NO_BODY                                           0xFFFFFFFF
+/* Low bits of a handle naming its slot; the high bits count the slot's reuses. */
+#define   HANDLE_SLOT_BITS                                          22
+#define   HANDLE_SLOT_MASK                  ((1u << HANDLE_SLOT_BITS) - 1)
 
 /******************************************************************************
  *																			  *
@@ -31,6 +50,15 @@
  *  radius                                                                    *
  *          METERS                                                            *
  *          Bounding distance from the center of the object to its surface.   *
+ *  handles                                                                   *
+ *          Handle of the body at each index: a slot and the generation of    *
+ *          the slot when the body was added.                                 *
+ *  handleIndex, slotGeneration, freeSlots                                    *
+ *          Index of the body in each slot (NO_BODY while free), the number   *
+ *          of times each slot has been given out, and the free slots in the  *
+ *          order they were freed.                                            *
+ *  reorderInterval, stepsSinceReorder                                        *
+ *          Number of steps between Morton reorders of the bodies (0 never).  *
  *                                                                            *
  ******************************************************************************
  * DESCRIPTION                                                                *
@@ -39,6 +67,18 @@
  *  and collisions. This class deines several orbital system constants used   *
  *  by the orbital bodies to simulate physics.                                *
  *                                                                            *
+ *  Bodies may be rearranged along a Morton curve of their positions every    *
+ *  few steps, so that bodies near each other in space are near each other    *
+ *  in memory. Anything kept across steps should refer to a body by its       *
+ *  handle (or pointer) rather than its index; observers are told of every    *
+ *  rearrangement.                                                            *
+ *                                                                            *
+ *  Removing a body moves the last body into its place, so bodies, meshes,    *
+ *  matrices and rotations stay packed at O(1) cost however much the system   *
+ *  churns. A freed slot is reused only after every slot freed before it,     *
+ *  and its generation changes, so a handle to a removed body stays invalid   *
+ *  (until a slot has been reused 2^10 times).                                *
+ *                                                                            *
  ******************************************************************************/
 class OrbitalSystem
 {
@@ -48,7 +88,9 @@ public:
 	/* Custom constructor. */
 	OrbitalSystem(const char* objFile,
 		          const char* textureFile,
-				  const GLfloat starsScale) : G(DEFAULT_G), clock(0), scale(1)
+				  const GLfloat starsScale) : G(DEFAULT_G), clock(0), stepStart(0),
+				                              scale(1), regularizing(false),
+				                              reorderInterval(0), stepsSinceReorder(0)
 	{
 		/* Initialize the stars. */
 		stars = Geometry::loadObj(objFile, textureFile);
@@ -74,19 +116,42 @@ public:
 
 	OrbitalSystem(const OrbitalSystem& rhs);
 
-	/* Load an orbital system from a file. */
-	static OrbitalSystem      loadFile         (const char*        xmlFile    );
+	/* Load an orbital system from a file (optionally without any meshes). */
+	static OrbitalSystem      loadFile         (const char*        xmlFile,
+	                                            const bool         loadGeometry
+	                                                                = true    );
 
-	/* Add a body to the system. */
-	void                      addBody          (      OrbitalBody* body       );
+	/* Copy the translational state of every body. */
+	void                      gatherState      (      NBodyState&  out        ) const;
+
+	/* Add a body to the system, returning its handle. */
+	GLuint                    addBody          (      OrbitalBody* body       );
+	/* Add several bodies at once. */
+	void                      addBodies        (const std::vector<OrbitalBody*>& batch);
 	
-	/* Remove a body from the system given its name. */
+	/* Remove the body at index i (the last body takes its index). */
 	void                      removeBody       (const GLuint       i          );
+	/* Remove the bodies at several indices at once. */
+	void                      removeBodies     (      std::vector<GLuint> indices);
+
+	/* Add a nested subsystem of bodies already in the system. */
+	void                      addSubsystem     (const Subsystem&   subsystem  );
+
+	/* Register an observer to be notified after every step. */
+	void                      addObserver      (      StepObserver* o         );
+	/* Unregister a previously added observer. */
+	void                      removeObserver   (      StepObserver* o         );
 	
 	/* Adjust the gravity vector for each body in the system. */
 	void                      compute          (                              );
 	/* Update the system by incrementing the time until seconds have passed. */
 	void                      interpolate      (const GLfloat      seconds    );
+	/* Take one step of dt simulation seconds, optionally without observers. */
+	void                      advance          (      GLfloat      dt,
+	                                                  bool         notify     );
+	/* Put every body back into a previously gathered state. */
+	void                      restoreState     (const NBodyState&    saved,
+	                                            const AttitudeState& savedAttitude);
 	
 	/* Calculate the gravitational forces felt by each body. */
 	glm::vec3                 gravityVector    (      OrbitalBody* subject,      
@@ -97,36 +162,121 @@ public:
 	                                            const glm::vec3    position, 
 	                                            const GLfloat      dt         );
 	
-	/* Approximation of the change in variables using Runge-Katta method. */
-	void                      rungeKattaApprx  (      OrbitalBody* subject, 
-	                                            const GLfloat      t          );
+	/* Approximation of the change in variables using Runge-Katta method, *
+	 * applied to every body simultaneously.                              */
+	void                      rungeKattaApprx  (const GLfloat      dt         );
+
+	/* Step in which each subsystem is advanced with its own step size. */
+	void                      hierarchicalStep (const GLfloat      dt         );
+
+	/* Move close pairs into, and separated pairs out of, regularization. */
+	void                      regularizeEncounters(const GLfloat   dt         );
+
+	/* Rearrange the bodies along a Morton curve of their positions. */
+	void                      reorderBodies    (                              );
+
+	/* Rebuild the transformation matrices of every body for drawing. */
+	void                      snapshotTransforms(                             );
+
+	/* State of a body at any time t within the last step (dense output). */
+	BodyState                 stateAt          (const GLuint       i,
+	                                            const GLdouble     t          );
 
 	/* Remove all of the allocated space. */
 	void                      cleanUp();
 
 	/* Getters. */
 	GLfloat                   getG()            const  {  return G;            }
-	GLfloat                   t()               const  {  return clock;        }
+	GLdouble                  t()               const  {  return clock;        }
+	GLdouble                  getStepStart()    const  {  return stepStart;    }
+	GLuint                    getNumBodies()    const  {  return bodies.size();}
 	OrbitalBody*              getBody(GLuint i)        {  return bodies.at(i); }
+	GLuint                    getHandle(GLuint i) const  {  return handles.at(i); }
+	GLuint                    getNumSlots()     const  {  return handleIndex.size(); }
+	GLuint                    getSlotIndex(GLuint slot) const
+	                                  {  return handleIndex.at(slot);          }
+	GLuint                    indexOf(GLuint handle) const
+	{
+		GLuint slot = handle & HANDLE_SLOT_MASK;
+		if(slot >= handleIndex.size() || 
+		   slotGeneration[slot] != (handle >> HANDLE_SLOT_BITS))
+			return NO_BODY;
+		return handleIndex[slot];
+	}
+	GLuint                    getNumSubsystems() const {  return subsystems.size(); }
+	Subsystem*                getSubsystem(GLuint i)   {  return &subsystems.at(i); }
 	std::vector<Mesh*>        getMeshes()       const  {  return meshes;       }
 	std::vector<glm::mat4*>   getTransforms()   const  {  return transforms;   }
 	glm::mat4                 getStarsMatrix()  const  {  return starsMatrix;  }
 	Mesh*                     getStars()        const  {  return stars;        }
+	WorkerPool*               getWorkerPool()   const  
+	                                  {  return integrator.getWorkerPool();    }
+
+	NBodyIntegrator*          getIntegrator()          {  return &integrator; }
+	AttitudeState*            getAttitude()            {  return &attitude;   }
+	SummationMode             getSummationMode() const 
+	                                  {  return integrator.getSummationMode(); }
+	GravitySolver*            getGravitySolver() const 
+	                                  {  return integrator.getSolver();        }
+	bool                      isRegularizing()  const  {  return regularizing; }
+	GLuint                    getReorderInterval() const {  return reorderInterval; }
+
+	/* Setters. */
+	void                      setWorkerPool(WorkerPool* p) 
+	{  
+		integrator.setWorkerPool(p);
+		attitudeIntegrator.setWorkerPool(p);
+	}
+	void                      setSummationMode(SummationMode m)
+	                                  {  integrator.setSummationMode(m);       }
+	void                      setGravitySolver(GravitySolver* s)
+	                                  {  integrator.setSolver(s);              }
+	void                      setRegularizing(bool r)  {  regularizing = r;    }
+	void                      setForceSplit(GLfloat radius, GLuint ratio)
+	                                  {  integrator.setForceSplit(radius, ratio); }
+	void                      setReorderInterval(GLuint steps)
+	                                  {  reorderInterval = steps;  stepsSinceReorder = 0;  }
 
 protected:
 	
+	/* Pairwise (fixed order) gravity on subject from bodies [lo, hi). */
+	glm::vec3                 pairwiseGravity  (      OrbitalBody* subject,
+	                                            const glm::vec3    position,
+	                                            const GLuint       lo,
+	                                            const GLuint       hi         );
+
 	/* Private default constructor (used for loading xml file).*/
 	OrbitalSystem() :
-	G(0.0f), clock(0), stars(nullptr) {}
+	G(0.0f), clock(0), stepStart(0), stars(nullptr), regularizing(false),
+	reorderInterval(0), stepsSinceReorder(0) {}
 
 	/* Collection of orbital bodies in this system. */
 	GLfloat                   G;
-	GLfloat                   clock;
+	GLdouble                  clock;
+	GLdouble                  stepStart;
 	GLfloat                   scale;
 	std::vector<OrbitalBody*> bodies;
 	Mesh*                     stars;
 	glm::mat4                 starsMatrix;
 	std::vector<Mesh*>        meshes;
 	std::vector<glm::mat4*>   transforms;
+	std::vector<StepObserver*> observers;
+	/* Nested groups of bodies with their own step size. */
+	std::vector<Subsystem>    subsystems;
+	/* Whether close pairs are regularized automatically. */
+	bool                      regularizing;
+	/* Stable handles of the bodies, and how often they are reordered. */
+	std::vector<GLuint>       handles;
+	std::vector<GLuint>       handleIndex;
+	std::vector<GLuint>       slotGeneration;
+	std::deque<GLuint>        freeSlots;
+	GLuint                    reorderInterval;
+	GLuint                    stepsSinceReorder;
+	/* Structure-of-arrays state and the integrator which advances it. */
+	NBodyState                state;
+	NBodyIntegrator           integrator;
+	/* Rotational state of every body and the integrator which turns it. */
+	AttitudeState             attitude;
+	AttitudeIntegrator        attitudeIntegrator;
 };
 
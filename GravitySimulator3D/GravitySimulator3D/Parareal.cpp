@@ -0,0 +1,174 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <algorithm>
+#include "Parareal.h"
+
+/******************************************************************************
+*                                                                             *
+*                        Parareal::Parareal (Constructor)                     *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param pool                                                                *
+*           Worker pool on which the fine slices are propagated.              *
+*  @param config                                                              *
+*           Parameters of the run.                                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the Parareal class.                                        *
+*                                                                             *
+*******************************************************************************/
+Parareal::Parareal(WorkerPool* pool, const PararealConfig& config) :
+	pool(pool), config(config), iterations(0), lastChange(0)
+{
+	/* Empty. */
+}
+
+/******************************************************************************
+*                                                                             *
+*                              Parareal::propagate                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param integrator                                                          *
+*           Integrator (and scratch space) to use.                            *
+*  @param state                                                               *
+*           State to advance in place.                                        *
+*  @param duration                                                            *
+*           SECONDS                                                           *
+*           Time to advance the state by.                                     *
+*  @param step                                                                *
+*           SECONDS                                                           *
+*           Largest step to take.                                             *
+*  @param fine                                                                *
+*           True for the Runge-Kutta propagator, false for leapfrog.          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Covers the duration with equal steps no longer than step.                  *
+*                                                                             *
+*******************************************************************************/
+void Parareal::propagate(NBodyIntegrator& integrator, NBodyState& state,
+                         GLfloat duration, GLfloat step, bool fine)
+{
+	GLuint  steps = std::max(1u, (GLuint) ceil(duration / step));
+	GLfloat h     = duration / steps;
+
+	for (GLuint i = 0; i < steps; i++)
+	{
+		if (fine)
+			integrator.rungeKutta(state, h);
+		else
+			integrator.leapfrog(state, h);
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                                 Parareal::run                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param initial                                                             *
+*           State at the start of the run.                                    *
+*  @param duration                                                            *
+*           SECONDS                                                           *
+*           Length of the run.                                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The state at the end of the run.                                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Runs the Parareal iteration. After iteration k the first k + 1 slices      *
+*  equal the serial fine solution, so the loop always terminates after at     *
+*  most one iteration per slice even if the tolerance is never met.           *
+*                                                                             *
+*******************************************************************************/
+NBodyState Parareal::run(const NBodyState& initial, GLfloat duration)
+{
+	GLuint  n     = config.slices ? config.slices : pool->getNumThreads();
+	GLfloat width = duration / n;
+
+	/* Serial coarse prediction of every slice boundary. */
+	NBodyIntegrator         serial;
+	std::vector<NBodyState> coarse(n + 1);
+	std::vector<NBodyState> fine(n + 1);
+	slices.assign(n + 1, initial);
+	for (GLuint k = 0; k < n; k++)
+	{
+		slices[k + 1] = slices[k];
+		propagate(serial, slices[k + 1], width, config.coarseStep, false);
+		coarse[k + 1] = slices[k + 1];
+	}
+
+	iterations = 0;
+	lastChange = 0;
+	for (GLuint it = 0; it < config.maxIterations && it < n; it++)
+	{
+		/* Fine propagation of every unconverged slice, in parallel. */
+		pool->parallelFor(n - it, [&](GLuint begin, GLuint end)
+		{
+			NBodyIntegrator integrator;
+			for (GLuint s = begin; s < end; s++)
+			{
+				fine[it + s + 1] = slices[it + s];
+				propagate(integrator, fine[it + s + 1], width,
+				          config.fineStep, true);
+			}
+		});
+
+		/* The first unconverged slice now starts from an exact state. */
+		lastChange = 0;
+		slices[it + 1] = fine[it + 1];
+
+		/* Serial coarse sweep with the Parareal correction. */
+		for (GLuint k = it + 1; k < n; k++)
+		{
+			NBodyState g = slices[k];
+			propagate(serial, g, width, config.coarseStep, false);
+
+			NBodyState& u     = slices[k + 1];
+			GLfloat     delta = 0;
+			GLfloat     size  = 0;
+			for (GLuint i = 0; i < u.positions.size(); i++)
+			{
+				glm::vec3 r = g.positions[i]  + fine[k + 1].positions[i]  -
+				              coarse[k + 1].positions[i];
+				glm::vec3 v = g.velocities[i] + fine[k + 1].velocities[i] -
+				              coarse[k + 1].velocities[i];
+
+				delta = std::max(delta, glm::length(r - u.positions[i]));
+				size  = std::max(size,  glm::length(r));
+
+				u.positions[i]  = r;
+				u.velocities[i] = v;
+			}
+			u.t = g.t;
+			coarse[k + 1] = g;
+
+			if (size > 0)
+				lastChange = std::max(lastChange, delta / size);
+		}
+
+		iterations = it + 1;
+		if (lastChange < config.tolerance)
+			break;
+	}
+
+	return slices[n];
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  "NBodyIntegrator.h"
+#include  "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define   PARAREAL_MAX_ITERATIONS            10
+#define   PARAREAL_TOLERANCE              1e-5f
+/* Ratio of the coarse step to the fine step used by default. */
+#define   PARAREAL_COARSE_FACTOR             20
+
+/******************************************************************************
+*                                                                             *
+*                           PararealConfig (struct)                           *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  slices                                                                     *
+*          Number of time slices (0 uses one per worker thread).              *
+*  coarseStep                                                                 *
+*          SECONDS                                                            *
+*          Step of the cheap serial (leapfrog) propagator.                    *
+*  fineStep                                                                   *
+*          SECONDS                                                            *
+*          Step of the accurate parallel (Runge-Kutta) propagator.            *
+*  maxIterations                                                              *
+*          Upper bound on the number of Parareal corrections.                 *
+*  tolerance                                                                  *
+*          Largest relative change of any slice state for convergence.        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Parameters of a Parareal run.                                              *
+*                                                                             *
+*******************************************************************************/
+struct PararealConfig
+{
+	GLuint         slices;
+	GLfloat        coarseStep;
+	GLfloat        fineStep;
+	GLuint         maxIterations;
+	GLfloat        tolerance;
+};
+
+/******************************************************************************
+ *																			  *
+ *                              Parareal Class                                *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  pool                                                                      *
+ *          Worker pool on which the fine slices are propagated.              *
+ *  config                                                                    *
+ *          Parameters of the run.                                            *
+ *  slices                                                                    *
+ *          Corrected state at each slice boundary (slices + 1 entries).      *
+ *  iterations                                                                *
+ *          Number of corrections performed by the last run.                  *
+ *  lastChange                                                                *
+ *          Largest relative change in the final correction.                  *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Parallel-in-time driver for long runs of small systems. The horizon is    *
+ *  cut into slices; a coarse leapfrog pass predicts the state at every       *
+ *  slice boundary serially, then every slice is propagated with the fine     *
+ *  integrator in parallel from its predicted start. The two are combined     *
+ *  with the Parareal correction U = G(new) + F(old) - G(old) and iterated    *
+ *  until the slice states stop changing. Slices before the current           *
+ *  iteration are exact and are not recomputed.                               *
+ *                                                                            *
+ ******************************************************************************/
+class Parareal
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   Parareal(WorkerPool*           pool,
+	                            const PararealConfig& config);
+
+	/* Integrate the initial state over duration seconds. */
+	NBodyState         run(const NBodyState& initial, GLfloat duration);
+
+	/* Getters. */
+	const std::vector<NBodyState>& getSliceStates() const  {  return slices; }
+	GLuint             getIterations()     const  {  return iterations;      }
+	GLfloat            getLastChange()     const  {  return lastChange;      }
+
+	/* Destructor. */
+	                  ~Parareal()                                          {}
+
+/* Private Members. */
+private:
+
+	/* Worker pool for the fine slices. */
+	WorkerPool*             pool;
+	/* Run parameters. */
+	PararealConfig          config;
+	/* Corrected slice boundary states. */
+	std::vector<NBodyState> slices;
+	/* Convergence information. */
+	GLuint                  iterations;
+	GLfloat                 lastChange;
+
+	/* Propagate a state over duration with fixed steps. */
+	static void        propagate(NBodyIntegrator& integrator,
+	                             NBodyState&      state,
+	                             GLfloat          duration,
+	                             GLfloat          step,
+	                             bool             fine);
+};
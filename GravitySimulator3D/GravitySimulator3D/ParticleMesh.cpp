@@ -0,0 +1,689 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <algorithm>
+#include "ParticleMesh.h"
+
+/******************************************************************************
+*                                                                             *
+*                               Local Helpers                                 *
+*                                                                             *
+******************************************************************************/
+/* Smallest power of two of at least PM_MIN_GRID cells which holds n cells. */
+static GLuint meshSize(GLuint n)
+{
+	GLuint size = PM_MIN_GRID;
+	while (size < n)
+		size *= 2;
+	return size;
+}
+
+/******************************************************************************
+*                                                                             *
+*                    ParticleMesh::ParticleMesh (Constructor)                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param gridSize                                                            *
+*           Number of cells along each axis, rounded up to a power of two     *
+*           of at least PM_MIN_GRID.                                          *
+*  @param pool                                                                *
+*           Optional worker pool for every stage.                             *
+*  @param shortRange                                                          *
+*           True to add the direct short-range correction (P3M).              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the ParticleMesh class. The Green's function is built on   *
+*  the first evaluation.                                                      *
+*                                                                             *
+*******************************************************************************/
+ParticleMesh::ParticleMesh(GLuint gridSize, WorkerPool* pool, bool shortRange) :
+	gridSize(meshSize(gridSize)), paddedSize(2 * this->gridSize), pool(pool),
+	shortRange(shortRange), origin(0), cellSize(0), chainSize(0), chainCells(0)
+{
+	/* Roots of unity exp(-2 pi i k / M). */
+	const GLdouble pi = 3.14159265358979323846;
+	twiddles.resize(paddedSize / 2);
+	for (GLuint k = 0; k < paddedSize / 2; k++)
+		twiddles[k] = Complex((GLfloat) cos(2 * pi * k / paddedSize),
+		                      (GLfloat) -sin(2 * pi * k / paddedSize));
+}
+
+/******************************************************************************
+*                                                                             *
+*                          ParticleMesh::parallelFor                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param count                                                               *
+*           Number of items in the range.                                     *
+*  @param task                                                                *
+*           Function called with each chunk [begin, end) of the range.        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Splits the range across the pool, or runs it inline without one.           *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::parallelFor(GLuint count, const WorkerPool::RangeTask& task)
+{
+	if (pool != nullptr)
+		pool->parallelFor(count, task);
+	else
+		task(0, count);
+}
+
+/******************************************************************************
+*                                                                             *
+*                         ParticleMesh::accelerations                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions at which to evaluate gravity (one per body).            *
+*  @param out                                                                 *
+*           Output acceleration of every body.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Runs the deposit, forward transform, convolution, inverse transform,       *
+*  differencing and interpolation stages, then the short-range correction     *
+*  if it is enabled.                                                          *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::accelerations(const NBodyState& state,
+                                 const std::vector<glm::vec3>& positions,
+                                 std::vector<glm::vec3>& out)
+{
+	out.resize(positions.size());
+	if (positions.empty())
+		return;
+
+	if (kernel.empty())
+		buildKernel();
+
+	fitMesh(positions);
+	deposit(state);
+	transform(false, true);
+
+	/* Convolution with the Green's function is a product of transforms. */
+	GLuint planeCells = paddedSize * paddedSize;
+	parallelFor(paddedSize, [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin * planeCells; i < end * planeCells; i++)
+			mesh[i] *= kernel[i];
+	});
+
+	transform(true, true);
+	differentiate(state);
+	interpolate(out);
+
+	if (shortRange)
+		correct(state, positions, out);
+}
+
+/******************************************************************************
+*                                                                             *
+*                          ParticleMesh::buildKernel                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Samples -1 / r on the padded mesh, in cell units and with the distance     *
+*  wrapped so that the circular convolution of the zero padded mass is the    *
+*  isolated one, and transforms it. With the short-range correction on, the   *
+*  transform is multiplied by exp(-k^2 rs^2), which leaves only the force     *
+*  of Gaussian smoothed masses on the mesh. The 1 / M^3 of the inverse        *
+*  transform is folded in here too.                                           *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::buildKernel()
+{
+	const GLdouble pi = 3.14159265358979323846;
+	GLuint         M  = paddedSize;
+
+	mesh.assign(M * M * M, Complex(0));
+	for (GLuint z = 0; z < M; z++)
+	{
+		for (GLuint y = 0; y < M; y++)
+		{
+			for (GLuint x = 0; x < M; x++)
+			{
+				GLfloat dx = (GLfloat) std::min(x, M - x);
+				GLfloat dy = (GLfloat) std::min(y, M - y);
+				GLfloat dz = (GLfloat) std::min(z, M - z);
+				GLfloat r  = sqrt(dx * dx + dy * dy + dz * dz);
+
+				mesh[x + M * (y + M * z)] = (r == 0) ? -PM_SELF_POTENTIAL
+				                                     : -1.0f / r;
+			}
+		}
+	}
+
+	transform(false, false);
+
+	/* The kernel is even, so its transform is real. */
+	GLdouble rs = PM_SPLIT_CELLS;
+	kernel.resize(M * M * M);
+	for (GLuint z = 0; z < M; z++)
+	{
+		for (GLuint y = 0; y < M; y++)
+		{
+			for (GLuint x = 0; x < M; x++)
+			{
+				GLuint   i      = x + M * (y + M * z);
+				GLdouble filter = 1;
+				if (shortRange)
+				{
+					GLdouble kx = 2 * pi * ((x <= M / 2) ? (GLint) x : (GLint) x - (GLint) M) / M;
+					GLdouble ky = 2 * pi * ((y <= M / 2) ? (GLint) y : (GLint) y - (GLint) M) / M;
+					GLdouble kz = 2 * pi * ((z <= M / 2) ? (GLint) z : (GLint) z - (GLint) M) / M;
+					filter = exp(-(kx * kx + ky * ky + kz * kz) * rs * rs);
+				}
+				kernel[i] = (GLfloat) (mesh[i].real() * filter / ((GLdouble) M * M * M));
+			}
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ParticleMesh::fitMesh                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param positions                                                           *
+*           Positions of the bodies.                                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Centers a cube on the bodies' bounding box, leaving one cell free on       *
+*  every side so that each body's cloud lies wholly inside the mesh, and      *
+*  converts every position to cell units.                                     *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::fitMesh(const std::vector<glm::vec3>& positions)
+{
+	GLuint n      = positions.size();
+	GLuint chunks = (pool != nullptr) ? pool->getNumThreads() : 1;
+
+	/* Bounding box, reduced per chunk. */
+	std::vector<glm::vec3> lo(chunks, positions[0]);
+	std::vector<glm::vec3> hi(chunks, positions[0]);
+	parallelFor(chunks, [&](GLuint begin, GLuint end)
+	{
+		for (GLuint c = begin; c < end; c++)
+		{
+			GLuint first = (GLuint) (((unsigned long long) n * c) / chunks);
+			GLuint last  = (GLuint) (((unsigned long long) n * (c + 1)) / chunks);
+			for (GLuint i = first; i < last; i++)
+			{
+				lo[c] = glm::min(lo[c], positions[i]);
+				hi[c] = glm::max(hi[c], positions[i]);
+			}
+		}
+	});
+	for (GLuint c = 1; c < chunks; c++)
+	{
+		lo[0] = glm::min(lo[0], lo[c]);
+		hi[0] = glm::max(hi[0], hi[c]);
+	}
+
+	glm::vec3 size   = hi[0] - lo[0];
+	GLfloat   extent = std::max(size.x, std::max(size.y, size.z));
+	if (extent <= 0)
+		extent = 1;
+
+	cellSize = extent / (gridSize - 3);
+	origin   = 0.5f * (lo[0] + hi[0]) - (0.5f * (gridSize - 1) * cellSize);
+
+	cells.resize(n);
+	parallelFor(n, [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin; i < end; i++)
+			cells[i] = (positions[i] - origin) / cellSize;
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ParticleMesh::deposit                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses.                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Cloud-in-cell assignment: each mass is shared between the eight nodes      *
+*  around it in proportion to overlap. A body in x plane p writes only to     *
+*  planes p and p + 1, so the bodies are sorted by plane and the planes are   *
+*  cut into slabs: every other slab is deposited in parallel, then the rest,  *
+*  and no two threads can touch the same node. The slab width is fixed, so    *
+*  every node receives its masses in the same order however many threads      *
+*  share the slabs, and the result does not depend on the pool.               *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::deposit(const NBodyState& state)
+{
+	GLuint M = paddedSize;
+	GLuint N = gridSize;
+	GLuint n = cells.size();
+
+	/* Clear the padded mesh. */
+	mesh.resize(M * M * M);
+	parallelFor(M, [&](GLuint begin, GLuint end)
+	{
+		std::fill(mesh.begin() + begin * M * M, mesh.begin() + end * M * M,
+		          Complex(0));
+	});
+
+	/* Counting sort of the bodies by x plane. */
+	planeStart.assign(N + 1, 0);
+	for (GLuint i = 0; i < n; i++)
+		planeStart[(GLuint) cells[i].x + 1]++;
+	for (GLuint p = 0; p < N; p++)
+		planeStart[p + 1] += planeStart[p];
+	order.resize(n);
+	std::vector<GLuint> cursor(planeStart.begin(), planeStart.end() - 1);
+	for (GLuint i = 0; i < n; i++)
+		order[cursor[(GLuint) cells[i].x]++] = i;
+
+	/* Slabs of a fixed number of planes, whatever the number of threads. */
+	GLuint width = PM_SLAB_PLANES;
+	GLuint slabs = (N - 1 + width - 1) / width;
+
+	for (GLuint parity = 0; parity < 2; parity++)
+	{
+		parallelFor((slabs + 1 - parity) / 2, [&](GLuint begin, GLuint end)
+		{
+			for (GLuint s = begin; s < end; s++)
+			{
+				GLuint slab  = 2 * s + parity;
+				GLuint first = slab * width;
+				GLuint last  = std::min(first + width, N - 1);
+
+				for (GLuint k = planeStart[first]; k < planeStart[last]; k++)
+				{
+					GLuint  i = order[k];
+					GLfloat m = state.masses[i];
+					if (m == 0)
+						continue;
+
+					glm::vec3 u  = cells[i];
+					GLuint    ix = (GLuint) u.x;
+					GLuint    iy = (GLuint) u.y;
+					GLuint    iz = (GLuint) u.z;
+					glm::vec3 f  = u - glm::vec3(ix, iy, iz);
+
+					for (GLuint c = 0; c < 8; c++)
+					{
+						GLuint  dx = c & 1, dy = (c >> 1) & 1, dz = (c >> 2) & 1;
+						GLfloat w  = (dx ? f.x : 1 - f.x) *
+						             (dy ? f.y : 1 - f.y) *
+						             (dz ? f.z : 1 - f.z);
+						mesh[(ix + dx) + M * ((iy + dy) + M * (iz + dz))] += m * w;
+					}
+				}
+			}
+		});
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ParticleMesh::transform                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param inverse                                                             *
+*           False for the forward transform, true for the inverse.            *
+*  @param sparse                                                              *
+*           True when the mesh holds a zero padded mass (forward), or when    *
+*           only the unpadded potential is wanted (inverse).                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Three dimensional transform of the padded mesh, one axis at a time, with   *
+*  the lines of each axis split across the pool. When sparse, lines known     *
+*  to be zero are skipped on the way forward (only the first gridSize nodes   *
+*  of an axis are non-zero until it is transformed), and on the way back      *
+*  only the lines needed to difference the potential over the unpadded mesh   *
+*  (one node beyond it either side) are transformed. This removes about       *
+*  half of the work of a full transform.                                      *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::transform(bool inverse, bool sparse)
+{
+	GLuint M          = paddedSize;
+	GLuint N          = gridSize;
+	GLuint stride[3]  = { 1, M, M * M };
+	bool   done[3]    = { false, false, false };
+
+	/* Coordinates along an axis which must be visited. */
+	std::vector<GLuint> all, few;
+	for (GLuint c = 0; c < M; c++)
+	{
+		all.push_back(c);
+		if (!sparse || (inverse ? (c <= N || c == M - 1) : (c < N)))
+			few.push_back(c);
+	}
+
+	for (GLuint pass = 0; pass < 3; pass++)
+	{
+		GLuint axis = inverse ? 2 - pass : pass;
+		GLuint a    = (axis + 1) % 3;
+		GLuint b    = (axis + 2) % 3;
+
+		/* Forward: untransformed axes are sparse. Inverse: transformed ones. */
+		const std::vector<GLuint>& as = (done[a] != inverse) ? all : few;
+		const std::vector<GLuint>& bs = (done[b] != inverse) ? all : few;
+		GLuint lines = as.size() * bs.size();
+
+		parallelFor(lines, [&](GLuint begin, GLuint end)
+		{
+			std::vector<Complex> line(M);
+			for (GLuint l = begin; l < end; l++)
+			{
+				GLuint base = as[l % as.size()] * stride[a] +
+				              bs[l / as.size()] * stride[b];
+
+				if (stride[axis] == 1)
+				{
+					fft(&mesh[base], inverse);
+					continue;
+				}
+
+				for (GLuint k = 0; k < M; k++)
+					line[k] = mesh[base + k * stride[axis]];
+				fft(&line[0], inverse);
+				for (GLuint k = 0; k < M; k++)
+					mesh[base + k * stride[axis]] = line[k];
+			}
+		});
+
+		done[axis] = true;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                              ParticleMesh::fft                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param data                                                                *
+*           The paddedSize values to transform in place.                      *
+*  @param inverse                                                             *
+*           True for the (unnormalized) inverse transform.                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Iterative Cooley-Tukey transform: bit reversal permutation followed by     *
+*  log2(n) butterfly passes using the precomputed roots of unity.             *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::fft(Complex* data, bool inverse) const
+{
+	GLuint n = paddedSize;
+
+	/* Bit reversal permutation. */
+	for (GLuint i = 1, j = 0; i < n; i++)
+	{
+		GLuint bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j)
+			std::swap(data[i], data[j]);
+	}
+
+	/* Butterflies. */
+	for (GLuint length = 2; length <= n; length <<= 1)
+	{
+		GLuint half = length >> 1;
+		GLuint step = n / length;
+		for (GLuint start = 0; start < n; start += length)
+		{
+			for (GLuint k = 0; k < half; k++)
+			{
+				Complex w = twiddles[k * step];
+				if (inverse)
+					w = std::conj(w);
+
+				Complex odd = w * data[start + k + half];
+				data[start + k + half] = data[start + k] - odd;
+				data[start + k]       += odd;
+			}
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                         ParticleMesh::differentiate                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the gravitational constant.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Central differences of the potential at every node of the unpadded mesh.   *
+*  The potential is in cell units, so the physical acceleration is            *
+*  -G / (2 h^2) times the difference of the neighbouring nodes. Node -1 of    *
+*  an axis is node M - 1 of the circular padded mesh.                         *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::differentiate(const NBodyState& state)
+{
+	GLuint  M     = paddedSize;
+	GLuint  N     = gridSize;
+	GLfloat scale = -state.G / (2 * cellSize * cellSize);
+
+	field.resize(N * N * N);
+	parallelFor(N, [&](GLuint begin, GLuint end)
+	{
+		for (GLuint z = begin; z < end; z++)
+		{
+			GLuint zm = (z + M - 1) % M;
+			for (GLuint y = 0; y < N; y++)
+			{
+				GLuint ym = (y + M - 1) % M;
+				for (GLuint x = 0; x < N; x++)
+				{
+					GLuint xm = (x + M - 1) % M;
+					glm::vec3 g(mesh[(x + 1) + M * (y + M * z)].real() -
+					            mesh[xm      + M * (y + M * z)].real(),
+					            mesh[x + M * ((y + 1) + M * z)].real() -
+					            mesh[x + M * (ym      + M * z)].real(),
+					            mesh[x + M * (y + M * (z + 1))].real() -
+					            mesh[x + M * (y + M * zm)].real());
+					field[x + N * (y + N * z)] = scale * g;
+				}
+			}
+		}
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                          ParticleMesh::interpolate                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param out                                                                 *
+*           Output acceleration of every body.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gathers the field to each body with the cloud-in-cell weights used for     *
+*  the deposit, which keeps the mesh force free of self-force.                *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::interpolate(std::vector<glm::vec3>& out)
+{
+	GLuint N = gridSize;
+
+	parallelFor(cells.size(), [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin; i < end; i++)
+		{
+			glm::vec3 u  = cells[i];
+			GLuint    ix = (GLuint) u.x;
+			GLuint    iy = (GLuint) u.y;
+			GLuint    iz = (GLuint) u.z;
+			glm::vec3 f  = u - glm::vec3(ix, iy, iz);
+
+			glm::vec3 a(0);
+			for (GLuint c = 0; c < 8; c++)
+			{
+				GLuint  dx = c & 1, dy = (c >> 1) & 1, dz = (c >> 2) & 1;
+				GLfloat w  = (dx ? f.x : 1 - f.x) *
+				             (dy ? f.y : 1 - f.y) *
+				             (dz ? f.z : 1 - f.z);
+				a += w * field[(ix + dx) + N * ((iy + dy) + N * (iz + dz))];
+			}
+			out[i] = a;
+		}
+	});
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ParticleMesh::correct                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state supplying the masses and gravitational constant.        *
+*  @param positions                                                           *
+*           Positions of the bodies.                                          *
+*  @param out                                                                 *
+*           Accelerations to which the short-range part is added.             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Adds G m / r^2 * (erfc(r / 2rs) + r / (rs sqrt(pi)) exp(-r^2 / 4rs^2))     *
+*  for every pair closer than the cutoff, which is exactly the part of the    *
+*  Newtonian force removed from the mesh by the Gaussian filter. Bodies are   *
+*  linked into a chaining mesh of cells at least one cutoff wide, so only     *
+*  the 27 surrounding chaining cells need to be searched.                     *
+*                                                                             *
+*******************************************************************************/
+void ParticleMesh::correct(const NBodyState& state,
+                           const std::vector<glm::vec3>& positions,
+                           std::vector<glm::vec3>& out)
+{
+	const GLfloat rootPi = 1.7724538509f;
+	GLuint        n      = positions.size();
+	GLfloat       rs     = PM_SPLIT_CELLS * cellSize;
+	GLfloat       cutoff = PM_CUTOFF_SPLITS * rs;
+
+	/* Chaining mesh in cell units. */
+	chainCells = std::max(1u, (GLuint) (gridSize / (PM_SPLIT_CELLS * PM_CUTOFF_SPLITS)));
+	chainSize  = (GLfloat) gridSize / chainCells;
+	GLuint C   = chainCells;
+
+	chainHead.assign(C * C * C, -1);
+	chainNext.resize(n);
+	std::vector<GLuint> home(n);
+	for (GLuint i = 0; i < n; i++)
+	{
+		glm::vec3 c  = cells[i] / chainSize;
+		GLuint    cx = std::min((GLuint) c.x, C - 1);
+		GLuint    cy = std::min((GLuint) c.y, C - 1);
+		GLuint    cz = std::min((GLuint) c.z, C - 1);
+		home[i]      = cx + C * (cy + C * cz);
+		chainNext[i] = chainHead[home[i]];
+		chainHead[home[i]] = i;
+	}
+
+	parallelFor(n, [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin; i < end; i++)
+		{
+			GLint cx = home[i] % C;
+			GLint cy = (home[i] / C) % C;
+			GLint cz = home[i] / (C * C);
+
+			glm::vec3 a(0);
+			for (GLint z = std::max(cz - 1, 0); z <= std::min(cz + 1, (GLint) C - 1); z++)
+			for (GLint y = std::max(cy - 1, 0); y <= std::min(cy + 1, (GLint) C - 1); y++)
+			for (GLint x = std::max(cx - 1, 0); x <= std::min(cx + 1, (GLint) C - 1); x++)
+			{
+				for (GLint j = chainHead[x + C * (y + C * z)]; j >= 0; j = chainNext[j])
+				{
+					if ((GLuint) j == i || state.masses[j] == 0)
+						continue;
+
+					glm::vec3 d  = positions[j] - positions[i];
+					GLfloat   r2 = glm::dot(d, d);
+					if (r2 == 0 || r2 >= cutoff * cutoff)
+						continue;
+
+					GLfloat r = sqrt(r2);
+					GLfloat x = r / (2 * rs);
+					GLfloat g = erfc(x) + (r / (rs * rootPi)) * exp(-x * x);
+					a += (state.G * state.masses[j] * g / (r2 * r)) * d;
+				}
+			}
+			out[i] += a;
+		}
+	});
+}
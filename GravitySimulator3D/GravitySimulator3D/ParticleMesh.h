@@ -0,0 +1,157 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <complex>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "GravitySolver.h"
+#include  "NBodyIntegrator.h"
+#include  "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default number of mesh cells along each axis (a power of two). */
+#define   PM_DEFAULT_GRID                     64
+/* Smallest mesh: the bodies are fitted inside a border of cells. */
+#define   PM_MIN_GRID                          4
+/* Number of x planes in each slab of the deposit. */
+#define   PM_SLAB_PLANES                       2
+/* Width of the force split, in mesh cells, when the P3M correction is on. */
+#define   PM_SPLIT_CELLS                   1.25f
+/* Range of the short-range correction, in split widths. */
+#define   PM_CUTOFF_SPLITS                 4.5f
+/* Mean of 1/r over a unit cube, used for the kernel at zero separation. */
+#define   PM_SELF_POTENTIAL               2.38f
+
+/******************************************************************************
+ *																			  *
+ *                            ParticleMesh Class                              *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  gridSize                                                                  *
+ *          Number of cells along each axis of the mesh holding the bodies.   *
+ *  paddedSize                                                                *
+ *          Twice gridSize: the transforms run on a zero padded mesh so that  *
+ *          the convolution has no periodic images (isolated boundaries).     *
+ *  pool                                                                      *
+ *          Optional worker pool for every stage.                             *
+ *  shortRange                                                                *
+ *          True to split the force and add the short-range part directly     *
+ *          (P3M), false for the pure mesh force.                             *
+ *  twiddles                                                                  *
+ *          Roots of unity for transforms of length paddedSize.               *
+ *  kernel                                                                    *
+ *          Transform of the Green's function in cell units, including the    *
+ *          long-range filter and the normalization of the inverse transform. *
+ *          It is independent of the cell size, so it is built only once.     *
+ *  mesh                                                                      *
+ *          Mass, then its transform, then the potential on the padded mesh.  *
+ *  field                                                                     *
+ *          Acceleration at every node of the unpadded mesh.                  *
+ *  origin, cellSize                                                          *
+ *          Placement of the mesh for the current evaluation.                 *
+ *  cells                                                                     *
+ *          Position of every body in cell units.                             *
+ *  order, planeStart                                                         *
+ *          Bodies sorted by the x plane of their cell, for the deposit.      *
+ *  chainHead, chainNext, chainSize, chainCells                               *
+ *          Linked lists of bodies per coarse cell for the short-range pass.  *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Particle-mesh gravity for large, smooth distributions. Every evaluation   *
+ *  fits a cubic mesh around the bodies, deposits their masses onto it with   *
+ *  cloud-in-cell weights, convolves the mass with the Green's function by    *
+ *  FFT to get the potential, differences it into an acceleration field and   *
+ *  interpolates that back to the bodies with the same weights. The cost is   *
+ *  O(n + M^3 log M) instead of O(n^2). The deposit is split into slabs of x  *
+ *  planes processed alternately, so that no two threads ever write the same  *
+ *  node, and the transforms, differencing and interpolation are split by     *
+ *  lines, planes and bodies. None of the stages depends on the number of     *
+ *  threads, so the forces are the same bit for bit with any pool.            *
+ *                                                                            *
+ *  The mesh cannot resolve forces below a few cells. With the short-range    *
+ *  correction on, the mesh only carries the Gaussian-filtered long-range     *
+ *  force and pairs closer than the cutoff are summed directly with the       *
+ *  complementary erfc force, found through a coarse chaining mesh.           *
+ *                                                                            *
+ ******************************************************************************/
+class ParticleMesh : public GravitySolver
+{
+/* Public Members. */
+public:
+
+	/* Constructor (gridSize is rounded up to a power of two). */
+	                   ParticleMesh(GLuint      gridSize   = PM_DEFAULT_GRID,
+	                                WorkerPool* pool       = nullptr,
+	                                bool        shortRange = false);
+
+	/* Gravitational acceleration of every body at the given positions. */
+	void               accelerations(const NBodyState&             state,
+	                                 const std::vector<glm::vec3>& positions,
+	                                       std::vector<glm::vec3>& out);
+
+	/* Getters. */
+	GLuint             getGridSize()       const  {  return gridSize;        }
+	bool               hasShortRange()     const  {  return shortRange;      }
+	GLfloat            getCellSize()       const  {  return cellSize;        }
+
+	/* Destructor. */
+	                  ~ParticleMesh()                                      {}
+
+/* Private Members. */
+private:
+
+	typedef std::complex<GLfloat> Complex;
+
+	/* Mesh dimensions and options. */
+	GLuint                 gridSize;
+	GLuint                 paddedSize;
+	WorkerPool*            pool;
+	bool                   shortRange;
+	/* Roots of unity for the transforms. */
+	std::vector<Complex>   twiddles;
+	/* Transformed Green's function (real, by symmetry). */
+	std::vector<GLfloat>   kernel;
+	/* Padded mesh and the acceleration field. */
+	std::vector<Complex>   mesh;
+	std::vector<glm::vec3> field;
+	/* Placement of the mesh. */
+	glm::vec3              origin;
+	GLfloat                cellSize;
+	/* Per-evaluation scratch space. */
+	std::vector<glm::vec3> cells;
+	std::vector<GLuint>    order;
+	std::vector<GLuint>    planeStart;
+	std::vector<GLint>     chainHead;
+	std::vector<GLint>     chainNext;
+	GLfloat                chainSize;
+	GLuint                 chainCells;
+
+	/* Run a task over [0, count) on the pool if there is one. */
+	void               parallelFor  (GLuint count,
+	                                 const WorkerPool::RangeTask& task);
+
+	/* Stages of an evaluation. */
+	void               buildKernel  ();
+	void               fitMesh      (const std::vector<glm::vec3>& positions);
+	void               deposit      (const NBodyState& state);
+	void               transform    (bool inverse, bool sparse);
+	void               differentiate(const NBodyState& state);
+	void               interpolate  (std::vector<glm::vec3>& out);
+	void               correct      (const NBodyState& state,
+	                                 const std::vector<glm::vec3>& positions,
+	                                       std::vector<glm::vec3>& out);
+
+	/* In-place radix-2 transform of paddedSize complex values. */
+	void               fft          (Complex* data, bool inverse)         const;
+};
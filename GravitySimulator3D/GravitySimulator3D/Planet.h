@@ -15,7 +15,8 @@ public:
            const glm::vec3   initialPosition,
 		   const glm::vec3   initialVelocity) 
 	{
-		this->geometry       = Geometry::loadObj(objFile, textFile);
+		this->geometry       = (objFile != NULL) ? 
+		                       Geometry::loadObj(objFile, textFile) : NULL;
 		this->name           = std::string(name);
 		this->mass           = mass;
 		this->radius         = radius;
@@ -0,0 +1,308 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <algorithm>
+#include <cmath>
+#include "QualityGovernor.h"
+
+/******************************************************************************
+*                                                                             *
+*                QualityGovernor::QualityGovernor (Constructor)               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param scheduler                                                           *
+*           Scheduler advancing the system each frame.                        *
+*  @param frameMillis                                                         *
+*           Wall-clock milliseconds each frame should take.                   *
+*  @param field                                                               *
+*           Potential field sampled and drawn each frame, if any.             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the QualityGovernor class. The current settings of the     *
+*  scheduler and field are taken as full quality.                             *
+*                                                                             *
+*******************************************************************************/
+QualityGovernor::QualityGovernor(TimeWarpScheduler* scheduler,
+                                 GLfloat frameMillis, FieldSampler* field) :
+	scheduler(scheduler), field(field), frameMillis(frameMillis),
+	baseStep(scheduler->getMaxStep()),
+	baseAngle((field != nullptr) ? field->getOpeningAngle() : 0),
+	baseResolution((field != nullptr) ? field->getCount(0) : 0),
+	physicsMillis(0), renderMillis(0), heldFrames(0)
+{
+	/* Empty. */
+}
+
+/******************************************************************************
+*                                                                             *
+*                          QualityGovernor::frame                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param physicsMs                                                           *
+*           Wall-clock milliseconds spent advancing the system this frame.    *
+*  @param renderMs                                                            *
+*           Wall-clock milliseconds spent sampling and drawing this frame.    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Smooths the measured times and gives physics whatever part of the frame    *
+*  drawing leaves. Once the last adjustment has settled, makes at most one    *
+*  more: lower the drawing quality if drawing overruns its share, else the    *
+*  physics quality if the warp is not being kept. Otherwise it raises         *
+*  drawing quality, then physics quality, if either now has room for it.      *
+*                                                                             *
+*******************************************************************************/
+void QualityGovernor::frame(GLfloat physicsMs, GLfloat renderMs)
+{
+	physicsMillis += GOVERNOR_SMOOTHING * (physicsMs - physicsMillis);
+	renderMillis  += GOVERNOR_SMOOTHING * (renderMs  - renderMillis);
+
+	/* Drawing takes what it needs, physics the rest (within limits). */
+	GLfloat renderBudget  = (1.0f - GOVERNOR_MIN_PHYSICS_SHARE) * frameMillis;
+	GLfloat physicsBudget = std::max(frameMillis - renderMillis,
+	                                 GOVERNOR_MIN_PHYSICS_SHARE * frameMillis);
+	scheduler->setBudget(physicsBudget);
+
+	if (++heldFrames < GOVERNOR_HOLD_FRAMES)
+		return;
+
+	/* Drawing may only grow into time physics is not using. */
+	bool changed = false;
+	if (renderMillis > renderBudget)
+		changed = degradeRender();
+	if (!changed && !scheduler->isKeepingUp())
+		changed = degradePhysics();
+	if (!changed)
+		changed = restoreRender(std::min(renderBudget, frameMillis - physicsMillis));
+	if (!changed && scheduler->isKeepingUp())
+		changed = restorePhysics(physicsBudget);
+
+	if (changed)
+		heldFrames = 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       QualityGovernor::pollChanges                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Every adjustment made since the last poll, oldest first.                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Hands over the recorded adjustments so they can be logged.                 *
+*                                                                             *
+*******************************************************************************/
+std::vector<QualityChange> QualityGovernor::pollChanges()
+{
+	std::vector<QualityChange> polled;
+	polled.swap(changes);
+	return polled;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      QualityGovernor::degradePhysics                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether a setting was changed.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Lengthens the largest step, up to a limit, so the warp is covered with     *
+*  fewer substeps.                                                            *
+*                                                                             *
+*******************************************************************************/
+bool QualityGovernor::degradePhysics()
+{
+	GLfloat step = scheduler->getMaxStep();
+	GLfloat next = std::min(step * GOVERNOR_STEP_FACTOR,
+	                        baseStep * GOVERNOR_MAX_STEP_FACTOR);
+	if (next <= step)
+		return false;
+
+	scheduler->setMaxStep(next);
+	record(QualityKnob::MAX_STEP, step, next);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      QualityGovernor::restorePhysics                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param physicsBudget                                                       *
+*           Milliseconds physics may take this frame.                         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether a setting was changed.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Shortens the largest step back towards its original length, provided the   *
+*  extra substeps this needs are predicted to fit in the budget.              *
+*                                                                             *
+*******************************************************************************/
+bool QualityGovernor::restorePhysics(GLfloat physicsBudget)
+{
+	GLfloat step = scheduler->getMaxStep();
+	GLfloat next = std::max(step / GOVERNOR_STEP_FACTOR, baseStep);
+	if (next >= step ||
+	    physicsMillis * (step / next) > GOVERNOR_RESTORE_HEADROOM * physicsBudget)
+		return false;
+
+	scheduler->setMaxStep(next);
+	record(QualityKnob::MAX_STEP, step, next);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       QualityGovernor::degradeRender                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether a setting was changed.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Widens the field's opening angle, and once that is at its limit, reduces   *
+*  the field's nodes per side.                                                *
+*                                                                             *
+*******************************************************************************/
+bool QualityGovernor::degradeRender()
+{
+	if (field == nullptr)
+		return false;
+
+	GLfloat angle = field->getOpeningAngle();
+	if (angle < GOVERNOR_MAX_OPENING_ANGLE)
+	{
+		GLfloat next = std::min(angle + GOVERNOR_OPENING_ANGLE_STEP,
+		                        GOVERNOR_MAX_OPENING_ANGLE);
+		field->setOpeningAngle(next);
+		record(QualityKnob::OPENING_ANGLE, angle, next);
+		return true;
+	}
+
+	GLuint resolution = field->getCount(0);
+	GLuint next       = std::max(resolution / GOVERNOR_RESOLUTION_FACTOR,
+	                             (GLuint) GOVERNOR_MIN_RESOLUTION);
+	if (next >= resolution)
+		return false;
+
+	field->setResolution(next);
+	record(QualityKnob::RESOLUTION, (GLfloat) resolution, (GLfloat) next);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                       QualityGovernor::restoreRender                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param renderBudget                                                        *
+*           Milliseconds drawing may take this frame.                         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether a setting was changed.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gives back the field's nodes first and then its opening angle. More nodes  *
+*  cost in proportion to their number. A narrower angle is assumed to at      *
+*  most double the cost of drawing.                                           *
+*                                                                             *
+*******************************************************************************/
+bool QualityGovernor::restoreRender(GLfloat renderBudget)
+{
+	if (field == nullptr)
+		return false;
+
+	GLuint resolution = field->getCount(0);
+	if (resolution < baseResolution)
+	{
+		GLuint  next  = std::min(resolution * GOVERNOR_RESOLUTION_FACTOR,
+		                         baseResolution);
+		GLfloat ratio = (GLfloat) next / resolution;
+		GLfloat cost  = renderMillis * ratio * ratio;
+		if (field->getCount(2) > 1)
+			cost *= ratio;
+		if (cost > GOVERNOR_RESTORE_HEADROOM * renderBudget)
+			return false;
+
+		field->setResolution(next);
+		record(QualityKnob::RESOLUTION, (GLfloat) resolution, (GLfloat) next);
+		return true;
+	}
+
+	GLfloat angle = field->getOpeningAngle();
+	if (angle > baseAngle)
+	{
+		if (2.0f * renderMillis > GOVERNOR_RESTORE_HEADROOM * renderBudget)
+			return false;
+
+		GLfloat next = std::max(angle - GOVERNOR_OPENING_ANGLE_STEP, baseAngle);
+		field->setOpeningAngle(next);
+		record(QualityKnob::OPENING_ANGLE, angle, next);
+		return true;
+	}
+	return false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          QualityGovernor::record                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param knob                                                                *
+*           Setting which was changed.                                        *
+*  @param from, to                                                            *
+*           Its old and new values.                                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Appends an adjustment, with the times which prompted it, to be polled.     *
+*                                                                             *
+*******************************************************************************/
+void QualityGovernor::record(QualityKnob knob, GLfloat from, GLfloat to)
+{
+	QualityChange change = { knob, from, to, physicsMillis, renderMillis };
+	changes.push_back(change);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  "TimeWarpScheduler.h"
+#include  "FieldSampler.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Smoothing factor applied to the measured physics and render times. */
+#define   GOVERNOR_SMOOTHING                 0.1f
+/* Frames to wait after an adjustment before judging its effect. */
+#define   GOVERNOR_HOLD_FRAMES                 30
+/* Smallest share of the frame left to physics, however slow the drawing. */
+#define   GOVERNOR_MIN_PHYSICS_SHARE         0.25f
+/* A knob is restored only if its predicted cost fits in this much of its share. */
+#define   GOVERNOR_RESTORE_HEADROOM          0.5f
+/* Factor by which the largest step grows per adjustment, and its limit. */
+#define   GOVERNOR_STEP_FACTOR               2.0f
+#define   GOVERNOR_MAX_STEP_FACTOR           8.0f
+/* Increase of the field's opening angle per adjustment, and its limit. */
+#define   GOVERNOR_OPENING_ANGLE_STEP        0.25f
+#define   GOVERNOR_MAX_OPENING_ANGLE         1.0f
+/* Factor by which the field's nodes per side shrink per adjustment, and the least. */
+#define   GOVERNOR_RESOLUTION_FACTOR           2
+#define   GOVERNOR_MIN_RESOLUTION             16
+
+/******************************************************************************
+ *																			  *
+ *	                          QualityKnob Enum                                *
+ *																			  *
+ ******************************************************************************
+ *  MAX_STEP                                                                  *
+ *       Largest integrator step (fewer, longer substeps per frame).          *
+ *  OPENING_ANGLE                                                             *
+ *       Opening angle of the potential field's far-cell approximation.       *
+ *  RESOLUTION                                                                *
+ *       Nodes along each side of the potential field (and its heightmap).    *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Enumeration of the settings the QualityGovernor may trade for time.       *
+ *                                                                            *
+ ******************************************************************************/
+enum class QualityKnob
+{
+	MAX_STEP,
+	OPENING_ANGLE,
+	RESOLUTION,
+};
+
+/******************************************************************************
+*                                                                             *
+*                           QualityChange (struct)                            *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  knob                                                                       *
+*          Setting which was changed.                                         *
+*  from, to                                                                   *
+*          Value of the setting before and after the change.                  *
+*  physicsMillis, renderMillis                                                *
+*          Smoothed wall-clock time per frame which prompted the change.      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Struct recording a single adjustment made by the governor.                 *
+*                                                                             *
+*******************************************************************************/
+struct QualityChange
+{
+	QualityKnob    knob;
+	GLfloat        from;
+	GLfloat        to;
+	GLfloat        physicsMillis;
+	GLfloat        renderMillis;
+};
+
+/******************************************************************************
+ *																			  *
+ *                           QualityGovernor Class                            *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  scheduler                                                                 *
+ *          Scheduler whose step size and physics budget are governed.        *
+ *  field                                                                     *
+ *          Potential field drawn each frame (nullptr if none).               *
+ *  frameMillis                                                               *
+ *          Wall-clock time each frame should take.                           *
+ *  baseStep, baseAngle, baseResolution                                       *
+ *          Settings at construction, which are never exceeded on restore.    *
+ *  physicsMillis, renderMillis                                               *
+ *          Smoothed time spent per frame on physics and on drawing.          *
+ *  heldFrames                                                                *
+ *          Frames since the last adjustment.                                 *
+ *  changes                                                                   *
+ *          Adjustments not yet polled.                                       *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Holds the frame rate of the interactive loop on any machine by trading    *
+ *  accuracy for time. Each frame the caller reports how long physics and     *
+ *  drawing took. Drawing gets what it needs, and the scheduler's physics     *
+ *  budget is set to the rest of the frame, with a floor.                     *
+ *                                                                            *
+ *  When the scheduler cannot keep up with the warp in that budget, the       *
+ *  largest step is lengthened so the warp needs fewer substeps. When the     *
+ *  drawing overruns its share, the potential field is approximated more      *
+ *  coarsely, first with a larger opening angle and then with fewer nodes.    *
+ *  Settings are restored in the opposite order, one at a time. A setting is  *
+ *  only restored once its predicted cost fits with headroom, so the governor *
+ *  does not oscillate. It waits a number of frames after every change so     *
+ *  the smoothed times reflect it. Every change is recorded for the caller    *
+ *  to report.                                                                *
+ *                                                                            *
+ ******************************************************************************/
+class QualityGovernor
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                QualityGovernor(TimeWarpScheduler* scheduler,
+	                                GLfloat            frameMillis,
+	                                FieldSampler*      field = nullptr);
+
+	/* Account for one frame's measured times and adjust the settings. */
+	void            frame        (GLfloat physicsMs, GLfloat renderMs);
+
+	/* Remove and return all of the adjustments made so far. */
+	std::vector<QualityChange> pollChanges();
+
+	/* Getters. */
+	GLfloat         getFrameBudget()    const     {  return frameMillis;     }
+	GLfloat         getPhysicsMillis()  const     {  return physicsMillis;   }
+	GLfloat         getRenderMillis()   const     {  return renderMillis;    }
+
+	/* Destructor. */
+	               ~QualityGovernor()             {                          }
+
+/* Private Members. */
+private:
+
+	/* Governed objects. */
+	TimeWarpScheduler* scheduler;
+	FieldSampler*      field;
+	/* Target time per frame. */
+	GLfloat            frameMillis;
+	/* Settings at full quality. */
+	GLfloat            baseStep;
+	GLfloat            baseAngle;
+	GLuint             baseResolution;
+	/* Measured times. */
+	GLfloat            physicsMillis;
+	GLfloat            renderMillis;
+	GLuint             heldFrames;
+	/* Adjustments not yet polled. */
+	std::vector<QualityChange> changes;
+
+	/* Try to lower, or to raise, the quality of physics or drawing. */
+	bool            degradePhysics();
+	bool            restorePhysics(GLfloat physicsBudget);
+	bool            degradeRender();
+	bool            restoreRender(GLfloat renderBudget);
+	/* Record an adjustment. */
+	void            record       (QualityKnob knob, GLfloat from, GLfloat to);
+};
@@ -0,0 +1,616 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iterator>
+#include "ResultCache.h"
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(d) _mkdir(d)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(d) mkdir(d, 0755)
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                               Local Constants                               *
+*                                                                             *
+******************************************************************************/
+/* Magic, version, key, payload size and payload checksum. */
+static const unsigned long long HEADER_BYTES = 4 + sizeof(GLuint) +
+                                               3 * sizeof(unsigned long long);
+
+/******************************************************************************
+*                                                                             *
+*                             ContentHash::add                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param data                                                                *
+*           Bytes to hash.                                                    *
+*  @param bytes                                                               *
+*           Number of bytes.                                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************/
+void ContentHash::add(const void* data, size_t bytes)
+{
+	const unsigned char* p = (const unsigned char*) data;
+	for (size_t i = 0; i < bytes; i++)
+	{
+		value ^= p[i];
+		value *= FNV_PRIME;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                             ContentHash::add                                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param text                                                                *
+*           String to hash, including its terminating null.                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************/
+void ContentHash::add(const std::string& text)
+{
+	add(text.c_str(), text.size() + 1);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ContentHash::addFile                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the file whose contents are hashed.                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the file could not be read (nothing is added).                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Hashes the contents followed by their length, so the key changes with      *
+*  any edit to a scene file but not with its name or modification time.       *
+*                                                                             *
+*******************************************************************************/
+bool ContentHash::addFile(const char* file)
+{
+	std::ifstream in(file, std::ios::binary);
+	if (!in)
+		return false;
+
+	char               buffer[4096];
+	unsigned long long length = 0;
+	while (in)
+	{
+		in.read(buffer, sizeof(buffer));
+		add(buffer, (size_t) in.gcount());
+		length += in.gcount();
+	}
+	addValue(length);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                    ResultCache::ResultCache (Constructor)                   *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param directory                                                           *
+*           Directory of the store.                                           *
+*  @param maxBytes                                                            *
+*           Largest total size of the entries.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the ResultCache class. Reads the index of the directory,   *
+*  which is only created once something is stored.                            *
+*                                                                             *
+*******************************************************************************/
+ResultCache::ResultCache(const char* directory, unsigned long long maxBytes) :
+	directory(directory), maxBytes(maxBytes), totalBytes(0), useCounter(0),
+	hits(0), misses(0), rejected(0)
+{
+	loadIndex();
+}
+
+/******************************************************************************
+*                                                                             *
+*                              ResultCache::get                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*  @param payload                                                             *
+*           Filled with the stored bytes on a hit, emptied on a miss.         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether an intact entry was found.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Checks the entry's magic, version, key and length before reading it, and   *
+*  its checksum after. An entry failing any check is deleted.                 *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::get(unsigned long long key, std::vector<char>& payload)
+{
+	payload.clear();
+	std::ifstream in(pathOf(key).c_str(), std::ios::binary);
+	if (!in)
+	{
+		if (entries.count(key))
+			drop(key);
+		misses++;
+		return false;
+	}
+
+	in.seekg(0, std::ios::end);
+	unsigned long long length = (unsigned long long) in.tellg();
+	in.seekg(0, std::ios::beg);
+
+	char               magic[4];
+	GLuint             version   = 0;
+	unsigned long long storedKey = 0, size = 0, checksum = 0;
+	in.read(magic, 4);
+	in.read((char*) &version,   sizeof(version));
+	in.read((char*) &storedKey, sizeof(storedKey));
+	in.read((char*) &size,      sizeof(size));
+	in.read((char*) &checksum,  sizeof(checksum));
+
+	bool intact = in && memcmp(magic, CACHE_MAGIC, 4) == 0 &&
+	              version == CACHE_VERSION && storedKey == key &&
+	              length == HEADER_BYTES + size;
+	if (intact)
+	{
+		payload.resize((size_t) size);
+		if (size > 0)
+			in.read(&payload[0], (std::streamsize) size);
+		ContentHash hash;
+		hash.add(payload.data(), payload.size());
+		intact = in && hash.getValue() == checksum;
+	}
+	in.close();
+
+	if (!intact)
+	{
+		payload.clear();
+		drop(key);
+		saveIndex();
+		rejected++;
+		misses++;
+		return false;
+	}
+
+	touch(key, length);
+	saveIndex();
+	hits++;
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              ResultCache::put                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*  @param payload                                                             *
+*           Bytes to store.                                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether the entry was stored. A payload larger than the whole cache is     *
+*  not.                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Writes the entry beside its final name and renames it into place, then     *
+*  evicts the least recently used entries until the total is within limits.   *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::put(unsigned long long key, const std::vector<char>& payload)
+{
+	unsigned long long size  = payload.size();
+	unsigned long long bytes = HEADER_BYTES + size;
+	if (bytes > maxBytes)
+		return false;
+
+	ContentHash hash;
+	hash.add(payload.data(), payload.size());
+	unsigned long long checksum = hash.getValue();
+	GLuint             version  = CACHE_VERSION;
+
+	std::string path      = pathOf(key);
+	std::string temporary = path + ".tmp";
+	MAKE_DIRECTORY(directory.c_str());
+	{
+		std::ofstream out(temporary.c_str(), std::ios::binary);
+		out.write(CACHE_MAGIC, 4);
+		out.write((const char*) &version,  sizeof(version));
+		out.write((const char*) &key,      sizeof(key));
+		out.write((const char*) &size,     sizeof(size));
+		out.write((const char*) &checksum, sizeof(checksum));
+		if (size > 0)
+			out.write(&payload[0], (std::streamsize) size);
+		if (!out)
+		{
+			out.close();
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+
+	/* Replace any old entry (rename will not overwrite on every platform). */
+	std::remove(path.c_str());
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		std::remove(temporary.c_str());
+		return false;
+	}
+
+	touch(key, bytes);
+	evict(key);
+	saveIndex();
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ResultCache::getFile                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*  @param file                                                                *
+*           Path to write the stored bytes to.                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether an intact entry was found and written out.                         *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::getFile(unsigned long long key, const char* file)
+{
+	std::vector<char> payload;
+	if (!get(key, payload))
+		return false;
+
+	std::ofstream out(file, std::ios::binary);
+	if (!payload.empty())
+		out.write(&payload[0], (std::streamsize) payload.size());
+	return (bool) out;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ResultCache::putFile                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*  @param file                                                                *
+*           Path of a finished result, such as a trajectory archive.          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether the file was read and stored.                                      *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::putFile(unsigned long long key, const char* file)
+{
+	std::ifstream in(file, std::ios::binary);
+	if (!in)
+		return false;
+
+	std::vector<char> payload((std::istreambuf_iterator<char>(in)),
+	                          std::istreambuf_iterator<char>());
+	return put(key, payload);
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ResultCache::getState                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*  @param state                                                               *
+*           Filled with the stored state on a hit.                            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether an intact entry holding a whole state was found.                   *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::getState(unsigned long long key, NBodyState& state)
+{
+	std::vector<char> payload;
+	if (!get(key, payload))
+		return false;
+
+	/* Body count, G and time, then positions, velocities and masses. */
+	GLuint n      = 0;
+	size_t header = sizeof(GLuint) + sizeof(GLfloat) + sizeof(GLdouble);
+	if (payload.size() < header)
+		return false;
+	memcpy(&n, &payload[0], sizeof(GLuint));
+	if (payload.size() != header + n * (2 * sizeof(glm::vec3) + sizeof(GLfloat)))
+		return false;
+
+	const char* p = &payload[0] + sizeof(GLuint);
+	memcpy(&state.G, p, sizeof(GLfloat));  p += sizeof(GLfloat);
+	memcpy(&state.t, p, sizeof(GLdouble)); p += sizeof(GLdouble);
+	state.positions.resize(n);
+	state.velocities.resize(n);
+	state.masses.resize(n);
+	if (n > 0)
+	{
+		memcpy(&state.positions[0],  p, n * sizeof(glm::vec3));  p += n * sizeof(glm::vec3);
+		memcpy(&state.velocities[0], p, n * sizeof(glm::vec3));  p += n * sizeof(glm::vec3);
+		memcpy(&state.masses[0],     p, n * sizeof(GLfloat));
+	}
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            ResultCache::putState                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*  @param state                                                               *
+*           State to store.                                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether the state was stored.                                              *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::putState(unsigned long long key, const NBodyState& state)
+{
+	GLuint            n = state.positions.size();
+	std::vector<char> payload(sizeof(GLuint) + sizeof(GLfloat) + sizeof(GLdouble) +
+	                          n * (2 * sizeof(glm::vec3) + sizeof(GLfloat)));
+
+	char* p = &payload[0];
+	memcpy(p, &n,       sizeof(GLuint));   p += sizeof(GLuint);
+	memcpy(p, &state.G, sizeof(GLfloat));  p += sizeof(GLfloat);
+	memcpy(p, &state.t, sizeof(GLdouble)); p += sizeof(GLdouble);
+	if (n > 0)
+	{
+		memcpy(p, &state.positions[0],  n * sizeof(glm::vec3));  p += n * sizeof(glm::vec3);
+		memcpy(p, &state.velocities[0], n * sizeof(glm::vec3));  p += n * sizeof(glm::vec3);
+		memcpy(p, &state.masses[0],     n * sizeof(GLfloat));
+	}
+	return put(key, payload);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             ResultCache::pathOf                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Hash of the inputs of the result.                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Path of the entry: its key as 16 hexadecimal digits in the directory.      *
+*                                                                             *
+*******************************************************************************/
+std::string ResultCache::pathOf(unsigned long long key) const
+{
+	std::ostringstream path;
+	path << directory << '/' << std::hex << std::setw(16) << std::setfill('0')
+	     << key << CACHE_EXTENSION;
+	return path.str();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ResultCache::indexPath                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Path of the index file.                                                    *
+*                                                                             *
+*******************************************************************************/
+std::string ResultCache::indexPath() const
+{
+	return directory + '/' + CACHE_INDEX_FILE;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ResultCache::loadIndex                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads a line per entry: key, size and last use. An unreadable index is     *
+*  ignored; the entries it listed are still served when asked for.            *
+*                                                                             *
+*******************************************************************************/
+void ResultCache::loadIndex()
+{
+	std::ifstream in(indexPath().c_str());
+	std::string   magic;
+	GLuint        version = 0;
+	if (!(in >> magic >> version) || magic != CACHE_MAGIC || version != CACHE_VERSION)
+		return;
+
+	unsigned long long key;
+	CacheEntry         entry;
+	while (in >> std::hex >> key >> std::dec >> entry.bytes >> entry.lastUse)
+	{
+		if (entries.count(key))
+			totalBytes -= entries[key].bytes;
+		entries[key] = entry;
+		totalBytes  += entry.bytes;
+		if (entry.lastUse > useCounter)
+			useCounter = entry.lastUse;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           ResultCache::saveIndex                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  Whether the index was written.                                             *
+*                                                                             *
+*******************************************************************************/
+bool ResultCache::saveIndex() const
+{
+	std::string path      = indexPath();
+	std::string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary.c_str());
+		out << CACHE_MAGIC << ' ' << CACHE_VERSION << '\n';
+		for (std::map<unsigned long long, CacheEntry>::const_iterator e = entries.begin();
+		     e != entries.end(); ++e)
+			out << std::hex << std::setw(16) << std::setfill('0') << e->first
+			    << std::dec << ' ' << e->second.bytes << ' ' << e->second.lastUse << '\n';
+		if (!out)
+			return false;
+	}
+	std::remove(path.c_str());
+	return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             ResultCache::touch                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Entry which was read or written.                                  *
+*  @param bytes                                                               *
+*           Size of its file.                                                 *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************/
+void ResultCache::touch(unsigned long long key, unsigned long long bytes)
+{
+	std::map<unsigned long long, CacheEntry>::iterator e = entries.find(key);
+	if (e != entries.end())
+		totalBytes -= e->second.bytes;
+
+	CacheEntry entry = { bytes, ++useCounter };
+	entries[key] = entry;
+	totalBytes  += bytes;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              ResultCache::drop                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param key                                                                 *
+*           Entry to delete.                                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************/
+void ResultCache::drop(unsigned long long key)
+{
+	std::remove(pathOf(key).c_str());
+
+	std::map<unsigned long long, CacheEntry>::iterator e = entries.find(key);
+	if (e == entries.end())
+		return;
+	totalBytes -= e->second.bytes;
+	entries.erase(e);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             ResultCache::evict                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param keep                                                                *
+*           Entry which must not be evicted (the one just written).           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Deletes the least recently used entries until the total size is within     *
+*  the limit. Caches hold few, large entries, so each victim is found by a    *
+*  scan of the index.                                                         *
+*                                                                             *
+*******************************************************************************/
+void ResultCache::evict(unsigned long long keep)
+{
+	while (totalBytes > maxBytes)
+	{
+		std::map<unsigned long long, CacheEntry>::iterator victim = entries.end();
+		for (std::map<unsigned long long, CacheEntry>::iterator e = entries.begin();
+		     e != entries.end(); ++e)
+			if (e->first != keep &&
+			    (victim == entries.end() || e->second.lastUse < victim->second.lastUse))
+				victim = e;
+		if (victim == entries.end())
+			return;
+		drop(victim->first);
+	}
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <map>
+#include  <string>
+#include  <vector>
+#include  <GL\glew.h>
+#include  "NBodyIntegrator.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default largest total size of the cached results, in bytes. */
+#define   CACHE_DEFAULT_BYTES         (256ull << 20)
+/* File listing the entries and when each was last used. */
+#define   CACHE_INDEX_FILE             "index.txt"
+/* Extension of an entry file. */
+#define   CACHE_EXTENSION              ".gsc"
+/* First four bytes of an entry, and the format version after them. */
+#define   CACHE_MAGIC                  "GSRC"
+#define   CACHE_VERSION                       2
+/* Parameters of the 64-bit FNV-1a hash. */
+#define   FNV_OFFSET_BASIS     14695981039346656037ull
+#define   FNV_PRIME                  1099511628211ull
+
+/******************************************************************************
+ *																			  *
+ *                            ContentHash Class                               *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  value                                                                     *
+ *          Hash of everything added so far.                                  *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Running 64-bit FNV-1a hash of bytes, used both to key cached results by   *
+ *  their inputs and to check that an entry was read back intact. Values are  *
+ *  added as their in-memory bytes, so a key is only meaningful on machines   *
+ *  with the same float and integer layout, which is all this cache needs.    *
+ *                                                                            *
+ ******************************************************************************/
+class ContentHash
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   ContentHash  () : value(FNV_OFFSET_BASIS)           {}
+
+	/* Add raw bytes. */
+	void               add          (const void* data, size_t bytes);
+	/* Add a string, terminated so that "ab" + "c" differs from "a" + "bc". */
+	void               add          (const std::string& text);
+	/* Add the contents of a file; false if it cannot be read. */
+	bool               addFile      (const char* file);
+	/* Add a plain value. */
+	template <typename T>
+	void               addValue     (const T& v)          {  add(&v, sizeof(T)); }
+
+	/* Getters. */
+	unsigned long long getValue()          const  {  return value;           }
+
+/* Private Members. */
+private:
+
+	unsigned long long value;
+};
+
+/******************************************************************************
+*                                                                             *
+*                            CacheEntry (struct)                              *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  bytes                                                                      *
+*          Size of the entry file.                                            *
+*  lastUse                                                                    *
+*          Value of the cache's use counter when the entry was last read or   *
+*          written.                                                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Index record of a single cached result.                                    *
+*                                                                             *
+*******************************************************************************/
+struct CacheEntry
+{
+	unsigned long long bytes;
+	unsigned long long lastUse;
+};
+
+/******************************************************************************
+ *																			  *
+ *                            ResultCache Class                               *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  directory                                                                 *
+ *          Directory holding the index and one file per entry.               *
+ *  maxBytes                                                                  *
+ *          Largest total size of the entries before the least recently used  *
+ *          are evicted.                                                      *
+ *  entries                                                                   *
+ *          Index of the entries by key.                                      *
+ *  totalBytes                                                                *
+ *          Total size of the indexed entries.                                *
+ *  useCounter                                                                *
+ *          Incremented on every read or write, to order the entries by use.  *
+ *  hits, misses, rejected                                                    *
+ *          Reads served, reads not served, and entries discarded because     *
+ *          they failed their integrity check.                                *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Local on-disk store of simulation results, addressed by a hash of         *
+ *  everything that determines them: the scene file, the integrator's         *
+ *  settings and the time range. Identical runs are then served from disk     *
+ *  instead of being simulated again.                                         *
+ *                                                                            *
+ *  Each entry is a file named by its key. The file repeats the key and       *
+ *  holds the size and a checksum of the payload, and every read checks all   *
+ *  three, so a truncated, corrupted or misnamed entry is deleted and counts  *
+ *  as a miss. Entries are written to a temporary file and renamed into       *
+ *  place, so a reader never sees half of one. The index records the size     *
+ *  and last use of every entry. When the total exceeds the limit, the least  *
+ *  recently used entries are evicted. An entry missing from the index is     *
+ *  still served if its file is intact.                                       *
+ *                                                                            *
+ ******************************************************************************/
+class ResultCache
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   ResultCache  (const char*        directory,
+	                                 unsigned long long maxBytes = CACHE_DEFAULT_BYTES);
+
+	/* Read, or store, the payload of an entry. */
+	bool               get          (unsigned long long       key,
+	                                 std::vector<char>&       payload);
+	bool               put          (unsigned long long       key,
+	                                 const std::vector<char>& payload);
+
+	/* Copy an entry out to a file, or a file in as an entry (trajectories). */
+	bool               getFile      (unsigned long long key, const char* file);
+	bool               putFile      (unsigned long long key, const char* file);
+
+	/* Read, or store, a single state (checkpoints). */
+	bool               getState     (unsigned long long key, NBodyState& state);
+	bool               putState     (unsigned long long key, const NBodyState& state);
+
+	/* Getters. */
+	GLuint             getNumEntries()     const  {  return entries.size();  }
+	unsigned long long getTotalBytes()     const  {  return totalBytes;      }
+	GLuint             getHits()           const  {  return hits;            }
+	GLuint             getMisses()         const  {  return misses;          }
+	GLuint             getRejected()       const  {  return rejected;        }
+
+	/* Destructor. */
+	                  ~ResultCache()                                       {}
+
+/* Private Members. */
+private:
+
+	std::string        directory;
+	unsigned long long maxBytes;
+	std::map<unsigned long long, CacheEntry> entries;
+	unsigned long long totalBytes;
+	unsigned long long useCounter;
+	GLuint             hits;
+	GLuint             misses;
+	GLuint             rejected;
+
+	/* Path of the file of an entry, and of the index. */
+	std::string        pathOf       (unsigned long long key)              const;
+	std::string        indexPath    ()                                    const;
+	/* Read, or write, the index. */
+	void               loadIndex    ();
+	bool               saveIndex    ()                                    const;
+	/* Record a use of an entry of the given size. */
+	void               touch        (unsigned long long key, unsigned long long bytes);
+	/* Delete an entry's file and forget it. */
+	void               drop         (unsigned long long key);
+	/* Evict the least recently used entries, other than keep, down to the limit. */
+	void               evict        (unsigned long long keep);
+};
@@ -68,6 +68,7 @@ Shader::Shader(std::string vertexShaderFilepath,
 	glBindAttribLocation(program, 1, "modelColor");
 	glBindAttribLocation(program, 2, "modelNormal");
 	glBindAttribLocation(program, 3, "modelTexCoord");
+	glBindAttribLocation(program, 4, "modelToWorld");
 
 	/* Link the shader objects. */
 	glLinkProgram(program);
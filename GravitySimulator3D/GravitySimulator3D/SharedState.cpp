@@ -0,0 +1,420 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <new>
+#include "SharedState.h"
+#include "OrbitalSystem.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                     SharedState::SharedState (Constructor)                  *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the SharedState class. Nothing is mapped until create or   *
+*  attach is called.                                                          *
+*                                                                             *
+*******************************************************************************/
+SharedState::SharedState() :
+	header(nullptr), bytes(0), handle(nullptr), owner(false), acquired(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                      SharedState::~SharedState (Destructor)                 *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Destructor for the SharedState class.                                      *
+*                                                                             *
+*******************************************************************************/
+SharedState::~SharedState()
+{
+	detach();
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SharedState::map                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param name                                                                *
+*           Name of the segment.                                              *
+*  @param bytes                                                               *
+*           Size of the segment when creating it (ignored when opening).      *
+*  @param create                                                              *
+*           True to create the segment, false to open an existing one.        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the segment was mapped.                                            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The only platform specific part of the class. On POSIX systems the name    *
+*  is given a leading slash and the descriptor is closed once mapped; on      *
+*  Windows the mapping handle is kept until the view is unmapped.             *
+*                                                                             *
+*******************************************************************************/
+bool SharedState::map(const char* name, size_t bytes, bool create)
+{
+	this->name = name;
+
+#ifdef _WIN32
+	std::string path = std::string("Local\\") + name;
+	HANDLE mapping = create
+	    ? CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+	                         (DWORD) ((unsigned long long) bytes >> 32),
+	                         (DWORD) bytes, path.c_str())
+	    : OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path.c_str());
+	if (mapping == NULL)
+		return false;
+
+	void* base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (base == NULL)
+	{
+		CloseHandle(mapping);
+		return false;
+	}
+
+	/* The size of an opened mapping is that of its view. */
+	if (!create)
+	{
+		MEMORY_BASIC_INFORMATION info;
+		VirtualQuery(base, &info, sizeof(info));
+		bytes = info.RegionSize;
+	}
+	handle = mapping;
+#else
+	std::string path = std::string("/") + name;
+	int descriptor = create ? shm_open(path.c_str(), O_CREAT | O_RDWR, 0644)
+	                        : shm_open(path.c_str(), O_RDWR, 0);
+	if (descriptor < 0)
+		return false;
+
+	struct stat info;
+	if (create ? ftruncate(descriptor, bytes) != 0
+	           : fstat(descriptor, &info) != 0)
+	{
+		close(descriptor);
+		return false;
+	}
+	if (!create)
+		bytes = (size_t) info.st_size;
+
+	void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+	                  descriptor, 0);
+	close(descriptor);
+	if (base == MAP_FAILED)
+		return false;
+#endif
+
+	header      = (SharedStateHeader*) base;
+	this->bytes = bytes;
+	owner       = create;
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SharedState::create                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param name                                                                *
+*           Name of the segment.                                              *
+*  @param capacity                                                            *
+*           Largest number of bodies a frame can hold.                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the segment was created.                                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Creates (or takes over) the named segment and writes an empty header.      *
+*  Slots are padded to a multiple of the header size so that each starts on   *
+*  its own cache line.                                                        *
+*                                                                             *
+*******************************************************************************/
+bool SharedState::create(const char* name, GLuint capacity)
+{
+	detach();
+
+	size_t slotBytes = SHARED_STATE_HEADER_BYTES +
+	                   capacity * (sizeof(glm::mat4) + 2 * sizeof(glm::vec3));
+	slotBytes = (slotBytes + SHARED_STATE_HEADER_BYTES - 1) /
+	            SHARED_STATE_HEADER_BYTES * SHARED_STATE_HEADER_BYTES;
+
+	if (!map(name, SHARED_STATE_HEADER_BYTES + SHARED_STATE_SLOTS * slotBytes, true))
+		return false;
+
+	/* Viewers check the magic last, so it is written after everything else. */
+	new (header) SharedStateHeader;
+	header->magic     = 0;
+	header->version   = SHARED_STATE_VERSION;
+	header->capacity  = capacity;
+	header->slotBytes = (GLuint) slotBytes;
+	header->frame.store(0);
+	for (GLuint s = 0; s < SHARED_STATE_SLOTS; s++)
+	{
+		SharedFrame* f = slot(s);
+		new (f) SharedFrame;
+		f->sequence.store(0);
+		f->frame     = 0;
+		f->numBodies = 0;
+		f->capacity  = capacity;
+		f->t         = 0;
+	}
+	header->running.store(1);
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic     = SHARED_STATE_MAGIC;
+
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SharedState::attach                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param name                                                                *
+*           Name of the segment.                                              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if a compatible segment was mapped.                                   *
+*                                                                             *
+*******************************************************************************/
+bool SharedState::attach(const char* name)
+{
+	detach();
+
+	if (!map(name, 0, false))
+		return false;
+
+	/* Reject segments of another layout, or not yet initialized. */
+	if (bytes < SHARED_STATE_HEADER_BYTES ||
+	    header->magic != SHARED_STATE_MAGIC ||
+	    header->version != SHARED_STATE_VERSION ||
+	    bytes < SHARED_STATE_HEADER_BYTES +
+	            SHARED_STATE_SLOTS * (size_t) header->slotBytes)
+	{
+		detach();
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SharedState::detach                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Unmaps the segment. The server first marks it stopped so attached viewers  *
+*  can tell, and removes its name so no new viewer attaches; the memory       *
+*  itself lasts until the last viewer has detached.                           *
+*                                                                             *
+*******************************************************************************/
+void SharedState::detach()
+{
+	if (header == nullptr)
+		return;
+
+	if (owner)
+		header->running.store(0);
+
+#ifdef _WIN32
+	UnmapViewOfFile(header);
+	CloseHandle((HANDLE) handle);
+#else
+	munmap(header, bytes);
+	if (owner)
+		shm_unlink((std::string("/") + name).c_str());
+#endif
+
+	header = nullptr;
+	handle = nullptr;
+	bytes  = 0;
+	owner  = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                              SharedState::slot                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param f                                                                   *
+*           Frame number.                                                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The slot frame f is written to.                                            *
+*                                                                             *
+*******************************************************************************/
+SharedFrame* SharedState::slot(GLuint f) const
+{
+	return (SharedFrame*) ((char*) header + SHARED_STATE_HEADER_BYTES +
+	                       (f % SHARED_STATE_SLOTS) * (size_t) header->slotBytes);
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SharedState::publish                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system to publish.                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if a frame was written (only the server can write, and only while     *
+*  the bodies fit).                                                           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Writes the next frame into the slot not holding the latest one. The odd    *
+*  sequence is stored before any data and the even one after all of it, so    *
+*  a viewer that reads the same even sequence on both sides of its use of a   *
+*  slot saw a whole frame. Bodies are written in order of handle, which does  *
+*  not change when the server reorders them.                                  *
+*                                                                             *
+*******************************************************************************/
+bool SharedState::publish(OrbitalSystem& system)
+{
+	GLuint n = system.getNumBodies();
+	if (!owner || n > header->capacity)
+		return false;
+
+	GLuint       f     = header->frame.load(std::memory_order_relaxed) + 1;
+	SharedFrame* frame = slot(f);
+
+	frame->sequence.store(2 * f - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	system.snapshotTransforms();
+	glm::mat4* transforms = frame->getTransforms();
+	glm::vec3* positions  = frame->getPositions();
+	glm::vec3* velocities = frame->getVelocities();
+	GLuint     k          = 0;
+	for (GLuint slot = 0; slot < system.getNumSlots(); slot++)
+	{
+		/* In order of handle, which viewers loading the same file share. */
+		GLuint i = system.getSlotIndex(slot);
+		if (i == NO_BODY)
+			continue;
+
+		OrbitalBody* body = system.getBody(i);
+		transforms[k] = *body->getTransformation();
+		positions[k]  = body->getLinearPosition();
+		velocities[k] = body->getLinearVelocity();
+		k++;
+	}
+	frame->frame     = f;
+	frame->numBodies = n;
+	frame->t         = system.t();
+
+	frame->sequence.store(2 * f, std::memory_order_release);
+	header->frame.store(f, std::memory_order_release);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SharedState::acquire                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The latest complete frame, or null if nothing has been published or the    *
+*  server overwrote the frame before it could be taken.                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The frame stays in the shared segment, where the server may overwrite it   *
+*  at any time: copy what is needed, then call release to validate the copy.  *
+*                                                                             *
+*******************************************************************************/
+SharedFrame* SharedState::acquire()
+{
+	if (header == nullptr)
+		return nullptr;
+
+	GLuint f = header->frame.load(std::memory_order_acquire);
+	if (f == 0)
+		return nullptr;
+
+	SharedFrame* frame = slot(f);
+	if (frame->sequence.load(std::memory_order_acquire) != 2 * f)
+		return nullptr;
+
+	acquired = f;
+	return frame;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             SharedState::release                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param frame                                                               *
+*           A frame returned by acquire.                                      *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the server did not start writing to the slot while it was in use,  *
+*  so everything read from it belongs to one frame.                           *
+*                                                                             *
+*******************************************************************************/
+bool SharedState::release(SharedFrame* frame) const
+{
+	/* The number is kept privately, since the slot's own copy may be rewritten. */
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return frame->sequence.load(std::memory_order_relaxed) == 2 * acquired;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <atomic>
+#include  <string>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+
+/******************************************************************************
+*                                                                             *
+*                              Forward Declarations                           *
+*                                                                             *
+******************************************************************************/
+class OrbitalSystem;
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default name of the shared segment. */
+#define   SHARED_STATE_NAME        "GravitySimulator3D"
+/* Default largest number of bodies the segment holds. */
+#define   SHARED_STATE_CAPACITY                   4096
+/* Identifies a segment written by this program ("GS3D"). */
+#define   SHARED_STATE_MAGIC                0x47533344
+/* Layout version of the segment. */
+#define   SHARED_STATE_VERSION                       2
+/* Number of frame slots; the writer alternates between them. */
+#define   SHARED_STATE_SLOTS                         2
+/* Bytes reserved for each header, so the arrays start on a cache line. */
+#define   SHARED_STATE_HEADER_BYTES                 64
+
+/******************************************************************************
+*                                                                             *
+*                          SharedStateHeader (struct)                         *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  magic, version                                                             *
+*          Identify the layout of the segment.                                *
+*  capacity                                                                   *
+*          Largest number of bodies in a frame.                               *
+*  slotBytes                                                                  *
+*          Size of each frame slot.                                           *
+*  running                                                                    *
+*          Non-zero while the server is publishing.                           *
+*  frame                                                                      *
+*          Number of the latest complete frame (0 before the first).          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Start of the shared segment, followed by SHARED_STATE_SLOTS frames.        *
+*                                                                             *
+*******************************************************************************/
+struct SharedStateHeader
+{
+	GLuint              magic;
+	GLuint              version;
+	GLuint              capacity;
+	GLuint              slotBytes;
+	std::atomic<GLuint> running;
+	std::atomic<GLuint> frame;
+};
+
+/******************************************************************************
+*                                                                             *
+*                            SharedFrame (struct)                             *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  sequence                                                                   *
+*          Twice the number of the frame in the slot, odd while it is being   *
+*          written.                                                           *
+*  frame                                                                      *
+*          Number of the frame in the slot.                                   *
+*  numBodies, capacity                                                        *
+*          Number of bodies in the frame, and room in the slot.               *
+*  t                                                                          *
+*          SECONDS                                                            *
+*          Simulation time of the frame.                                      *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  One slot of the shared segment. The header is followed by the transforms,  *
+*  positions and velocities of the bodies, each sized for capacity bodies.    *
+*  A viewer copies what it needs out of the slot before checking that the     *
+*  copy was not torn.                                                         *
+*                                                                             *
+*******************************************************************************/
+struct SharedFrame
+{
+	std::atomic<GLuint> sequence;
+	GLuint              frame;
+	GLuint              numBodies;
+	GLuint              capacity;
+	GLdouble            t;
+
+	/* Body arrays following the header. */
+	glm::mat4*       getTransforms()
+	{  return (glm::mat4*) ((char*) this + SHARED_STATE_HEADER_BYTES);                  }
+	glm::vec3*       getPositions()
+	{  return (glm::vec3*) (getTransforms() + capacity);                                 }
+	glm::vec3*       getVelocities()
+	{  return getPositions() + capacity;                                                 }
+};
+
+/******************************************************************************
+ *																			  *
+ *                             SharedState Class                              *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  name                                                                      *
+ *          Name of the segment.                                              *
+ *  header                                                                    *
+ *          Start of the mapped segment (null when not attached).             *
+ *  bytes                                                                     *
+ *          Size of the mapping.                                              *
+ *  handle                                                                    *
+ *          Platform mapping handle, kept open on Windows only.               *
+ *  owner                                                                     *
+ *          True for the server, which created the segment.                   *
+ *  acquired                                                                  *
+ *          Number of the frame last returned by acquire.                     *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Publishes the bodies of a running system through a named shared memory    *
+ *  segment (POSIX shm_open, or a file mapping on Windows), so any number of  *
+ *  viewer processes can draw a simulation running in another process.        *
+ *                                                                            *
+ *  The segment holds two frame slots, each guarded by a seqlock. The server  *
+ *  writes frame f into slot f % 2, marking the slot's sequence odd while it  *
+ *  writes and 2f when it is done, and then publishes f. The server never     *
+ *  waits on a viewer. A viewer acquires the latest frame, copies it out of   *
+ *  the slot, then releases it; release re-checks the sequence and reports    *
+ *  whether the server reused the slot during the copy (which takes two       *
+ *  further frames), in which case the copy must be discarded.                *
+ *                                                                            *
+ ******************************************************************************/
+class SharedState
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                       SharedState  ();
+
+	/* Create the segment and become its server. */
+	bool                   create       (const char* name     = SHARED_STATE_NAME,
+	                                     GLuint      capacity = SHARED_STATE_CAPACITY);
+	/* Map an existing segment as a viewer. */
+	bool                   attach       (const char* name     = SHARED_STATE_NAME);
+	/* Unmap the segment (the server also marks it stopped and removes it). */
+	void                   detach       ();
+
+	/* Write the current bodies of the system as the next frame. */
+	bool                   publish      (OrbitalSystem& system);
+
+	/* Latest complete frame, or null if there is none. */
+	SharedFrame*           acquire      ();
+	/* True if the acquired frame was not overwritten while in use. */
+	bool                   release      (SharedFrame* frame) const;
+
+	/* Getters. */
+	bool                   isAttached()        const  {  return header != nullptr; }
+	bool                   isOwner()           const  {  return owner;            }
+	bool                   isServerRunning()   const
+	                       {  return header != nullptr && header->running.load() != 0;  }
+	GLuint                 getCapacity()       const
+	                       {  return header ? header->capacity : 0;                      }
+
+	/* Destructor (detaches). */
+	                      ~SharedState();
+
+/* Private Members. */
+private:
+
+	/* Mapping. */
+	std::string            name;
+	SharedStateHeader*     header;
+	size_t                 bytes;
+	void*                  handle;
+	bool                   owner;
+	/* Frame held by the viewer. */
+	GLuint                 acquired;
+
+	/* Slot holding frame number f. */
+	SharedFrame*           slot         (GLuint f) const;
+	/* Map bytes of the named segment, creating it if asked. */
+	bool                   map          (const char* name, size_t bytes, bool create);
+
+	/* Not copyable (the mapping is owned). */
+	                       SharedState  (const SharedState&);
+	SharedState&           operator=    (const SharedState&);
+};
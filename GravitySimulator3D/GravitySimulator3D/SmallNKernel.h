@@ -0,0 +1,192 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <array>
+#include  <vector>
+#include  <cmath>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "NBodyIntegrator.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Smallest and largest body counts with a specialized kernel. */
+#define   SMALL_N_MIN                          2
+#define   SMALL_N_MAX                         16
+
+/******************************************************************************
+ *																			  *
+ *                          SmallNPairs Template                              *
+ *																			  *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Unrolled loop over the pairs (I, J), J > I, of N bodies. Each instance    *
+ *  handles one pair and calls the next, and a row ends by starting the next  *
+ *  row through SmallNRow, so the compiler sees straight-line code with the   *
+ *  indices as constants. Each pair is evaluated once and applied to both     *
+ *  bodies with opposite signs.                                               *
+ *                                                                            *
+ ******************************************************************************/
+template <GLuint N, GLuint I>
+struct SmallNRow;
+
+template <GLuint N, GLuint I, GLuint J>
+struct SmallNPairs
+{
+	static void run(const std::array<GLfloat, N>&   gm,
+	                const std::array<glm::vec3, N>& x,
+	                      std::array<glm::vec3, N>& a)
+	{
+		glm::vec3 d  = x[J] - x[I];
+		GLfloat   r2 = glm::dot(d, d);
+		if (r2 > 0)
+		{
+			GLfloat   r = sqrt(r2);
+			glm::vec3 s = d / (r2 * r);
+			a[I] += gm[J] * s;
+			a[J] -= gm[I] * s;
+		}
+		SmallNPairs<N, I, J + 1>::run(gm, x, a);
+	}
+};
+
+/* End of row I: go on with the pairs of body I + 1. */
+template <GLuint N, GLuint I>
+struct SmallNPairs<N, I, N>
+{
+	static void run(const std::array<GLfloat, N>&   gm,
+	                const std::array<glm::vec3, N>& x,
+	                      std::array<glm::vec3, N>& a)
+	{
+		SmallNRow<N, I + 1>::run(gm, x, a);
+	}
+};
+
+/* Row I: the pairs (I, I + 1) .. (I, N - 1). */
+template <GLuint N, GLuint I>
+struct SmallNRow
+{
+	static void run(const std::array<GLfloat, N>&   gm,
+	                const std::array<glm::vec3, N>& x,
+	                      std::array<glm::vec3, N>& a)
+	{
+		SmallNPairs<N, I, I + 1>::run(gm, x, a);
+	}
+};
+
+/* Past the last row. */
+template <GLuint N>
+struct SmallNRow<N, N>
+{
+	static void run(const std::array<GLfloat, N>&,
+	                const std::array<glm::vec3, N>&,
+	                      std::array<glm::vec3, N>&)                       {}
+};
+
+/******************************************************************************
+ *																			  *
+ *                          SmallNKernel Template                             *
+ *																			  *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Runge-Kutta step for exactly N bodies. The whole state of the step lives  *
+ *  in std::arrays on the stack, the pair loops are unrolled by SmallNPairs,  *
+ *  and there are no self or bounds checks, so a scene of a few bodies costs  *
+ *  little more than its arithmetic. It takes the same stages as              *
+ *  NBodyIntegrator::rungeKutta; only the order of the sums differs.          *
+ *                                                                            *
+ ******************************************************************************/
+template <GLuint N>
+struct SmallNKernel
+{
+	typedef std::array<glm::vec3, N> Vectors;
+	typedef std::array<GLfloat, N>   Scalars;
+
+	/* Accelerations of every body, including a linear tidal field. */
+	static void accelerations(const Scalars&   gm,
+	                          const Vectors&   x,
+	                          const glm::mat3& tidal,
+	                                Vectors&   a)
+	{
+		for (GLuint i = 0; i < N; i++)
+			a[i] = tidal * x[i];
+		SmallNRow<N, 0>::run(gm, x, a);
+	}
+
+	/* Advance the state by dt; start holds a(x) on entry unless computeStart. */
+	static void rungeKutta(      NBodyState&             state,
+	                       const GLfloat                 dt,
+	                       const glm::mat3&              tidal,
+	                       const bool                    computeStart,
+	                             std::vector<glm::vec3>& start,
+	                             std::vector<glm::vec3>& end)
+	{
+		Scalars gm;
+		Vectors x, v, a, kx, kv, sx, sv;
+		for (GLuint i = 0; i < N; i++)
+		{
+			gm[i] = state.G * state.masses[i];
+			x[i]  = state.positions[i];
+			v[i]  = state.velocities[i];
+		}
+
+		/* Stage 1. */
+		if (computeStart)
+			accelerations(gm, x, tidal, a);
+		else
+			for (GLuint i = 0; i < N; i++)
+				a[i] = start[i];
+		start.resize(N);
+		for (GLuint i = 0; i < N; i++)
+		{
+			start[i] = a[i];
+			kv[i]    = v[i];
+			sx[i]    = v[i];
+			sv[i]    = a[i];
+		}
+
+		/* Stages 2 - 4. */
+		for (GLuint stage = 2; stage <= 4; stage++)
+		{
+			GLfloat c = (stage < 4) ? 0.5f * dt : dt;
+			GLfloat w = (stage < 4) ? 2.0f      : 1.0f;
+
+			for (GLuint i = 0; i < N; i++)
+			{
+				kx[i] = x[i] + c * kv[i];
+				kv[i] = v[i] + c * a[i];
+			}
+			accelerations(gm, kx, tidal, a);
+			for (GLuint i = 0; i < N; i++)
+			{
+				sx[i] += w * kv[i];
+				sv[i] += w * a[i];
+			}
+		}
+
+		/* Combine the stages, and the acceleration at the end. */
+		GLfloat c = dt / 6.0f;
+		for (GLuint i = 0; i < N; i++)
+		{
+			x[i] += c * sx[i];
+			v[i] += c * sv[i];
+		}
+		accelerations(gm, x, tidal, a);
+
+		end.resize(N);
+		for (GLuint i = 0; i < N; i++)
+		{
+			state.positions[i]  = x[i];
+			state.velocities[i] = v[i];
+			end[i]              = a[i];
+		}
+		state.t += dt;
+	}
+};
@@ -0,0 +1,402 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include "SocketTransport.h"
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef int    socklen_t;
+typedef SOCKET NativeSocket;
+#define CLOSE_SOCKET(s) closesocket((NativeSocket) (s))
+#else
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+typedef int    NativeSocket;
+#define CLOSE_SOCKET(s) ::close((NativeSocket) (s))
+#endif
+
+/******************************************************************************
+*                                                                             *
+*                               Local Helpers                                 *
+*                                                                             *
+******************************************************************************/
+/* New TCP socket, or -1. */
+static long long openSocket()
+{
+	NativeSocket s = socket(AF_INET, SOCK_STREAM, 0);
+#ifdef _WIN32
+	if (s == INVALID_SOCKET)
+		return -1;
+#endif
+	return (long long) s;
+}
+
+/* Next connection on a listening socket, or -1. */
+static long long acceptSocket(long long listener)
+{
+	NativeSocket s = accept((NativeSocket) listener, nullptr, nullptr);
+#ifdef _WIN32
+	if (s == INVALID_SOCKET)
+		return -1;
+#endif
+	return (long long) s;
+}
+
+/* Send every byte, however many calls it takes. */
+static bool sendAll(long long socket, const char* data, size_t bytes)
+{
+	while (bytes > 0)
+	{
+		size_t chunk = std::min(bytes, (size_t) 1 << 20);
+		int    sent  = ::send((NativeSocket) socket, data, (int) chunk, 0);
+		if (sent <= 0)
+			return false;
+		data  += sent;
+		bytes -= sent;
+	}
+	return true;
+}
+
+/* Receive exactly the given number of bytes. */
+static bool receiveAll(long long socket, char* data, size_t bytes)
+{
+	while (bytes > 0)
+	{
+		size_t chunk    = std::min(bytes, (size_t) 1 << 20);
+		int    received = ::recv((NativeSocket) socket, data, (int) chunk, 0);
+		if (received <= 0)
+			return false;
+		data  += received;
+		bytes -= received;
+	}
+	return true;
+}
+
+/* Small messages (the control traffic) must not wait for more data. */
+static void setNoDelay(long long socket)
+{
+	int on = 1;
+	setsockopt((NativeSocket) socket, IPPROTO_TCP, TCP_NODELAY,
+	           (const char*) &on, sizeof(on));
+}
+
+/******************************************************************************
+*                                                                             *
+*                 SocketTransport::SocketTransport (Constructor)              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the SocketTransport class. The transport is a run of one   *
+*  until open is called.                                                      *
+*                                                                             *
+*******************************************************************************/
+SocketTransport::SocketTransport() :
+	rank(0), size(1), bytesSent(0), bytesReceived(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                 SocketTransport::~SocketTransport (Destructor)              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Destructor for the SocketTransport class.                                  *
+*                                                                             *
+*******************************************************************************/
+SocketTransport::~SocketTransport()
+{
+	close();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SocketTransport::open                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param rank                                                                *
+*           Rank of this process, from 0 to size - 1.                         *
+*  @param size                                                                *
+*           Number of processes in the run.                                   *
+*  @param host                                                                *
+*           Address of rank 0 (used by the other ranks).                      *
+*  @param port                                                                *
+*           TCP port rank 0 listens on.                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True once every process has joined.                                        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Rank 0 accepts size - 1 connections, each of which starts by naming its    *
+*  rank. The other ranks retry for a while, so the processes may be started   *
+*  in any order.                                                              *
+*                                                                             *
+*******************************************************************************/
+bool SocketTransport::open(GLuint rank, GLuint size, const char* host,
+                           unsigned short port)
+{
+	close();
+	if (size == 0 || rank >= size)
+		return false;
+	this->rank = rank;
+	this->size = size;
+	if (size == 1)
+		return true;
+
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0)
+		return false;
+#endif
+
+	if (rank == 0)
+	{
+		long long listener = openSocket();
+		int       on       = 1;
+		if (listener < 0)
+			return false;
+		setsockopt((NativeSocket) listener, SOL_SOCKET, SO_REUSEADDR, (const char*) &on, sizeof(on));
+
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family      = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_ANY);
+		address.sin_port        = htons(port);
+		if (bind((NativeSocket) listener, (sockaddr*) &address, sizeof(address)) != 0 ||
+		    listen((NativeSocket) listener, size) != 0)
+		{
+			CLOSE_SOCKET(listener);
+			return false;
+		}
+
+		/* Slot each worker by the rank it sends. */
+		peers.assign(size, -1);
+		for (GLuint k = 1; k < size; k++)
+		{
+			long long peer = acceptSocket(listener);
+			GLuint    peerRank;
+			if (peer < 0 || !receiveAll(peer, (char*) &peerRank, sizeof(peerRank)) ||
+			    peerRank == 0 || peerRank >= size || peers[peerRank] >= 0)
+			{
+				if (peer >= 0)
+					CLOSE_SOCKET(peer);
+				CLOSE_SOCKET(listener);
+				close();
+				return false;
+			}
+			setNoDelay(peer);
+			peers[peerRank] = peer;
+		}
+		CLOSE_SOCKET(listener);
+		return true;
+	}
+
+	/* Every other rank connects to rank 0. */
+	addrinfo  hints;
+	addrinfo* found = nullptr;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family   = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	std::string service = std::to_string((unsigned long long) port);
+	if (getaddrinfo(host, service.c_str(), &hints, &found) != 0)
+		return false;
+
+	long long root = -1;
+	for (GLuint attempt = 0; attempt < TRANSPORT_CONNECT_ATTEMPTS && root < 0; attempt++)
+	{
+		root = openSocket();
+		if (root >= 0 &&
+		    connect((NativeSocket) root, found->ai_addr, (socklen_t) found->ai_addrlen) != 0)
+		{
+			CLOSE_SOCKET(root);
+			root = -1;
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(TRANSPORT_CONNECT_DELAY));
+		}
+	}
+	freeaddrinfo(found);
+	if (root < 0)
+		return false;
+
+	setNoDelay(root);
+	if (!sendAll(root, (const char*) &rank, sizeof(rank)))
+	{
+		CLOSE_SOCKET(root);
+		return false;
+	}
+	peers.assign(1, root);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           SocketTransport::close                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Closes every socket. The transport is then a run of one again.             *
+*                                                                             *
+*******************************************************************************/
+void SocketTransport::close()
+{
+	if (peers.empty())
+		return;
+
+	for (long long peer : peers)
+		if (peer >= 0)
+			CLOSE_SOCKET(peer);
+	peers.clear();
+#ifdef _WIN32
+	WSACleanup();
+#endif
+	rank = 0;
+	size = 1;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         SocketTransport::exchange                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param outgoing                                                            *
+*           One buffer for every rank (this rank's own is passed through).    *
+*  @param incoming                                                            *
+*           Output buffer received from every rank.                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if a connection failed, after which the run cannot continue.         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Workers send their size buffers to rank 0 and then read size buffers       *
+*  back. Rank 0 reads the workers in rank order, then sends each worker the   *
+*  buffers addressed to it in rank order. A worker blocked in send while      *
+*  rank 0 reads another simply waits its turn.                                *
+*                                                                             *
+*******************************************************************************/
+bool SocketTransport::exchange(const std::vector<std::vector<char> >& outgoing,
+                                     std::vector<std::vector<char> >& incoming)
+{
+	if (outgoing.size() != size)
+		return false;
+	incoming.resize(size);
+
+	if (size == 1)
+	{
+		incoming[0] = outgoing[0];
+		return true;
+	}
+
+	if (rank != 0)
+	{
+		for (GLuint r = 0; r < size; r++)
+			if (!send(peers[0], outgoing[r]))
+				return false;
+		for (GLuint r = 0; r < size; r++)
+			if (!receive(peers[0], incoming[r]))
+				return false;
+		return true;
+	}
+
+	/* routed[w][r] is the buffer from worker w to rank r. */
+	std::vector<std::vector<std::vector<char> > > routed(size);
+	for (GLuint w = 1; w < size; w++)
+	{
+		routed[w].resize(size);
+		for (GLuint r = 0; r < size; r++)
+			if (!receive(peers[w], routed[w][r]))
+				return false;
+	}
+
+	for (GLuint w = 1; w < size; w++)
+		for (GLuint r = 0; r < size; r++)
+			if (!send(peers[w], (r == 0) ? outgoing[w] : routed[r][w]))
+				return false;
+
+	incoming[0] = outgoing[0];
+	for (GLuint w = 1; w < size; w++)
+		incoming[w].swap(routed[w][0]);
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                      SocketTransport::send / receive                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param socket                                                              *
+*           The connection to use.                                            *
+*  @param data                                                                *
+*           The message to send, or the output message received.              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the connection failed.                                            *
+*                                                                             *
+*******************************************************************************/
+bool SocketTransport::send(long long socket, const std::vector<char>& data)
+{
+	GLuint length = data.size();
+	if (!sendAll(socket, (const char*) &length, sizeof(length)) ||
+	    !sendAll(socket, data.data(), length))
+		return false;
+
+	bytesSent += sizeof(length) + length;
+	return true;
+}
+
+bool SocketTransport::receive(long long socket, std::vector<char>& data)
+{
+	GLuint length;
+	if (!receiveAll(socket, (char*) &length, sizeof(length)))
+		return false;
+
+	data.resize(length);
+	if (!receiveAll(socket, data.data(), length))
+		return false;
+
+	bytesReceived += sizeof(length) + length;
+	return true;
+}
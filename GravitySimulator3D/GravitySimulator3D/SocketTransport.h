@@ -0,0 +1,122 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default TCP port of rank 0. */
+#define   TRANSPORT_PORT                   47533
+/* Attempts, and milliseconds between them, to reach rank 0. */
+#define   TRANSPORT_CONNECT_ATTEMPTS         200
+#define   TRANSPORT_CONNECT_DELAY             50
+
+/******************************************************************************
+ *																			  *
+ *                              Transport Class                               *
+ *																			  *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Interface for the communication between the processes of a distributed    *
+ *  run. The only operation is a personalized all-to-all exchange, which      *
+ *  every process must enter together; an all-gather or a broadcast is an     *
+ *  exchange in which the same (or an empty) buffer goes to every rank. Any   *
+ *  message passing layer (sockets, MPI) can stand behind it.                 *
+ *                                                                            *
+ ******************************************************************************/
+class Transport
+{
+/* Public Members. */
+public:
+
+	/* Send outgoing[r] to every rank r, and receive incoming[r] from each. */
+	virtual bool   exchange(const std::vector<std::vector<char> >& outgoing,
+	                              std::vector<std::vector<char> >& incoming) = 0;
+
+	/* Rank of this process, and number of processes. */
+	virtual GLuint getRank() const = 0;
+	virtual GLuint getSize() const = 0;
+
+	/* Destructor. */
+	virtual       ~Transport()                    {                          }
+};
+
+/******************************************************************************
+ *																			  *
+ *                           SocketTransport Class                            *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  rank, size                                                                *
+ *          Rank of this process, and number of processes.                    *
+ *  peers                                                                     *
+ *          Socket to each worker (rank 0), or to rank 0 (every other rank).  *
+ *  bytesSent, bytesReceived                                                  *
+ *          Traffic of this process so far.                                   *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Transport over TCP in a star: rank 0 listens and every other rank         *
+ *  connects to it, so the processes may run on one machine or on several.    *
+ *  In an exchange each worker sends all of its buffers to rank 0, which      *
+ *  routes them on to their destinations. Every message is a 32 bit length    *
+ *  followed by the bytes.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+class SocketTransport : public Transport
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   SocketTransport ();
+
+	/* Join a run of size processes as the given rank. */
+	bool               open            (GLuint         rank,
+	                                    GLuint         size,
+	                                    const char*    host = "127.0.0.1",
+	                                    unsigned short port = TRANSPORT_PORT);
+	/* Leave the run. */
+	void               close           ();
+
+	/* Send outgoing[r] to every rank r, and receive incoming[r] from each. */
+	virtual bool       exchange        (const std::vector<std::vector<char> >& outgoing,
+	                                          std::vector<std::vector<char> >& incoming);
+
+	/* Getters. */
+	virtual GLuint     getRank()           const  {  return rank;            }
+	virtual GLuint     getSize()           const  {  return size;            }
+	bool               isOpen()            const  {  return !peers.empty() || size == 1; }
+	unsigned long long getBytesSent()      const  {  return bytesSent;       }
+	unsigned long long getBytesReceived()  const  {  return bytesReceived;   }
+
+	/* Destructor (closes the sockets). */
+	virtual           ~SocketTransport ();
+
+/* Private Members. */
+private:
+
+	/* Run layout. */
+	GLuint             rank;
+	GLuint             size;
+	std::vector<long long> peers;
+	/* Statistics. */
+	unsigned long long bytesSent;
+	unsigned long long bytesReceived;
+
+	/* Send, or receive, one length-prefixed message. */
+	bool               send            (long long socket, const std::vector<char>& data);
+	bool               receive         (long long socket,       std::vector<char>& data);
+
+	/* Not copyable (the sockets are owned). */
+	                   SocketTransport (const SocketTransport&);
+	SocketTransport&   operator=       (const SocketTransport&);
+};
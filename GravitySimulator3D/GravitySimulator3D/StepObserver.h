@@ -0,0 +1,56 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+
+/******************************************************************************
+*                                                                             *
+*                              Forward Declarations                           *
+*                                                                             *
+******************************************************************************/
+class OrbitalSystem;
+
+/******************************************************************************
+ *																			  *
+ *                             StepObserver Class                             *
+ *																			  *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Interface for any component which needs to inspect the orbital system     *
+ *  after every integrator step (event detection, analytics, recording).      *
+ *  Observers are registered with OrbitalSystem::addObserver and are called   *
+ *  once the step has completed, while the dense output of that step is       *
+ *  still available through OrbitalSystem::stateAt.                           *
+ *                                                                            *
+ *  Observers which keep anything by body index are also told when the        *
+ *  system rearranges its bodies, with the old index of the body now at each  *
+ *  index (order[new] = old), and should rearrange their own records to       *
+ *  match. This happens between steps, even while the observers are not       *
+ *  being notified of the steps themselves. Likewise they are told before a   *
+ *  body is removed, after which the last body takes the removed one's index. *
+ *                                                                            *
+ ******************************************************************************/
+class StepObserver
+{
+/* Public Members. */
+public:
+
+	/* Called by the system once each integrator step has completed. */
+	virtual void   onStep(OrbitalSystem& system) = 0;
+
+	/* Called by the system after it has rearranged its bodies. */
+	virtual void   onReorder(OrbitalSystem&,
+	                         const std::vector<GLuint>&)        {            }
+
+	/* Called by the system just before it removes the body at index i. */
+	virtual void   onRemove(OrbitalSystem&,
+	                        GLuint)                             {            }
+
+	/* Destructor. */
+	virtual       ~StepObserver()                 {                          }
+};
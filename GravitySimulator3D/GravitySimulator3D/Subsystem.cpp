@@ -0,0 +1,407 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include "Subsystem.h"
+
+/******************************************************************************
+*                                                                             *
+*                       Subsystem::Subsystem (Constructor)                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param name                                                                *
+*           Name of the subsystem.                                            *
+*  @param maxStep                                                             *
+*           SECONDS                                                           *
+*           Largest step taken by the internal integrator.                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the Subsystem class. The subsystem starts empty.           *
+*                                                                             *
+*******************************************************************************/
+Subsystem::Subsystem(const std::string& name, GLfloat maxStep) :
+	name(name), maxStep(maxStep), captured(false), mass(0),
+	centerPosition(0), centerVelocity(0), regularized(false), perturbation(0)
+{
+	/* Empty. */
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Subsystem::addMember                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param i                                                                   *
+*           Index of the body in the owning system.                           *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Adds the body to the group. The local frame is rebuilt before the next     *
+*  step.                                                                      *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::addMember(GLuint i)
+{
+	if (contains(i))
+		return;
+
+	members.push_back(i);
+	captured = false;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          Subsystem::removeMember                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param i                                                                   *
+*           Index of the body being removed from the owning system.           *
+*  @param last                                                                *
+*           Index of the owning system's last body, which moves to index i.   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Drops the body if it is a member, and renames the last body of the owning  *
+*  system if it is a member. The other members keep their order, so only a    *
+*  removal needs a new capture.                                               *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::removeMember(GLuint i, GLuint last)
+{
+	std::vector<GLuint>::iterator found = std::find(members.begin(),
+	                                                members.end(), i);
+	if (found != members.end())
+	{
+		members.erase(found);
+		captured = false;
+	}
+
+	for (GLuint& m : members)
+		if (m == last)
+			m = i;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          Subsystem::remapMembers                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param newIndex                                                            *
+*           New index in the owning system of the body at each old index.     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Only the indices change: the members keep their order, so the local frame  *
+*  stays valid and no new capture is needed.                                  *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::remapMembers(const std::vector<GLuint>& newIndex)
+{
+	for (GLuint& m : members)
+		m = newIndex[m];
+}
+
+/******************************************************************************
+*                                                                             *
+*                            Subsystem::contains                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param i                                                                   *
+*           Index of a body in the owning system.                             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the body is a member.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Linear search of the members (subsystems are small).                       *
+*                                                                             *
+*******************************************************************************/
+bool Subsystem::contains(GLuint i) const
+{
+	return std::find(members.begin(), members.end(), i) != members.end();
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Subsystem::capture                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param world                                                               *
+*           World space state of every body of the owning system.             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Computes the total mass and the center of mass, and stores every member    *
+*  relative to it.                                                            *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::capture(const NBodyState& world)
+{
+	GLuint n = members.size();
+
+	mass           = 0;
+	centerPosition = glm::vec3(0);
+	centerVelocity = glm::vec3(0);
+	for (GLuint k = 0; k < n; k++)
+	{
+		GLfloat m       = world.masses[members[k]];
+		mass           += m;
+		centerPosition += m * world.positions[members[k]];
+		centerVelocity += m * world.velocities[members[k]];
+	}
+	if (mass > 0)
+	{
+		centerPosition /= mass;
+		centerVelocity /= mass;
+	}
+
+	local.positions.resize(n);
+	local.velocities.resize(n);
+	local.masses.resize(n);
+	for (GLuint k = 0; k < n; k++)
+	{
+		local.positions[k]  = world.positions[members[k]]  - centerPosition;
+		local.velocities[k] = world.velocities[members[k]] - centerVelocity;
+		local.masses[k]     = world.masses[members[k]];
+	}
+	local.G = world.G;
+	local.t = world.t;
+
+	/* Accelerations at the captured state, before any step is taken. */
+	integrator.setTidalTensor(glm::mat3(0.0f));
+	integrator.accelerations(local, local.positions, startAccel);
+	endAccel = startAccel;
+
+	captured = true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                            Subsystem::setCenter                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param position, velocity                                                  *
+*           World space state of the center of mass.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Moves the local frame to where the outer integrator took the composite.    *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::setCenter(const glm::vec3& position, const glm::vec3& velocity)
+{
+	centerPosition = position;
+	centerVelocity = velocity;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Subsystem::advance                              *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the outer step.                                         *
+*  @param tidalStart, tidalEnd                                                *
+*           Tidal tensor of the rest of the system at the start and end of    *
+*           the outer step.                                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Covers the outer step with equal internal steps no longer than maxStep.    *
+*  Each internal step uses the tidal tensor interpolated to its midpoint.     *
+*  Regularized pairs are handed to advancePair instead.                       *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::advance(GLfloat dt, const glm::mat3& tidalStart,
+                        const glm::mat3& tidalEnd)
+{
+	if (regularized && members.size() == 2)
+	{
+		advancePair(dt, tidalStart, tidalEnd);
+		return;
+	}
+
+	GLuint  steps = std::max(1u, (GLuint) ceil(dt / maxStep));
+	GLfloat h     = dt / steps;
+
+	for (GLuint k = 0; k < steps; k++)
+	{
+		GLfloat s = (k + 0.5f) / steps;
+		integrator.setTidalTensor(tidalStart + s * (tidalEnd - tidalStart));
+		integrator.rungeKutta(local, h);
+
+		if (k == 0)
+			startAccel = integrator.getStartAccel();
+	}
+	endAccel = integrator.getEndAccel();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Subsystem::advancePair                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param dt                                                                  *
+*           SECONDS                                                           *
+*           Length of the outer step.                                         *
+*  @param tidalStart, tidalEnd                                                *
+*           Tidal tensor of the rest of the system at the start and end of    *
+*           the outer step.                                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The relative coordinate r = x1 - x0 feels -mu r / |r|^3 plus tidal * r,    *
+*  which KSIntegrator follows in double precision. The members are placed     *
+*  back about the center of mass in the ratio of their masses, and the        *
+*  accelerations at both ends come from the ordinary integrator so that the   *
+*  dense output is built the same way as for any other subsystem.             *
+*                                                                             *
+*******************************************************************************/
+void Subsystem::advancePair(GLfloat dt, const glm::mat3& tidalStart,
+                            const glm::mat3& tidalEnd)
+{
+	GLdouble   m0 = local.masses[0];
+	GLdouble   m1 = local.masses[1];
+	GLdouble   mu = (GLdouble) local.G * (m0 + m1);
+	glm::dvec3 r(local.positions[1]  - local.positions[0]);
+	glm::dvec3 v(local.velocities[1] - local.velocities[0]);
+
+	integrator.setTidalTensor(tidalStart);
+	integrator.accelerations(local, local.positions, startAccel);
+
+	ks.advance(r, v, mu, dt, tidalStart, tidalEnd);
+
+	/* Split the relative motion about the center of mass. */
+	GLdouble f0 = (m0 + m1 > 0) ? m1 / (m0 + m1) : 0.5;
+	GLdouble f1 = 1.0 - f0;
+	local.positions[0]  = glm::vec3(-f0 * r);
+	local.positions[1]  = glm::vec3( f1 * r);
+	local.velocities[0] = glm::vec3(-f0 * v);
+	local.velocities[1] = glm::vec3( f1 * v);
+	local.t            += dt;
+
+	integrator.setTidalTensor(tidalEnd);
+	integrator.accelerations(local, local.positions, endAccel);
+
+	/* How strongly the rest of the system disturbs the pair. */
+	GLdouble d2  = glm::dot(r, r);
+	perturbation = (mu > 0) ? (GLfloat) (glm::length(glm::dmat3(tidalEnd) * r) * d2 / mu)
+	                        : 0;
+}
+
+/******************************************************************************
+*                                                                             *
+*                             Subsystem::pairTime                             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param r                                                                   *
+*           Separation of the pair.                                           *
+*  @param mu                                                                  *
+*           G times the total mass of the pair.                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  sqrt(r^3 / mu), the time scale of the pair's own motion at that            *
+*  separation (infinite for a massless pair).                                 *
+*                                                                             *
+*******************************************************************************/
+GLfloat Subsystem::pairTime(GLfloat r, GLfloat mu)
+{
+	if (mu <= 0)
+		return std::numeric_limits<GLfloat>::infinity();
+	return (GLfloat) sqrt((GLdouble) r * r * r / mu);
+}
+
+/******************************************************************************
+*                                                                             *
+*                           Subsystem::tidalTensor                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           State of the outer system.                                        *
+*  @param self                                                                *
+*           Index of the entry at which to evaluate the tensor.               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The gradient of the gravitational acceleration at the entry.               *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  For each other mass at offset d = r_self - r_k the gradient is             *
+*  G * m * (3 * d * d^T / |d|^5 - I / |d|^3), so that a body at a small       *
+*  offset x from the entry feels an extra acceleration of T * x relative      *
+*  to it.                                                                     *
+*                                                                             *
+*******************************************************************************/
+glm::mat3 Subsystem::tidalTensor(const NBodyState& state, GLuint self)
+{
+	glm::mat3 tensor(0.0f);
+	for (GLuint k = 0; k < state.positions.size(); k++)
+	{
+		if (k == self || state.masses[k] == 0)
+			continue;
+
+		glm::vec3 d  = state.positions[self] - state.positions[k];
+		GLfloat   r2 = glm::dot(d, d);
+		if (r2 == 0)
+			continue;
+		GLfloat   r  = sqrt(r2);
+		GLfloat   c  = state.G * state.masses[k] / (r2 * r);
+
+		tensor += (3.0f * c / r2) * glm::outerProduct(d, d) - 
+		          c * glm::mat3(1.0f);
+	}
+	return tensor;
+}
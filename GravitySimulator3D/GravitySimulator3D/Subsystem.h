@@ -0,0 +1,169 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <string>
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "NBodyIntegrator.h"
+#include  "KSRegularization.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default largest internal step of a subsystem. */
+#define   DEFAULT_SUBSYSTEM_STEP             10.0f
+
+/******************************************************************************
+ *																			  *
+ *                              Subsystem Class                               *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  name                                                                      *
+ *          Name of the subsystem.                                            *
+ *  maxStep                                                                   *
+ *          SECONDS                                                           *
+ *          Largest step taken by the internal integrator.                    *
+ *  members                                                                   *
+ *          Indices of the member bodies in the owning system.                *
+ *  captured                                                                  *
+ *          False until the local frame has been built from the members'      *
+ *          world state (and again whenever the membership changes).          *
+ *  mass                                                                      *
+ *          KILOGRAMS                                                         *
+ *          Total mass of the members.                                        *
+ *  centerPosition, centerVelocity                                            *
+ *          World space state of the members' center of mass.                 *
+ *  local                                                                     *
+ *          State of every member relative to the center of mass.             *
+ *  integrator                                                                *
+ *          Integrator for the internal motion.                               *
+ *  startAccel, endAccel                                                      *
+ *          Local accelerations (internal gravity plus tides) of every        *
+ *          member at the start and end of the last outer step.               *
+ *  regularized                                                               *
+ *          True if a pair's relative motion is integrated in                 *
+ *          Kustaanheimo-Stiefel coordinates instead of by the integrator.    *
+ *  ks                                                                        *
+ *          Integrator for the relative motion of a regularized pair.         *
+ *  perturbation                                                              *
+ *          Tidal acceleration on a regularized pair relative to its mutual   *
+ *          gravity, at the end of the last outer step.                       *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  A tightly bound group of bodies (a planet and its moons, a multiple star) *
+ *  nested inside an orbital system. The outer system sees the group as a     *
+ *  single point mass at its center of mass and takes its own, long steps.    *
+ *  The members are integrated in the local center of mass frame with short   *
+ *  steps of their own, feeling each other directly and the rest of the       *
+ *  system only through its tidal field: the difference between the outer     *
+ *  gravity at the member and at the center, to first order in the offset.    *
+ *  The tidal tensor is evaluated at both ends of each outer step and         *
+ *  interpolated across the internal steps. Keeping the local state between   *
+ *  steps, rather than re-deriving it from large world coordinates, also      *
+ *  preserves the precision of the internal orbits.                           *
+ *                                                                            *
+ *  A regularized subsystem of exactly two members is a close pair (a tight   *
+ *  binary or an encounter): its relative motion is integrated with           *
+ *  KSIntegrator, whose steps follow the separation through pericenter on     *
+ *  their own, so the pair costs the same however close it comes.             *
+ *                                                                            *
+ ******************************************************************************/
+class Subsystem
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   Subsystem(const std::string& name    = "",
+	                             GLfloat            maxStep = DEFAULT_SUBSYSTEM_STEP);
+
+	/* Add the body at index i of the owning system. */
+	void               addMember    (GLuint i);
+
+	/* Forget the body at index i, whose place the body at last takes. */
+	void               removeMember (GLuint i, GLuint last);
+
+	/* Follow the bodies to their new indices after the system reorders them. */
+	void               remapMembers (const std::vector<GLuint>& newIndex);
+
+	/* Determine whether the body at index i is a member. */
+	bool               contains     (GLuint i)                            const;
+
+	/* Build the local frame from the world state of the whole system. */
+	void               capture      (const NBodyState& world);
+
+	/* Place the center of mass after an outer step. */
+	void               setCenter    (const glm::vec3& position,
+	                                 const glm::vec3& velocity);
+
+	/* Advance the internal motion by dt under a changing tidal field. */
+	void               advance      (GLfloat          dt,
+	                                 const glm::mat3& tidalStart,
+	                                 const glm::mat3& tidalEnd);
+
+	/* Two-body dynamical time of a pair at separation r. */
+	static GLfloat     pairTime     (GLfloat r, GLfloat mu);
+
+	/* Tidal tensor at entry self of a state due to every other entry. */
+	static glm::mat3   tidalTensor  (const NBodyState& state, GLuint self);
+
+	/* Getters. */
+	std::string        getName()           const  {  return name;            }
+	GLfloat            getMaxStep()        const  {  return maxStep;         }
+	bool               isCaptured()        const  {  return captured;        }
+	GLfloat            getMass()           const  {  return mass;            }
+	glm::vec3          getCenterPosition() const  {  return centerPosition;  }
+	glm::vec3          getCenterVelocity() const  {  return centerVelocity;  }
+	const std::vector<GLuint>& getMembers()  const {  return members;         }
+	const NBodyState&  getLocalState()     const  {  return local;           }
+	const std::vector<glm::vec3>& getStartAccel() const
+	                                              {  return startAccel;      }
+	const std::vector<glm::vec3>& getEndAccel()   const
+	                                              {  return endAccel;        }
+	bool               isRegularized()     const  {  return regularized;     }
+	GLfloat            getPerturbation()   const  {  return perturbation;    }
+	KSIntegrator*      getKSIntegrator()          {  return &ks;             }
+
+	/* Setters. */
+	void               setMaxStep(GLfloat s)      {  maxStep = s;            }
+	void               setRegularized(bool r)     {  regularized = r;        }
+
+	/* Destructor. */
+	                  ~Subsystem()                                         {}
+
+/* Private Members. */
+private:
+
+	/* Identification. */
+	std::string            name;
+	GLfloat                maxStep;
+	std::vector<GLuint>    members;
+	bool                   captured;
+	/* Composite point mass. */
+	GLfloat                mass;
+	glm::vec3              centerPosition;
+	glm::vec3              centerVelocity;
+	/* Internal motion in the center of mass frame. */
+	NBodyState             local;
+	NBodyIntegrator        integrator;
+	std::vector<glm::vec3> startAccel;
+	std::vector<glm::vec3> endAccel;
+	/* Regularized pair. */
+	bool                   regularized;
+	KSIntegrator           ks;
+	GLfloat                perturbation;
+
+	/* Advance a regularized pair in KS coordinates. */
+	void               advancePair  (GLfloat          dt,
+	                                 const glm::mat3& tidalStart,
+	                                 const glm::mat3& tidalEnd);
+};
@@ -0,0 +1,99 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <chrono>
+#include <cmath>
+#include "TimeWarpScheduler.h"
+
+/******************************************************************************
+*                                                                             *
+*              TimeWarpScheduler::TimeWarpScheduler (Constructor)             *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system to advance.                                    *
+*  @param maxStep                                                             *
+*           Largest integrator step, in simulation seconds.                   *
+*  @param budgetMillis                                                        *
+*           Wall-clock milliseconds per frame available for physics.          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the TimeWarpScheduler class. The warp starts at 1.         *
+*                                                                             *
+*******************************************************************************/
+TimeWarpScheduler::TimeWarpScheduler(OrbitalSystem* system, GLfloat maxStep,
+                                     GLfloat budgetMillis) :
+	system(system), warp(1), maxStep(maxStep), budgetMillis(budgetMillis),
+	backlog(0), achievedWarp(1), lastSubsteps(0)
+{
+	/* Empty. */
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TimeWarpScheduler::advance                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param realSeconds                                                         *
+*           Wall-clock seconds which have passed since the last call.         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Converts the elapsed real time to simulation time at the requested warp,   *
+*  then takes equal substeps no longer than maxStep until that time is        *
+*  covered or the frame's budget is spent. Time which could not be covered    *
+*  is carried into the next frame, but never more than one frame's worth,     *
+*  so a slow machine falls behind gracefully instead of spiralling.           *
+*                                                                             *
+*******************************************************************************/
+void TimeWarpScheduler::advance(GLfloat realSeconds)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	GLfloat owed   = warp * realSeconds;
+	GLfloat target = backlog + owed;
+	lastSubsteps   = 0;
+
+	if (target <= 0)
+		return;
+
+	/* Split the owed time into equal steps within the accuracy limit. */
+	GLuint  steps = (GLuint) ceil(target / maxStep);
+	GLfloat h     = target / steps;
+
+	/* Take as many steps as the budget allows. */
+	Clock::time_point start = Clock::now();
+	while (lastSubsteps < steps)
+	{
+		system->interpolate(h);
+		lastSubsteps++;
+
+		std::chrono::duration<GLfloat, std::milli> spent = Clock::now() - start;
+		if (spent.count() >= budgetMillis)
+			break;
+	}
+
+	/* Carry at most one frame of unsimulated time. */
+	GLfloat simulated = lastSubsteps * h;
+	backlog = target - simulated;
+	if (backlog > owed)
+		backlog = owed;
+
+	/* Update the measured warp. */
+	if (realSeconds > 0)
+		achievedWarp += WARP_SMOOTHING *
+		                (simulated / realSeconds - achievedWarp);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <GL\glew.h>
+#include  "OrbitalSystem.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default wall-clock budget for physics in each frame. */
+#define   DEFAULT_PHYSICS_BUDGET_MS          8.0f
+/* Smoothing factor applied to the achieved warp measurement. */
+#define   WARP_SMOOTHING                     0.1f
+
+/******************************************************************************
+ *																			  *
+ *                          TimeWarpScheduler Class                           *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  system                                                                    *
+ *          The orbital system being advanced.                                *
+ *  warp                                                                      *
+ *          Requested simulation seconds per real second.                     *
+ *  maxStep                                                                   *
+ *          SECONDS                                                           *
+ *          Largest step the integrator may take while remaining accurate.    *
+ *  budgetMillis                                                              *
+ *          Wall-clock time per frame which may be spent on substeps.         *
+ *  backlog                                                                   *
+ *          SECONDS                                                           *
+ *          Simulation time requested but not yet simulated.                  *
+ *  achievedWarp                                                              *
+ *          Smoothed simulation seconds actually simulated per real second.   *
+ *  lastSubsteps                                                              *
+ *          Number of substeps taken during the last frame.                   *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Decouples the speed of the simulation from the size of the integrator     *
+ *  step. Each frame the requested warp is converted to simulation time,      *
+ *  which is covered with as many steps of at most maxStep as fit in the      *
+ *  frame's budget (the force evaluation inside each step is spread across    *
+ *  the system's worker pool). When the budget runs out, the remainder is     *
+ *  carried for at most one frame and then dropped, and the achieved warp     *
+ *  is reported so the caller can show that the simulation cannot keep up.    *
+ *                                                                            *
+ ******************************************************************************/
+class TimeWarpScheduler
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	               TimeWarpScheduler(OrbitalSystem* system,
+	                                 GLfloat        maxStep      = MAX_DELTA_T,
+	                                 GLfloat        budgetMillis =
+	                                                DEFAULT_PHYSICS_BUDGET_MS);
+
+	/* Advance the system by the simulation time owed for realSeconds. */
+	void           advance(GLfloat realSeconds);
+
+	/* Getters. */
+	GLfloat        getWarp()            const     {  return warp;            }
+	GLfloat        getAchievedWarp()    const     {  return achievedWarp;    }
+	GLfloat        getMaxStep()         const     {  return maxStep;         }
+	GLfloat        getBudget()          const     {  return budgetMillis;    }
+	GLuint         getLastSubsteps()    const     {  return lastSubsteps;    }
+	bool           isKeepingUp()        const
+	               {  return achievedWarp >= (1.0f - WARP_SMOOTHING) * warp;  }
+
+	/* Setters. */
+	void           setWarp(GLfloat w)             {  warp         = w;       }
+	void           setMaxStep(GLfloat s)          {  maxStep      = s;       }
+	void           setBudget(GLfloat b)           {  budgetMillis = b;       }
+
+	/* Destructor. */
+	              ~TimeWarpScheduler()            {                          }
+
+/* Private Members. */
+private:
+
+	/* System being advanced. */
+	OrbitalSystem* system;
+	/* Requested warp factor. */
+	GLfloat        warp;
+	/* Accuracy limit on the step size. */
+	GLfloat        maxStep;
+	/* Wall-clock budget per frame. */
+	GLfloat        budgetMillis;
+	/* Simulation time still owed. */
+	GLfloat        backlog;
+	/* Measured warp factor. */
+	GLfloat        achievedWarp;
+	/* Substeps taken in the last frame. */
+	GLuint         lastSubsteps;
+};
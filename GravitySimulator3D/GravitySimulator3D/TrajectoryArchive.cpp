@@ -0,0 +1,998 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include "TrajectoryArchive.h"
+#include "OrbitalSystem.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+#define   ARCHIVE_MAGIC                   "GSTA"
+#define   INDEX_MAGIC                     "GSTI"
+#define   FOOTER_BYTES                        16
+
+/******************************************************************************
+*                                                                             *
+*                              write / read (helpers)                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Raw binary transfer of a single value, in the byte order of the machine.   *
+*                                                                             *
+*******************************************************************************/
+template <typename T>
+static void write(std::ostream& out, const T& value)
+{
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool read(std::istream& in, T& value)
+{
+	return (bool) in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+/******************************************************************************
+*                                                                             *
+*                              BitWriter (struct)                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Appends bit fields to a byte array, least significant bit first. Rice      *
+*  codes are written as a unary quotient (ones ended by a zero) followed by   *
+*  the low k bits; large quotients escape to the raw 64-bit value.            *
+*                                                                             *
+*******************************************************************************/
+struct BitWriter
+{
+	std::vector<unsigned char> bytes;
+	unsigned long long         bits;
+	GLuint                     count;
+
+	BitWriter() : bits(0), count(0) {}
+
+	/* Append the low n (up to 32) bits of value. */
+	void put(unsigned long long value, GLuint n)
+	{
+		bits  |= (value & ((1ull << n) - 1)) << count;
+		count += n;
+		while (count >= 8)
+		{
+			bytes.push_back((unsigned char) bits);
+			bits  >>= 8;
+			count  -= 8;
+		}
+	}
+
+	/* Append a Rice code with parameter k. */
+	void rice(unsigned long long value, GLuint k)
+	{
+		unsigned long long quotient = value >> k;
+		if (quotient >= RICE_ESCAPE)
+		{
+			put((1ull << RICE_ESCAPE) - 1, RICE_ESCAPE);
+			put(value, 32);
+			put(value >> 32, 32);
+			return;
+		}
+		put((1ull << quotient) - 1, (GLuint) quotient + 1);
+		for (GLuint shift = 0; shift < k; shift += 32)
+			put(value >> shift, std::min(32u, k - shift));
+	}
+
+	/* Pad the last byte with zeros. */
+	void finish()
+	{
+		if (count > 0)
+			bytes.push_back((unsigned char) bits);
+		bits  = 0;
+		count = 0;
+	}
+};
+
+/******************************************************************************
+*                                                                             *
+*                              BitReader (struct)                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads the bit fields appended by a BitWriter. Reading past the end yields  *
+*  zeros and sets the overrun flag.                                           *
+*                                                                             *
+*******************************************************************************/
+struct BitReader
+{
+	const unsigned char* data;
+	size_t               size;
+	size_t               next;
+	unsigned long long   bits;
+	GLuint               count;
+	bool                 overrun;
+
+	BitReader(const unsigned char* data, size_t size) :
+		data(data), size(size), next(0), bits(0), count(0), overrun(false) {}
+
+	/* Read n (up to 32) bits. */
+	unsigned long long get(GLuint n)
+	{
+		while (count < n)
+		{
+			if (next < size)
+				bits |= (unsigned long long) data[next++] << count;
+			else
+				overrun = true;
+			count += 8;
+		}
+		unsigned long long value = bits & ((1ull << n) - 1);
+		bits  >>= n;
+		count  -= n;
+		return value;
+	}
+
+	/* Read a Rice code with parameter k. */
+	unsigned long long rice(GLuint k)
+	{
+		unsigned long long quotient = 0;
+		while (quotient < RICE_ESCAPE && get(1) == 1)
+			quotient++;
+		if (quotient == RICE_ESCAPE)
+		{
+			unsigned long long low = get(32);
+			return low | (get(32) << 32);
+		}
+		unsigned long long value = 0;
+		for (GLuint shift = 0; shift < k; shift += 32)
+			value |= get(std::min(32u, k - shift)) << shift;
+		return (quotient << k) | value;
+	}
+};
+
+/******************************************************************************
+*                                                                             *
+*                                   predict                                   *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param position, velocity                                                  *
+*           Reconstructed state of the previous frame.                        *
+*  @param before                                                              *
+*           Reconstructed velocities of the frame before that (or null).      *
+*  @param dt, dtBefore                                                        *
+*           Time since the previous frame, and between the two before it.     *
+*  @param predictedPosition, predictedVelocity                                *
+*           Output predictions.                                               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constant acceleration extrapolation, with the acceleration estimated from  *
+*  the last two velocities. The writer and the reader both call this on the   *
+*  same reconstructed values, so they make exactly the same predictions.      *
+*                                                                             *
+*******************************************************************************/
+static void predict(const std::vector<GLdouble>& position,
+                    const std::vector<GLdouble>& velocity,
+                    const std::vector<GLdouble>* before,
+                    GLdouble dt, GLdouble dtBefore,
+                    std::vector<GLdouble>& predictedPosition,
+                    std::vector<GLdouble>& predictedVelocity)
+{
+	GLuint n = position.size();
+	bool   accel = (before != nullptr && dtBefore > 0);
+
+	for (GLuint c = 0; c < n; c++)
+	{
+		GLdouble a = accel ? (velocity[c] - (*before)[c]) / dtBefore : 0.0;
+		predictedPosition[c] = position[c] + dt * (velocity[c] + 0.5 * dt * a);
+		predictedVelocity[c] = velocity[c] + dt * a;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                           floatKey / keyFloat (helpers)                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Maps the bits of a float to an unsigned key in the same order as the       *
+*  values, and back. Neighbouring floats get neighbouring keys, so the key    *
+*  difference between a value and its prediction is a small integer.         *
+*                                                                             *
+*******************************************************************************/
+static GLuint floatKey(GLfloat value)
+{
+	GLuint bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+static GLfloat keyFloat(GLuint key)
+{
+	GLuint  bits = (key & 0x80000000u) ? (key & 0x7fffffffu) : ~key;
+	GLfloat value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          quantize / dequantize (helpers)                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param value                                                               *
+*           Stored value (a float).                                           *
+*  @param predicted                                                           *
+*           Prediction of the value made from the reconstructed frames.       *
+*  @param step                                                                *
+*           Quantization step, twice the tolerance; zero or less stores the   *
+*           value exactly.                                                    *
+*  @param reconstructed                                                       *
+*           Output value the reader will decode.                              *
+*  @param q                                                                   *
+*           Residual code.                                                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The residual code, or the decoded value.                                   *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  With a positive step the residual is rounded to a multiple of the step.    *
+*  Otherwise it is the distance in floats between the value and the float     *
+*  nearest the prediction, which the reader undoes exactly.                   *
+*                                                                             *
+*******************************************************************************/
+static long long quantize(GLdouble value, GLdouble predicted, GLdouble step,
+                          GLdouble& reconstructed)
+{
+	if (step > 0)
+	{
+		long long q   = llround((value - predicted) / step);
+		reconstructed = predicted + q * step;
+		return q;
+	}
+	reconstructed = (GLfloat) value;
+	return (long long) floatKey((GLfloat) value) - 
+	       (long long) floatKey((GLfloat) predicted);
+}
+
+static GLdouble dequantize(long long q, GLdouble predicted, GLdouble step)
+{
+	if (step > 0)
+		return predicted + q * step;
+	return keyFloat((GLuint) (floatKey((GLfloat) predicted) + q));
+}
+
+/******************************************************************************
+*                                                                             *
+*                                 riceParameter                               *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param values                                                              *
+*           Unsigned (zigzag) residuals of one channel of a block.            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The Rice parameter k, about log2 of the mean value.                        *
+*                                                                             *
+*******************************************************************************/
+static GLuint riceParameter(const std::vector<unsigned long long>& values)
+{
+	if (values.empty())
+		return 0;
+
+	GLdouble mean = 0;
+	for (unsigned long long v : values)
+		mean += (GLdouble) v;
+	mean /= values.size();
+
+	GLuint k = 0;
+	while (k < 62 && (GLdouble) (1ull << (k + 1)) <= mean)
+		k++;
+	return k;
+}
+
+/******************************************************************************
+*                                                                             *
+*                  TrajectoryWriter::TrajectoryWriter (Constructor)           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the archive to create.                                    *
+*  @param positionTolerance                                                   *
+*           METERS                                                            *
+*           Largest error allowed in any stored position coordinate. Zero     *
+*           stores every position exactly.                                    *
+*  @param velocityTolerance                                                   *
+*           METERS / SECOND                                                   *
+*           Largest error allowed in any stored velocity coordinate. Zero     *
+*           stores every velocity exactly.                                    *
+*  @param blockFrames                                                         *
+*           Number of frames per independently decodable block.               *
+*  @param interval                                                            *
+*           Number of steps between recorded frames.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the TrajectoryWriter class.                                *
+*                                                                             *
+*******************************************************************************/
+TrajectoryWriter::TrajectoryWriter(const char* file, GLdouble positionTolerance,
+                                   GLdouble velocityTolerance,
+                                   GLuint blockFrames, GLuint interval) :
+	out(file, std::ios::binary), positionTolerance(positionTolerance),
+	velocityTolerance(velocityTolerance), blockFrames(std::max(1u, blockFrames)),
+	interval(std::max(1u, interval)), steps(0), numBodies(0), frames(0)
+{
+}
+
+/******************************************************************************
+*                                                                             *
+*                  TrajectoryWriter::~TrajectoryWriter (Destructor)           *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Completes the archive if close was not called.                             *
+*                                                                             *
+*******************************************************************************/
+TrajectoryWriter::~TrajectoryWriter()
+{
+	if (out.is_open())
+		close();
+}
+
+/******************************************************************************
+*                                                                             *
+*                          TrajectoryWriter::onStep                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has just completed a step.               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Records the state of the system every interval steps, with the recorded    *
+*  bodies picked out of the system in their first order.                      *
+*                                                                             *
+*******************************************************************************/
+void TrajectoryWriter::onStep(OrbitalSystem& system)
+{
+	if (++steps % interval != 0)
+		return;
+
+	NBodyState state;
+	system.gatherState(state);
+	bool started = frames > 0 || !pending.empty();
+	if (started && state.positions.size() != numBodies)
+		trackBodies(numBodies);
+	if (!bodyOrder.empty())
+	{
+		NBodyState frame;
+		GLuint     n = bodyOrder.size();
+		frame.G = state.G;
+		frame.t = state.t;
+		frame.positions.resize(n);
+		frame.velocities.resize(n);
+		frame.masses.resize(n);
+		for (GLuint k = 0; k < n; k++)
+		{
+			GLuint            i      = bodyOrder[k];
+			const NBodyState& source = (i != NO_BODY) ? state : lastFrame;
+			GLuint            j      = (i != NO_BODY) ? i : k;
+			frame.positions[k]  = source.positions[j];
+			frame.velocities[k] = source.velocities[j];
+			frame.masses[k]     = source.masses[j];
+		}
+		state.positions.swap(frame.positions);
+		state.velocities.swap(frame.velocities);
+		state.masses.swap(frame.masses);
+	}
+	if (addFrame(state))
+		lastFrame = state;
+}
+
+/******************************************************************************
+*                                                                             *
+*                        TrajectoryWriter::onReorder                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which has rearranged its bodies.               *
+*  @param order                                                               *
+*           Old index of the body now at each index.                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The archive keeps the order of the first frame for its whole length, so    *
+*  the writer tracks where each recorded body has moved to in the system.     *
+*                                                                             *
+*******************************************************************************/
+void TrajectoryWriter::onReorder(OrbitalSystem&,
+                                 const std::vector<GLuint>& order)
+{
+	GLuint n = order.size();
+	trackBodies(n);
+
+	std::vector<GLuint> newIndex(n);
+	for (GLuint i = 0; i < n; i++)
+		newIndex[order[i]] = i;
+	for (GLuint& i : bodyOrder)
+		if (i != NO_BODY)
+			i = newIndex[i];
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectoryWriter::onRemove                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param system                                                              *
+*           The orbital system which is removing a body.                      *
+*  @param i                                                                   *
+*           Index of the body being removed.                                  *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The removed body is no longer followed, and the last body, which takes     *
+*  its index, is followed to its new one.                                     *
+*                                                                             *
+*******************************************************************************/
+void TrajectoryWriter::onRemove(OrbitalSystem& system, GLuint i)
+{
+	GLuint last = system.getNumBodies() - 1;
+	trackBodies(last + 1);
+
+	/* Before the first frame the body is simply not recorded. */
+	if (frames == 0 && pending.empty())
+		bodyOrder.erase(std::remove(bodyOrder.begin(), bodyOrder.end(), i),
+		                bodyOrder.end());
+	for (GLuint& b : bodyOrder)
+	{
+		if (b == i)
+			b = NO_BODY;
+		else if (b == last)
+			b = i;
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                        TrajectoryWriter::trackBodies                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param n                                                                   *
+*           Number of bodies in the system.                                   *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Until the bodies first change, the recorded bodies are the system's first  *
+*  bodies in order: all of them before the first frame, or as many as the     *
+*  first frame held after it (any beyond were added since).                   *
+*                                                                             *
+*******************************************************************************/
+void TrajectoryWriter::trackBodies(GLuint n)
+{
+	if (!bodyOrder.empty())
+		return;
+
+	GLuint count = (frames > 0 || !pending.empty()) ? numBodies : n;
+	bodyOrder.resize(count);
+	for (GLuint k = 0; k < count; k++)
+		bodyOrder[k] = k;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectoryWriter::addFrame                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param state                                                               *
+*           The state to record.                                              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  False if the archive is closed or the number of bodies has changed.        *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The first frame fixes the bodies and writes the header. Frames are held    *
+*  until a block is full, and then encoded together.                          *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryWriter::addFrame(const NBodyState& state)
+{
+	if (!out.is_open())
+		return false;
+
+	/* Header: magic, version, bodies, G, tolerances and masses. */
+	if (frames == 0 && pending.empty())
+	{
+		numBodies = state.positions.size();
+		out.write(ARCHIVE_MAGIC, 4);
+		write(out, (GLuint) ARCHIVE_VERSION);
+		write(out, numBodies);
+		write(out, state.G);
+		write(out, positionTolerance);
+		write(out, velocityTolerance);
+		for (GLuint i = 0; i < numBodies; i++)
+			write(out, state.masses[i]);
+	}
+	else if (state.positions.size() != numBodies)
+		return false;
+
+	pending.push_back(state);
+	if (pending.size() >= blockFrames)
+		return flush();
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           TrajectoryWriter::flush                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the block was written.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Block layout: frame count, Rice parameters for positions and velocities,   *
+*  payload size, the time of every frame, the first frame as raw floats and   *
+*  then the bit stream of residuals, frame by frame and body by body.         *
+*  The residuals are quantized in a first pass so that each parameter can     *
+*  be fitted to the block before coding.                                      *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryWriter::flush()
+{
+	if (pending.empty())
+		return true;
+
+	GLuint   count = pending.size();
+	GLuint   n     = 3 * numBodies;
+	GLdouble stepP = 2 * positionTolerance;
+	GLdouble stepV = 2 * velocityTolerance;
+
+	/* Reconstructed state of the last two frames, and the predictions. */
+	std::vector<GLdouble> position(n), velocity(n), before(n);
+	std::vector<GLdouble> predictedPosition(n), predictedVelocity(n);
+	for (GLuint c = 0; c < n; c++)
+	{
+		position[c] = pending[0].positions[c / 3][c % 3];
+		velocity[c] = pending[0].velocities[c / 3][c % 3];
+	}
+
+	/* Quantize the residuals of every later frame. */
+	std::vector<unsigned long long> codesP, codesV;
+	codesP.reserve((count - 1) * n);
+	codesV.reserve((count - 1) * n);
+	for (GLuint k = 1; k < count; k++)
+	{
+		GLdouble dt       = (GLdouble) pending[k].t - pending[k - 1].t;
+		GLdouble dtBefore = (k >= 2) ? (GLdouble) pending[k - 1].t - pending[k - 2].t : 0.0;
+		predict(position, velocity, (k >= 2) ? &before : nullptr, dt, dtBefore,
+		        predictedPosition, predictedVelocity);
+		before = velocity;
+
+		for (GLuint c = 0; c < n; c++)
+		{
+			GLdouble p = pending[k].positions[c / 3][c % 3];
+			GLdouble v = pending[k].velocities[c / 3][c % 3];
+
+			/* Quantize, exactly when the tolerance is zero. */
+			long long qp = quantize(p, predictedPosition[c], stepP, position[c]);
+			long long qv = quantize(v, predictedVelocity[c], stepV, velocity[c]);
+
+			/* Zigzag: 0, -1, 1, -2, ... become 0, 1, 2, 3, ... */
+			codesP.push_back(((unsigned long long) qp << 1) ^ (unsigned long long) (qp >> 63));
+			codesV.push_back(((unsigned long long) qv << 1) ^ (unsigned long long) (qv >> 63));
+		}
+	}
+
+	/* Rice code the residuals. */
+	GLuint    kP = riceParameter(codesP);
+	GLuint    kV = riceParameter(codesV);
+	BitWriter bits;
+	for (GLuint k = 0; k + 1 < count; k++)
+	{
+		for (GLuint c = 0; c < n; c++)
+			bits.rice(codesP[k * n + c], kP);
+		for (GLuint c = 0; c < n; c++)
+			bits.rice(codesV[k * n + c], kV);
+	}
+	bits.finish();
+
+	/* Index entry. */
+	ArchiveBlock block;
+	block.offset     = (unsigned long long) out.tellp();
+	block.firstFrame = frames;
+	block.frames     = count;
+	block.startTime  = pending[0].t;
+	index.push_back(block);
+
+	/* Block. */
+	write(out, count);
+	write(out, (unsigned char) kP);
+	write(out, (unsigned char) kV);
+	write(out, (unsigned short) 0);
+	write(out, (GLuint) bits.bytes.size());
+	for (GLuint k = 0; k < count; k++)
+		write(out, pending[k].t);
+	for (GLuint i = 0; i < numBodies; i++)
+		write(out, pending[0].positions[i]);
+	for (GLuint i = 0; i < numBodies; i++)
+		write(out, pending[0].velocities[i]);
+	if (!bits.bytes.empty())
+		out.write(reinterpret_cast<const char*>(&bits.bytes[0]), bits.bytes.size());
+
+	frames += count;
+	pending.clear();
+	return out.good();
+}
+
+/******************************************************************************
+*                                                                             *
+*                           TrajectoryWriter::close                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the archive was completed.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Writes any partial block, then the index (offset, first frame, frames and  *
+*  start time of every block) and a fixed-size footer pointing to it.         *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryWriter::close()
+{
+	if (!out.is_open())
+		return false;
+
+	/* An empty archive still gets a header. */
+	if (frames == 0 && pending.empty())
+	{
+		NBodyState empty;
+		empty.G = 0;
+		empty.t = 0;
+		addFrame(empty);
+		pending.clear();
+	}
+
+	bool ok = flush();
+
+	unsigned long long indexOffset = (unsigned long long) out.tellp();
+	for (const ArchiveBlock& b : index)
+	{
+		write(out, b.offset);
+		write(out, b.firstFrame);
+		write(out, b.frames);
+		write(out, b.startTime);
+	}
+	write(out, indexOffset);
+	write(out, (GLuint) index.size());
+	out.write(INDEX_MAGIC, 4);
+
+	ok = ok && out.good();
+	out.close();
+	return ok;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           TrajectoryReader::open                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the archive.                                              *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the header and index were read.                                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Reads the header from the start of the file and the index through the      *
+*  footer at its end. No frames are decoded.                                  *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryReader::open(const char* file)
+{
+	std::ifstream in(file, std::ios::binary);
+	if (!in)
+		return false;
+
+	this->file  = file;
+	cachedBlock = -1;
+	cache.clear();
+	masses.clear();
+	index.clear();
+
+	/* Header. */
+	char   magic[4];
+	GLuint version, n;
+	if (!in.read(magic, 4) || memcmp(magic, ARCHIVE_MAGIC, 4) != 0 ||
+	    !read(in, version) || version != ARCHIVE_VERSION || !read(in, n) ||
+	    !read(in, G) || !read(in, positionTolerance) ||
+	    !read(in, velocityTolerance))
+		return false;
+	masses.resize(n);
+	for (GLuint i = 0; i < n; i++)
+		if (!read(in, masses[i]))
+			return false;
+
+	/* Footer, then the index. */
+	unsigned long long indexOffset;
+	GLuint             blocks;
+	in.seekg(-FOOTER_BYTES, std::ios::end);
+	if (!read(in, indexOffset) || !read(in, blocks) || !in.read(magic, 4) ||
+	    memcmp(magic, INDEX_MAGIC, 4) != 0)
+		return false;
+
+	in.seekg(indexOffset);
+	index.resize(blocks);
+	for (ArchiveBlock& b : index)
+		if (!read(in, b.offset) || !read(in, b.firstFrame) ||
+		    !read(in, b.frames) || !read(in, b.startTime))
+			return false;
+
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectoryReader::readBlock                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param block                                                               *
+*           Index of the block.                                               *
+*  @param out                                                                 *
+*           Output frames of the block.                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the block was decoded.                                             *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Opens its own stream, so several blocks may be decoded at once, and        *
+*  repeats the writer's predictions on the reconstructed values.              *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryReader::readBlock(GLuint block, std::vector<NBodyState>& out) const
+{
+	if (block >= index.size())
+		return false;
+
+	std::ifstream in(file.c_str(), std::ios::binary);
+	in.seekg(index[block].offset);
+
+	GLuint         count, payload;
+	unsigned char  kP, kV;
+	unsigned short pad;
+	if (!read(in, count) || !read(in, kP) || !read(in, kV) || !read(in, pad) ||
+	    !read(in, payload))
+		return false;
+
+	GLuint nb = masses.size();
+	GLuint n  = 3 * nb;
+	out.resize(count);
+	for (GLuint k = 0; k < count; k++)
+	{
+		out[k].G = G;
+		out[k].masses = masses;
+		out[k].positions.resize(nb);
+		out[k].velocities.resize(nb);
+		if (!read(in, out[k].t))
+			return false;
+	}
+	for (GLuint i = 0; i < nb; i++)
+		if (!read(in, out[0].positions[i]))
+			return false;
+	for (GLuint i = 0; i < nb; i++)
+		if (!read(in, out[0].velocities[i]))
+			return false;
+
+	std::vector<unsigned char> bytes(payload);
+	if (payload > 0 && !in.read(reinterpret_cast<char*>(&bytes[0]), payload))
+		return false;
+
+	GLdouble stepP = 2 * positionTolerance;
+	GLdouble stepV = 2 * velocityTolerance;
+	std::vector<GLdouble> position(n), velocity(n), before(n);
+	std::vector<GLdouble> predictedPosition(n), predictedVelocity(n);
+	for (GLuint c = 0; c < n; c++)
+	{
+		position[c] = out[0].positions[c / 3][c % 3];
+		velocity[c] = out[0].velocities[c / 3][c % 3];
+	}
+
+	BitReader bits(bytes.empty() ? nullptr : &bytes[0], bytes.size());
+	for (GLuint k = 1; k < count; k++)
+	{
+		GLdouble dt       = (GLdouble) out[k].t - out[k - 1].t;
+		GLdouble dtBefore = (k >= 2) ? (GLdouble) out[k - 1].t - out[k - 2].t : 0.0;
+		predict(position, velocity, (k >= 2) ? &before : nullptr, dt, dtBefore,
+		        predictedPosition, predictedVelocity);
+		before = velocity;
+
+		for (GLuint c = 0; c < n; c++)
+		{
+			unsigned long long z = bits.rice(kP);
+			long long          q = (long long) (z >> 1) ^ -(long long) (z & 1);
+			position[c] = dequantize(q, predictedPosition[c], stepP);
+		}
+		for (GLuint c = 0; c < n; c++)
+		{
+			unsigned long long z = bits.rice(kV);
+			long long          q = (long long) (z >> 1) ^ -(long long) (z & 1);
+			velocity[c] = dequantize(q, predictedVelocity[c], stepV);
+		}
+
+		for (GLuint c = 0; c < n; c++)
+		{
+			out[k].positions[c / 3][c % 3]  = (GLfloat) position[c];
+			out[k].velocities[c / 3][c % 3] = (GLfloat) velocity[c];
+		}
+	}
+
+	return !bits.overrun;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectoryReader::readFrame                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param frame                                                               *
+*           Index of the frame.                                               *
+*  @param out                                                                 *
+*           Output state.                                                     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the frame exists and was decoded.                                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Finds the block holding the frame by binary search of the index, and       *
+*  keeps the decoded block so that neighbouring frames are free.              *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryReader::readFrame(GLuint frame, NBodyState& out)
+{
+	if (frame >= getNumFrames())
+		return false;
+
+	GLint block = (GLint) (std::upper_bound(index.begin(), index.end(), frame,
+	                       [](GLuint f, const ArchiveBlock& b)
+	                       { return f < b.firstFrame; }) - index.begin()) - 1;
+
+	if (block != cachedBlock)
+	{
+		cachedBlock = -1;
+		if (!readBlock(block, cache))
+			return false;
+		cachedBlock = block;
+	}
+
+	out = cache[frame - index[block].firstFrame];
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectoryReader::readRange                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param first, last                                                         *
+*           The range of frames [first, last) to decode.                      *
+*  @param out                                                                 *
+*           Output frames.                                                    *
+*  @param pool                                                                *
+*           Optional worker pool across which blocks are divided.             *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if every frame of the range was decoded.                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Every block overlapping the range is decoded independently, and copies     *
+*  its frames straight into their place in the output.                        *
+*                                                                             *
+*******************************************************************************/
+bool TrajectoryReader::readRange(GLuint first, GLuint last,
+                                 std::vector<NBodyState>& out,
+                                 WorkerPool* pool) const
+{
+	last = std::min(last, getNumFrames());
+	if (first >= last)
+	{
+		out.clear();
+		return first == last;
+	}
+	out.resize(last - first);
+
+	/* Blocks overlapping the range. */
+	GLuint begin = 0;
+	while (index[begin].firstFrame + index[begin].frames <= first)
+		begin++;
+	GLuint end = begin;
+	while (end < index.size() && index[end].firstFrame < last)
+		end++;
+
+	std::vector<char>     ok(end - begin, 0);
+	WorkerPool::RangeTask task = [&](GLuint lo, GLuint hi)
+	{
+		std::vector<NBodyState> frames;
+		for (GLuint b = begin + lo; b < begin + hi; b++)
+		{
+			if (!readBlock(b, frames))
+				continue;
+
+			GLuint from = std::max(first, index[b].firstFrame);
+			GLuint to   = std::min(last, index[b].firstFrame + index[b].frames);
+			for (GLuint f = from; f < to; f++)
+				out[f - first] = frames[f - index[b].firstFrame];
+			ok[b - begin] = 1;
+		}
+	};
+
+	if (pool != nullptr)
+		pool->parallelFor(end - begin, task);
+	else
+		task(0, end - begin);
+
+	return std::find(ok.begin(), ok.end(), 0) == ok.end();
+}
@@ -0,0 +1,243 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <string>
+#include  <fstream>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "StepObserver.h"
+#include  "NBodyIntegrator.h"
+#include  "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Default number of frames in each independently decodable block. */
+#define   ARCHIVE_BLOCK_FRAMES               256
+/* Default largest error of a recorded position coordinate. */
+#define   ARCHIVE_POSITION_TOLERANCE        1.0
+/* Default largest error of a recorded velocity coordinate. */
+#define   ARCHIVE_VELOCITY_TOLERANCE     1.0e-3
+/* Format version written to the header. */
+#define   ARCHIVE_VERSION                      2
+/* Rice quotients at or above this are followed by the raw value instead. */
+#define   RICE_ESCAPE                         24
+
+/******************************************************************************
+*                                                                             *
+*                           ArchiveBlock (struct)                             *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  offset                                                                     *
+*          Position of the block in the file, in bytes.                       *
+*  firstFrame, frames                                                         *
+*          Index of the first frame in the block, and the number of frames.   *
+*  startTime                                                                  *
+*          SECONDS                                                            *
+*          Simulation time of the first frame.                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Entry of the block index kept at the end of an archive.                    *
+*                                                                             *
+*******************************************************************************/
+struct ArchiveBlock
+{
+	unsigned long long offset;
+	GLuint             firstFrame;
+	GLuint             frames;
+	GLdouble           startTime;
+};
+
+/******************************************************************************
+ *																			  *
+ *                           TrajectoryWriter Class                           *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  out                                                                       *
+ *          The archive being written.                                        *
+ *  positionTolerance, velocityTolerance                                      *
+ *          Largest error allowed in any stored coordinate.                   *
+ *  blockFrames                                                               *
+ *          Number of frames per block.                                       *
+ *  interval, steps                                                           *
+ *          Number of steps between recorded frames, and steps observed.      *
+ *  numBodies, frames                                                         *
+ *          Number of bodies per frame, and frames written so far.            *
+ *  bodyOrder                                                                 *
+ *          Index in the system of each recorded body, or NO_BODY once it has *
+ *          been removed (empty until the system first reorders, adds or      *
+ *          removes bodies).                                                  *
+ *  lastFrame                                                                 *
+ *          The last frame recorded, which removed bodies stay at.            *
+ *  pending                                                                   *
+ *          Frames of the block being filled.                                 *
+ *  index                                                                     *
+ *          Every block written so far.                                       *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Step observer which records the state of every body in a compressed,      *
+ *  error-bounded archive. Frames are gathered into blocks. The first frame   *
+ *  of a block is stored exactly; every later position is predicted from the  *
+ *  previous reconstructed position, velocity and the change in velocity,     *
+ *  and every velocity from the previous two. The residual is quantized to    *
+ *  twice the tolerance, so no value is off by more than the tolerance (plus  *
+ *  float rounding). With a tolerance of zero the residual is instead counted *
+ *  in floats from the prediction, so every value is stored exactly. The      *
+ *  quantized residuals are Rice coded with a parameter fitted to each       *
+ *  block. The predictions use the reconstructed values, exactly as the      *
+ *  reader will, so errors never accumulate. An index of the blocks is        *
+ *  written at the end of the file when it is closed.                         *
+ *                                                                            *
+ *  Every frame holds the bodies of the first frame in their first order.     *
+ *  Bodies added to the system later are not recorded, and a removed body     *
+ *  stays where it was last recorded.                                         *
+ *                                                                            *
+ ******************************************************************************/
+class TrajectoryWriter : public StepObserver
+{
+/* Public Members. */
+public:
+
+	/* Constructor (opens the file; the header is written with the first frame). */
+	                   TrajectoryWriter(const char* file,
+	                                    GLdouble    positionTolerance,
+	                                    GLdouble    velocityTolerance,
+	                                    GLuint      blockFrames = ARCHIVE_BLOCK_FRAMES,
+	                                    GLuint      interval    = 1);
+
+	/* Record every interval-th step. */
+	virtual void       onStep       (OrbitalSystem& system);
+
+	/* Keep recording each body in the same place when the system reorders. */
+	virtual void       onReorder    (OrbitalSystem&             system,
+	                                 const std::vector<GLuint>& order);
+
+	/* Stop following a body which is leaving the system. */
+	virtual void       onRemove     (OrbitalSystem&             system,
+	                                 GLuint                     i);
+
+	/* Append one frame (every frame must have the same bodies). */
+	bool               addFrame     (const NBodyState& state);
+
+	/* Write the last block and the index, and close the file. */
+	bool               close        ();
+
+	/* Getters. */
+	bool               isOpen()            const  {  return out.is_open();   }
+	GLuint             getNumFrames()      const  {  return frames;          }
+	GLuint             getNumBlocks()      const  {  return index.size();    }
+
+	/* Destructor (closes the archive if still open). */
+	virtual           ~TrajectoryWriter();
+
+/* Private Members. */
+private:
+
+	/* Output file. */
+	std::ofstream             out;
+	/* Coding options. */
+	GLdouble                  positionTolerance;
+	GLdouble                  velocityTolerance;
+	GLuint                    blockFrames;
+	GLuint                    interval;
+	GLuint                    steps;
+	/* Progress. */
+	GLuint                    numBodies;
+	GLuint                    frames;
+	std::vector<GLuint>       bodyOrder;
+	NBodyState                lastFrame;
+	std::vector<NBodyState>   pending;
+	std::vector<ArchiveBlock> index;
+
+	/* Start tracking the recorded bodies, if not already. */
+	void               trackBodies  (GLuint n);
+	/* Encode and write the pending frames as one block. */
+	bool               flush        ();
+};
+
+/******************************************************************************
+ *																			  *
+ *                           TrajectoryReader Class                           *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  file                                                                      *
+ *          Path of the archive, reopened by every decode so that blocks can  *
+ *          be decoded on several threads at once.                            *
+ *  positionTolerance, velocityTolerance                                      *
+ *          Tolerances the archive was written with.                          *
+ *  masses, G                                                                 *
+ *          Masses and gravitational constant of the recorded system.         *
+ *  index                                                                     *
+ *          Every block of the archive.                                       *
+ *  cachedBlock, cache                                                        *
+ *          Last block decoded by readFrame, for sequential playback.         *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Reads archives written by TrajectoryWriter. Only the header and index are *
+ *  read when the archive is opened; any frame is then found through the      *
+ *  index and decoded from the start of its block, and whole ranges of        *
+ *  blocks can be decoded in parallel.                                        *
+ *                                                                            *
+ ******************************************************************************/
+class TrajectoryReader
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   TrajectoryReader() : G(0), positionTolerance(0),
+	                                        velocityTolerance(0), cachedBlock(-1) {}
+
+	/* Read the header and index of an archive. */
+	bool               open         (const char* file);
+
+	/* Decode a single frame. */
+	bool               readFrame    (GLuint frame, NBodyState& out);
+
+	/* Decode every frame of one block. */
+	bool               readBlock    (GLuint block, std::vector<NBodyState>& out) const;
+
+	/* Decode the frames [first, last), split by block across the pool. */
+	bool               readRange    (GLuint first, GLuint last,
+	                                 std::vector<NBodyState>& out,
+	                                 WorkerPool* pool = nullptr) const;
+
+	/* Getters. */
+	GLuint             getNumBodies()      const  {  return masses.size();   }
+	GLuint             getNumBlocks()      const  {  return index.size();    }
+	GLuint             getNumFrames()      const
+	    {  return index.empty() ? 0 : index.back().firstFrame + index.back().frames;  }
+	GLdouble           getPositionTolerance() const  {  return positionTolerance;  }
+	GLdouble           getVelocityTolerance() const  {  return velocityTolerance;  }
+	const std::vector<ArchiveBlock>& getIndex() const  {  return index;         }
+
+	/* Destructor. */
+	                  ~TrajectoryReader()                                  {}
+
+/* Private Members. */
+private:
+
+	/* Archive description. */
+	std::string               file;
+	std::vector<GLfloat>      masses;
+	GLfloat                   G;
+	GLdouble                  positionTolerance;
+	GLdouble                  velocityTolerance;
+	std::vector<ArchiveBlock> index;
+	/* Last decoded block. */
+	GLint                     cachedBlock;
+	std::vector<NBodyState>   cache;
+};
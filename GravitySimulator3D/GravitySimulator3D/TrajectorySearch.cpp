@@ -0,0 +1,532 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include <fstream>
+#include "TrajectorySearch.h"
+
+/******************************************************************************
+*                                                                             *
+*             TrajectorySearch::TrajectorySearch (Constructor)                *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param ephemeris                                                           *
+*           Precomputed motion of the massive bodies.                         *
+*  @param pool                                                                *
+*           Worker pool across which candidates are divided (may be null).    *
+*  @param step                                                                *
+*           SECONDS                                                           *
+*           Largest step used to propagate the probes.                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Constructor for the TrajectorySearch class.                                *
+*                                                                             *
+*******************************************************************************/
+TrajectorySearch::TrajectorySearch(const Ephemeris* ephemeris,
+                                   WorkerPool* pool, GLfloat step) :
+	ephemeris(ephemeris), pool(pool), step(step)
+{
+	/* Empty. */
+}
+
+/******************************************************************************
+*                                                                             *
+*                       TrajectorySearch::acceleration                        *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param candidate                                                           *
+*           The trajectory being propagated.                                  *
+*  @param t                                                                   *
+*           SECONDS                                                           *
+*           Time of the evaluation.                                           *
+*  @param r                                                                   *
+*           Position of the probe.                                            *
+*  @param thrust                                                              *
+*           Acceleration due to the engine.                                   *
+*  @param bodies                                                              *
+*           Scratch space, left holding the body positions at time t.         *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The net acceleration of the probe.                                         *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Gravity of every massive body (except the ignored one) plus thrust.        *
+*                                                                             *
+*******************************************************************************/
+glm::vec3 TrajectorySearch::acceleration(const Trajectory& candidate,
+                                         GLdouble t, const glm::vec3& r,
+                                         const glm::vec3& thrust,
+                                         std::vector<glm::vec3>& bodies) const
+{
+	const std::vector<GLfloat>& masses = ephemeris->getMasses();
+	GLfloat                     G      = ephemeris->getG();
+
+	ephemeris->positionsAt(t, bodies);
+
+	glm::vec3 net = thrust;
+	for (GLuint j = 0; j < bodies.size(); j++)
+	{
+		if ((GLint) j == candidate.ignoredBody || masses[j] == 0)
+			continue;
+
+		glm::vec3 d  = bodies[j] - r;
+		GLfloat   r2 = glm::dot(d, d);
+		if (r2 == 0)
+			continue;
+		GLfloat   r  = sqrt(r2);
+		net += (G * masses[j] / (r2 * r)) * d;
+	}
+	return net;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectorySearch::propagate                         *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param candidate                                                           *
+*           The trajectory to fly.                                            *
+*  @param target                                                              *
+*           Index of the body the probe is aiming for.                        *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  The cost of the trajectory.                                                *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Flies the probe from departure to arrival with Runge-Kutta steps. Steps    *
+*  end exactly where a burn starts or stops, so the thrust is constant over   *
+*  every step, and impulsive burns are applied between steps. The distance    *
+*  to the target is checked at the end of every step.                         *
+*                                                                             *
+*******************************************************************************/
+TrajectoryCost TrajectorySearch::propagate(const Trajectory& candidate,
+                                           GLuint target) const
+{
+	std::vector<glm::vec3> bodies;
+	std::vector<GLdouble>  breaks;
+	TrajectoryCost         cost;
+
+	/* Total burn magnitude and the times at which the thrust changes. */
+	cost.deltaV = 0;
+	for (const Burn& b : candidate.burns)
+	{
+		cost.deltaV += glm::length(b.deltaV);
+		breaks.push_back(b.start);
+		breaks.push_back(b.start + b.duration);
+	}
+	std::sort(breaks.begin(), breaks.end());
+
+	glm::vec3 r = candidate.position;
+	glm::vec3 v = candidate.velocity;
+	GLdouble  t = candidate.departure;
+
+	ephemeris->positionsAt(t, bodies);
+	cost.missDistance = glm::length(bodies[target] - r);
+	cost.closestTime  = t;
+
+	GLdouble previous = -DBL_MAX;
+	for (;;)
+	{
+		/* Apply the impulsive burns which fall due since the last step. */
+		for (const Burn& b : candidate.burns)
+			if (b.duration == 0 && b.start > previous && b.start <= t)
+				v += b.deltaV;
+		previous = t;
+
+		if (t >= candidate.arrival)
+			break;
+
+		/* Step to the next change in thrust, or by a full step. */
+		GLdouble end = std::min(t + step, candidate.arrival);
+		for (GLdouble b : breaks)
+		{
+			if (b > t && b < end)
+			{
+				end = b;
+				break;
+			}
+		}
+		GLfloat  h   = (GLfloat) (end - t);
+		GLdouble mid = t + 0.5 * (end - t);
+
+		/* Engine acceleration over the step. */
+		glm::vec3 thrust(0);
+		for (const Burn& b : candidate.burns)
+			if (b.duration > 0 && mid > b.start && mid < b.start + b.duration)
+				thrust += b.deltaV / b.duration;
+
+		/* Classical Runge-Kutta step. */
+		glm::vec3 k1r = v;
+		glm::vec3 k1v = acceleration(candidate, t, r, thrust, bodies);
+		glm::vec3 k2r = v + (0.5f * h) * k1v;
+		glm::vec3 k2v = acceleration(candidate, mid, r + (0.5f * h) * k1r,
+		                             thrust, bodies);
+		glm::vec3 k3r = v + (0.5f * h) * k2v;
+		glm::vec3 k3v = acceleration(candidate, mid, r + (0.5f * h) * k2r,
+		                             thrust, bodies);
+		glm::vec3 k4r = v + h * k3v;
+		glm::vec3 k4v = acceleration(candidate, end, r + h * k3r,
+		                             thrust, bodies);
+
+		r += (h / 6.0f) * (k1r + 2.0f * k2r + 2.0f * k3r + k4r);
+		v += (h / 6.0f) * (k1v + 2.0f * k2v + 2.0f * k3v + k4v);
+		t  = end;
+
+		/* The last evaluation left the bodies at the end of the step. */
+		GLfloat distance = glm::length(bodies[target] - r);
+		if (distance < cost.missDistance)
+		{
+			cost.missDistance = distance;
+			cost.closestTime  = t;
+		}
+	}
+
+	cost.finalState.position = r;
+	cost.finalState.velocity = v;
+	return cost;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectorySearch::evaluate                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param candidates                                                          *
+*           The trajectories to fly.                                          *
+*  @param target                                                              *
+*           Index of the body the probes are aiming for.                      *
+*  @param costs                                                               *
+*           Output cost of every candidate, in the same order.                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  The candidates share nothing but the read-only ephemeris, so they are      *
+*  simply divided between the threads of the pool.                            *
+*                                                                             *
+*******************************************************************************/
+void TrajectorySearch::evaluate(const std::vector<Trajectory>& candidates,
+                                GLuint target,
+                                std::vector<TrajectoryCost>& costs) const
+{
+	costs.resize(candidates.size());
+
+	WorkerPool::RangeTask task = [&](GLuint begin, GLuint end)
+	{
+		for (GLuint i = begin; i < end; i++)
+			costs[i] = propagate(candidates[i], target);
+	};
+
+	if (pool != nullptr)
+		pool->parallelFor(candidates.size(), task);
+	else
+		task(0, candidates.size());
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectorySearch::porkchop                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param problem                                                             *
+*           The bodies and parking orbit of the transfer.                     *
+*  @param departStart, departEnd                                              *
+*           SECONDS                                                           *
+*           Range of launch dates.                                            *
+*  @param arriveStart, arriveEnd                                              *
+*           SECONDS                                                           *
+*           Range of arrival dates.                                           *
+*  @param gridSize                                                            *
+*           Number of dates along each axis.                                  *
+*  @param cells                                                               *
+*           Output grid, ordered by launch date then arrival date.            *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  For every pair of dates, solves Lambert's problem around the central       *
+*  body between the departure point and the target's position at arrival.     *
+*  When the origin is the central body the probe leaves from a circular       *
+*  parking orbit whose phase is set by the launch date (zero at time zero),   *
+*  and the departure burn is the difference from the parking velocity.        *
+*  Otherwise the Lambert solution gives the excess velocity at the origin,    *
+*  and the burn from the parking orbit follows from the hyperbolic escape     *
+*  speed; the origin's gravity is then left out of the verification flight    *
+*  (patched conics). Every solution is flown under the system's gravity in    *
+*  one parallel batch to measure how close it really comes to the target.     *
+*                                                                             *
+*******************************************************************************/
+void TrajectorySearch::porkchop(const TransferProblem& problem,
+                                GLdouble departStart, GLdouble departEnd,
+                                GLdouble arriveStart, GLdouble arriveEnd,
+                                GLuint gridSize,
+                                std::vector<PorkchopCell>& cells) const
+{
+	const std::vector<GLfloat>& masses = ephemeris->getMasses();
+	GLdouble mu       = (GLdouble) ephemeris->getG() * masses[problem.central];
+	GLdouble muOrigin = (GLdouble) ephemeris->getG() * masses[problem.origin];
+	GLdouble rp       = problem.parkingRadius;
+	GLdouble rate     = sqrt(muOrigin / (rp * rp * rp));
+	GLuint   spans    = (gridSize > 1) ? gridSize - 1 : 1;
+
+	std::vector<Trajectory> candidates;
+	std::vector<GLuint>     owners;
+	cells.clear();
+
+	for (GLuint i = 0; i < gridSize; i++)
+	{
+		for (GLuint j = 0; j < gridSize; j++)
+		{
+			PorkchopCell cell = { departStart + (departEnd - departStart) * i / spans,
+			                      arriveStart + (arriveEnd - arriveStart) * j / spans,
+			                      0, 0, 0, false };
+			cells.push_back(cell);
+			if (cell.arrival <= cell.departure)
+				continue;
+
+			BodyState c0 = ephemeris->stateAt(problem.central, cell.departure);
+			BodyState o0 = ephemeris->stateAt(problem.origin,  cell.departure);
+			BodyState c1 = ephemeris->stateAt(problem.central, cell.arrival);
+			BodyState t1 = ephemeris->stateAt(problem.target,  cell.arrival);
+
+			/* Transfer in the plane of the target's orbit. */
+			glm::dvec3 r2     = glm::dvec3(t1.position - c1.position);
+			glm::dvec3 vt     = glm::dvec3(t1.velocity - c1.velocity);
+			glm::dvec3 normal = glm::normalize(glm::cross(r2, vt));
+
+			/* Any in-plane axis serves as the zero phase of the parking orbit. */
+			glm::dvec3 axis = (fabs(normal.x) < 0.9) ? glm::dvec3(1, 0, 0)
+			                                         : glm::dvec3(0, 1, 0);
+			glm::dvec3 e1   = glm::normalize(glm::cross(normal, axis));
+			glm::dvec3 e2   = glm::cross(normal, e1);
+
+			/* Departure point and velocity before the burn. */
+			glm::dvec3 r1;
+			glm::dvec3 before;
+			if (problem.origin == problem.central)
+			{
+				GLdouble phase = rate * cell.departure;
+				r1     = rp * (cos(phase) * e1 + sin(phase) * e2);
+				before = (rp * rate) * (cos(phase) * e2 - sin(phase) * e1);
+			}
+			else
+			{
+				r1     = glm::dvec3(o0.position - c0.position);
+				before = glm::dvec3(o0.velocity - c0.velocity);
+			}
+
+			glm::dvec3 v1, v2;
+			if (!lambert(r1, r2, cell.arrival - cell.departure, mu, normal,
+			             v1, v2))
+				continue;
+
+			/* Cost of the two burns. */
+			GLdouble excess = glm::length(v1 - before);
+			if (problem.origin == problem.central)
+				cell.departureDeltaV = (GLfloat) excess;
+			else
+				cell.departureDeltaV = (GLfloat) (sqrt(excess * excess +
+				                       2 * muOrigin / rp) - sqrt(muOrigin / rp));
+			cell.arrivalDeltaV = (GLfloat) glm::length(vt - v2);
+			cell.valid         = true;
+			cells.back()       = cell;
+
+			/* Flight plan for verification. */
+			Trajectory candidate;
+			candidate.departure   = cell.departure;
+			candidate.arrival     = cell.arrival;
+			candidate.position    = c0.position + glm::vec3(r1);
+			candidate.velocity    = c0.velocity + glm::vec3(before);
+			candidate.ignoredBody = (problem.origin == problem.central)
+			                        ? -1 : (GLint) problem.origin;
+			Burn burn = { cell.departure, problem.burnDuration,
+			              glm::vec3(v1 - before) };
+			candidate.burns.push_back(burn);
+
+			candidates.push_back(candidate);
+			owners.push_back(cells.size() - 1);
+		}
+	}
+
+	/* Fly every solution in parallel. */
+	std::vector<TrajectoryCost> costs;
+	evaluate(candidates, problem.target, costs);
+	for (GLuint k = 0; k < costs.size(); k++)
+		cells[owners[k]].missDistance = costs[k].missDistance;
+}
+
+/******************************************************************************
+*                                                                             *
+*                          TrajectorySearch::lambert                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param r1, r2                                                              *
+*           Positions relative to the central body at departure and arrival.  *
+*  @param tof                                                                 *
+*           SECONDS                                                           *
+*           Time of flight.                                                   *
+*  @param mu                                                                  *
+*           Gravitational parameter (G * M) of the central body.              *
+*  @param normal                                                              *
+*           Normal of the plane of prograde motion.                           *
+*  @param v1, v2                                                              *
+*           Output velocities relative to the central body at departure and   *
+*           arrival.                                                          *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if a solution was found.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Universal variable formulation. The time of flight increases               *
+*  monotonically with z on a single revolution, so z is found by bisection,   *
+*  which is slower than Newton's method but cannot diverge. The transfer      *
+*  angle is taken in the prograde direction about normal. Transfers of        *
+*  exactly 0 or 180 degrees have no unique plane and are rejected.            *
+*                                                                             *
+*******************************************************************************/
+bool TrajectorySearch::lambert(const glm::dvec3& r1, const glm::dvec3& r2,
+                               GLdouble tof, GLdouble mu,
+                               const glm::dvec3& normal,
+                               glm::dvec3& v1, glm::dvec3& v2)
+{
+	const GLdouble pi = 3.14159265358979323846;
+
+	/* Stumpff functions, with series near zero. */
+	auto stumpffC = [](GLdouble z) -> GLdouble
+	{
+		if (z > 1e-6)
+			return (1 - cos(sqrt(z))) / z;
+		if (z < -1e-6)
+			return (cosh(sqrt(-z)) - 1) / -z;
+		return 1.0 / 2.0 - z / 24.0;
+	};
+	auto stumpffS = [](GLdouble z) -> GLdouble
+	{
+		if (z > 1e-6)
+			return (sqrt(z) - sin(sqrt(z))) / pow(sqrt(z), 3);
+		if (z < -1e-6)
+			return (sinh(sqrt(-z)) - sqrt(-z)) / pow(sqrt(-z), 3);
+		return 1.0 / 6.0 - z / 120.0;
+	};
+
+	GLdouble n1       = glm::length(r1);
+	GLdouble n2       = glm::length(r2);
+	GLdouble cosAngle = glm::clamp(glm::dot(r1, r2) / (n1 * n2), -1.0, 1.0);
+	GLdouble angle    = acos(cosAngle);
+	if (glm::dot(glm::cross(r1, r2), normal) < 0)
+		angle = 2 * pi - angle;
+
+	if (1 - cosAngle < 1e-12 || fabs(sin(angle)) < 1e-12)
+		return false;
+
+	GLdouble A = sin(angle) * sqrt(n1 * n2 / (1 - cosAngle));
+
+	/* Time of flight (and y) as a function of z; y < 0 is unreachable. */
+	auto timeOfFlight = [&](GLdouble z, GLdouble& y) -> GLdouble
+	{
+		GLdouble C = stumpffC(z);
+		GLdouble S = stumpffS(z);
+		y = n1 + n2 + A * (z * S - 1) / sqrt(C);
+		if (y < 0)
+			return -1;
+
+		GLdouble chi = sqrt(y / C);
+		return (chi * chi * chi * S + A * sqrt(y)) / sqrt(mu);
+	};
+
+	/* Push the hyperbolic bound out until it is faster than required. */
+	GLdouble y  = 0;
+	GLdouble lo = -4 * pi * pi;
+	for (GLuint i = 0; i < LAMBERT_ITERATIONS && timeOfFlight(lo, y) > tof; i++)
+		lo *= 2;
+
+	/* Bisection on z up to the one revolution limit. */
+	GLdouble hi = 4 * pi * pi;
+	GLdouble t  = 0;
+	for (GLuint i = 0; i < LAMBERT_ITERATIONS; i++)
+	{
+		GLdouble z = 0.5 * (lo + hi);
+		t = timeOfFlight(z, y);
+		if (t < tof)
+			lo = z;
+		else
+			hi = z;
+	}
+
+	if (y <= 0 || fabs(t - tof) > LAMBERT_TOLERANCE * tof)
+		return false;
+
+	/* Lagrange coefficients. */
+	GLdouble f    = 1 - y / n1;
+	GLdouble g    = A * sqrt(y / mu);
+	GLdouble gdot = 1 - y / n2;
+
+	v1 = (r2 - f * r1) / g;
+	v2 = (gdot * r2 - r1) / g;
+	return true;
+}
+
+/******************************************************************************
+*                                                                             *
+*                         TrajectorySearch::writeCsv                          *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param file                                                                *
+*           Path of the file to write.                                        *
+*  @param cells                                                               *
+*           The porkchop grid.                                                *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  True if the file was written.                                              *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  One row per cell, for plotting with any spreadsheet or script. Invalid     *
+*  cells are kept so that the grid stays rectangular.                         *
+*                                                                             *
+*******************************************************************************/
+bool TrajectorySearch::writeCsv(const char* file,
+                                const std::vector<PorkchopCell>& cells)
+{
+	std::ofstream out(file);
+	if (!out)
+		return false;
+
+	out << "departure,arrival,departure_dv,arrival_dv,total_dv,miss_distance,valid\n";
+	for (const PorkchopCell& c : cells)
+		out << c.departure << "," << c.arrival << ","
+		    << c.departureDeltaV << "," << c.arrivalDeltaV << ","
+		    << c.departureDeltaV + c.arrivalDeltaV << ","
+		    << c.missDistance << "," << (c.valid ? 1 : 0) << "\n";
+
+	return out.good();
+}
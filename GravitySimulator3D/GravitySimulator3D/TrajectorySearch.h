@@ -0,0 +1,269 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <GL\glew.h>
+#include  <glm\glm.hpp>
+#include  "Ephemeris.h"
+#include  "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                           Defined Constants / Macros                        *
+*                                                                             *
+******************************************************************************/
+/* Bisection iterations of the Lambert solver. */
+#define   LAMBERT_ITERATIONS                 200
+/* Relative time of flight error accepted by the Lambert solver. */
+#define   LAMBERT_TOLERANCE                 1e-6
+/* Default size of each axis of a porkchop grid. */
+#define   PORKCHOP_GRID                       32
+
+/******************************************************************************
+*                                                                             *
+*                                Burn (struct)                                *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  start                                                                      *
+*          SECONDS                                                            *
+*          Simulation time at which the burn begins.                          *
+*  duration                                                                   *
+*          SECONDS                                                            *
+*          Length of the burn (0 for an impulsive burn).                      *
+*  deltaV                                                                     *
+*          METERS / SECOND                                                    *
+*          Total change in velocity delivered by the burn.                    *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A maneuver. Finite burns apply a constant acceleration deltaV / duration   *
+*  over their length.                                                         *
+*                                                                             *
+*******************************************************************************/
+struct Burn
+{
+	GLdouble       start;
+	GLfloat        duration;
+	glm::vec3      deltaV;
+};
+
+/******************************************************************************
+*                                                                             *
+*                             Trajectory (struct)                             *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  departure, arrival                                                         *
+*          SECONDS                                                            *
+*          Simulation times at which the probe is released and at which the   *
+*          propagation stops.                                                 *
+*  position, velocity                                                         *
+*          State of the probe at departure, before any burn.                  *
+*  burns                                                                      *
+*          Maneuvers performed during the flight.                             *
+*  ignoredBody                                                                *
+*          Body whose gravity the probe does not feel (-1 for none).          *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  A candidate spacecraft trajectory: a massless probe with a flight plan.    *
+*                                                                             *
+*******************************************************************************/
+struct Trajectory
+{
+	GLdouble          departure;
+	GLdouble          arrival;
+	glm::vec3         position;
+	glm::vec3         velocity;
+	std::vector<Burn> burns;
+	GLint             ignoredBody;
+};
+
+/******************************************************************************
+*                                                                             *
+*                           TrajectoryCost (struct)                           *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  deltaV                                                                     *
+*          METERS / SECOND                                                    *
+*          Sum of the magnitudes of every burn.                               *
+*  missDistance                                                               *
+*          METERS                                                             *
+*          Closest distance between the probe and the target body.            *
+*  closestTime                                                                *
+*          SECONDS                                                            *
+*          Time of the closest approach.                                      *
+*  finalState                                                                 *
+*          State of the probe at the end of the propagation.                  *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Result of propagating a single Trajectory.                                 *
+*                                                                             *
+*******************************************************************************/
+struct TrajectoryCost
+{
+	GLfloat        deltaV;
+	GLfloat        missDistance;
+	GLdouble       closestTime;
+	BodyState      finalState;
+};
+
+/******************************************************************************
+*                                                                             *
+*                          TransferProblem (struct)                           *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  central                                                                    *
+*          Index of the body which dominates the transfer orbit.              *
+*  origin, target                                                             *
+*          Indices of the departure and arrival bodies.                       *
+*  parkingRadius                                                              *
+*          METERS                                                             *
+*          Radius of the circular parking orbit around the origin.            *
+*  burnDuration                                                               *
+*          SECONDS                                                            *
+*          Length of the departure burn (0 for an impulsive burn).            *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Description of a two-impulse transfer for a porkchop search.               *
+*                                                                             *
+*******************************************************************************/
+struct TransferProblem
+{
+	GLuint         central;
+	GLuint         origin;
+	GLuint         target;
+	GLfloat        parkingRadius;
+	GLfloat        burnDuration;
+};
+
+/******************************************************************************
+*                                                                             *
+*                            PorkchopCell (struct)                            *
+*                                                                             *
+*******************************************************************************
+* MEMBERS                                                                     *
+*  departure, arrival                                                         *
+*          SECONDS                                                            *
+*          Launch and arrival dates of the cell.                              *
+*  departureDeltaV, arrivalDeltaV                                             *
+*          METERS / SECOND                                                    *
+*          Burns needed to leave the parking orbit and to match the target's  *
+*          velocity, from the Lambert solution.                               *
+*  missDistance                                                               *
+*          METERS                                                             *
+*          Closest approach to the target when the departure burn is flown    *
+*          under the full gravity of the system.                              *
+*  valid                                                                      *
+*          False when the arrival precedes the departure or the Lambert       *
+*          solver failed.                                                     *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  One launch date / arrival date entry of a porkchop plot.                   *
+*                                                                             *
+*******************************************************************************/
+struct PorkchopCell
+{
+	GLdouble       departure;
+	GLdouble       arrival;
+	GLfloat        departureDeltaV;
+	GLfloat        arrivalDeltaV;
+	GLfloat        missDistance;
+	bool           valid;
+};
+
+/******************************************************************************
+ *																			  *
+ *                           TrajectorySearch Class                           *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  ephemeris                                                                 *
+ *          Precomputed motion of the massive bodies.                         *
+ *  pool                                                                      *
+ *          Worker pool across which candidates are divided.                  *
+ *  step                                                                      *
+ *          SECONDS                                                           *
+ *          Largest step used to propagate the probes.                        *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Batch engine for maneuver planning. Candidates are massless, so they do   *
+ *  not disturb the system or one another: the massive bodies are recorded    *
+ *  once in an Ephemeris, and thousands of probes are then propagated         *
+ *  against it independently, split evenly across the worker pool. Porkchop   *
+ *  grids are seeded with a Lambert solution around the central body for      *
+ *  each launch and arrival date, then verified by propagation.               *
+ *                                                                            *
+ ******************************************************************************/
+class TrajectorySearch
+{
+/* Public Members. */
+public:
+
+	/* Constructor. */
+	                   TrajectorySearch(const Ephemeris* ephemeris,
+	                                    WorkerPool*      pool,
+	                                    GLfloat          step);
+
+	/* Propagate a single candidate and measure it against the target. */
+	TrajectoryCost     propagate    (const Trajectory&             candidate,
+	                                 GLuint                        target) const;
+
+	/* Propagate every candidate in parallel. */
+	void               evaluate     (const std::vector<Trajectory>&     candidates,
+	                                 GLuint                             target,
+	                                       std::vector<TrajectoryCost>& costs) const;
+
+	/* Evaluate a grid of launch and arrival dates. */
+	void               porkchop     (const TransferProblem&           problem,
+	                                 GLdouble                        departStart,
+	                                 GLdouble                        departEnd,
+	                                 GLdouble                        arriveStart,
+	                                 GLdouble                        arriveEnd,
+	                                 GLuint                          gridSize,
+	                                       std::vector<PorkchopCell>& cells) const;
+
+	/* Solve Lambert's problem for a single revolution prograde transfer. */
+	static bool        lambert      (const glm::dvec3&             r1,
+	                                 const glm::dvec3&             r2,
+	                                 GLdouble                      tof,
+	                                 GLdouble                      mu,
+	                                 const glm::dvec3&             normal,
+	                                       glm::dvec3&             v1,
+	                                       glm::dvec3&             v2);
+
+	/* Write a porkchop grid as comma separated values. */
+	static bool        writeCsv     (const char*                      file,
+	                                 const std::vector<PorkchopCell>& cells);
+
+	/* Destructor. */
+	                  ~TrajectorySearch()                                  {}
+
+/* Private Members. */
+private:
+
+	/* Motion of the massive bodies. */
+	const Ephemeris*   ephemeris;
+	/* Worker pool for batches. */
+	WorkerPool*        pool;
+	/* Probe step. */
+	GLfloat            step;
+
+	/* Acceleration of a probe at position r and time t. */
+	glm::vec3          acceleration (const Trajectory&              candidate,
+	                                 GLdouble                       t,
+	                                 const glm::vec3&               r,
+	                                 const glm::vec3&               thrust,
+	                                       std::vector<glm::vec3>&  bodies) const;
+};
@@ -0,0 +1,168 @@
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include "WorkerPool.h"
+
+/******************************************************************************
+*                                                                             *
+*                     WorkerPool::WorkerPool (Constructor)                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param numThreads                                                          *
+*           Total number of threads (including the caller) to split work      *
+*           across. 0 uses the number of hardware threads.                    *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Starts the worker threads, which sleep until work is handed out.           *
+*                                                                             *
+*******************************************************************************/
+WorkerPool::WorkerPool(GLuint numThreads) :
+	task(nullptr), count(0), generation(0), pending(0), stopping(false)
+{
+	if (numThreads == 0)
+		numThreads = std::thread::hardware_concurrency();
+	if (numThreads == 0)
+		numThreads = 1;
+
+	/* The calling thread takes the first chunk itself. */
+	for (GLuint i = 1; i < numThreads; i++)
+		threads.push_back(std::thread(&WorkerPool::workerLoop, this, i));
+}
+
+/******************************************************************************
+*                                                                             *
+*                           WorkerPool::parallelFor                           *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param count                                                               *
+*           Number of items in the range.                                     *
+*  @param task                                                                *
+*           Function called once per chunk with the chunk's [begin, end).     *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Splits the range evenly across the pool and blocks until every chunk is    *
+*  complete. Small ranges are run directly on the calling thread.             *
+*                                                                             *
+*******************************************************************************/
+void WorkerPool::parallelFor(GLuint count, const RangeTask& task)
+{
+	GLuint participants = getNumThreads();
+
+	/* Not worth waking the workers. */
+	if (threads.empty() || count <= 1)
+	{
+		task(0, count);
+		return;
+	}
+
+	/* Publish the work and wake the workers. */
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->task  = &task;
+		this->count = count;
+		pending     = threads.size();
+		generation++;
+	}
+	wake.notify_all();
+
+	/* Process the first chunk on this thread. */
+	task(0, count / participants);
+
+	/* Wait for the workers to finish their chunks. */
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this]() { return pending == 0; });
+	this->task = nullptr;
+}
+
+/******************************************************************************
+*                                                                             *
+*                           WorkerPool::workerLoop                            *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  @param index                                                               *
+*           Index of this worker's chunk (1 .. numThreads - 1).               *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Sleeps until a new range is published, processes this worker's chunk and   *
+*  reports completion, until the pool is destroyed.                           *
+*                                                                             *
+*******************************************************************************/
+void WorkerPool::workerLoop(GLuint index)
+{
+	GLuint seen = 0;
+	for (;;)
+	{
+		const RangeTask* current;
+		GLuint           n;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&]() { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen    = generation;
+			current = task;
+			n       = count;
+		}
+
+		/* Process this worker's chunk. */
+		GLuint participants = getNumThreads();
+		GLuint begin = (GLuint) (((unsigned long long) n * index) / participants);
+		GLuint end   = (GLuint) (((unsigned long long) n * (index + 1)) / participants);
+		(*current)(begin, end);
+
+		/* Report completion. */
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--pending == 0)
+				finished.notify_one();
+		}
+	}
+}
+
+/******************************************************************************
+*                                                                             *
+*                     WorkerPool::~WorkerPool (Destructor)                    *
+*                                                                             *
+*******************************************************************************
+* PARAMETERS                                                                  *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* RETURNS                                                                     *
+*  void                                                                       *
+*                                                                             *
+*******************************************************************************
+* DESCRIPTION                                                                 *
+*  Stops and joins every worker thread.                                       *
+*                                                                             *
+*******************************************************************************/
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& t : threads)
+		t.join();
+}
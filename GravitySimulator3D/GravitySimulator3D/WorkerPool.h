@@ -0,0 +1,87 @@
+#pragma once
+
+/******************************************************************************
+*                                                                             *
+*                              Included Header Files                          *
+*                                                                             *
+******************************************************************************/
+#include  <vector>
+#include  <thread>
+#include  <mutex>
+#include  <condition_variable>
+#include  <functional>
+#include  <GL\glew.h>
+
+/******************************************************************************
+ *																			  *
+ *                              WorkerPool Class                              *
+ *																			  *
+ ******************************************************************************
+ * MEMBERS                                                                    *
+ *  threads                                                                   *
+ *          Persistent worker threads, created once and reused.               *
+ *  mutex, wake, finished                                                     *
+ *          Synchronization for handing out work and waiting for it.          *
+ *  task                                                                      *
+ *          The range task currently being executed.                          *
+ *  count                                                                     *
+ *          Number of items in the current range.                             *
+ *  generation                                                                *
+ *          Incremented for every new range, so sleeping workers can tell     *
+ *          new work from a spurious wake-up.                                 *
+ *  pending                                                                   *
+ *          Number of workers which have not yet finished the current range.  *
+ *  stopping                                                                  *
+ *          Set when the pool is being destroyed.                             *
+ *                                                                            *
+ ******************************************************************************
+ * DESCRIPTION                                                                *
+ *  Fixed pool of worker threads which splits an index range [0, count) into  *
+ *  one contiguous chunk per thread. The calling thread works on the first    *
+ *  chunk, and parallelFor returns once every chunk has been processed. Only  *
+ *  one thread may call parallelFor on a given pool at a time.                *
+ *                                                                            *
+ ******************************************************************************/
+class WorkerPool
+{
+/* Public Members. */
+public:
+
+	/* Range task: process the items [begin, end). */
+	typedef std::function<void(GLuint begin, GLuint end)> RangeTask;
+
+	/* Constructor (0 threads uses every hardware thread). */
+	                   WorkerPool(GLuint numThreads = 0);
+
+	/* Run the task over [0, count) split across the pool. */
+	void               parallelFor(GLuint count, const RangeTask& task);
+
+	/* Getters. */
+	GLuint             getNumThreads()  const  {  return threads.size() + 1;  }
+
+	/* Destructor. */
+	                  ~WorkerPool();
+
+/* Private Members. */
+private:
+
+	/* Worker threads. */
+	std::vector<std::thread>  threads;
+	/* Synchronization. */
+	std::mutex                mutex;
+	std::condition_variable   wake;
+	std::condition_variable   finished;
+	/* Current work. */
+	const RangeTask*          task;
+	GLuint                    count;
+	GLuint                    generation;
+	GLuint                    pending;
+	bool                      stopping;
+
+	/* Body of each worker thread. */
+	void               workerLoop(GLuint index);
+
+	/* Disallow copying. */
+	                   WorkerPool(const WorkerPool& rhs);
+	WorkerPool&        operator=(const WorkerPool& rhs);
+};
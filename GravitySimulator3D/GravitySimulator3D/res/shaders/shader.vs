@@ -2,13 +2,13 @@
 
 precision highp float;
 
-uniform mat4 modelToProjectionMatrix;
-uniform mat4 modelToWorldMatrix;
+uniform mat4 worldToProjectionMatrix;
 
 attribute vec4 modelPosition;
 attribute vec3 modelColor;
 attribute vec3 modelNormal;
 attribute vec2 modelTexCoord;
+attribute mat4 modelToWorld;
 
 varying vec4 outPosition;
 varying vec3 outColor;
@@ -17,12 +17,12 @@ varying vec3 outNormal;
 
 void main()
 {
-	gl_Position = modelToProjectionMatrix * modelPosition;
-	outPosition = modelToWorldMatrix * modelPosition;
+	outPosition = modelToWorld * modelPosition;
+	gl_Position = worldToProjectionMatrix * outPosition;
 
 	outTexCoord = modelTexCoord;
 
 	outColor = modelColor;
 
-	outNormal = normalize(vec3(modelToWorldMatrix * vec4(modelNormal, 0.0)));
+	outNormal = normalize(vec3(modelToWorld * vec4(modelNormal, 0.0)));
 }
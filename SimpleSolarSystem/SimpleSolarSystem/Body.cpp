@@ -1,19 +1,24 @@
 #include "Body.h"
 #include <glm\glm.hpp>
-#include <GL\glew.h>
 #include "OrbitalSystem.h"
 
 Body::Body(const std::string name, int xPos, int yPos, int xVel, int yVel, float mass, float radius)
 {
 	this->name = name;
-	position[0] = xPos;
-	position[1] = yPos;
-	velocity[0] = xVel;
-	velocity[1] = yVel;
-	force[0] = 0;
-	force[1] = 0;
+	initial.position[0] = xPos;
+	initial.position[1] = yPos;
+	initial.velocity[0] = xVel;
+	initial.velocity[1] = yVel;
 	this->mass = mass;
 	this->radius = radius;
+
+	/* Colour by name, decided once rather than on every frame. */
+	if (name == "Earth")
+		color = glm::vec3(0, 0.5, 0);
+	else if (name == "Mars")
+		color = glm::vec3(1, 0, 0);
+	else
+		color = glm::vec3(1, 0.9, 0);
 }
 
 Body::~Body()
@@ -21,58 +26,42 @@ Body::~Body()
 }
 
 /**
- * Calculates the force vector felt by each orbital body.
+ * Calculates the force vector felt by this body, which is bodies[self],
+ * from the positions of every other body in states. The bodies and states
+ * are only read, never copied.
  */
-void Body::calculateForce(std::vector<Body> bodies)
+glm::vec2 Body::calculateForce(int self, const std::vector<Body>& bodies, const std::vector<BodyState>& states) const
 {
 	float delta_x = 0, delta_y = 0, distance = 0;
+	glm::vec2 position = states[self].position;
 	glm::vec2 force_sum (0.0, 0.0);
 
 	for (int i = 0; i < bodies.size(); i++)
 	{
-		glm::vec2 unit_vector(0.0, 0.0);
-		if (&bodies[i] == this)
+		if (i == self)
 			continue;
-		delta_x = bodies[i].getPosition()[0] - position[0];
-		delta_y = bodies[i].getPosition()[1] - position[1];
+		delta_x = states[i].position[0] - position[0];
+		delta_y = states[i].position[1] - position[1];
 		distance = sqrt(delta_x * delta_x + delta_y * delta_y);
-		if (distance == 0) distance = 1;		
-		unit_vector[0] += delta_x / distance;
-		unit_vector[1] += delta_y / distance;
+		if (distance == 0) distance = 1;
 
 		// F_g = ( G * m_1 * m_2) / r^2 
 		double magnitude = (G * mass * bodies[i].getMass()) / (distance * distance) * SCALE;
 
-		force_sum[0] += unit_vector[0] * magnitude;
-		force_sum[1] += unit_vector[1] * magnitude;
+		force_sum[0] += delta_x / distance * magnitude;
+		force_sum[1] += delta_y / distance * magnitude;
 	}
-	force = force_sum;
+	return force_sum;
 }
 
-void Body::move(float delta_t)
-{
-	position[0] += velocity[0] * delta_t;
-	position[1] += velocity[1] * delta_t;
-	velocity[0] += (force[0] / mass) * delta_t;
-	velocity[1] += (force[1] / mass) * delta_t;
-}
-
-void Body::draw()
+/**
+ * Integrates this body over delta_t from its previous state into its next
+ * state, under the force calculated from the previous states.
+ */
+void Body::move(const BodyState& previous, BodyState& next, const glm::vec2& force, float delta_t) const
 {
-	if (name == "Earth")
-		glColor3f(0, 0.5, 0);
-	else if (name == "Mars")
-		glColor3f(1, 0, 0);
-	else
-		glColor3f(1, 0.9, 0);
-	glBegin(GL_POLYGON);
-	for (int j = 0; j < VERTEX_COUNT; j++)
-	{
-		float angle = ( (double)j / VERTEX_COUNT ) * ( 2 * 3.1415 );
-		float x = position[0] + (cosf(angle) * radius);
-		float y = position[1] + (sinf(angle) * radius);
-		glVertex2f(x, y);
-
-	}
-	glEnd();
+	next.position[0] = previous.position[0] + previous.velocity[0] * delta_t;
+	next.position[1] = previous.position[1] + previous.velocity[1] * delta_t;
+	next.velocity[0] = previous.velocity[0] + (force[0] / mass) * delta_t;
+	next.velocity[1] = previous.velocity[1] + (force[1] / mass) * delta_t;
 }
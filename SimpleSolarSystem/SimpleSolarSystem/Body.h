@@ -5,28 +5,35 @@
 #include <string>
 #include <vector>
 
+/**
+ * Position and velocity of a body at one instant. The orbital system keeps
+ * two buffers of these, one per time step.
+ */
+struct BodyState
+{
+	glm::vec2	position;
+	glm::vec2	velocity;
+};
+
 class Body
 {
 public:
 	Body(const std::string name, int xPos, int yPos, int xVel, int yVel, float mass, float radius);
 	~Body();
-	void calculateForce(std::vector<Body> bodies);
-	void move(float delta_t);
-	void draw();
-	inline std::string& getName() { return name; }
-	inline glm::vec2& getPosition() { return position; }
-	inline glm::vec2& getVelocity() { return velocity; }
-	inline glm::vec2& getForce() { return force; }
-	inline float getMass() { return mass; }
-	inline float getRadius() { return radius; }
+	glm::vec2 calculateForce(int self, const std::vector<Body>& bodies, const std::vector<BodyState>& states) const;
+	void move(const BodyState& previous, BodyState& next, const glm::vec2& force, float delta_t) const;
+	inline const std::string& getName() const { return name; }
+	inline const BodyState& getInitialState() const { return initial; }
+	inline float getMass() const { return mass; }
+	inline float getRadius() const { return radius; }
+	inline const glm::vec3& getColor() const { return color; }
 private:
 /* Private members. */
 	std::string name;
-	glm::vec2	position;
-	glm::vec2	velocity;
-	glm::vec2	force;
+	BodyState	initial;
 	float		mass;
 	float		radius;
+	glm::vec3	color;
 };
 
 #endif
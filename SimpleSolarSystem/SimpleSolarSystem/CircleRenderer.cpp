@@ -0,0 +1,97 @@
+#include "CircleRenderer.h"
+#include "OrbitalSystem.h"
+#include <cmath>
+
+/**
+ * Constructor for the CircleRenderer class. Loads the circle shader and sends
+ * the unit circle down to the graphics card.
+ */
+CircleRenderer::CircleRenderer() : m_shader("./res/circleShader")
+{
+	/* Unit circle, counter-clockwise so that it faces the viewer. */
+	std::vector<glm::vec2> circle;
+	for (int j = 0; j < VERTEX_COUNT; j++)
+	{
+		float angle = ( (double)j / VERTEX_COUNT ) * ( 2 * 3.1415 );
+		circle.push_back(glm::vec2(cosf(angle), sinf(angle)));
+	}
+
+	glGenVertexArrays(1, &m_vertexArrayObject);
+	glBindVertexArray(m_vertexArrayObject);
+
+	glGenBuffers(NUM_BUFFERS, m_vertexArrayBuffers);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[CIRCLE_VB]);
+	glBufferData(GL_ARRAY_BUFFER, ( circle.size() * sizeof(circle[0]) ), &circle[0], GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+	/* The other attributes advance once per circle rather than per vertex. */
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[INSTANCE_VB]);
+	enableInstanceAttribute("center", 2, 0);
+	enableInstanceAttribute("radius", 1, sizeof(glm::vec2));
+	enableInstanceAttribute("color", 3, sizeof(glm::vec2) + sizeof(float));
+
+	glBindVertexArray(0);
+}
+
+CircleRenderer::~CircleRenderer()
+{
+	glDeleteBuffers(NUM_BUFFERS, m_vertexArrayBuffers);
+	glDeleteVertexArrays(1, &m_vertexArrayObject);
+}
+
+/**
+ * Draws each body at its position in states with one instanced draw call.
+ *
+ * @param bodies
+ *			Bodies to draw, for their radii and colours.
+ * @param states
+ *			Positions of the bodies.
+ */
+void CircleRenderer::draw(const std::vector<Body>& bodies, const std::vector<BodyState>& states)
+{
+	if (bodies.empty())
+		return;
+
+	/* Gather the attributes of every circle into one buffer update. */
+	m_instances.resize(bodies.size());
+	for (unsigned int i = 0; i < bodies.size(); i++)
+	{
+		m_instances[i].center = states[i].position;
+		m_instances[i].radius = bodies[i].getRadius();
+		m_instances[i].color = bodies[i].getColor();
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexArrayBuffers[INSTANCE_VB]);
+	glBufferData(GL_ARRAY_BUFFER, ( m_instances.size() * sizeof(m_instances[0]) ), &m_instances[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_shader.bind();
+	glBindVertexArray(m_vertexArrayObject);
+	glDrawArraysInstanced(GL_TRIANGLE_FAN, 0, VERTEX_COUNT, m_instances.size());
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
+
+/**
+ * Points a shader attribute at one field of the instance buffer, advancing
+ * once per instance. Attributes the shader does not use are skipped.
+ *
+ * @param name
+ *			Name of the attribute in circleShader.vs.
+ * @param size
+ *			Number of floats in the attribute.
+ * @param offset
+ *			Offset of the field within a CircleInstance.
+ */
+void CircleRenderer::enableInstanceAttribute(const char* name, GLint size, size_t offset)
+{
+	GLint location = glGetAttribLocation(m_shader.getProgram(), name);
+	if (location < 0)
+		return;
+
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, sizeof(CircleInstance), (const GLvoid*)offset);
+	glVertexAttribDivisor(location, 1);
+}
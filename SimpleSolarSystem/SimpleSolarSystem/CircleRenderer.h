@@ -0,0 +1,48 @@
+#ifndef CIRCLERENDERER_H
+#define CIRCLERENDERER_H
+
+#include <glm\glm.hpp>
+#include <GL\glew.h>
+#include <vector>
+#include "Body.h"
+#include "Shader.h"
+
+/**
+ * Attributes of one circle: where it is, how big, and its colour.
+ */
+struct CircleInstance
+{
+	glm::vec2	center;
+	float		radius;
+	glm::vec3	color;
+};
+
+/**
+ * Draws every body as a filled circle in a single instanced draw call. The
+ * unit circle is computed and sent to the graphics card once; each frame
+ * only the centers, radii and colours of the bodies are sent down.
+ */
+class CircleRenderer
+{
+public:
+	CircleRenderer();
+	~CircleRenderer();
+	void draw(const std::vector<Body>& bodies, const std::vector<BodyState>& states);
+private:
+	CircleRenderer(const CircleRenderer&) : m_shader("") {}
+	void operator=(const CircleRenderer&) {}
+	void enableInstanceAttribute(const char* name, GLint size, size_t offset);
+	enum
+	{
+		CIRCLE_VB,
+		INSTANCE_VB,
+		NUM_BUFFERS
+	};
+
+	Shader m_shader;
+	GLuint m_vertexArrayObject;
+	GLuint m_vertexArrayBuffers[NUM_BUFFERS];
+	std::vector<CircleInstance> m_instances;
+};
+
+#endif // CIRCLERENDERER_H
@@ -3,6 +3,7 @@
 
 OrbitalSystem::OrbitalSystem()
 {
+	current = 0;
 }
 
 
@@ -10,17 +11,27 @@ OrbitalSystem::~OrbitalSystem()
 {
 }
 
-void OrbitalSystem::addBody(Body body)
+void OrbitalSystem::addBody(const Body& body)
 {
 	bodies.push_back(body);
+	states[0].push_back(body.getInitialState());
+	states[1].push_back(body.getInitialState());
 }
 
 void OrbitalSystem::update(double delta_t)
 {
+	const std::vector<BodyState>& previous = states[current];
+	std::vector<BodyState>& next = states[1 - current];
+
 	for (int i = 0; i < bodies.size(); i++)
 	{
-		bodies[i].calculateForce(bodies);
-		bodies[i].draw();
-		bodies[i].move(delta_t);
+		glm::vec2 force = bodies[i].calculateForce(i, bodies, previous);
+		bodies[i].move(previous[i], next[i], force, delta_t);
 	}
-}
\ No newline at end of file
+	current = 1 - current;
+}
+
+void OrbitalSystem::draw(CircleRenderer& renderer) const
+{
+	renderer.draw(bodies, states[current]);
+}
@@ -4,6 +4,7 @@
 #include <glm\glm.hpp>
 #include <vector>
 #include "Body.h"
+#include "CircleRenderer.h"
 
 /* Gravitational Constant */
 #define G					6.67384E-11	/*m^3 / (kg * s^2)*/
@@ -26,15 +27,25 @@
 #define SCALE				1.0E-6
 #define VERTEX_COUNT		50
 
+/**
+ * Collection of bodies updated in two phases from a pair of state buffers:
+ * every force is calculated from the previous buffer, which is only read,
+ * every body is integrated into the next buffer, and the two are swapped.
+ * No body sees another which has already moved, and nothing is copied.
+ */
 class OrbitalSystem
 {
 public:
 	OrbitalSystem();
 	~OrbitalSystem();
-	void addBody(Body body);
+	void addBody(const Body& body);
 	void update(double delta_t);
+	void draw(CircleRenderer& renderer) const;
 private:
 	std::vector<Body> bodies;
+	/* Previous and next states of the bodies, and which buffer is current. */
+	std::vector<BodyState> states[2];
+	int current;
 };
 
 #endif
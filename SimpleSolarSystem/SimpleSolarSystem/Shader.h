@@ -14,6 +14,7 @@ public:
 	~Shader();
 	void bind();
 	void update(const Transform& transform, const Camera& camera);
+	inline GLuint getProgram() const { return m_program; }
 
 private:
 /* Private members. */
@@ -11,6 +11,7 @@
 #include "Input.h"
 #include "Body.h"
 #include "OrbitalSystem.h"
+#include "CircleRenderer.h"
 #include <ctime>
 
 /**
@@ -59,6 +60,7 @@ int main(int argc, char** argv)
 	bool closeWindow = false;
 
 	OrbitalSystem system;
+	CircleRenderer renderer;
 	Body sun("Sun", 0, 0, 0, 0, SUN_MASS * SCALE, SUN_RADIUS * SCALE * 12);
 	Body earth("Earth", -( EARTH_TO_SUN * SCALE ), 0, 0, sqrt(G * ( SUN_MASS / EARTH_TO_SUN ) * SCALE), EARTH_MASS * SCALE, SUN_RADIUS * SCALE * 6);
 	Body mars("Mars", ( MARS_TO_SUN * SCALE ), 0, 0, -sqrt(G * ( SUN_MASS / MARS_TO_SUN ) * SCALE), MARS_MASS * SCALE, SUN_RADIUS * SCALE * 6);
@@ -83,6 +85,7 @@ int main(int argc, char** argv)
 		//transform.getScale().x = 0.2;
 		//transform.getScale().y = 0.2;
 		system.update(1.0/CLOCKS_PER_SEC * 1000);
+		system.draw(renderer);
 		display.update();
 	}
 
@@ -0,0 +1,8 @@
+#version 120
+
+varying vec3 color0;
+
+void main()
+{
+	gl_FragColor = vec4(color0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 120
+
+attribute vec2 position;
+attribute vec2 center;
+attribute float radius;
+attribute vec3 color;
+
+varying vec3 color0;
+
+void main()
+{
+	gl_Position = gl_ModelViewProjectionMatrix * vec4(center + radius * position, 0.0, 1.0);
+	color0 = color;
+}
\ No newline at end of file